@@ -0,0 +1,1632 @@
+/*aot.c*/
+
+//
+// Ahead-of-time compiler from nuPython to native code; see aot.h.
+//
+// A program is translated into C functions, after a prelude of
+// helpers that implement the executor's operators. Variable #k of
+// the program is held in a frame, in f->v[k] (its value) and f->a[k]
+// (its address in memory, or -1 while it's not defined), e.g. for
+//
+//   x = y * 2.5
+//
+// with y proven to be an int:
+//
+//   {
+//     struct RAM_VALUE t;
+//     if (!real_operator(rt, 7, OPERATOR_ASTERISK, (double)f->v[1].types.i, 0x1.4p+1, &t)) goto failed;
+//     assign(rt, &f->v[0], &f->a[0], names[0], t);
+//   }
+//
+// The program's top-level statements are split into functions of
+// at most CHUNK_SIZE statements, chunk0(), chunk1(), ..., since C
+// compilers take time and memory out of all proportion to the size
+// of a function when it's very large. Each top-level loop is a
+// function of its own, loop0(), loop1(), ..., which holds the
+// variables it uses in locals vk and ak while it runs, so that
+// they can be kept in registers.
+//
+// A variable is written to memory when it's first assigned, so
+// memory holds the variables in the same order as when the program
+// is executed, and then when the program ends, or control passes
+// to the executor.
+//
+
+// mkstemp(), mkdir(), open_memstream() and dlopen() are POSIX:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdarg.h>  // va_list
+#include <string.h>
+#include <math.h>     // isnan, isinf, signbit
+#include <limits.h>   // INT_MIN
+#include <errno.h>
+#include <dlfcn.h>    // dlopen, dlsym, dlclose
+#include <unistd.h>   // close, unlink
+#include <sys/stat.h> // mkdir
+
+#include "aot.h"
+#include "execute.h"
+#include "graphcache.h"
+#include "builtins.h"
+#include "ram.h"
+#include "util.h"
+
+//
+// SHARED(declarations) declares them here, and also keeps their
+// text for the generated code, so both sides agree on them:
+//
+#define SHARED(...)   \
+  __VA_ARGS__         \
+  static const char shared_declarations[] = #__VA_ARGS__;
+
+//
+// What the generated code calls back into, and what it's given
+// to run with:
+//
+SHARED(
+struct AotRuntime
+{
+  void *interp;
+  FILE *output;
+  void **stmts;
+  int (*define)(void *interp, const char *name, struct RAM_VALUE value);
+  int (*load)(void *interp, const char *name, struct RAM_VALUE *value);
+  void (*store)(void *interp, int address, struct RAM_VALUE value);
+  int (*operator)(void *interp, int line, int operator, struct RAM_VALUE lhs, struct RAM_VALUE rhs, struct RAM_VALUE *result);
+  int (*execute)(void *interp, void *stmt);
+};
+)
+
+//
+// The start of every generated file, after the definitions of the
+// RAM_TYPE_ and OPERATOR_ constants. struct RAM_VALUE is as in
+// ram.h, which aot_compile checks via nupy_value_size.
+//
+static const char prelude[] =
+  "#include <stdio.h>\n"
+  "#include <stdlib.h>\n"
+  "#include <string.h>\n"
+  "#include <math.h>\n"
+  "\n"
+  "struct RAM_VALUE\n"
+  "{\n"
+  "  int value_type;\n"
+  "  union\n"
+  "  {\n"
+  "    int i;\n"
+  "    double d;\n"
+  "    char *s;\n"
+  "  } types;\n"
+  "};\n"
+  "\n"
+  "const int nupy_value_size = (int)sizeof(struct RAM_VALUE);\n"
+  "\n"
+  "%s\n" // shared_declarations
+  "\n"
+  "static struct RAM_VALUE int_value(int i) { struct RAM_VALUE v; v.value_type = RAM_TYPE_INT; v.types.i = i; return v; }\n"
+  "static struct RAM_VALUE real_value(double d) { struct RAM_VALUE v; v.value_type = RAM_TYPE_REAL; v.types.d = d; return v; }\n"
+  "static struct RAM_VALUE str_value(char *s) { struct RAM_VALUE v; v.value_type = RAM_TYPE_STR; v.types.s = s; return v; }\n"
+  "static struct RAM_VALUE bool_value(int i) { struct RAM_VALUE v; v.value_type = RAM_TYPE_BOOLEAN; v.types.i = i; return v; }\n"
+  "\n"
+  "static char *concat(const char *s1, const char *s2)\n"
+  "{\n"
+  "  size_t n1 = strlen(s1), n2 = strlen(s2);\n"
+  "  char *s = (char *)malloc(n1 + n2 + 1);\n"
+  "  memcpy(s, s1, n1);\n"
+  "  memcpy(s + n1, s2, n2 + 1);\n"
+  "  return s;\n"
+  "}\n"
+  "\n"
+  "static struct RAM_VALUE copy(struct RAM_VALUE v)\n"
+  "{\n"
+  "  if (v.value_type == RAM_TYPE_STR)\n"
+  "    v.types.s = concat(v.types.s, \"\");\n"
+  "  return v;\n"
+  "}\n"
+  "\n"
+  "static void release(struct RAM_VALUE v)\n"
+  "{\n"
+  "  if (v.value_type == RAM_TYPE_STR)\n"
+  "    free(v.types.s);\n"
+  "}\n"
+  "\n"
+  "static void assign(struct AotRuntime *rt, struct RAM_VALUE *var, int *address, const char *name, struct RAM_VALUE value)\n"
+  "{\n"
+  "  release(*var);\n"
+  "  *var = value;\n"
+  "  if (*address < 0)\n"
+  "    *address = rt->define(rt->interp, name, value);\n"
+  "}\n"
+  "\n"
+  "static int reload(struct AotRuntime *rt, const char *name, struct RAM_VALUE *var)\n"
+  "{\n"
+  "  release(*var);\n"
+  "  var->value_type = RAM_TYPE_NONE;\n"
+  "  return rt->load(rt->interp, name, var);\n"
+  "}\n"
+  "\n"
+  "static void undefined(struct AotRuntime *rt, const char *name, int line)\n"
+  "{\n"
+  "  fprintf(rt->output, \"**SEMANTIC ERROR: name '%%s' is not defined (line %%d)\\n\", name, line);\n"
+  "}\n"
+  "\n"
+  "static int invalid(struct AotRuntime *rt, int line)\n"
+  "{\n"
+  "  fprintf(rt->output, \"**SEMANTIC ERROR: invalid operand types (line %%d)\\n\", line);\n"
+  "  return 0;\n"
+  "}\n"
+  "\n"
+  "static int division_by_zero(struct AotRuntime *rt, int line)\n"
+  "{\n"
+  "  fprintf(rt->output, \"**EXECUTION ERROR: division by zero (line %%d)\\n\", line);\n"
+  "  return 0;\n"
+  "}\n"
+  "\n"
+  "static void invalid_range(struct AotRuntime *rt, int line)\n"
+  "{\n"
+  "  fprintf(rt->output, \"**SEMANTIC ERROR: Invalid parameter for range() (line %%d)\\n\", line);\n"
+  "}\n"
+  "\n"
+  "static void zero_step(struct AotRuntime *rt, int line)\n"
+  "{\n"
+  "  fprintf(rt->output, \"**EXECUTION ERROR: range() arg 3 must not be zero (line %%d)\\n\", line);\n"
+  "}\n"
+  "\n"
+  "static int int_operator(struct AotRuntime *rt, int line, int operator, int lhs, int rhs, struct RAM_VALUE *result)\n"
+  "{\n"
+  "  volatile double power; // converted to an int at run time, as the executor does\n"
+  "  result->value_type = RAM_TYPE_INT;\n"
+  "  switch (operator)\n"
+  "  {\n"
+  "  case OPERATOR_PLUS: result->types.i = lhs + rhs; return 1;\n"
+  "  case OPERATOR_MINUS: result->types.i = lhs - rhs; return 1;\n"
+  "  case OPERATOR_ASTERISK: result->types.i = lhs * rhs; return 1;\n"
+  "  case OPERATOR_POWER: power = pow(lhs, rhs); result->types.i = power; return 1;\n"
+  "  case OPERATOR_DIV: if (rhs == 0) return division_by_zero(rt, line); result->types.i = (rhs == -1) ? (int)(0u - (unsigned)lhs) : lhs / rhs; return 1;\n"
+  "  case OPERATOR_MOD: if (rhs == 0) return division_by_zero(rt, line); result->types.i = (rhs == -1) ? 0 : lhs %% rhs; return 1;\n"
+  "  }\n"
+  "  result->value_type = RAM_TYPE_BOOLEAN;\n"
+  "  switch (operator)\n"
+  "  {\n"
+  "  case OPERATOR_EQUAL: result->types.i = lhs == rhs; return 1;\n"
+  "  case OPERATOR_NOT_EQUAL: result->types.i = lhs != rhs; return 1;\n"
+  "  case OPERATOR_LT: result->types.i = lhs < rhs; return 1;\n"
+  "  case OPERATOR_LTE: result->types.i = lhs <= rhs; return 1;\n"
+  "  case OPERATOR_GT: result->types.i = lhs > rhs; return 1;\n"
+  "  case OPERATOR_GTE: result->types.i = lhs >= rhs; return 1;\n"
+  "  }\n"
+  "  return invalid(rt, line);\n"
+  "}\n"
+  "\n"
+  "static int real_operator(struct AotRuntime *rt, int line, int operator, double lhs, double rhs, struct RAM_VALUE *result)\n"
+  "{\n"
+  "  result->value_type = RAM_TYPE_REAL;\n"
+  "  switch (operator)\n"
+  "  {\n"
+  "  case OPERATOR_PLUS: result->types.d = lhs + rhs; return 1;\n"
+  "  case OPERATOR_MINUS: result->types.d = lhs - rhs; return 1;\n"
+  "  case OPERATOR_ASTERISK: result->types.d = lhs * rhs; return 1;\n"
+  "  case OPERATOR_POWER: result->types.d = pow(lhs, rhs); return 1;\n"
+  "  case OPERATOR_DIV: if (rhs == 0.0) return division_by_zero(rt, line); result->types.d = lhs / rhs; return 1;\n"
+  "  case OPERATOR_MOD: if (rhs == 0.0) return division_by_zero(rt, line); result->types.d = fmod(lhs, rhs); return 1;\n"
+  "  }\n"
+  "  result->value_type = RAM_TYPE_BOOLEAN;\n"
+  "  switch (operator)\n"
+  "  {\n"
+  "  case OPERATOR_EQUAL: result->types.i = fabs(lhs - rhs) < 0.001; return 1;\n"
+  "  case OPERATOR_NOT_EQUAL: result->types.i = fabs(lhs - rhs) > 0.001; return 1;\n"
+  "  case OPERATOR_LT: result->types.i = lhs < rhs; return 1;\n"
+  "  case OPERATOR_LTE: result->types.i = lhs <= rhs + 0.0001; return 1;\n"
+  "  case OPERATOR_GT: result->types.i = lhs > rhs + 0.0001; return 1;\n"
+  "  case OPERATOR_GTE: result->types.i = lhs > rhs - 0.0001; return 1;\n"
+  "  }\n"
+  "  return invalid(rt, line);\n"
+  "}\n"
+  "\n"
+  "static int str_operator(struct AotRuntime *rt, int line, int operator, char *lhs, char *rhs, struct RAM_VALUE *result)\n"
+  "{\n"
+  "  if (operator == OPERATOR_PLUS) { *result = str_value(concat(lhs, rhs)); return 1; }\n"
+  "  result->value_type = RAM_TYPE_BOOLEAN;\n"
+  "  if (operator == OPERATOR_IN) { result->types.i = strstr(rhs, lhs) != NULL; return 1; }\n"
+  "  int cmp = strcmp(lhs, rhs);\n"
+  "  switch (operator)\n"
+  "  {\n"
+  "  case OPERATOR_EQUAL: result->types.i = cmp == 0; return 1;\n"
+  "  case OPERATOR_NOT_EQUAL: result->types.i = cmp != 0; return 1;\n"
+  "  case OPERATOR_LT: result->types.i = cmp < 0; return 1;\n"
+  "  case OPERATOR_LTE: result->types.i = cmp <= 0; return 1;\n"
+  "  case OPERATOR_GT: result->types.i = cmp > 0; return 1;\n"
+  "  case OPERATOR_GTE: result->types.i = cmp >= 0; return 1;\n"
+  "  }\n"
+  "  return invalid(rt, line);\n"
+  "}\n"
+  "\n"
+  "static int any_operator(struct AotRuntime *rt, int line, int operator, struct RAM_VALUE lhs, struct RAM_VALUE rhs, struct RAM_VALUE *result)\n"
+  "{\n"
+  "  int l = lhs.value_type, r = rhs.value_type;\n"
+  "  if (l == RAM_TYPE_INT && r == RAM_TYPE_INT)\n"
+  "    return int_operator(rt, line, operator, lhs.types.i, rhs.types.i, result);\n"
+  "  if ((l == RAM_TYPE_INT || l == RAM_TYPE_REAL) && (r == RAM_TYPE_INT || r == RAM_TYPE_REAL))\n"
+  "    return real_operator(rt, line, operator, (l == RAM_TYPE_INT) ? lhs.types.i : lhs.types.d,\n"
+  "                         (r == RAM_TYPE_INT) ? rhs.types.i : rhs.types.d, result);\n"
+  "  if (l == RAM_TYPE_STR && r == RAM_TYPE_STR)\n"
+  "    return str_operator(rt, line, operator, lhs.types.s, rhs.types.s, result);\n"
+  "  return rt->operator(rt->interp, line, operator, lhs, rhs, result);\n"
+  "}\n"
+  "\n"
+  "static int print_value(struct AotRuntime *rt, struct RAM_VALUE v)\n"
+  "{\n"
+  "  switch (v.value_type)\n"
+  "  {\n"
+  "  case RAM_TYPE_BOOLEAN: fprintf(rt->output, \"%%s\\n\", v.types.i ? \"True\" : \"False\"); return 1;\n"
+  "  case RAM_TYPE_INT: fprintf(rt->output, \"%%d\\n\", v.types.i); return 1;\n"
+  "  case RAM_TYPE_REAL: fprintf(rt->output, \"%%lf\\n\", v.types.d); return 1;\n"
+  "  case RAM_TYPE_STR: fprintf(rt->output, \"%%s\\n\", v.types.s); return 1;\n"
+  "  }\n"
+  "  fprintf(rt->output, \"**ERROR: Unsupported data type in print statement\\n\");\n"
+  "  return 0;\n"
+  "}\n";
+
+//
+// Names of the operators, as the prelude defines them:
+//
+static const char *operator_names[] = {
+    "OPERATOR_PLUS", "OPERATOR_MINUS", "OPERATOR_ASTERISK", "OPERATOR_POWER", "OPERATOR_MOD",
+    "OPERATOR_DIV", "OPERATOR_EQUAL", "OPERATOR_NOT_EQUAL", "OPERATOR_LT", "OPERATOR_LTE",
+    "OPERATOR_GT", "OPERATOR_GTE", "OPERATOR_IS", "OPERATOR_IN", "OPERATOR_NO_OP"};
+
+//
+// A program being translated:
+//
+#define CHUNK_SIZE 64
+
+//
+// Programs of more statements than this aren't compiled, as that
+// would take far longer than executing them: code that size is
+// almost all run just once.
+//
+#define MAX_STMTS 4096
+
+struct Translator
+{
+  FILE *out;            // body of the function being translated
+  FILE *functions;      // the functions translated so far
+  int depth;            // of indentation
+
+  char **vars;          // the program's variables, #0, #1, ...
+  int num_vars;
+  int vars_capacity;
+
+  int *marks;           // marks[k] == loop if the loop uses #k
+  int marks_capacity;
+
+  int loop;             // # of the loop function being translated, or -1
+  int num_loops;
+  int num_chunks;
+  int num_translated;   // statements, up to MAX_STMTS
+
+  struct STMT **stmts;  // statements run by the executor,
+  int num_stmts;        // rt->stmts[0], ...
+  int stmts_capacity;
+
+  bool functions_defined; // values may be lists and dictionaries
+  bool failed;          // can't be translated, or out of memory
+
+  int live;             // temporaries s[0], ... of the expression (see translate_steps)
+  char fail[80];        // see jump_failed
+};
+
+struct AotProgram
+{
+  void *library;                       // from dlopen()
+  int (*entry)(struct AotRuntime *rt); // nupy_program()
+  struct STMT **stmts;                 // see struct Translator
+};
+
+//
+// Private functions:
+//
+
+//
+// runtime_*
+//
+// The functions in the AotRuntime that generated code calls.
+//
+static int runtime_define(void *interp, const char *name, struct RAM_VALUE value)
+{
+  struct RAM *memory = ((struct Interpreter *)interp)->memory;
+
+  ram_write_cell_by_id(memory, value, (char *)name);
+
+  return ram_get_addr(memory, (char *)name);
+}
+
+static int runtime_load(void *interp, const char *name, struct RAM_VALUE *value)
+{
+  struct RAM *memory = ((struct Interpreter *)interp)->memory;
+  int address = ram_get_addr(memory, (char *)name);
+
+  if (address >= 0)
+  {
+    *value = memory->cells[address].value;
+
+    if (value->value_type == RAM_TYPE_STR)
+      value->types.s = dupString(value->types.s);
+  }
+
+  return address;
+}
+
+static void runtime_store(void *interp, int address, struct RAM_VALUE value)
+{
+  ram_write_cell_by_addr(((struct Interpreter *)interp)->memory, value, address);
+}
+
+static int runtime_operator(void *interp, int line, int operator, struct RAM_VALUE lhs, struct RAM_VALUE rhs, struct RAM_VALUE *result)
+{
+  struct STMT stmt; // just for its line #, in error messages
+
+  memset(&stmt, 0, sizeof(stmt));
+  stmt.line = line;
+
+  return execute_operator((struct Interpreter *)interp, &stmt, operator, lhs, rhs, result);
+}
+
+static int runtime_execute(void *interp, void *stmt)
+{
+  return execute_statement((struct Interpreter *)interp, (struct STMT *)stmt);
+}
+
+//
+// grow
+//
+// Makes room for one more element at the end of the array,
+// returning false if out of memory.
+//
+static bool grow(void **array, int count, int *capacity, size_t element_size)
+{
+  if (count < *capacity)
+    return true;
+
+  int new_capacity = (*capacity == 0) ? 16 : 2 * *capacity;
+  void *grown = realloc(*array, new_capacity * element_size);
+
+  if (grown == NULL)
+    return false;
+
+  *array = grown;
+  *capacity = new_capacity;
+
+  return true;
+}
+
+//
+// var_index
+//
+// Returns the # of the variable with the given name, adding it
+// the first time it's seen.
+//
+static int var_index(struct Translator *t, char *name)
+{
+  for (int v = 0; v < t->num_vars; v++)
+    if (strcmp(t->vars[v], name) == 0)
+      return v;
+
+  if (!grow((void **)&t->vars, t->num_vars, &t->vars_capacity, sizeof(char *)) ||
+      !grow((void **)&t->marks, t->num_vars, &t->marks_capacity, sizeof(int)))
+  {
+    t->failed = true;
+    return 0;
+  }
+
+  t->vars[t->num_vars] = name;
+  t->marks[t->num_vars] = -1;
+
+  return t->num_vars++;
+}
+
+//
+// is_variable
+//
+// True if reading the element reads memory: identifiers, and
+// None, which the executor looks up like one.
+//
+static bool is_variable(struct ELEMENT *element)
+{
+  return element->element_type == ELEMENT_IDENTIFIER || element->element_type == ELEMENT_NONE;
+}
+
+//
+// ref
+//
+// Returns how a variable's value ('v') or address ('a') is referred
+// to in the function being translated: as a local in a loop
+// function, which then uses the variable, else in the frame.
+//
+struct Ref
+{
+  char text[32];
+};
+
+static struct Ref ref(struct Translator *t, char kind, int v)
+{
+  struct Ref r;
+
+  if (t->loop >= 0)
+  {
+    t->marks[v] = t->loop;
+    snprintf(r.text, sizeof(r.text), "%c%d", kind, v);
+  }
+  else
+  {
+    snprintf(r.text, sizeof(r.text), "f->%c[%d]", kind, v);
+  }
+
+  return r;
+}
+
+//
+// emit_line
+//
+// Appends a line of the function body, indented.
+//
+static void emit_line(struct Translator *t, const char *format, ...)
+{
+  va_list args;
+
+  fprintf(t->out, "%*s", 2 * t->depth, "");
+
+  va_start(args, format);
+  vfprintf(t->out, format, args);
+  va_end(args);
+
+  fputc('\n', t->out);
+}
+
+//
+// emit_string, emit_int, emit_real
+//
+// Append C literals with the given values.
+//
+static void emit_string(FILE *out, const char *s)
+{
+  fputc('"', out);
+
+  for (; *s != '\0'; s++)
+  {
+    unsigned char c = (unsigned char)*s;
+
+    if (c == '"' || c == '\\')
+      fprintf(out, "\\%c", c);
+    else if (c < ' ' || c > '~')
+      fprintf(out, "\\%03o", c);
+    else
+      fputc(c, out);
+  }
+
+  fputc('"', out);
+}
+
+static void emit_int(FILE *out, int i)
+{
+  if (i == INT_MIN)
+    fprintf(out, "(%d - 1)", INT_MIN + 1);
+  else
+    fprintf(out, "%d", i);
+}
+
+static void emit_real(FILE *out, double d)
+{
+  if (isnan(d))
+    fputs(signbit(d) ? "(-NAN)" : "NAN", out);
+  else if (isinf(d))
+    fputs((d > 0) ? "HUGE_VAL" : "(-HUGE_VAL)", out);
+  else
+    fprintf(out, "%a", d);
+}
+
+//
+// jump_failed
+//
+// Returns the statement jumping to failed, which first releases
+// the live temporaries of an expression being evaluated.
+//
+static const char *jump_failed(struct Translator *t)
+{
+  if (t->live == 0)
+    return "goto failed;";
+
+  snprintf(t->fail, sizeof(t->fail), "{ for (int k = 0; k < %d; k++) release(s[k]); goto failed; }", t->live);
+
+  return t->fail;
+}
+
+//
+// emit_check
+//
+// Appends the check that a variable has been assigned before it's
+// read, unless that's been proven (see optimizer_types).
+//
+static void emit_check(struct Translator *t, struct ELEMENT *element, int line)
+{
+  if (!is_variable(element) || element->defined == ELEMENT_DEFINED_ALWAYS)
+    return;
+
+  int v = var_index(t, element->element_value);
+
+  emit_line(t, "if (%s < 0) { undefined(rt, names[%d], %d); %s }", ref(t, 'a', v).text, v, line, jump_failed(t));
+}
+
+//
+// emit_native
+//
+// Appends the value of an element, whose type is known to be the
+// given one, as a C int, double or char *.
+//
+static void emit_native(struct Translator *t, struct ELEMENT *element, int type)
+{
+  if (is_variable(element))
+    fprintf(t->out, "%s.types.%c", ref(t, 'v', var_index(t, element->element_value)).text,
+            (type == RAM_TYPE_INT) ? 'i' : (type == RAM_TYPE_REAL) ? 'd' : 's');
+  else if (element->element_type == ELEMENT_INT_LITERAL)
+    emit_int(t->out, atoi(element->element_value));
+  else if (element->element_type == ELEMENT_REAL_LITERAL)
+    emit_real(t->out, atof(element->element_value));
+  else
+    emit_string(t->out, element->element_value);
+}
+
+//
+// emit_value
+//
+// Appends the value of an element as a struct RAM_VALUE; a string
+// is not copied.
+//
+static void emit_value(struct Translator *t, struct ELEMENT *element)
+{
+  switch (element->element_type)
+  {
+  case ELEMENT_INT_LITERAL:
+    fputs("int_value(", t->out);
+    emit_int(t->out, atoi(element->element_value));
+    break;
+  case ELEMENT_REAL_LITERAL:
+    fputs("real_value(", t->out);
+    emit_real(t->out, atof(element->element_value));
+    break;
+  case ELEMENT_STR_LITERAL:
+    fputs("str_value(", t->out);
+    emit_string(t->out, element->element_value);
+    break;
+  case ELEMENT_TRUE:
+  case ELEMENT_FALSE:
+    fprintf(t->out, "bool_value(%d", (element->element_type == ELEMENT_TRUE) ? 1 : 0);
+    break;
+  default:
+    fputs(ref(t, 'v', var_index(t, element->element_value)).text, t->out);
+    return;
+  }
+
+  fputc(')', t->out);
+}
+
+//
+// translate_operator
+//
+// Appends code applying the binary expression's operator into the
+// given struct RAM_VALUE, or jumping to failed. An operand is an
+// element, or else the temporary s[lhs_at] or s[rhs_at], passed
+// as a struct RAM_VALUE if type is -1, else as a C value.
+//
+static void translate_operand(struct Translator *t, struct UNARY_EXPR *unary, int at, int type)
+{
+  if (unary->expr_type == UNARY_ELEMENT && type < 0)
+    emit_value(t, unary->element);
+  else if (unary->expr_type == UNARY_ELEMENT)
+    emit_native(t, unary->element, type);
+  else if (type < 0)
+    fprintf(t->out, "s[%d]", at);
+  else
+    fprintf(t->out, "s[%d].types.%c", at, (type == RAM_TYPE_INT) ? 'i' : (type == RAM_TYPE_REAL) ? 'd' : 's');
+}
+
+static void translate_operator(struct Translator *t, struct STMT *stmt, struct VALUE_EXPR *expr, int lhs_at, int rhs_at, const char *into)
+{
+  fprintf(t->out, "%*sif (!", 2 * t->depth, "");
+
+  //
+  // operands of proven types are passed as C values, promoting an
+  // int to a real as the executor does:
+  //
+  static const int lhs_types[] = {0, RAM_TYPE_INT, RAM_TYPE_INT, RAM_TYPE_REAL, RAM_TYPE_REAL, RAM_TYPE_STR};
+  static const int rhs_types[] = {0, RAM_TYPE_INT, RAM_TYPE_REAL, RAM_TYPE_INT, RAM_TYPE_REAL, RAM_TYPE_STR};
+
+  if (expr->types == EXPR_TYPES_UNKNOWN)
+  {
+    fprintf(t->out, "any_operator(rt, %d, %s, ", stmt->line, operator_names[expr->operator]);
+    translate_operand(t, expr->lhs, lhs_at, -1);
+    fputs(", ", t->out);
+    translate_operand(t, expr->rhs, rhs_at, -1);
+  }
+  else
+  {
+    const char *function = (expr->types == EXPR_TYPES_INT_INT) ? "int_operator" : (expr->types == EXPR_TYPES_STR_STR) ? "str_operator" : "real_operator";
+    bool promote_lhs = (expr->types == EXPR_TYPES_INT_REAL);
+    bool promote_rhs = (expr->types == EXPR_TYPES_REAL_INT);
+
+    fprintf(t->out, "%s(rt, %d, %s, %s", function, stmt->line, operator_names[expr->operator], promote_lhs ? "(double)" : "");
+    translate_operand(t, expr->lhs, lhs_at, lhs_types[expr->types]);
+    fprintf(t->out, ", %s", promote_rhs ? "(double)" : "");
+    translate_operand(t, expr->rhs, rhs_at, rhs_types[expr->types]);
+  }
+
+  fprintf(t->out, ", &%s)) %s\n", into, jump_failed(t));
+}
+
+//
+// translate_steps
+//
+// Appends code evaluating an expression lowered to steps (see
+// VALUE_EXPR) into the given struct RAM_VALUE, with its stack of
+// values in the temporaries s[0], s[1], ...: a step reads its
+// nested operands from the topmost ones, releasing them once it's
+// evaluated, and its value then replaces them (via o).
+//
+static void translate_steps(struct Translator *t, struct STMT *stmt, struct VALUE_EXPR *expr, const char *into)
+{
+  int depth = 0, max_depth = 1;
+
+  for (int i = 0; i <= expr->num_steps; i++)
+  {
+    struct VALUE_EXPR *step = (i < expr->num_steps) ? &expr->steps[i] : expr;
+    bool nested_lhs = (step->lhs->expr_type == UNARY_NESTED);
+    bool nested_rhs = step->isBinaryExpr && step->rhs->expr_type == UNARY_NESTED;
+
+    if ((!nested_lhs && step->lhs->expr_type != UNARY_ELEMENT) || (!step->isBinaryExpr && nested_lhs) ||
+        (step->isBinaryExpr && !nested_rhs && step->rhs->expr_type != UNARY_ELEMENT))
+    {
+      t->failed = true; // the executor only has elements
+      return;
+    }
+
+    depth += 1 - nested_lhs - nested_rhs;
+    max_depth = (depth > max_depth) ? depth : max_depth;
+  }
+
+  emit_line(t, "{");
+  t->depth++;
+  emit_line(t, "struct RAM_VALUE s[%d], o;", max_depth);
+
+  depth = 0;
+
+  for (int i = 0; i <= expr->num_steps; i++)
+  {
+    struct VALUE_EXPR *step = (i < expr->num_steps) ? &expr->steps[i] : expr;
+    bool nested_lhs = (step->lhs->expr_type == UNARY_NESTED);
+    bool nested_rhs = step->isBinaryExpr && step->rhs->expr_type == UNARY_NESTED;
+
+    t->live = depth; // the operands are released after the step
+
+    int rhs_at = nested_rhs ? --depth : -1;
+    int lhs_at = nested_lhs ? --depth : -1;
+
+    char target[32];
+
+    if (step == expr)
+      snprintf(target, sizeof(target), "%s", into);
+    else if (nested_lhs || nested_rhs)
+      snprintf(target, sizeof(target), "o");
+    else
+      snprintf(target, sizeof(target), "s[%d]", depth);
+
+    if (!nested_lhs)
+      emit_check(t, step->lhs->element, stmt->line);
+
+    if (!step->isBinaryExpr)
+    {
+      fprintf(t->out, "%*s%s = copy(", 2 * t->depth, "", target);
+      emit_value(t, step->lhs->element);
+      fputs(");\n", t->out);
+    }
+    else
+    {
+      if (!nested_rhs)
+        emit_check(t, step->rhs->element, stmt->line);
+
+      translate_operator(t, stmt, step, lhs_at, rhs_at, target);
+    }
+
+    if (nested_lhs)
+      emit_line(t, "release(s[%d]);", lhs_at);
+    if (nested_rhs)
+      emit_line(t, "release(s[%d]);", rhs_at);
+    if (step != expr && (nested_lhs || nested_rhs))
+      emit_line(t, "s[%d] = o;", depth);
+
+    if (step != expr)
+      depth++;
+  }
+
+  t->live = 0;
+  t->depth--;
+  emit_line(t, "}");
+}
+
+//
+// translate_expr
+//
+// Appends code evaluating the expression into the given struct
+// RAM_VALUE, which then owns any string, or jumping to failed
+// after an error message, in the same order as the executor.
+//
+static void translate_expr(struct Translator *t, struct STMT *stmt, struct VALUE_EXPR *expr, const char *into)
+{
+  if (expr->num_steps > 0)
+  {
+    translate_steps(t, stmt, expr, into);
+    return;
+  }
+
+  if (expr->lhs->expr_type != UNARY_ELEMENT || (expr->isBinaryExpr && expr->rhs->expr_type != UNARY_ELEMENT))
+  {
+    t->failed = true; // the executor only has elements
+    return;
+  }
+
+  struct ELEMENT *lhs = expr->lhs->element;
+
+  emit_check(t, lhs, stmt->line);
+
+  if (!expr->isBinaryExpr)
+  {
+    fprintf(t->out, "%*s%s = copy(", 2 * t->depth, "", into);
+    emit_value(t, lhs);
+    fputs(");\n", t->out);
+    return;
+  }
+
+  emit_check(t, expr->rhs->element, stmt->line);
+
+  translate_operator(t, stmt, expr, -1, -1, into);
+}
+
+//
+// translate_executed
+//
+// Appends code handing the statement to the executor, with the
+// variables in memory while it runs; frame_out() and frame_in()
+// move them between the frame and memory, SAVEn and LOADn between
+// loop function #n's locals and the frame.
+//
+static void translate_executed(struct Translator *t, struct STMT *stmt)
+{
+  if (!grow((void **)&t->stmts, t->num_stmts, &t->stmts_capacity, sizeof(struct STMT *)))
+  {
+    t->failed = true;
+    return;
+  }
+
+  t->stmts[t->num_stmts] = stmt;
+
+  if (t->loop >= 0)
+    emit_line(t, "SAVE%d;", t->loop);
+  emit_line(t, "frame_out(rt, f);");
+  emit_line(t, "r = rt->execute(rt->interp, rt->stmts[%d]);", t->num_stmts);
+  emit_line(t, "frame_in(rt, f);");
+  if (t->loop >= 0)
+    emit_line(t, "LOAD%d;", t->loop);
+  emit_line(t, "if (!r) goto failed;");
+
+  t->num_stmts++;
+}
+
+static void translate_stmts(struct Translator *t, struct STMT *stmt, struct STMT *end);
+
+//
+// translate_assignment
+//
+static void translate_assignment(struct Translator *t, struct STMT *stmt)
+{
+  struct STMT_ASSIGNMENT *assignment = stmt->types.assignment;
+
+  if (assignment->index != NULL || assignment->rhs->value_type == VALUE_LIST || assignment->rhs->value_type == VALUE_DICT)
+  {
+    t->failed = true; // lists and dictionaries are left to the executor
+    return;
+  }
+
+  if (assignment->isPtrDeref || assignment->rhs->value_type != VALUE_EXPR) // e.g. input()
+  {
+    translate_executed(t, stmt);
+    return;
+  }
+
+  int v = var_index(t, assignment->var_name);
+
+  emit_line(t, "{");
+  t->depth++;
+  emit_line(t, "struct RAM_VALUE t;");
+  translate_expr(t, stmt, assignment->rhs->types.expr, "t");
+  emit_line(t, "assign(rt, &%s, &%s, names[%d], t);", ref(t, 'v', v).text, ref(t, 'a', v).text, v);
+  t->depth--;
+  emit_line(t, "}");
+}
+
+//
+// translate_print
+//
+static void translate_print(struct Translator *t, struct STMT *stmt)
+{
+  struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+  struct ELEMENT *parameter = (call->num_parameters > 0) ? call->parameters[0] : NULL;
+
+  if (call->object != NULL)
+  {
+    t->failed = true; // lists are left to the executor
+    return;
+  }
+
+  if (call->function != NULL || call->builtin != BUILTIN_PRINT)
+  {
+    translate_executed(t, stmt);
+    return;
+  }
+
+  if (parameter == NULL)
+  {
+    emit_line(t, "fputs(\"\\n\", rt->output);");
+    return;
+  }
+
+  if (is_variable(parameter) && t->functions_defined) // may be a list, which the executor prints
+  {
+    translate_executed(t, stmt);
+    return;
+  }
+
+  if (is_variable(parameter))
+  {
+    emit_check(t, parameter, stmt->line);
+    emit_line(t, "if (!print_value(rt, %s)) goto failed;", ref(t, 'v', var_index(t, parameter->element_value)).text);
+    return;
+  }
+
+  //
+  // literals, as the executor prints them:
+  //
+  const char *format = (parameter->element_type == ELEMENT_INT_LITERAL) ? "%d" : (parameter->element_type == ELEMENT_REAL_LITERAL) ? "%lf" : "%s";
+
+  fprintf(t->out, "%*sfprintf(rt->output, \"%s\\n\", ", 2 * t->depth, "", format);
+
+  if (parameter->element_type == ELEMENT_INT_LITERAL)
+    emit_int(t->out, atoi(parameter->element_value));
+  else if (parameter->element_type == ELEMENT_REAL_LITERAL)
+    emit_real(t->out, atof(parameter->element_value));
+  else
+    emit_string(t->out, parameter->element_value); // including True and False
+
+  fputs(");\n", t->out);
+}
+
+//
+// translate_condition
+//
+// Appends code deciding the condition into the C int c, branching
+// around the rhs of an and or an or that its lhs decides, and
+// comparing two proven ints as C ints; an expression that isn't a
+// boolean fails, without a message, as in execute_while_loop.
+//
+static void translate_condition(struct Translator *t, struct STMT *stmt, struct CONDITION *condition)
+{
+  static const char *int_compares[] = {"==", "!=", "<", "<=", ">", ">="};
+
+  if (condition->condition_type == CONDITION_AND || condition->condition_type == CONDITION_OR)
+  {
+    translate_condition(t, stmt, condition->lhs);
+    emit_line(t, (condition->condition_type == CONDITION_AND) ? "if (c)" : "if (!c)");
+    emit_line(t, "{");
+    t->depth++;
+    translate_condition(t, stmt, condition->rhs);
+    t->depth--;
+    emit_line(t, "}");
+    return;
+  }
+
+  if (condition->condition_type == CONDITION_NOT)
+  {
+    translate_condition(t, stmt, condition->lhs);
+    emit_line(t, "c = !c;");
+    return;
+  }
+
+  struct VALUE_EXPR *expr = condition->expr;
+
+  if (expr->isBinaryExpr && expr->types == EXPR_TYPES_INT_INT && expr->num_steps == 0 &&
+      expr->operator >= OPERATOR_EQUAL && expr->operator <= OPERATOR_GTE)
+  {
+    emit_check(t, expr->lhs->element, stmt->line);
+    emit_check(t, expr->rhs->element, stmt->line);
+
+    fprintf(t->out, "%*sc = (", 2 * t->depth, "");
+    emit_native(t, expr->lhs->element, RAM_TYPE_INT);
+    fprintf(t->out, " %s ", int_compares[expr->operator - OPERATOR_EQUAL]);
+    emit_native(t, expr->rhs->element, RAM_TYPE_INT);
+    fputs(");\n", t->out);
+    return;
+  }
+
+  emit_line(t, "{");
+  t->depth++;
+  emit_line(t, "struct RAM_VALUE e;");
+  translate_expr(t, stmt, expr, "e");
+  emit_line(t, "if (e.value_type != RAM_TYPE_BOOLEAN) { release(e); goto failed; }");
+  emit_line(t, "c = (e.types.i != 0);");
+  t->depth--;
+  emit_line(t, "}");
+}
+
+//
+// translate_while_loop
+//
+static void translate_while_loop(struct Translator *t, struct STMT *stmt)
+{
+  struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+  emit_line(t, "{");
+  t->depth++;
+  emit_line(t, "int c;");
+  translate_condition(t, stmt, loop->condition);
+  emit_line(t, "if (c)");
+  emit_line(t, "{");
+  t->depth++;
+  translate_stmts(t, loop->preheader, NULL);
+  emit_line(t, "do");
+  emit_line(t, "{");
+  t->depth++;
+  translate_stmts(t, loop->loop_body, loop->next_stmt);
+  translate_condition(t, stmt, loop->condition);
+  t->depth--;
+  emit_line(t, "} while (c);");
+  t->depth--;
+  emit_line(t, "}");
+  t->depth--;
+  emit_line(t, "}");
+}
+
+//
+// translate_for_loop
+//
+// The range is evaluated and checked once, as execute_for_loop
+// does, into rD0..rD2, and counted on a native kD, where D is the
+// depth of the loop, so a nested loop has its own.
+//
+static void translate_for_loop(struct Translator *t, struct STMT *stmt)
+{
+  struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+  struct ELEMENT *elements[3] = {loop->start, loop->stop, loop->step};
+  int v = var_index(t, loop->var_name);
+  int d = t->depth;
+
+  emit_line(t, "{");
+  t->depth++;
+
+  for (int i = 0; i < 3; i++)
+  {
+    emit_check(t, elements[i], stmt->line);
+    fprintf(t->out, "%*sstruct RAM_VALUE r%d%d = ", 2 * t->depth, "", d, i);
+    emit_value(t, elements[i]);
+    fputs(";\n", t->out);
+    emit_line(t, "if (r%d%d.value_type != RAM_TYPE_INT) { invalid_range(rt, %d); goto failed; }", d, i, stmt->line);
+  }
+
+  emit_line(t, "if (r%d2.types.i == 0) { zero_step(rt, %d); goto failed; }", d, stmt->line);
+  emit_line(t, "for (long long k%d = r%d0.types.i; (r%d2.types.i > 0) ? k%d < r%d1.types.i : k%d > r%d1.types.i; k%d += r%d2.types.i)",
+            d, d, d, d, d, d, d, d, d);
+  emit_line(t, "{");
+  t->depth++;
+  emit_line(t, "assign(rt, &%s, &%s, names[%d], int_value((int)k%d));", ref(t, 'v', v).text, ref(t, 'a', v).text, v, d);
+  translate_stmts(t, loop->loop_body, loop->next_stmt);
+  t->depth--;
+  emit_line(t, "}");
+  t->depth--;
+  emit_line(t, "}");
+}
+
+//
+// translate_stmt
+//
+// Appends the statement, and returns the one after it.
+//
+static struct STMT *translate_stmt(struct Translator *t, struct STMT *stmt)
+{
+  if (++t->num_translated > MAX_STMTS)
+  {
+    t->failed = true;
+    return NULL;
+  }
+
+  emit_line(t, "// line %d", stmt->line);
+
+  switch (stmt->stmt_type)
+  {
+  case STMT_ASSIGNMENT:
+    translate_assignment(t, stmt);
+    return stmt->types.assignment->next_stmt;
+  case STMT_FUNCTION_CALL:
+    translate_print(t, stmt);
+    return stmt->types.function_call->next_stmt;
+  case STMT_WHILE_LOOP:
+    translate_while_loop(t, stmt);
+    return stmt->types.while_loop->next_stmt;
+  case STMT_FOR_LOOP:
+    translate_for_loop(t, stmt);
+    return stmt->types.for_loop->next_stmt;
+  case STMT_PASS:
+    return stmt->types.pass->next_stmt;
+  case STMT_DEF: // nothing to do, calls are executed
+    return stmt->types.def->next_stmt;
+  default: // not executed either
+    t->failed = true;
+    return NULL;
+  }
+}
+
+//
+// translate_stmts
+//
+// Appends the statements from stmt up to, but not including, end.
+//
+static void translate_stmts(struct Translator *t, struct STMT *stmt, struct STMT *end)
+{
+  while (stmt != NULL && stmt != end && !t->failed)
+    stmt = translate_stmt(t, stmt);
+}
+
+//
+// translate_function
+//
+// Appends the function with the given header and body to
+// t->functions: before the body are declarations of the loop
+// function's locals, and after it, the epilogue.
+//
+static void translate_function(struct Translator *t, const char *header, const char *body, size_t size)
+{
+  fprintf(t->functions, "%s\n{\n  int ok = 0, r = 0;\n", header);
+
+  if (t->loop >= 0)
+  {
+    for (int v = 0; v < t->num_vars; v++)
+      if (t->marks[v] == t->loop)
+        fprintf(t->functions, "  struct RAM_VALUE v%d = f->v[%d]; int a%d = f->a[%d];\n", v, v, v, v);
+  }
+
+  fputs("  (void)r;\n\n", t->functions);
+  fwrite(body, 1, size, t->functions);
+  fputs("\n  ok = 1;\nfailed:\n", t->functions);
+
+  if (t->loop >= 0)
+    fprintf(t->functions, "  SAVE%d;\n", t->loop);
+
+  fputs("  return ok;\n}\n\n", t->functions);
+}
+
+//
+// translate_loop_function
+//
+// Appends a call to a new function for the top-level while or for
+// loop, which is appended to t->functions.
+//
+static void translate_loop_function(struct Translator *t, struct STMT *stmt)
+{
+  FILE *out = t->out;
+  int depth = t->depth;
+  char *body = NULL;
+  size_t size = 0;
+
+  t->out = open_memstream(&body, &size);
+
+  if (t->out == NULL)
+  {
+    t->out = out;
+    t->failed = true;
+    return;
+  }
+
+  t->loop = t->num_loops++;
+  t->depth = 1;
+
+  if (stmt->stmt_type == STMT_WHILE_LOOP)
+    translate_while_loop(t, stmt);
+  else
+    translate_for_loop(t, stmt);
+
+  if (fclose(t->out) != 0)
+    t->failed = true;
+
+  //
+  // moving the loop's locals to and from the frame:
+  //
+  fprintf(t->functions, "#define SAVE%d do { \\\n", t->loop);
+  for (int v = 0; v < t->num_vars; v++)
+    if (t->marks[v] == t->loop)
+      fprintf(t->functions, "  f->v[%d] = v%d; f->a[%d] = a%d; \\\n", v, v, v, v);
+  fputs("} while (0)\n\n", t->functions);
+
+  fprintf(t->functions, "#define LOAD%d do { \\\n", t->loop);
+  for (int v = 0; v < t->num_vars; v++)
+    if (t->marks[v] == t->loop)
+      fprintf(t->functions, "  v%d = f->v[%d]; a%d = f->a[%d]; \\\n", v, v, v, v);
+  fputs("} while (0)\n\n", t->functions);
+
+  char header[64];
+
+  snprintf(header, sizeof(header), "static int loop%d(struct AotRuntime *rt, struct Frame *f)", t->loop);
+  translate_function(t, header, body, size);
+
+  free(body);
+
+  t->out = out;
+  t->depth = depth;
+  emit_line(t, "if (!loop%d(rt, f)) goto failed;", t->loop);
+  t->loop = -1;
+}
+
+//
+// translate_chunks
+//
+// Appends the program's top-level statements to t->functions, as
+// chunk functions of at most CHUNK_SIZE statements.
+//
+static void translate_chunks(struct Translator *t, struct STMT *program)
+{
+  struct STMT *stmt = program;
+
+  while (stmt != NULL && !t->failed)
+  {
+    char *body = NULL;
+    size_t size = 0;
+
+    t->out = open_memstream(&body, &size);
+
+    if (t->out == NULL)
+    {
+      t->failed = true;
+      return;
+    }
+
+    t->depth = 1;
+
+    for (int count = 0; count < CHUNK_SIZE && stmt != NULL && !t->failed; count++)
+    {
+      if (stmt->stmt_type == STMT_WHILE_LOOP || stmt->stmt_type == STMT_FOR_LOOP)
+      {
+        emit_line(t, "// line %d", stmt->line);
+        translate_loop_function(t, stmt);
+        stmt = (stmt->stmt_type == STMT_WHILE_LOOP) ? stmt->types.while_loop->next_stmt : stmt->types.for_loop->next_stmt;
+      }
+      else
+      {
+        stmt = translate_stmt(t, stmt);
+      }
+    }
+
+    if (fclose(t->out) != 0)
+      t->failed = true;
+
+    char header[64];
+
+    snprintf(header, sizeof(header), "static int chunk%d(struct AotRuntime *rt, struct Frame *f)", t->num_chunks++);
+    translate_function(t, header, body, size);
+
+    free(body);
+  }
+}
+
+//
+// next_stmt
+//
+// Returns the statement after the given one.
+//
+static struct STMT *next_stmt(struct STMT *stmt)
+{
+  switch (stmt->stmt_type)
+  {
+  case STMT_ASSIGNMENT:
+    return stmt->types.assignment->next_stmt;
+  case STMT_FUNCTION_CALL:
+    return stmt->types.function_call->next_stmt;
+  case STMT_WHILE_LOOP:
+    return stmt->types.while_loop->next_stmt;
+  case STMT_FOR_LOOP:
+    return stmt->types.for_loop->next_stmt;
+  case STMT_PASS:
+    return stmt->types.pass->next_stmt;
+  case STMT_DEF:
+    return stmt->types.def->next_stmt;
+  default:
+    return NULL;
+  }
+}
+
+//
+// translate
+//
+// Translates the program into a C file, returned in memory the
+// caller frees, and sets t->stmts for it. Returns NULL if the
+// program can't be translated.
+//
+static char *translate(struct Translator *t, struct STMT *program, size_t *size)
+{
+  char *functions = NULL;
+  size_t functions_size = 0;
+
+  t->functions = open_memstream(&functions, &functions_size);
+
+  if (t->functions == NULL)
+    return NULL;
+
+  //
+  // lists and dictionaries are left to the executor, but a function
+  // the program defines may return one:
+  //
+  for (struct STMT *stmt = program; stmt != NULL; stmt = next_stmt(stmt))
+    if (stmt->stmt_type == STMT_DEF)
+      t->functions_defined = true;
+
+  t->loop = -1;
+  translate_chunks(t, program);
+
+  if (fclose(t->functions) != 0 || t->failed)
+  {
+    free(functions);
+    return NULL;
+  }
+
+  char *code = NULL;
+  FILE *out = open_memstream(&code, size);
+
+  if (out == NULL)
+  {
+    free(functions);
+    return NULL;
+  }
+
+  fprintf(out, "enum { RAM_TYPE_INT = %d, RAM_TYPE_REAL = %d, RAM_TYPE_STR = %d, RAM_TYPE_BOOLEAN = %d, RAM_TYPE_NONE = %d };\n",
+          RAM_TYPE_INT, RAM_TYPE_REAL, RAM_TYPE_STR, RAM_TYPE_BOOLEAN, RAM_TYPE_NONE);
+  fputs("enum {", out);
+  for (int op = 0; op <= OPERATOR_NO_OP; op++)
+    fprintf(out, "%s %s = %d", (op == 0) ? "" : ",", operator_names[op], op);
+  fputs(" };\n\n", out);
+
+  fprintf(out, prelude, shared_declarations);
+
+  //
+  // the variables, and moving them to and from memory:
+  //
+  fprintf(out, "\n#define NUM_VARS %d\n\nstatic const char *names[] = {", t->num_vars);
+  for (int v = 0; v < t->num_vars; v++)
+  {
+    emit_string(out, t->vars[v]);
+    fputs(", ", out);
+  }
+  fputs("0};\n\n", out);
+
+  fputs("struct Frame\n"
+        "{\n"
+        "  struct RAM_VALUE v[NUM_VARS + 1];\n"
+        "  int a[NUM_VARS + 1];\n"
+        "};\n"
+        "\n"
+        "static void frame_out(struct AotRuntime *rt, struct Frame *f)\n"
+        "{\n"
+        "  for (int k = 0; k < NUM_VARS; k++)\n"
+        "    if (f->a[k] >= 0)\n"
+        "      rt->store(rt->interp, f->a[k], f->v[k]);\n"
+        "}\n"
+        "\n"
+        "static void frame_in(struct AotRuntime *rt, struct Frame *f)\n"
+        "{\n"
+        "  for (int k = 0; k < NUM_VARS; k++)\n"
+        "    f->a[k] = reload(rt, names[k], &f->v[k]);\n"
+        "}\n\n", out);
+
+  fwrite(functions, 1, functions_size, out);
+  free(functions);
+
+  fputs("static int (*const chunks[])(struct AotRuntime *rt, struct Frame *f) = {", out);
+  for (int c = 0; c < t->num_chunks; c++)
+    fprintf(out, "chunk%d, ", c);
+  fputs("0};\n\n", out);
+
+  fputs("int nupy_program(struct AotRuntime *rt)\n"
+        "{\n"
+        "  struct Frame *f = (struct Frame *)malloc(sizeof(struct Frame));\n"
+        "  int ok = 1;\n"
+        "  if (f == NULL)\n"
+        "    return 0;\n"
+        "  for (int k = 0; k < NUM_VARS; k++)\n"
+        "    f->v[k].value_type = RAM_TYPE_NONE;\n"
+        "  frame_in(rt, f);\n"
+        "  for (int c = 0; ok && chunks[c] != 0; c++)\n"
+        "    ok = chunks[c](rt, f);\n"
+        "  frame_out(rt, f);\n"
+        "  for (int k = 0; k < NUM_VARS; k++)\n"
+        "    release(f->v[k]);\n"
+        "  free(f);\n"
+        "  return ok;\n"
+        "}\n", out);
+
+  if (fclose(out) != 0)
+  {
+    free(code);
+    return NULL;
+  }
+
+  return code;
+}
+
+//
+// temp_file
+//
+// Creates an empty temporary file in the directory, and returns
+// its name, or NULL if that fails.
+//
+static char *temp_file(const char *dir)
+{
+  size_t length = strlen(dir) + 16;
+  char *temp = (char *)malloc(length);
+
+  if (temp == NULL)
+    return NULL;
+
+  snprintf(temp, length, "%s/.tmpXXXXXX", dir);
+
+  int fd = mkstemp(temp);
+
+  if (fd < 0 && errno == ENOENT) // create the directory and try again:
+  {
+    mkdir(dir, 0777);
+    snprintf(temp, length, "%s/.tmpXXXXXX", dir);
+
+    fd = mkstemp(temp);
+  }
+
+  if (fd < 0)
+  {
+    free(temp);
+    return NULL;
+  }
+
+  close(fd);
+
+  return temp;
+}
+
+//
+// build
+//
+// Compiles the C code into a shared object in the directory, and
+// returns its name, or NULL if it can't be compiled.
+//
+static char *build(const char *dir, const char *code, size_t size)
+{
+  if (strchr(dir, '\'') != NULL) // can't be quoted below
+    return NULL;
+
+  char *source = temp_file(dir);
+  char *object = (source == NULL) ? NULL : temp_file(dir);
+
+  if (object == NULL)
+  {
+    if (source != NULL)
+      unlink(source);
+    free(source);
+    return NULL;
+  }
+
+  FILE *file = fopen(source, "w");
+  bool success = (file != NULL);
+
+  if (success)
+  {
+    success = fwrite(code, 1, size, file) == size;
+    success = (fclose(file) == 0) && success;
+  }
+
+  char *cc = getenv("CC");
+
+  if (cc == NULL || cc[0] == '\0')
+    cc = "cc";
+
+  size_t length = strlen(cc) + strlen(source) + strlen(object) + 128;
+  char *command = (char *)malloc(length);
+
+  if (success && command != NULL)
+  {
+    //
+    // -fwrapv: ints wrap around, as they do in the executor
+    //
+    snprintf(command, length, "%s -std=c11 -O2 -fwrapv -fPIC -shared -x c -o '%s' '%s' -lm >/dev/null 2>&1",
+             cc, object, source);
+
+    success = (system(command) == 0);
+  }
+  else
+  {
+    success = false;
+  }
+
+  unlink(source);
+  free(source);
+  free(command);
+
+  if (!success)
+  {
+    unlink(object);
+    free(object);
+    return NULL;
+  }
+
+  return object;
+}
+
+//
+// load
+//
+// Loads the shared object at the given path into the compiled
+// program, returning false if it's not a valid one.
+//
+static bool load(struct AotProgram *native, const char *path)
+{
+  void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+  if (library == NULL)
+    return false;
+
+  void *entry = dlsym(library, "nupy_program");
+  int *value_size = (int *)dlsym(library, "nupy_value_size");
+
+  if (entry == NULL || value_size == NULL || *value_size != (int)sizeof(struct RAM_VALUE))
+  {
+    dlclose(library);
+    return false;
+  }
+
+  native->library = library;
+  memcpy(&native->entry, &entry, sizeof(native->entry));
+
+  return true;
+}
+
+//
+// Public functions:
+//
+
+//
+// aot_compile
+//
+struct AotProgram *aot_compile(struct Interpreter *interp, struct STMT *program, char *filename, bool verbose)
+{
+  struct Translator t;
+  size_t size;
+
+  memset(&t, 0, sizeof(t));
+
+  char *code = translate(&t, program, &size);
+  struct AotProgram *native = (struct AotProgram *)malloc(sizeof(struct AotProgram));
+  char *dir = (filename == NULL) ? NULL : graphcache_dir(filename);
+  char *path = NULL;
+  bool cached = false;
+  bool compiled = false;
+
+  free(t.vars);
+  free(t.marks);
+
+  if (native != NULL)
+  {
+    native->library = NULL;
+    native->stmts = t.stmts;
+    t.stmts = NULL;
+  }
+
+  if (code != NULL && native != NULL)
+  {
+
+    //
+    // cached under a hash of the code, else compiled:
+    //
+    if (dir != NULL)
+    {
+      size_t length = strlen(dir) + 32;
+
+      path = (char *)malloc(length);
+
+      if (path != NULL)
+      {
+        snprintf(path, length, "%s/%016llx.so", dir, hashBytes(HASH_START, code, size));
+        cached = load(native, path);
+      }
+    }
+
+    if (!cached)
+    {
+      char *tmpdir = getenv("TMPDIR");
+      char *object = build((dir != NULL) ? dir : (tmpdir != NULL && tmpdir[0] != '\0') ? tmpdir : "/tmp", code, size);
+
+      if (object != NULL)
+      {
+        if (path != NULL && rename(object, path) == 0)
+        {
+          compiled = load(native, path);
+        }
+        else // not cached: once loaded, it's no longer needed
+        {
+          compiled = load(native, object);
+          unlink(object);
+        }
+
+        free(object);
+      }
+    }
+  }
+
+  free(t.stmts);
+  free(code);
+  free(dir);
+  free(path);
+
+  if (verbose)
+  {
+    if (cached)
+      fprintf(interp->output, "**loaded native code from the cache...\n");
+    else if (compiled)
+      fprintf(interp->output, "**compiled to native code...\n");
+    else
+      fprintf(interp->output, "**could not compile to native code...\n");
+  }
+
+  if (!cached && !compiled)
+  {
+    if (native != NULL)
+      free(native->stmts);
+    free(native);
+    return NULL;
+  }
+
+  return native;
+}
+
+//
+// aot_run
+//
+bool aot_run(struct AotProgram *native, struct Interpreter *interp)
+{
+  struct AotRuntime rt;
+
+  rt.interp = interp;
+  rt.output = interp->output;
+  rt.stmts = (void **)native->stmts;
+  rt.define = runtime_define;
+  rt.load = runtime_load;
+  rt.store = runtime_store;
+  rt.operator = runtime_operator;
+  rt.execute = runtime_execute;
+
+  return native->entry(&rt) != 0;
+}
+
+//
+// aot_destroy
+//
+void aot_destroy(struct AotProgram *native)
+{
+  if (native == NULL)
+    return;
+
+  dlclose(native->library);
+  free(native->stmts);
+  free(native);
+}
@@ -0,0 +1,78 @@
+/*aot.h*/
+
+//
+// Ahead-of-time compiler from nuPython to native code. The program
+// graph is translated into a C file in which the program's variables
+// are RAM_VALUEs, held in C locals while loops run, and each statement
+// is C code with the executor's semantics; expressions whose operand
+// types were proven before the program ran (see optimizer_types)
+// become plain int, double and string operations. The system's C compiler ($CC,
+// by default cc) builds the file at -O2 into a shared object, which
+// is loaded and run in place of execute().
+//
+// Shared objects are kept in the graph cache's directory (see
+// graphcache.h), keyed by a hash of the generated C, so a program
+// is only compiled again when it, or the translator, changes. If
+// the cache is disabled, programs are compiled in $TMPDIR (by
+// default /tmp) every time they're run.
+//
+// Very large programs, of thousands of statements, aren't compiled,
+// nor are programs the executor can't run (see execute()).
+//
+// Statements that aren't translated, such as x = input('...'), are
+// run by the executor, with the variables written back to memory
+// before and read again after.
+//
+// Usage:
+//
+//   struct AotProgram *native = aot_compile(interp, program, filename, verbose);
+//
+//   if (native != NULL)
+//     aot_run(native, interp);
+//   else
+//     execute(interp, program);
+//
+//   aot_destroy(native);
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+#include "interpreter.h"
+
+struct AotProgram; // opaque
+
+//
+// Public functions:
+//
+
+//
+// aot_compile
+//
+// Compiles the program, or loads it from the cache, and returns it;
+// the program graph must outlive the result. filename is where the
+// source came from, for where the cache is, or NULL if it didn't
+// come from a file. Returns NULL if the program can't be compiled,
+// e.g. there's no C compiler, in which case it should be executed.
+// If verbose, the outcome is reported to the interpreter's output.
+//
+struct AotProgram *aot_compile(struct Interpreter *interp, struct STMT *program, char *filename, bool verbose);
+
+//
+// aot_run
+//
+// Runs the compiled program with the interpreter's memory and
+// streams, exactly as execute() runs its graph, and returns true
+// if it ran to completion, false if not (after outputting an error
+// message).
+//
+bool aot_run(struct AotProgram *native, struct Interpreter *interp);
+
+//
+// aot_destroy
+//
+// Unloads the compiled program. NULL is ignored.
+//
+void aot_destroy(struct AotProgram *native);
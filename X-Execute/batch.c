@@ -0,0 +1,324 @@
+/*batch.c*/
+
+//
+// Batch mode for nuPython: runs many programs in one process, in
+// parallel on a thread pool. Each program gets its own memory and
+// its own output buffer, and the outputs are printed in the order
+// the programs were given (each flushed as soon as it is printed),
+// followed by a status line with timing.
+//
+
+// open_memstream(), clock_gettime() and sysconf() are POSIX, not C11:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>   // clock_gettime
+#include <unistd.h> // sysconf
+
+#include "parser.h"
+#include "programgraph.h"
+#include "ram.h"
+#include "execute.h"
+#include "interpreter.h"
+#include "threadpool.h"
+#include "batch.h"
+#include "graphcache.h"
+#include "optimizer.h"
+
+//
+// What each task needs: its slot in the results, and a
+// way to tell the main thread that the slot is filled in.
+//
+struct BATCH_JOB
+{
+  struct BATCH_RESULT *result;
+  bool done;
+
+  pthread_mutex_t *lock; // shared by all the jobs
+  pthread_cond_t *finished;
+};
+
+//
+// Private functions:
+//
+
+//
+// now_ms
+//
+// Returns a monotonic timestamp in milliseconds.
+//
+static double now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//
+// run_program
+//
+// Parses, builds and executes one nuPython file, with the
+// output going to the given stream. Returns the status. The
+// program graph comes from the cache when possible.
+//
+static int run_program(char *filename, FILE *output)
+{
+  FILE *source = fopen(filename, "r");
+
+  if (source == NULL)
+  {
+    fprintf(output, "**ERROR: unable to open input file '%s' for input.\n", filename);
+    return BATCH_CANNOT_OPEN;
+  }
+
+  //
+  // programs see an empty input stream:
+  //
+  FILE *input = fopen("/dev/null", "r");
+  struct Interpreter *interp = (input != NULL) ? interpreter_create(input, output) : NULL;
+
+  if (interp == NULL)
+  {
+    if (input != NULL)
+      fclose(input);
+    fclose(source);
+    return BATCH_OUT_OF_MEMORY;
+  }
+
+  int status = BATCH_SYNTAX_ERROR;
+
+  struct GraphCache *cache = graphcache_open(source, filename);
+  struct STMT *program = graphcache_load(cache);
+
+  if (program == NULL)
+  {
+    struct TokenQueue *tokens = parser_parse(interp, source);
+
+    if (tokens != NULL)
+    {
+      program = programgraph_build(interp, tokens);
+
+      //
+      // the listing is kept for when the program is run on its
+      // own (see main.c), which prints it:
+      //
+      char *listing = (program == NULL) ? NULL : programgraph_listing(program);
+
+      if (program != NULL)
+        optimizer_run(interp, program, true, false, NULL);
+
+      graphcache_store(cache, program, listing);
+      free(listing);
+      graphcache_close(cache); // not holding a cached graph
+      cache = NULL;
+
+      tokenqueue_destroy(tokens);
+    }
+  }
+
+  fclose(source);
+
+  if (program != NULL)
+  {
+    bool success = optimizer_report_undefined(interp, program) == 0 &&
+                   execute(interp, program);
+
+    status = success ? BATCH_OK : BATCH_EXECUTION_ERROR;
+
+    if (cache == NULL) // else freed with the cache
+      programgraph_destroy(program);
+  }
+
+  graphcache_close(cache);
+  interpreter_destroy(interp);
+  fclose(input);
+
+  return status;
+}
+
+//
+// run_job
+//
+// Thread pool task: runs one program into its own output
+// buffer, then marks the job as done.
+//
+static void run_job(void *arg)
+{
+  struct BATCH_JOB *job = (struct BATCH_JOB *)arg;
+  struct BATCH_RESULT *result = job->result;
+
+  double start = now_ms();
+
+  FILE *output = open_memstream(&result->output, &result->output_size);
+
+  if (output == NULL)
+  {
+    result->status = BATCH_OUT_OF_MEMORY;
+  }
+  else
+  {
+    result->status = run_program(result->filename, output);
+
+    fclose(output); // finalizes output and output_size
+  }
+
+  result->elapsed_ms = now_ms() - start;
+
+  pthread_mutex_lock(job->lock);
+  job->done = true;
+  pthread_cond_broadcast(job->finished);
+  pthread_mutex_unlock(job->lock);
+}
+
+//
+// status_string
+//
+// Returns a printable description of the status.
+//
+static char *status_string(int status)
+{
+  switch (status)
+  {
+  case BATCH_OK:
+    return "ok";
+  case BATCH_CANNOT_OPEN:
+    return "cannot open";
+  case BATCH_SYNTAX_ERROR:
+    return "syntax error";
+  case BATCH_EXECUTION_ERROR:
+    return "execution error";
+  case BATCH_OUT_OF_MEMORY:
+    return "out of memory";
+  default:
+    return "unknown";
+  }
+}
+
+//
+// Public functions:
+//
+
+//
+// batch_run
+//
+// Runs the given nuPython files on a pool of num_threads
+// worker threads (if num_threads <= 0, one per CPU). The
+// output of each program is printed as soon as it and all
+// the programs before it have finished, so the overall
+// output is in the same order as the files. Programs see
+// an empty input stream, so input() reports end of input.
+//
+// Returns the # of programs that did not run successfully.
+//
+int batch_run(char *filenames[], int num_files, int num_threads)
+{
+  assert(num_files >= 0);
+
+  if (num_threads <= 0)
+  {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    num_threads = (num_cpus > 0) ? (int)num_cpus : 1;
+  }
+
+  if (num_threads > num_files && num_files > 0)
+    num_threads = num_files;
+
+  struct BATCH_RESULT *results = (struct BATCH_RESULT *)malloc(sizeof(struct BATCH_RESULT) * (num_files + 1));
+  struct BATCH_JOB *jobs = (struct BATCH_JOB *)malloc(sizeof(struct BATCH_JOB) * (num_files + 1));
+  struct ThreadPool *pool = (num_files > 0) ? threadpool_create(num_threads) : NULL;
+
+  if (results == NULL || jobs == NULL || (num_files > 0 && pool == NULL))
+  {
+    printf("**ERROR: unable to start batch of %d programs.\n", num_files);
+    free(results);
+    free(jobs);
+    threadpool_destroy(pool);
+    return num_files;
+  }
+
+  pthread_mutex_t lock;
+  pthread_cond_t finished;
+
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&finished, NULL);
+
+  printf("**BATCH: %d programs on %d threads\n", num_files, (pool != NULL) ? pool->num_workers : 0);
+
+  double start = now_ms();
+
+  //
+  // queue up all the programs:
+  //
+  for (int i = 0; i < num_files; i++)
+  {
+    results[i].filename = filenames[i];
+    results[i].output = NULL;
+    results[i].output_size = 0;
+    results[i].status = BATCH_OUT_OF_MEMORY;
+    results[i].elapsed_ms = 0.0;
+
+    jobs[i].result = &results[i];
+    jobs[i].done = false;
+    jobs[i].lock = &lock;
+    jobs[i].finished = &finished;
+
+    if (!threadpool_submit(pool, run_job, &jobs[i]))
+    {
+      jobs[i].done = true; // status already says out of memory
+    }
+  }
+
+  //
+  // print the results in order, as they become available:
+  //
+  int num_failed = 0;
+
+  for (int i = 0; i < num_files; i++)
+  {
+    pthread_mutex_lock(&lock);
+    while (!jobs[i].done)
+    {
+      pthread_cond_wait(&finished, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    struct BATCH_RESULT *result = &results[i];
+
+    printf("**%s:\n", result->filename);
+
+    if (result->output != NULL)
+      fwrite(result->output, 1, result->output_size, stdout);
+
+    printf("**%s: %s (%.3f ms)\n", result->filename, status_string(result->status), result->elapsed_ms);
+
+    //
+    // stdout is buffered when piped: flush, so the results so far
+    // are not lost if a later program brings the process down
+    //
+    fflush(stdout);
+
+    if (result->status != BATCH_OK)
+      num_failed++;
+
+    free(result->output);
+  }
+
+  threadpool_destroy(pool);
+
+  printf("**BATCH DONE: %d ok, %d failed (%.3f ms)\n", num_files - num_failed, num_failed, now_ms() - start);
+
+  pthread_mutex_destroy(&lock);
+  pthread_cond_destroy(&finished);
+
+  free(results);
+  free(jobs);
+
+  return num_failed;
+}
@@ -0,0 +1,51 @@
+/*batch.h*/
+
+//
+// Batch mode for nuPython: runs many programs in one process, in
+// parallel on a thread pool. Each program gets its own memory and
+// its own output buffer, and the outputs are printed in the order
+// the programs were given, followed by a status line with timing.
+//
+
+#pragma once
+
+#include <stddef.h> // size_t
+
+//
+// Status of one program in the batch:
+//
+enum BATCH_STATUS
+{
+  BATCH_OK = 0,          // ran to completion
+  BATCH_CANNOT_OPEN,     // file could not be opened
+  BATCH_SYNTAX_ERROR,    // parser found a syntax error
+  BATCH_EXECUTION_ERROR, // semantic / execution error at runtime
+  BATCH_OUT_OF_MEMORY
+};
+
+struct BATCH_RESULT
+{
+  char *filename;
+  char *output;       // everything the program printed
+  size_t output_size; // # of bytes in output
+  int status;         // enum BATCH_STATUS
+  double elapsed_ms;  // wall-clock time to parse, build and run
+};
+
+//
+// Public functions:
+//
+
+//
+// batch_run
+//
+// Runs the given nuPython files on a pool of num_threads
+// worker threads (if num_threads <= 0, one per CPU). The
+// output of each program is printed as soon as it and all
+// the programs before it have finished, so the overall
+// output is in the same order as the files. Programs see
+// an empty input stream, so input() reports end of input.
+//
+// Returns the # of programs that did not run successfully.
+//
+int batch_run(char *filenames[], int num_files, int num_threads);
@@ -0,0 +1,24 @@
+def square(x):
+{
+  return x * x
+}
+
+def add(x, y):
+{
+  s = square(x)
+  return s + y
+}
+
+def step(h, i):
+{
+  k = i % 7
+  h = add(k, h)
+  return h % 1000003
+}
+
+h = 7
+for i in range(1000000):
+{
+  h = step(h, i)
+}
+print(h)
@@ -0,0 +1,105 @@
+/*dictbench.c*/
+
+//
+// Times dictionaries (see dict.h) with 1K to 10M entries keyed by
+// strings: inserting the keys, looking each one up (and a key that
+// isn't there), and iterating over the entries in order. Run from
+// X-Execute with make dictbench.
+//
+
+// clock_gettime() is POSIX:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../dict.h"
+
+#define MISSING 1024
+
+//
+// seconds
+//
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+  static char missing[MISSING][16]; // keys that aren't there
+
+  for (int i = 0; i < MISSING; i++)
+    snprintf(missing[i], sizeof(missing[i]), "nokey%d", i);
+
+  printf("%10s %12s %12s %12s %12s\n", "entries", "insert ns", "hit ns", "miss ns", "iterate ns");
+
+  for (int n = 1000; n <= 10000000; n *= 10)
+  {
+    char **keys = (char **)malloc(n * sizeof(char *));
+
+    for (int i = 0; i < n; i++)
+    {
+      keys[i] = (char *)malloc(16);
+      snprintf(keys[i], 16, "key%d", i);
+    }
+
+    struct DICT *dict = dict_create();
+    struct RAM_VALUE key, value;
+
+    key.value_type = RAM_TYPE_STR;
+    value.value_type = RAM_TYPE_INT;
+
+    double start = seconds();
+
+    for (int i = 0; i < n; i++)
+    {
+      key.types.s = keys[i];
+      value.types.i = i;
+      dict_set(dict, key, value);
+    }
+
+    double inserted = seconds();
+    long long sum = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+      key.types.s = keys[(int)((i * 7919LL) % n)];
+      if (dict_get(dict, key, &value))
+        sum += value.types.i;
+    }
+
+    double hit = seconds();
+
+    for (int i = 0; i < n; i++)
+    {
+      key.types.s = missing[i % MISSING];
+      if (dict_get(dict, key, &value))
+        sum++;
+    }
+
+    double missed = seconds();
+
+    for (int e = 0; e < dict->length; e++)
+      sum += dict->entries[e].value.types.i;
+
+    double iterated = seconds();
+
+    printf("%10d %12.1f %12.1f %12.1f %12.1f  (%lld)\n", n,
+           (inserted - start) * 1e9 / n, (hit - inserted) * 1e9 / n,
+           (missed - hit) * 1e9 / n, (iterated - missed) * 1e9 / n, sum);
+
+    dict_release(dict);
+
+    for (int i = 0; i < n; i++)
+      free(keys[i]);
+    free(keys);
+  }
+
+  return 0;
+}
@@ -0,0 +1,15 @@
+def fib(n):
+{
+  while n > 1:
+  {
+    m = n - 1
+    a = fib(m)
+    m = n - 2
+    b = fib(m)
+    return a + b
+  }
+  return n
+}
+
+f = fib(27)
+print(f)
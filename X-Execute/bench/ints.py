@@ -0,0 +1,11 @@
+i = 0
+h = 7
+while i < 3000000:
+{
+  h = h * 31
+  h = h % 1000003
+  k = i % 7
+  h = h + k
+  i = i + 1
+}
+print(h)
@@ -0,0 +1,14 @@
+i = 0
+s = 0.0
+while i < 300:
+{
+  j = 0
+  while j < 10000:
+  {
+    t = j * 0.5
+    s = s + t
+    j = j + 1
+  }
+  i = i + 1
+}
+print(s)
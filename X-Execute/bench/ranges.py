@@ -0,0 +1,9 @@
+h = 7
+for i in range(3000000):
+{
+  h = h * 31
+  h = h % 1000003
+  k = i % 7
+  h = h + k
+}
+print(h)
@@ -0,0 +1,10 @@
+i = 0
+s = 0.0
+while i < 3000000:
+{
+  x = i * 2.5
+  y = x / 3
+  s = s + y
+  i = i + 1
+}
+print(s)
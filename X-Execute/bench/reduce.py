@@ -0,0 +1,22 @@
+x = []
+y = []
+for i in range(10000):
+{
+  j = i % 100
+  x.append(j)
+  r = i * 0.25
+  y.append(r)
+}
+for k in range(10000):
+{
+  s = sum(y)
+  d = dot(y, y)
+  n = dot(x, x)
+  lo = min(y)
+  hi = max(x)
+}
+print(s)
+print(d)
+print(n)
+print(lo)
+print(hi)
@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+# Times each benchmark in bench/ with the interpreter, again run
+# as closures (--closures), with hot loops compiled to machine code
+# (--jit), and compiled ahead of time (--aot), once it's been
+# compiled and cached. Run from X-Execute after make build.
+#
+TIMEFORMAT=%R
+
+for program in bench/*.py
+do
+  ./a.out --aot "$program" > /dev/null  # compiles it, into the cache
+
+  echo "$program:"
+  echo -n "  interpreter: "
+  { time ./a.out "$program" > /dev/null; } 2>&1
+  echo -n "  closures:    "
+  { time ./a.out --closures "$program" > /dev/null; } 2>&1
+  echo -n "  jit:         "
+  { time ./a.out --jit "$program" > /dev/null; } 2>&1
+  echo -n "  aot:         "
+  { time ./a.out --aot "$program" > /dev/null; } 2>&1
+done
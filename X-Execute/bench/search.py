@@ -0,0 +1,18 @@
+line = "the quick brown fox jumps over the lazy dog, "
+j = 0
+while j < 6:
+{
+  line = line + line
+  j = j + 1
+}
+line = line + "ERROR: disk full"
+long = "the quick brown fox jumps over the lazy cat, and keeps running"
+for i in range(100000):
+{
+  short = "ERROR" in line
+  missing = "WARN" in line
+  absent = long in line
+}
+print(short)
+print(missing)
+print(absent)
@@ -0,0 +1,18 @@
+i = 0
+total = 0
+while i < 20000:
+{
+  s = ""
+  j = 0
+  while j < 10:
+  {
+    s = s + "ab"
+    j = j + 1
+  }
+  same = s == "abababababababababab"
+  total = total + j
+  i = i + 1
+}
+print(total)
+print(same)
+print(s)
@@ -0,0 +1,15 @@
+def total(n, acc):
+{
+  done = n == 0
+  while done:
+  {
+    return acc
+  }
+  m = n - 1
+  a = acc + n
+  a = a % 1000003
+  return total(m, a)
+}
+
+t = total(1000000, 0)
+print(t)
@@ -0,0 +1,242 @@
+/*builtins.c*/
+
+//
+// The functions a nuPython program can call; see builtins.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+
+#include "builtins.h"
+#include "util.h"
+
+#define T(type) BUILTIN_TYPE(RAM_TYPE_##type)
+#define NUMBER (T(INT) | T(REAL) | T(BOOLEAN))
+
+//
+// The builtins, by ID:
+//
+static const struct BUILTIN Core[BUILTIN_NATIVES] = {
+    [BUILTIN_UNRESOLVED] = {NULL},
+    [BUILTIN_PRINT] = {"print", 0, 1, BUILTIN_ANY_TYPE, T(NONE), false},
+    [BUILTIN_INPUT] = {"input", 1, 1, T(STR), T(STR), false},
+    [BUILTIN_INT] = {"int", 1, 1, T(STR), T(INT), false},
+    [BUILTIN_FLOAT] = {"float", 1, 1, T(STR), T(REAL), false},
+    [BUILTIN_LEN] = {"len", 1, 1, T(STR) | T(LIST) | T(DICT), T(INT), false},
+    [BUILTIN_SUM] = {"sum", 1, 1, T(LIST), T(INT) | T(REAL), false},
+    [BUILTIN_MIN] = {"min", 1, 1, T(LIST), BUILTIN_ANY_TYPE, false},
+    [BUILTIN_MAX] = {"max", 1, 1, T(LIST), BUILTIN_ANY_TYPE, false},
+    [BUILTIN_ABS] = {"abs", 1, 1, NUMBER, T(INT) | T(REAL), false},
+    [BUILTIN_DOT] = {"dot", 2, 2, T(LIST), T(INT) | T(REAL), false},
+    [BUILTIN_APPEND] = {"append", 1, 1, BUILTIN_ANY_TYPE, T(NONE), true},
+};
+
+struct Builtins
+{
+  struct BUILTIN *natives; // ID BUILTIN_NATIVES + i => natives[i]
+  int num_natives;
+  int natives_capacity;
+
+  //
+  // hash table, name => ID, with linear probing; 0 marks an
+  // empty slot, and at most half the slots are used:
+  //
+  int *slots;
+  int num_slots; // a power of 2
+};
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**BUILTINS ERROR\n");
+  printf("**BUILTINS ERROR: %s\n", msg);
+  printf("**BUILTINS ERROR\n");
+
+  exit(-123);
+}
+
+//
+// get
+//
+// Returns the function with the given ID, which must exist.
+//
+static const struct BUILTIN *get(struct Builtins *registry, int id)
+{
+  return (id < BUILTIN_NATIVES) ? &Core[id] : &registry->natives[id - BUILTIN_NATIVES];
+}
+
+//
+// find
+//
+// Returns the slot holding the named function's ID, or the
+// empty slot where it would go.
+//
+static int find(struct Builtins *registry, const char *name)
+{
+  int mask = registry->num_slots - 1;
+  int slot = (int)(hashBytes(HASH_START, name, strlen(name)) & mask);
+
+  while (registry->slots[slot] != BUILTIN_UNRESOLVED &&
+         strcmp(get(registry, registry->slots[slot])->name, name) != 0)
+    slot = (slot + 1) & mask;
+
+  return slot;
+}
+
+//
+// grow
+//
+// Doubles the number of slots, moving each ID to its new slot.
+//
+static void grow(struct Builtins *registry)
+{
+  int *old_slots = registry->slots;
+  int old_num_slots = registry->num_slots;
+
+  registry->num_slots *= 2;
+  registry->slots = (int *)calloc(registry->num_slots, sizeof(int));
+  if (registry->slots == NULL)
+    panic("out of memory");
+
+  for (int i = 0; i < old_num_slots; i++)
+    if (old_slots[i] != BUILTIN_UNRESOLVED)
+      registry->slots[find(registry, get(registry, old_slots[i])->name)] = old_slots[i];
+
+  free(old_slots);
+}
+
+//
+// Public functions:
+//
+
+//
+// builtins_create
+//
+struct Builtins *builtins_create(void)
+{
+  struct Builtins *registry = (struct Builtins *)malloc(sizeof(struct Builtins));
+  if (registry == NULL)
+    return NULL;
+
+  registry->natives = NULL;
+  registry->num_natives = 0;
+  registry->natives_capacity = 0;
+
+  registry->num_slots = 32;
+  registry->slots = (int *)calloc(registry->num_slots, sizeof(int));
+  if (registry->slots == NULL)
+  {
+    free(registry);
+    return NULL;
+  }
+
+  for (int id = BUILTIN_UNRESOLVED + 1; id < BUILTIN_NATIVES; id++)
+    registry->slots[find(registry, Core[id].name)] = id;
+
+  return registry;
+}
+
+//
+// builtins_destroy
+//
+void builtins_destroy(struct Builtins *registry)
+{
+  if (registry == NULL)
+    return;
+
+  for (int i = 0; i < registry->num_natives; i++)
+    free((char *)registry->natives[i].name);
+
+  free(registry->natives);
+  free(registry->slots);
+  free(registry);
+}
+
+//
+// builtins_register
+//
+int builtins_register(struct Builtins *registry, const char *name, int num_params, int param_types, int result_types,
+                      builtin_native_fn native, void *userdata)
+{
+  int results = T(INT) | T(REAL) | T(BOOLEAN) | T(STR) | T(NONE);
+
+  if (name == NULL || name[0] == '\0' || native == NULL)
+    return BUILTIN_UNRESOLVED;
+  if (num_params < 0 || num_params > 2 || (param_types & BUILTIN_ANY_TYPE) == 0)
+    return BUILTIN_UNRESOLVED;
+  if (result_types == 0 || (result_types & ~results) != 0)
+    return BUILTIN_UNRESOLVED;
+
+  int slot = find(registry, name);
+
+  if (registry->slots[slot] != BUILTIN_UNRESOLVED) // taken
+    return BUILTIN_UNRESOLVED;
+
+  if (registry->num_natives == registry->natives_capacity)
+  {
+    registry->natives_capacity = (registry->natives_capacity == 0) ? 4 : 2 * registry->natives_capacity;
+    registry->natives = (struct BUILTIN *)realloc(registry->natives, registry->natives_capacity * sizeof(struct BUILTIN));
+    if (registry->natives == NULL)
+      panic("out of memory");
+  }
+
+  struct BUILTIN *function = &registry->natives[registry->num_natives];
+
+  function->name = dupString((char *)name);
+  function->min_params = num_params;
+  function->max_params = num_params;
+  function->param_types = param_types & BUILTIN_ANY_TYPE;
+  function->result_types = result_types;
+  function->method = false;
+  function->native = native;
+  function->userdata = userdata;
+
+  int id = BUILTIN_NATIVES + registry->num_natives;
+
+  registry->num_natives++;
+  registry->slots[slot] = id;
+
+  if (2 * (BUILTIN_NATIVES - 1 + registry->num_natives) > registry->num_slots)
+    grow(registry);
+
+  return id;
+}
+
+//
+// builtins_resolve
+//
+int builtins_resolve(struct Builtins *registry, const char *name, bool method)
+{
+  int id = registry->slots[find(registry, name)];
+
+  if (id == BUILTIN_UNRESOLVED || get(registry, id)->method != method)
+    return BUILTIN_UNRESOLVED;
+
+  return id;
+}
+
+//
+// builtins_get
+//
+const struct BUILTIN *builtins_get(struct Builtins *registry, int id)
+{
+  if (id <= BUILTIN_UNRESOLVED)
+    return NULL;
+  if (id < BUILTIN_NATIVES)
+    return &Core[id];
+  if (registry == NULL || id - BUILTIN_NATIVES >= registry->num_natives)
+    return NULL;
+
+  return &registry->natives[id - BUILTIN_NATIVES];
+}
@@ -0,0 +1,130 @@
+/*builtins.h*/
+
+//
+// The functions a nuPython program can call: the builtins print(),
+// input(), int(), float(), len(), sum(), min(), max(), abs() and
+// dot(), the list method append(), and native C functions that an
+// embedder registers (see nupy_register in nupy.h).
+//
+// Each function has an ID. When the program graph is built, the name
+// at each call site is looked up in the interpreter's registry (one
+// hash probe) and the ID is stored in the call site; a name that is
+// not known yet, e.g. a native registered after the program was
+// compiled, is looked up again at its first call. The executor then
+// dispatches on the ID, and never compares names.
+//
+// The IDs of the builtins are fixed, so they are kept in the graph
+// cache. Natives are numbered from BUILTIN_NATIVES in the order they
+// are registered, so the cache leaves them to be looked up again, and
+// a program compiled with natives must run in an interpreter with the
+// same natives registered in the same order, e.g. the one that
+// compiled it.
+//
+// Each function also records the number of parameters it takes and,
+// as masks of RAM types (BUILTIN_TYPE(RAM_TYPE_INT) | ...), the types
+// it accepts and returns. Calls with the wrong number of parameters
+// are rejected before the function runs. Natives are only passed
+// values of the types they accept, and must return one of the types
+// they declare. The optimizer types an assignment from a builtin by
+// the builtin's result types.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "ram.h"
+
+#define BUILTIN_TYPE(type) (1 << (type))
+#define BUILTIN_ANY_TYPE 0xFF // all the RAM types
+
+//
+// The IDs:
+//
+enum BUILTIN_ID
+{
+  BUILTIN_UNRESOLVED = 0, // not looked up yet, or no such function
+  BUILTIN_PRINT,
+  BUILTIN_INPUT,
+  BUILTIN_INT,
+  BUILTIN_FLOAT,
+  BUILTIN_LEN,
+  BUILTIN_SUM,
+  BUILTIN_MIN,
+  BUILTIN_MAX,
+  BUILTIN_ABS,
+  BUILTIN_DOT,
+  BUILTIN_APPEND, // x.append(value)
+  BUILTIN_NATIVES // the first native
+};
+
+//
+// A native function: called with the values of its num_args
+// parameters, which it must not keep or free, it stores its
+// result in *result and returns true, or returns false if it
+// failed, which stops the program. A string result must be
+// allocated with malloc, and is then owned by the interpreter.
+//
+typedef bool (*builtin_native_fn)(void *userdata, struct RAM_VALUE *args, int num_args, struct RAM_VALUE *result);
+
+struct BUILTIN
+{
+  const char *name;
+  int min_params; // # of parameters, not counting x in x.name()
+  int max_params;
+  int param_types;  // types each parameter may have
+  int result_types; // types the result may have
+  bool method;      // called as x.name(...)?
+
+  builtin_native_fn native; // NULL for the builtins
+  void *userdata;
+};
+
+struct Builtins; // a registry, one per interpreter
+
+//
+// Public functions:
+//
+
+//
+// builtins_create
+//
+// Returns a new registry holding just the builtins, or NULL
+// if out of memory.
+//
+struct Builtins *builtins_create(void);
+
+//
+// builtins_destroy
+//
+// Frees the registry. NULL is ignored.
+//
+void builtins_destroy(struct Builtins *registry);
+
+//
+// builtins_register
+//
+// Registers a native function taking num_params parameters,
+// 0, 1 or 2, each of one of the param_types, and returning one
+// of the result_types, which may be ints, reals, booleans,
+// strings and None. Returns its ID, or BUILTIN_UNRESOLVED if
+// the name is taken or the metadata is invalid.
+//
+int builtins_register(struct Builtins *registry, const char *name, int num_params, int param_types, int result_types,
+                      builtin_native_fn native, void *userdata);
+
+//
+// builtins_resolve
+//
+// Returns the ID of the named function, or of the named method
+// if method is true, or BUILTIN_UNRESOLVED if there is none.
+//
+int builtins_resolve(struct Builtins *registry, const char *name, bool method);
+
+//
+// builtins_get
+//
+// Returns the function with the given ID, or NULL if there is
+// none. The registry may be NULL to get just the builtins.
+//
+const struct BUILTIN *builtins_get(struct Builtins *registry, int id);
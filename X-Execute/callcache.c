@@ -0,0 +1,196 @@
+/*callcache.c*/
+
+//
+// Inline caches for nuPython's calls; see callcache.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h> // uintptr_t
+#include <assert.h>
+
+#include "callcache.h"
+#include "optimizer.h"
+
+//
+// Private functions:
+//
+
+//
+// signature
+//
+// Returns the types of the arguments packed 4 bits apiece, after a
+// leading 1 so that calls with fewer arguments differ, or 0 if
+// there are too many to pack, in which case the call isn't typed.
+//
+static unsigned int signature(struct RAM_VALUE *args, int num_args)
+{
+  if (num_args > 7)
+    return 0;
+
+  unsigned int sig = 1;
+
+  for (int i = 0; i < num_args; i++)
+    sig = (sig << 4) | (unsigned int)(args[i].value_type + 1);
+
+  return sig;
+}
+
+//
+// specialize
+//
+// Returns the function's body typed for the given signature,
+// copying and typing it if that hasn't been done; the def's own
+// body if the function has as many copies as it may, or if out of
+// memory.
+//
+static struct STMT *specialize(struct CallCache *cache, struct STMT *function, unsigned int sig,
+                               struct RAM_VALUE *args, int num_args)
+{
+  struct STMT_DEF *def = function->types.def;
+  int copies = 0;
+
+  for (struct Specialization *s = cache->specializations; s != NULL; s = s->next)
+  {
+    if (s->function != function)
+      continue;
+    if (s->signature == sig)
+      return s->body;
+
+    copies++;
+  }
+
+  if (copies == CALLCACHE_MAX_SPECIALIZATIONS || def->body == NULL)
+    return def->body;
+
+  struct Specialization *s = (struct Specialization *)malloc(sizeof(struct Specialization));
+  if (s == NULL)
+    return def->body;
+
+  int types[7];
+
+  for (int i = 0; i < num_args; i++)
+    types[i] = args[i].value_type;
+
+  s->function = function;
+  s->signature = sig;
+  s->body = programgraph_copy(def->body);
+  s->next = cache->specializations;
+
+  optimizer_specialize(function, s->body, types);
+
+  cache->specializations = s;
+
+  return s->body;
+}
+
+//
+// Public functions:
+//
+
+//
+// callcache_create
+//
+// Returns a new cache with no entries, or NULL if out of memory.
+//
+struct CallCache *callcache_create(void)
+{
+  struct CallCache *cache = (struct CallCache *)malloc(sizeof(struct CallCache));
+  if (cache == NULL)
+    return NULL;
+
+  for (int i = 0; i < CALLCACHE_SIZE; i++)
+  {
+    cache->entries[i].site = NULL;
+    cache->builtins[i].site = NULL;
+  }
+
+  cache->specializations = NULL;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->tail_calls = 0;
+
+  return cache;
+}
+
+//
+// callcache_destroy
+//
+// Frees the cache and the typed copies it made. NULL is ignored.
+//
+void callcache_destroy(struct CallCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  struct Specialization *s = cache->specializations;
+
+  while (s != NULL)
+  {
+    struct Specialization *next = s->next;
+
+    programgraph_destroy(s->body);
+    free(s);
+
+    s = next;
+  }
+
+  free(cache);
+}
+
+//
+// callcache_body
+//
+// Returns the body to run for a call, at the given site, of the
+// given function, with the given arguments: a copy of the def's
+// body typed for their types, or else the def's own body.
+//
+struct STMT *callcache_body(struct CallCache *cache, const void *site, struct STMT *function, struct RAM_VALUE *args,
+                            int num_args)
+{
+  assert(function->stmt_type == STMT_DEF);
+
+  unsigned int sig = signature(args, num_args);
+
+  if (sig == 0)
+    return function->types.def->body;
+
+  //
+  // the calls are allocated at least 16 bytes apart:
+  //
+  struct CallCacheEntry *entry = &cache->entries[((uintptr_t)site >> 4) & (CALLCACHE_SIZE - 1)];
+
+  if (entry->site == site && entry->signature == sig)
+  {
+    cache->hits++;
+    return entry->body;
+  }
+
+  cache->misses++;
+
+  entry->site = site;
+  entry->signature = sig;
+  entry->body = specialize(cache, function, sig, args, num_args);
+
+  return entry->body;
+}
+
+//
+// callcache_builtin
+//
+// Returns the ID of the function called, by the given name, at
+// the given site, looking it up if the site's entry is for
+// another site.
+//
+int callcache_builtin(struct CallCache *cache, const void *site, struct Builtins *registry, const char *name, bool method)
+{
+  struct CallCacheBuiltin *entry = &cache->builtins[((uintptr_t)site >> 4) & (CALLCACHE_SIZE - 1)];
+
+  if (entry->site != site)
+  {
+    entry->site = site;
+    entry->builtin = builtins_resolve(registry, name, method);
+  }
+
+  return entry->builtin;
+}
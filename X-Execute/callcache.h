@@ -0,0 +1,110 @@
+/*callcache.h*/
+
+//
+// Inline caches for the calls of functions a nuPython program defines.
+//
+// A call is bound to its function's def when the graph is built, so
+// what a call site caches is the body to run for the types of the
+// arguments it was last called with. The first call of a function
+// with a given list of argument types makes a copy of the function's
+// body and types it for those arguments (see optimizer_specialize),
+// so its arithmetic on the parameters runs without checking their
+// types. Each site then remembers the types it saw and the copy it
+// got: while a site keeps passing arguments of the same types, which
+// most do, a call checks them against what the site remembers and
+// runs the typed copy, else it looks the types up among the
+// function's copies, making one if there are fewer than
+// CALLCACHE_MAX_SPECIALIZATIONS, else running the untyped body.
+//
+// A call site also caches the ID of a function that wasn't known when
+// the graph was built, e.g. a native registered since (see builtins.h),
+// which is looked up by name at the site's first call.
+//
+// The caches are kept by the interpreter, not in the graph, since
+// a graph may be run by several interpreters at once (see daemon.c),
+// each with its own natives, and hold pointers into the graph, so
+// they must be destroyed before the interpreter runs another program.
+//
+
+#pragma once
+
+#include "programgraph.h"
+#include "ram.h"
+#include "builtins.h"
+
+#define CALLCACHE_SIZE 256 // call sites, direct-mapped
+#define CALLCACHE_MAX_SPECIALIZATIONS 4 // typed copies per function
+
+struct CallCacheEntry
+{
+  const void *site;       // the call, NULL if the entry is empty
+  unsigned int signature; // the argument types it was last called with
+  struct STMT *body;      // ... and the body run for them
+};
+
+struct CallCacheBuiltin
+{
+  const void *site; // the call, NULL if the entry is empty
+  int builtin;      // the ID its name resolved to
+};
+
+struct Specialization
+{
+  struct STMT *function;  // the def
+  unsigned int signature; // the parameter types the copy is typed for
+  struct STMT *body;      // the typed copy of the def's body
+  struct Specialization *next;
+};
+
+struct CallCache
+{
+  struct CallCacheEntry entries[CALLCACHE_SIZE];
+  struct CallCacheBuiltin builtins[CALLCACHE_SIZE];
+  struct Specialization *specializations;
+
+  //
+  // stats: calls that found their site's types in its entry, those
+  // that didn't, and calls that reused the caller's frame:
+  //
+  long hits;
+  long misses;
+  long tail_calls;
+};
+
+//
+// Public functions:
+//
+
+//
+// callcache_create
+//
+// Returns a new cache with no entries, or NULL if out of memory.
+//
+struct CallCache *callcache_create(void);
+
+//
+// callcache_destroy
+//
+// Frees the cache and the typed copies it made. NULL is ignored.
+//
+void callcache_destroy(struct CallCache *cache);
+
+//
+// callcache_body
+//
+// Returns the body to run for a call, at the given site, of the
+// given function, with the given arguments: a copy of the def's
+// body typed for their types, or else the def's own body.
+//
+struct STMT *callcache_body(struct CallCache *cache, const void *site, struct STMT *function, struct RAM_VALUE *args,
+                            int num_args);
+
+//
+// callcache_builtin
+//
+// Returns the ID of the function called, by the given name, at the
+// given site, whose ID wasn't known when the graph was built: the
+// name is looked up in the registry at the site's first call. Returns
+// BUILTIN_UNRESOLVED if there is no such function.
+//
+int callcache_builtin(struct CallCache *cache, const void *site, struct Builtins *registry, const char *name, bool method);
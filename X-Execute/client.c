@@ -0,0 +1,237 @@
+/*client.c*/
+
+//
+// Client for the nuPython server (see daemon.h): sends a script to
+// a running server (a.out --serve), forwards our standard input to
+// the script's input(), and copies the script's output to standard
+// output as it arrives.
+//
+// usage: nupy-client [-s socket] filename.py
+//        nupy-client [-s socket] -c 'source code'
+//
+// The socket defaults to $NUPY_SOCKET, or DAEMON_DEFAULT_SOCKET.
+// The exit status is the script's status (enum BATCH_STATUS), so
+// 0 if the script ran successfully.
+//
+
+// realpath() is POSIX, not C11:
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // uint32_t
+#include <string.h>
+#include <errno.h>
+#include <limits.h>     // PATH_MAX
+#include <poll.h>
+#include <unistd.h>     // read, close
+#include <sys/socket.h> // socket, connect, send, recv
+#include <sys/un.h>     // sockaddr_un
+
+#include "daemon.h"
+
+//
+// recv_full, send_full
+//
+// Receive / send exactly length bytes. Return false if the
+// connection is closed or lost.
+//
+static bool recv_full(int fd, void *buffer, size_t length)
+{
+  char *p = (char *)buffer;
+
+  while (length > 0)
+  {
+    ssize_t n = recv(fd, p, length, 0);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+
+    p += n;
+    length -= n;
+  }
+
+  return true;
+}
+
+static bool send_full(int fd, const void *buffer, size_t length)
+{
+  const char *p = (const char *)buffer;
+
+  while (length > 0)
+  {
+    ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+
+    p += n;
+    length -= n;
+  }
+
+  return true;
+}
+
+static bool send_frame(int fd, char type, const void *payload, uint32_t length)
+{
+  char header[DAEMON_FRAME_HEADER];
+
+  header[0] = type;
+  memcpy(&header[1], &length, sizeof(length));
+
+  return send_full(fd, header, sizeof(header)) && send_full(fd, payload, length);
+}
+
+//
+// main
+//
+int main(int argc, char *argv[])
+{
+  char *socket_path = getenv("NUPY_SOCKET");
+  int arg = 1;
+
+  if (socket_path == NULL)
+    socket_path = DAEMON_DEFAULT_SOCKET;
+
+  if (argc >= 3 && strcmp(argv[1], "-s") == 0)
+  {
+    socket_path = argv[2];
+    arg = 3;
+  }
+
+  char type;
+  char *payload;
+  char path[PATH_MAX];
+
+  if (argc == arg + 2 && strcmp(argv[arg], "-c") == 0)
+  {
+    type = DAEMON_SOURCE;
+    payload = argv[arg + 1];
+  }
+  else if (argc == arg + 1)
+  {
+    //
+    // the server has its own working directory:
+    //
+    if (realpath(argv[arg], path) == NULL)
+    {
+      printf("**ERROR: unable to open input file '%s' for input.\n", argv[arg]);
+      return 1;
+    }
+
+    type = DAEMON_PATH;
+    payload = path;
+  }
+  else
+  {
+    printf("usage: %s [-s socket] filename.py\n", argv[0]);
+    printf("       %s [-s socket] -c 'source code'\n", argv[0]);
+    return 1;
+  }
+
+  struct sockaddr_un addr;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+  {
+    printf("**ERROR: socket path '%s' is too long.\n", socket_path);
+    return 1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    printf("**ERROR: unable to connect to nuPython server at '%s': %s.\n", socket_path, strerror(errno));
+    return 1;
+  }
+
+  if (!send_frame(fd, type, payload, (uint32_t)strlen(payload)))
+  {
+    printf("**ERROR: lost connection to nuPython server.\n");
+    return 1;
+  }
+
+  //
+  // forward our input until it runs out, and copy the output
+  // until the server says the script is done:
+  //
+  struct pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+  int num_fds = 2;
+  char buffer[8192];
+
+  while (true)
+  {
+    if (poll(fds, num_fds, -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    if (fds[0].revents != 0)
+    {
+      char header[DAEMON_FRAME_HEADER];
+      uint32_t length;
+
+      if (!recv_full(fd, header, sizeof(header)))
+        break;
+
+      memcpy(&length, &header[1], sizeof(length));
+
+      if (header[0] == DAEMON_EXIT)
+      {
+        char status = 1;
+
+        recv_full(fd, &status, 1);
+        close(fd);
+
+        return status;
+      }
+
+      while (length > 0) // copy the output:
+      {
+        uint32_t n = (length < sizeof(buffer)) ? length : sizeof(buffer);
+
+        if (!recv_full(fd, buffer, n))
+          break;
+
+        fwrite(buffer, 1, n, stdout);
+        length -= n;
+      }
+
+      if (length > 0)
+        break;
+
+      fflush(stdout);
+    }
+
+    if (num_fds == 2 && fds[1].revents != 0)
+    {
+      ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+      if (n > 0)
+      {
+        send_frame(fd, DAEMON_INPUT, buffer, (uint32_t)n);
+      }
+      else // end of our input:
+      {
+        send_frame(fd, DAEMON_EOF, NULL, 0);
+        num_fds = 1;
+      }
+    }
+  }
+
+  printf("**ERROR: lost connection to nuPython server.\n");
+  close(fd);
+
+  return 1;
+}
@@ -0,0 +1,1143 @@
+/*closure.c*/
+
+//
+// Closure compiler for nuPython program graphs; see closure.h.
+//
+// A statement compiles into a struct Closure, whose run function
+// does just what that kind of statement needs, e.g. x = y * 2.5
+// with y proven to be an int into a closure that runs
+// run_assign_expr(), whose expression is bound to mul_id(). The
+// statements of a block are chained by their next pointers.
+//
+// Variables are numbered, as slots, when the program is compiled;
+// while it runs, each slot holds the variable's address in memory
+// once it's been looked up, since that never changes.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+#include <math.h>    // pow, fmod, fabs
+#include <assert.h>  // assert
+
+#include "closure.h"
+#include "execute.h"
+#include "induction.h"
+#include "loopkernel.h"
+#include "list.h"
+#include "dict.h"
+#include "builtins.h"
+#include "ram.h"
+#include "util.h"
+
+//
+// A run of a compiled program:
+//
+struct Context
+{
+  struct Interpreter *interp;
+  int *addresses; // of the variables, by slot; -1 => not in memory yet
+};
+
+//
+// A compiled element of an expression: fetches its value, which
+// is only borrowed (a string is not copied), after checking that
+// a variable has been assigned unless that's been proven.
+//
+struct Operand;
+
+typedef bool (*Fetch)(struct Context *ctx, struct Operand *operand, struct STMT *stmt, struct RAM_VALUE *value);
+
+struct Operand
+{
+  Fetch fetch;
+  int slot;               // a variable's,
+  char *name;             // and its name
+  struct RAM_VALUE value; // a literal's
+};
+
+//
+// A compiled expression: evaluates it, into a value that owns any
+// string, and a reference to any list or dictionary.
+//
+struct Expr;
+
+typedef bool (*Eval)(struct Context *ctx, struct Expr *expr, struct RAM_VALUE *result);
+
+struct Expr
+{
+  Eval eval;
+  int operator;
+  struct Operand lhs;
+  struct Operand rhs;
+  struct STMT *stmt;        // for the line # in error messages
+  struct VALUE_EXPR *graph; // evaluated by the executor, e.g. x[i]
+};
+
+//
+// A compiled condition: decides it, into a C bool. An and or an
+// or decides its rhs only if its lhs doesn't decide it, and a
+// comparison of two proven ints is made on the C ints.
+//
+struct Test;
+
+typedef bool (*Decide)(struct Context *ctx, struct Test *test, bool *truth);
+
+struct Test
+{
+  Decide decide;
+  struct Expr expr;   // an expression's
+  struct Test *lhs;   // an and's, or's or not's
+  struct Test *rhs;   // an and's or or's
+  struct Test *chain; // of all the tests, for freeing
+};
+
+//
+// A compiled statement:
+//
+struct Closure;
+
+typedef bool (*Run)(struct Context *ctx, struct Closure *closure);
+
+struct Closure
+{
+  Run run;
+  struct Closure *next;      // in the same block, NULL at its end
+  struct STMT *stmt;
+
+  int slot;                  // variable assigned,
+  char *name;                // and its name
+  struct Operand operand;    // value assigned, or printed
+  struct Expr expr;          // expression assigned
+  struct Test *test;         // loop condition
+  char *text;                // output by printing a literal
+
+  struct Operand range[3];   // start, stop and step of a for loop
+  struct Closure *preheader; // of a loop
+  struct Closure *body;
+
+  struct Closure *chain;     // of all the closures, for freeing
+};
+
+struct ClosureProgram
+{
+  struct Closure *program;
+  struct Closure *closures; // all of them, by chain
+  struct Test *tests;       // all of them, by chain
+  int num_slots;
+};
+
+//
+// Compiling a program:
+//
+struct Compiler
+{
+  struct ClosureProgram *compiled;
+
+  char **names;  // hash table of the variables' names,
+  int *slots;    // and their slots
+  int capacity;  // a power of 2
+  bool failed;   // the executor doesn't run the program either
+};
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**CLOSURE ERROR\n");
+  printf("**CLOSURE ERROR: %s\n", msg);
+  printf("**CLOSURE ERROR\n");
+
+  exit(-123);
+}
+
+//
+// address_of
+//
+// Returns the address of the variable in memory, -1 if it's
+// not there.
+//
+static int address_of(struct Context *ctx, int slot, char *name)
+{
+  int address = ctx->addresses[slot];
+
+  if (address < 0)
+  {
+    address = ram_get_addr(ctx->interp->memory, name);
+    ctx->addresses[slot] = address;
+  }
+
+  return address;
+}
+
+//
+// store
+//
+// Writes the value to the variable, which makes its own copy of
+// a string.
+//
+static void store(struct Context *ctx, int slot, char *name, struct RAM_VALUE value)
+{
+  int address = address_of(ctx, slot, name);
+
+  if (address >= 0)
+    ram_write_cell_by_addr(ctx->interp->memory, value, address);
+  else
+    ram_write_cell_by_id(ctx->interp->memory, value, name);
+}
+
+//
+// fetch_*
+//
+// The ways of fetching an operand: a literal, a variable, and a
+// variable proven to be assigned before it's read.
+//
+static bool fetch_literal(struct Context *ctx, struct Operand *operand, struct STMT *stmt, struct RAM_VALUE *value)
+{
+  *value = operand->value;
+
+  return true;
+}
+
+static bool fetch_variable(struct Context *ctx, struct Operand *operand, struct STMT *stmt, struct RAM_VALUE *value)
+{
+  int address = address_of(ctx, operand->slot, operand->name);
+
+  if (address < 0)
+  {
+    fprintf(ctx->interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", operand->name, stmt->line);
+    return false;
+  }
+
+  *value = ctx->interp->memory->cells[address].value;
+
+  return true;
+}
+
+static bool fetch_defined(struct Context *ctx, struct Operand *operand, struct STMT *stmt, struct RAM_VALUE *value)
+{
+  int address = address_of(ctx, operand->slot, operand->name);
+
+  assert(address >= 0);
+  *value = ctx->interp->memory->cells[address].value;
+
+  return true;
+}
+
+//
+// division_by_zero, invalid_operands
+//
+// Output the executor's error messages, and return false.
+//
+static bool division_by_zero(struct Context *ctx, struct Expr *expr)
+{
+  fprintf(ctx->interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", expr->stmt->line);
+  return false;
+}
+
+static bool invalid_operands(struct Context *ctx, struct Expr *expr)
+{
+  fprintf(ctx->interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", expr->stmt->line);
+  return false;
+}
+
+//
+// release
+//
+// Frees what an evaluated value owns: a string, or a reference
+// to a list or dictionary.
+//
+static void release(struct RAM_VALUE *value)
+{
+  if (value->value_type == RAM_TYPE_STR)
+    free(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_release(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_release(value->types.m);
+}
+
+//
+// eval_unary, eval_binary, eval_executed
+//
+// Evaluate expressions whose operand types aren't known: just an
+// element, whose value is copied, any binary operator, via
+// execute_operator, or subscripts, by the executor.
+//
+static bool eval_unary(struct Context *ctx, struct Expr *expr, struct RAM_VALUE *result)
+{
+  if (!expr->lhs.fetch(ctx, &expr->lhs, expr->stmt, result))
+    return false;
+
+  if (result->value_type == RAM_TYPE_STR)
+    result->types.s = dupString(result->types.s);
+  else if (result->value_type == RAM_TYPE_LIST)
+    list_retain(result->types.l);
+  else if (result->value_type == RAM_TYPE_DICT)
+    dict_retain(result->types.m);
+
+  return true;
+}
+
+static bool eval_binary(struct Context *ctx, struct Expr *expr, struct RAM_VALUE *result)
+{
+  struct RAM_VALUE lhs, rhs;
+
+  if (!expr->lhs.fetch(ctx, &expr->lhs, expr->stmt, &lhs) ||
+      !expr->rhs.fetch(ctx, &expr->rhs, expr->stmt, &rhs))
+    return false;
+
+  return execute_operator(ctx->interp, expr->stmt, expr->operator, lhs, rhs, result);
+}
+
+static bool eval_executed(struct Context *ctx, struct Expr *expr, struct RAM_VALUE *result)
+{
+  return execute_expr(ctx->interp, expr->stmt, expr->graph, result);
+}
+
+//
+// The evaluators for expressions whose operand types are known
+// are instantiated from these templates, for each operator and
+// pair of operand types, with the semantics of execute_operator:
+// L and R are the members of the values' union holding the
+// operands (i, d or s). Ints wrap around, and an int and a real
+// give a real; the real comparisons have the executor's
+// tolerances.
+//
+#define EVAL(name, L, R, statement)                                                        \
+  static bool name##_##L##R(struct Context *ctx, struct Expr *expr, struct RAM_VALUE *result) \
+  {                                                                                        \
+    struct RAM_VALUE lhs, rhs;                                                             \
+    if (!expr->lhs.fetch(ctx, &expr->lhs, expr->stmt, &lhs) ||                             \
+        !expr->rhs.fetch(ctx, &expr->rhs, expr->stmt, &rhs))                               \
+      return false;                                                                        \
+    statement;                                                                             \
+    return true;                                                                           \
+  }
+
+#define INT(value) (result->value_type = RAM_TYPE_INT, result->types.i = (value))
+#define REAL(value) (result->value_type = RAM_TYPE_REAL, result->types.d = (value))
+#define BOOL(value) (result->value_type = RAM_TYPE_BOOLEAN, result->types.i = (value) ? 1 : 0)
+
+#define INT_EVALS                                                                                   \
+  EVAL(add, i, i, INT((int)((unsigned)lhs.types.i + (unsigned)rhs.types.i)))                       \
+  EVAL(sub, i, i, INT((int)((unsigned)lhs.types.i - (unsigned)rhs.types.i)))                       \
+  EVAL(mul, i, i, INT((int)((unsigned)lhs.types.i * (unsigned)rhs.types.i)))                       \
+  EVAL(pow, i, i, INT(pow(lhs.types.i, rhs.types.i)))                                              \
+  EVAL(mod, i, i, if (rhs.types.i == 0) return division_by_zero(ctx, expr); INT((rhs.types.i == -1) ? 0 : lhs.types.i % rhs.types.i)) \
+  EVAL(div, i, i, if (rhs.types.i == 0) return division_by_zero(ctx, expr); INT((rhs.types.i == -1) ? (int)(0u - (unsigned)lhs.types.i) : lhs.types.i / rhs.types.i)) \
+  EVAL(eq, i, i, BOOL(lhs.types.i == rhs.types.i))                                                 \
+  EVAL(ne, i, i, BOOL(lhs.types.i != rhs.types.i))                                                 \
+  EVAL(lt, i, i, BOOL(lhs.types.i < rhs.types.i))                                                  \
+  EVAL(lte, i, i, BOOL(lhs.types.i <= rhs.types.i))                                                \
+  EVAL(gt, i, i, BOOL(lhs.types.i > rhs.types.i))                                                  \
+  EVAL(gte, i, i, BOOL(lhs.types.i >= rhs.types.i))
+
+#define REAL_EVALS(L, R)                                                                            \
+  EVAL(add, L, R, REAL((double)lhs.types.L + (double)rhs.types.R))                                 \
+  EVAL(sub, L, R, REAL((double)lhs.types.L - (double)rhs.types.R))                                 \
+  EVAL(mul, L, R, REAL((double)lhs.types.L * (double)rhs.types.R))                                 \
+  EVAL(pow, L, R, REAL(pow((double)lhs.types.L, (double)rhs.types.R)))                             \
+  EVAL(mod, L, R, if ((double)rhs.types.R == 0.0) return division_by_zero(ctx, expr); REAL(fmod((double)lhs.types.L, (double)rhs.types.R))) \
+  EVAL(div, L, R, if ((double)rhs.types.R == 0.0) return division_by_zero(ctx, expr); REAL((double)lhs.types.L / (double)rhs.types.R)) \
+  EVAL(eq, L, R, BOOL(fabs((double)lhs.types.L - (double)rhs.types.R) < 0.001))                    \
+  EVAL(ne, L, R, BOOL(fabs((double)lhs.types.L - (double)rhs.types.R) > 0.001))                    \
+  EVAL(lt, L, R, BOOL((double)lhs.types.L < (double)rhs.types.R))                                  \
+  EVAL(lte, L, R, BOOL((double)lhs.types.L <= (double)rhs.types.R + 0.0001))                       \
+  EVAL(gt, L, R, BOOL((double)lhs.types.L > (double)rhs.types.R + 0.0001))                         \
+  EVAL(gte, L, R, BOOL((double)lhs.types.L > (double)rhs.types.R - 0.0001))
+
+//
+// strings: + concatenates, into new memory, and only the
+// comparisons are valid besides
+//
+#define STR_EVALS                                                                                   \
+  EVAL(add, s, s, result->value_type = RAM_TYPE_STR; result->types.s = dupStrings(lhs.types.s, rhs.types.s)) \
+  EVAL(sub, s, s, return invalid_operands(ctx, expr))                                              \
+  EVAL(mul, s, s, return invalid_operands(ctx, expr))                                              \
+  EVAL(pow, s, s, return invalid_operands(ctx, expr))                                              \
+  EVAL(mod, s, s, return invalid_operands(ctx, expr))                                              \
+  EVAL(div, s, s, return invalid_operands(ctx, expr))                                              \
+  EVAL(eq, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) == 0))                                      \
+  EVAL(ne, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) != 0))                                      \
+  EVAL(lt, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) < 0))                                       \
+  EVAL(lte, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) <= 0))                                     \
+  EVAL(gt, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) > 0))                                       \
+  EVAL(gte, s, s, BOOL(strcmp(lhs.types.s, rhs.types.s) >= 0))
+
+INT_EVALS
+REAL_EVALS(i, d)
+REAL_EVALS(d, i)
+REAL_EVALS(d, d)
+STR_EVALS
+
+//
+// The evaluators by operand types (enum EXPR_TYPES, int-int
+// through str-str) and operator (enum OPERATORS, + through >=):
+//
+#define EVAL_ROW(L, R)                                                      \
+  {                                                                         \
+    add_##L##R, sub_##L##R, mul_##L##R, pow_##L##R, mod_##L##R, div_##L##R, \
+        eq_##L##R, ne_##L##R, lt_##L##R, lte_##L##R, gt_##L##R, gte_##L##R  \
+  }
+
+static const Eval typed_evals[EXPR_TYPES_STR_STR][OPERATOR_GTE + 1] = {
+    EVAL_ROW(i, i),
+    EVAL_ROW(i, d),
+    EVAL_ROW(d, i),
+    EVAL_ROW(d, d),
+    EVAL_ROW(s, s)};
+
+//
+// decide_*
+//
+// The ways of deciding a condition: an expression, which must be
+// a boolean (else the loop fails without a message, as in
+// execute_while_loop), and, or, not, and the comparisons of two
+// proven ints, by operator (enum OPERATORS, == through >=).
+//
+static bool decide_expr(struct Context *ctx, struct Test *test, bool *truth)
+{
+  struct RAM_VALUE value;
+
+  if (!test->expr.eval(ctx, &test->expr, &value))
+    return false;
+
+  if (value.value_type != RAM_TYPE_BOOLEAN)
+  {
+    release(&value);
+    return false;
+  }
+
+  *truth = (value.types.i != 0);
+
+  return true;
+}
+
+static bool decide_and(struct Context *ctx, struct Test *test, bool *truth)
+{
+  if (!test->lhs->decide(ctx, test->lhs, truth))
+    return false;
+
+  return !*truth || test->rhs->decide(ctx, test->rhs, truth);
+}
+
+static bool decide_or(struct Context *ctx, struct Test *test, bool *truth)
+{
+  if (!test->lhs->decide(ctx, test->lhs, truth))
+    return false;
+
+  return *truth || test->rhs->decide(ctx, test->rhs, truth);
+}
+
+static bool decide_not(struct Context *ctx, struct Test *test, bool *truth)
+{
+  if (!test->lhs->decide(ctx, test->lhs, truth))
+    return false;
+
+  *truth = !*truth;
+
+  return true;
+}
+
+#define DECIDE(name, op)                                                             \
+  static bool decide_##name(struct Context *ctx, struct Test *test, bool *truth)     \
+  {                                                                                  \
+    struct Expr *expr = &test->expr;                                                 \
+    struct RAM_VALUE lhs, rhs;                                                       \
+    if (!expr->lhs.fetch(ctx, &expr->lhs, expr->stmt, &lhs) ||                       \
+        !expr->rhs.fetch(ctx, &expr->rhs, expr->stmt, &rhs))                         \
+      return false;                                                                  \
+    *truth = (lhs.types.i op rhs.types.i);                                           \
+    return true;                                                                     \
+  }
+
+DECIDE(eq, ==)
+DECIDE(ne, !=)
+DECIDE(lt, <)
+DECIDE(lte, <=)
+DECIDE(gt, >)
+DECIDE(gte, >=)
+
+static const Decide int_decides[OPERATOR_GTE - OPERATOR_EQUAL + 1] = {
+    decide_eq, decide_ne, decide_lt, decide_lte, decide_gt, decide_gte};
+
+//
+// run_block
+//
+// Runs the closures of a block, returning false as soon as one
+// fails.
+//
+static bool run_block(struct Context *ctx, struct Closure *closure)
+{
+  for (; closure != NULL; closure = closure->next)
+    if (!closure->run(ctx, closure))
+      return false;
+
+  return true;
+}
+
+//
+// run_*
+//
+// The ways of running a statement.
+//
+
+// x = 123, x = y
+static bool run_assign_copy(struct Context *ctx, struct Closure *closure)
+{
+  struct RAM_VALUE value;
+
+  if (!closure->operand.fetch(ctx, &closure->operand, closure->stmt, &value))
+    return false;
+
+  store(ctx, closure->slot, closure->name, value);
+
+  return true;
+}
+
+// x = y * 2.5
+static bool run_assign_expr(struct Context *ctx, struct Closure *closure)
+{
+  struct RAM_VALUE value;
+
+  if (!closure->expr.eval(ctx, &closure->expr, &value))
+    return false;
+
+  store(ctx, closure->slot, closure->name, value);
+  release(&value);
+
+  return true;
+}
+
+// x = input('...'), and anything else left to the executor
+static bool run_executed(struct Context *ctx, struct Closure *closure)
+{
+  return execute_statement(ctx->interp, closure->stmt);
+}
+
+// print(), print(123)
+static bool run_print_text(struct Context *ctx, struct Closure *closure)
+{
+  fputs(closure->text, ctx->interp->output);
+
+  return true;
+}
+
+// print(x)
+static bool run_print_variable(struct Context *ctx, struct Closure *closure)
+{
+  struct RAM_VALUE value;
+  FILE *output = ctx->interp->output;
+
+  if (!closure->operand.fetch(ctx, &closure->operand, closure->stmt, &value))
+    return false;
+
+  switch (value.value_type)
+  {
+  case RAM_TYPE_BOOLEAN:
+    fprintf(output, "%s\n", value.types.i ? "True" : "False");
+    return true;
+  case RAM_TYPE_INT:
+    fprintf(output, "%d\n", value.types.i);
+    return true;
+  case RAM_TYPE_REAL:
+    fprintf(output, "%lf\n", value.types.d);
+    return true;
+  case RAM_TYPE_STR:
+    fprintf(output, "%s\n", value.types.s);
+    return true;
+  case RAM_TYPE_LIST:
+    list_print(output, value.types.l);
+    fprintf(output, "\n");
+    return true;
+  case RAM_TYPE_DICT:
+    dict_print(output, value.types.m);
+    fprintf(output, "\n");
+    return true;
+  default:
+    fprintf(output, "**ERROR: Unsupported data type in print statement\n");
+    return false;
+  }
+}
+
+// while condition: ..., as execute_while_loop runs it
+static bool run_while_loop(struct Context *ctx, struct Closure *closure)
+{
+  struct Test *test = closure->test;
+  bool truth;
+
+  if (!test->decide(ctx, test, &truth))
+    return false;
+
+  if (!truth)
+    return true;
+
+  if (!run_block(ctx, closure->preheader))
+    return false;
+
+  //
+  // a counting loop may be run without iterating (see induction.h),
+  // and one doing arithmetic on native values (see loopkernel.h);
+  // if that stops partway through an iteration, the rest of it
+  // runs here, from resume:
+  //
+  if (induction_run(ctx->interp, closure->stmt))
+    return true;
+
+  struct STMT *resume = closure->stmt->types.while_loop->loop_body;
+
+  if (loopkernel_run(ctx->interp, closure->stmt, &resume))
+    return true;
+
+  struct Closure *from = closure->body;
+
+  while (from != NULL && from->stmt != resume)
+    from = from->next;
+
+  if (from == NULL) // resume is a pass
+    from = closure->body;
+
+  do
+  {
+    if (!run_block(ctx, from))
+      return false;
+
+    from = closure->body;
+
+    if (!test->decide(ctx, test, &truth))
+      return false;
+  } while (truth);
+
+  return true;
+}
+
+// for x in range(start, stop, step): ..., as execute_for_loop runs it
+static bool run_for_loop(struct Context *ctx, struct Closure *closure)
+{
+  struct RAM_VALUE range[3];
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (!closure->range[i].fetch(ctx, &closure->range[i], closure->stmt, &range[i]))
+      return false;
+
+    if (range[i].value_type != RAM_TYPE_INT)
+    {
+      fprintf(ctx->interp->output, "**SEMANTIC ERROR: Invalid parameter for range() (line %d)\n", closure->stmt->line);
+      return false;
+    }
+  }
+
+  if (range[2].types.i == 0)
+  {
+    fprintf(ctx->interp->output, "**EXECUTION ERROR: range() arg 3 must not be zero (line %d)\n", closure->stmt->line);
+    return false;
+  }
+
+  long long stop = range[1].types.i;
+  long long step = range[2].types.i;
+  long long i = range[0].types.i;
+  struct RAM_VALUE value;
+
+  value.value_type = RAM_TYPE_INT;
+
+  //
+  // a loop doing arithmetic on native values may be run with
+  // kernels (see loopkernel.h); if that stops partway through an
+  // iteration, the rest of it runs here, from resume:
+  //
+  if ((step > 0) ? i < stop : i > stop)
+  {
+    struct STMT *resume = closure->stmt->types.for_loop->loop_body;
+    int counter = range[0].types.i;
+
+    if (loopkernel_run_for(ctx->interp, closure->stmt, &counter, range[1].types.i, range[2].types.i, &resume))
+      return true;
+
+    i = counter;
+
+    if (resume != closure->stmt->types.for_loop->loop_body)
+    {
+      struct Closure *from = closure->body;
+
+      while (from != NULL && from->stmt != resume)
+        from = from->next;
+
+      if (!run_block(ctx, from))
+        return false;
+
+      i += step;
+    }
+  }
+
+  for (; (step > 0) ? i < stop : i > stop; i += step)
+  {
+    value.types.i = (int)i;
+    store(ctx, closure->slot, closure->name, value);
+
+    if (!run_block(ctx, closure->body))
+      return false;
+  }
+
+  return true;
+}
+
+//
+// slot_of
+//
+// Returns the slot of the variable with the given name, numbering
+// it the first time it's seen.
+//
+static int slot_of(struct Compiler *compiler, char *name)
+{
+  if (2 * compiler->compiled->num_slots >= compiler->capacity) // grow, and rehash:
+  {
+    int capacity = (compiler->capacity == 0) ? 64 : 2 * compiler->capacity;
+    char **names = (char **)calloc(capacity, sizeof(char *));
+    int *slots = (int *)malloc(capacity * sizeof(int));
+
+    if (names == NULL || slots == NULL)
+      panic("out of memory (slot_of)");
+
+    for (int i = 0; i < compiler->capacity; i++)
+    {
+      if (compiler->names[i] == NULL)
+        continue;
+
+      int j = (int)(hashBytes(HASH_START, compiler->names[i], strlen(compiler->names[i])) & (capacity - 1));
+
+      while (names[j] != NULL)
+        j = (j + 1) & (capacity - 1);
+
+      names[j] = compiler->names[i];
+      slots[j] = compiler->slots[i];
+    }
+
+    free(compiler->names);
+    free(compiler->slots);
+    compiler->names = names;
+    compiler->slots = slots;
+    compiler->capacity = capacity;
+  }
+
+  int i = (int)(hashBytes(HASH_START, name, strlen(name)) & (compiler->capacity - 1));
+
+  for (; compiler->names[i] != NULL; i = (i + 1) & (compiler->capacity - 1))
+    if (strcmp(compiler->names[i], name) == 0)
+      return compiler->slots[i];
+
+  compiler->names[i] = name;
+  compiler->slots[i] = compiler->compiled->num_slots;
+
+  return compiler->compiled->num_slots++;
+}
+
+//
+// compile_operand
+//
+// Compiles an element of an expression, or a print parameter.
+//
+static void compile_operand(struct Compiler *compiler, struct ELEMENT *element, struct Operand *operand)
+{
+  memset(operand, 0, sizeof(struct Operand));
+  operand->fetch = fetch_literal;
+
+  switch (element->element_type)
+  {
+  case ELEMENT_INT_LITERAL:
+    operand->value.value_type = RAM_TYPE_INT;
+    operand->value.types.i = atoi(element->element_value);
+    break;
+  case ELEMENT_REAL_LITERAL:
+    operand->value.value_type = RAM_TYPE_REAL;
+    operand->value.types.d = atof(element->element_value);
+    break;
+  case ELEMENT_STR_LITERAL:
+    operand->value.value_type = RAM_TYPE_STR;
+    operand->value.types.s = element->element_value;
+    break;
+  case ELEMENT_TRUE:
+  case ELEMENT_FALSE:
+    operand->value.value_type = RAM_TYPE_BOOLEAN;
+    operand->value.types.i = (element->element_type == ELEMENT_TRUE) ? 1 : 0;
+    break;
+  default: // identifiers, and None, which is read like one
+    operand->fetch = (element->defined == ELEMENT_DEFINED_ALWAYS) ? fetch_defined : fetch_variable;
+    operand->slot = slot_of(compiler, element->element_value);
+    operand->name = element->element_value;
+    break;
+  }
+}
+
+//
+// is_subscript
+//
+// Is the operand x[i] or x[i:j]? These are left to the executor.
+//
+static bool is_subscript(struct UNARY_EXPR *unary)
+{
+  return unary->expr_type == UNARY_INDEX || unary->expr_type == UNARY_SLICE;
+}
+
+//
+// compile_expr
+//
+static void compile_expr(struct Compiler *compiler, struct STMT *stmt, struct VALUE_EXPR *expr, struct Expr *compiled)
+{
+  memset(compiled, 0, sizeof(struct Expr));
+  compiled->stmt = stmt;
+  compiled->operator = expr->operator;
+  compiled->graph = expr;
+
+  // an expression lowered to steps is evaluated by the executor
+  // on its stack of values (see VALUE_EXPR), as is x[i]:
+  if (expr->num_steps > 0 || is_subscript(expr->lhs) || (expr->isBinaryExpr && is_subscript(expr->rhs)))
+  {
+    compiled->eval = eval_executed;
+    return;
+  }
+
+  if (expr->lhs->expr_type != UNARY_ELEMENT || (expr->isBinaryExpr && expr->rhs->expr_type != UNARY_ELEMENT))
+  {
+    compiler->failed = true; // the executor only has elements
+    return;
+  }
+
+  compile_operand(compiler, expr->lhs->element, &compiled->lhs);
+
+  if (!expr->isBinaryExpr)
+  {
+    compiled->eval = eval_unary;
+    return;
+  }
+
+  compile_operand(compiler, expr->rhs->element, &compiled->rhs);
+
+  if (expr->types != EXPR_TYPES_UNKNOWN && expr->operator <= OPERATOR_GTE)
+    compiled->eval = typed_evals[expr->types - 1][expr->operator];
+  else
+    compiled->eval = eval_binary;
+}
+
+//
+// compile_test
+//
+// Compiles a condition, into a new test.
+//
+static struct Test *compile_test(struct Compiler *compiler, struct STMT *stmt, struct CONDITION *condition)
+{
+  struct Test *test = (struct Test *)calloc(1, sizeof(struct Test));
+
+  if (test == NULL)
+    panic("out of memory (compile_test)");
+
+  test->chain = compiler->compiled->tests;
+  compiler->compiled->tests = test;
+
+  switch (condition->condition_type)
+  {
+  case CONDITION_AND:
+  case CONDITION_OR:
+    test->decide = (condition->condition_type == CONDITION_AND) ? decide_and : decide_or;
+    test->lhs = compile_test(compiler, stmt, condition->lhs);
+    test->rhs = compile_test(compiler, stmt, condition->rhs);
+    break;
+  case CONDITION_NOT:
+    test->decide = decide_not;
+    test->lhs = compile_test(compiler, stmt, condition->lhs);
+    break;
+  default: // CONDITION_EXPR
+    compile_expr(compiler, stmt, condition->expr, &test->expr);
+
+    struct VALUE_EXPR *expr = condition->expr;
+
+    if (expr->isBinaryExpr && expr->types == EXPR_TYPES_INT_INT && expr->num_steps == 0 &&
+        expr->operator >= OPERATOR_EQUAL && expr->operator <= OPERATOR_GTE)
+      test->decide = int_decides[expr->operator - OPERATOR_EQUAL];
+    else
+      test->decide = decide_expr;
+    break;
+  }
+
+  return test;
+}
+
+//
+// print_text
+//
+// Returns what print() outputs for a literal parameter, as the
+// executor formats it, in new memory.
+//
+static char *print_text(struct ELEMENT *parameter)
+{
+  if (parameter == NULL)
+    return dupString("\n");
+
+  if (parameter->element_type != ELEMENT_INT_LITERAL && parameter->element_type != ELEMENT_REAL_LITERAL)
+    return dupStrings(parameter->element_value, "\n"); // strings, True and False
+
+  char buffer[32];
+  const char *format = (parameter->element_type == ELEMENT_INT_LITERAL) ? "%d\n" : "%lf\n";
+  int length = (parameter->element_type == ELEMENT_INT_LITERAL)
+                   ? snprintf(buffer, sizeof(buffer), format, atoi(parameter->element_value))
+                   : snprintf(buffer, sizeof(buffer), format, atof(parameter->element_value));
+
+  if (length < (int)sizeof(buffer))
+    return dupString(buffer);
+
+  char *text = (char *)malloc(length + 1); // a very large real
+
+  if (text == NULL)
+    panic("out of memory (print_text)");
+
+  snprintf(text, length + 1, format, atof(parameter->element_value));
+
+  return text;
+}
+
+static struct Closure *compile_block(struct Compiler *compiler, struct STMT *stmt, struct STMT *end);
+
+//
+// compile_stmt
+//
+// Compiles the statement, returning NULL for a pass or a def,
+// which do nothing when they're reached; calls to the functions
+// the program defines are left to the executor.
+//
+static struct Closure *compile_stmt(struct Compiler *compiler, struct STMT *stmt)
+{
+  if (stmt->stmt_type == STMT_PASS || stmt->stmt_type == STMT_DEF)
+    return NULL;
+
+  struct Closure *closure = (struct Closure *)calloc(1, sizeof(struct Closure));
+
+  if (closure == NULL)
+    panic("out of memory (compile_stmt)");
+
+  closure->stmt = stmt;
+  closure->chain = compiler->compiled->closures;
+  compiler->compiled->closures = closure;
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT)
+  {
+    struct STMT_ASSIGNMENT *assignment = stmt->types.assignment;
+
+    closure->run = run_executed;
+
+    if (assignment->isPtrDeref || assignment->index != NULL || assignment->rhs->value_type != VALUE_EXPR) // e.g. input()
+      return closure;
+
+    struct VALUE_EXPR *expr = assignment->rhs->types.expr;
+
+    closure->slot = slot_of(compiler, assignment->var_name);
+    closure->name = assignment->var_name;
+
+    if (!expr->isBinaryExpr && expr->lhs->expr_type == UNARY_ELEMENT)
+    {
+      closure->run = run_assign_copy;
+      compile_operand(compiler, expr->lhs->element, &closure->operand);
+    }
+    else
+    {
+      closure->run = run_assign_expr;
+      compile_expr(compiler, stmt, expr, &closure->expr);
+    }
+  }
+  else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+  {
+    struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+    struct ELEMENT *parameter = (call->num_parameters > 0) ? call->parameters[0] : NULL;
+
+    if (call->function != NULL || call->builtin != BUILTIN_PRINT)
+    {
+      closure->run = run_executed;
+    }
+    else if (parameter != NULL && (parameter->element_type == ELEMENT_IDENTIFIER || parameter->element_type == ELEMENT_NONE))
+    {
+      closure->run = run_print_variable;
+      compile_operand(compiler, parameter, &closure->operand);
+    }
+    else
+    {
+      closure->run = run_print_text;
+      closure->text = print_text(parameter);
+    }
+  }
+  else if (stmt->stmt_type == STMT_WHILE_LOOP)
+  {
+    struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+    closure->run = run_while_loop;
+    closure->test = compile_test(compiler, stmt, loop->condition);
+    closure->preheader = compile_block(compiler, loop->preheader, NULL);
+    closure->body = compile_block(compiler, loop->loop_body, loop->next_stmt);
+  }
+  else if (stmt->stmt_type == STMT_FOR_LOOP)
+  {
+    struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+    closure->run = run_for_loop;
+    closure->slot = slot_of(compiler, loop->var_name);
+    closure->name = loop->var_name;
+    compile_operand(compiler, loop->start, &closure->range[0]);
+    compile_operand(compiler, loop->stop, &closure->range[1]);
+    compile_operand(compiler, loop->step, &closure->range[2]);
+    closure->body = compile_block(compiler, loop->loop_body, loop->next_stmt);
+  }
+  else // not executed either
+  {
+    compiler->failed = true;
+  }
+
+  return closure;
+}
+
+//
+// next_stmt
+//
+// Returns the statement after the given one.
+//
+static struct STMT *next_stmt(struct STMT *stmt)
+{
+  switch (stmt->stmt_type)
+  {
+  case STMT_ASSIGNMENT:
+    return stmt->types.assignment->next_stmt;
+  case STMT_FUNCTION_CALL:
+    return stmt->types.function_call->next_stmt;
+  case STMT_WHILE_LOOP:
+    return stmt->types.while_loop->next_stmt;
+  case STMT_FOR_LOOP:
+    return stmt->types.for_loop->next_stmt;
+  case STMT_PASS:
+    return stmt->types.pass->next_stmt;
+  case STMT_DEF:
+    return stmt->types.def->next_stmt;
+  default:
+    return NULL;
+  }
+}
+
+//
+// compile_block
+//
+// Compiles the statements from stmt up to, but not including, end,
+// and returns the first closure of the block.
+//
+static struct Closure *compile_block(struct Compiler *compiler, struct STMT *stmt, struct STMT *end)
+{
+  struct Closure *first = NULL;
+  struct Closure **last = &first;
+
+  for (; stmt != NULL && stmt != end && !compiler->failed; stmt = next_stmt(stmt))
+  {
+    struct Closure *closure = compile_stmt(compiler, stmt);
+
+    if (closure != NULL)
+    {
+      *last = closure;
+      last = &closure->next;
+    }
+  }
+
+  return first;
+}
+
+//
+// Public functions:
+//
+
+//
+// closure_compile
+//
+struct ClosureProgram *closure_compile(struct STMT *program)
+{
+  struct Compiler compiler;
+  struct ClosureProgram *compiled = (struct ClosureProgram *)calloc(1, sizeof(struct ClosureProgram));
+
+  if (compiled == NULL)
+    panic("out of memory (closure_compile)");
+
+  memset(&compiler, 0, sizeof(compiler));
+  compiler.compiled = compiled;
+
+  compiled->program = compile_block(&compiler, program, NULL);
+
+  free(compiler.names);
+  free(compiler.slots);
+
+  if (compiler.failed)
+  {
+    closure_destroy(compiled);
+    return NULL;
+  }
+
+  return compiled;
+}
+
+//
+// closure_run
+//
+bool closure_run(struct ClosureProgram *compiled, struct Interpreter *interp)
+{
+  struct Context ctx;
+
+  ctx.interp = interp;
+  ctx.addresses = (int *)malloc((compiled->num_slots + 1) * sizeof(int));
+
+  if (ctx.addresses == NULL)
+    panic("out of memory (closure_run)");
+
+  for (int slot = 0; slot < compiled->num_slots; slot++)
+    ctx.addresses[slot] = -1;
+
+  bool success = run_block(&ctx, compiled->program);
+
+  free(ctx.addresses);
+
+  return success;
+}
+
+//
+// closure_destroy
+//
+void closure_destroy(struct ClosureProgram *compiled)
+{
+  if (compiled == NULL)
+    return;
+
+  struct Closure *closure = compiled->closures;
+
+  while (closure != NULL)
+  {
+    struct Closure *chain = closure->chain;
+
+    free(closure->text);
+    free(closure);
+
+    closure = chain;
+  }
+
+  struct Test *test = compiled->tests;
+
+  while (test != NULL)
+  {
+    struct Test *chain = test->chain;
+
+    free(test);
+
+    test = chain;
+  }
+
+  free(compiled);
+}
@@ -0,0 +1,66 @@
+/*closure.h*/
+
+//
+// Closure compiler for nuPython program graphs: an alternative to
+// execute() that does the work of walking the graph once, up front.
+// Each statement and expression is compiled into a closure, i.e. a
+// function pointer together with its operands, resolved in advance:
+// literals are parsed into values, variables numbered so that their
+// addresses in memory are only looked up once per run, and each
+// operator whose operand types were proven (see optimizer_types) is
+// bound to the function for that operator and those types. Running
+// the program is then a chain of indirect calls, with no switching
+// on statement, element or operator types.
+//
+// Output and memory are exactly as when the program is executed.
+//
+// Usage:
+//
+//   struct ClosureProgram *compiled = closure_compile(program);
+//
+//   if (compiled != NULL)
+//     closure_run(compiled, interp);
+//   else
+//     execute(interp, program);
+//
+//   closure_destroy(compiled);
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+#include "interpreter.h"
+
+struct ClosureProgram; // opaque
+
+//
+// Public functions:
+//
+
+//
+// closure_compile
+//
+// Compiles the program graph, which must outlive the result, and
+// returns it. Returns NULL if the program has statements that the
+// executor doesn't run either, in which case it's left to execute().
+//
+struct ClosureProgram *closure_compile(struct STMT *program);
+
+//
+// closure_run
+//
+// Runs the compiled program with the interpreter's memory and
+// streams, exactly as execute() runs its graph, and returns true
+// if it ran to completion, false if not (after outputting an error
+// message). A compiled program can be run any number of times.
+//
+bool closure_run(struct ClosureProgram *compiled, struct Interpreter *interp);
+
+//
+// closure_destroy
+//
+// Frees the compiled program. NULL is ignored.
+//
+void closure_destroy(struct ClosureProgram *compiled);
@@ -0,0 +1,721 @@
+/*daemon.c*/
+
+//
+// Server mode for nuPython: listens on a Unix domain socket and
+// runs scripts for clients on a pool of worker threads. Program
+// graphs are kept in an in-memory cache, keyed by file path (or
+// by content hash for source sent directly), so a script that
+// has not changed is parsed only once.
+//
+// A cache entry for a file is reused as long as the file's mtime
+// and size are unchanged; if they have changed, the file is read
+// and hashed, and the entry is reused if the content is still the
+// same (e.g. the file was just touched), else the script is built
+// again and replaces the entry.
+//
+
+// fopencookie() is a GNU extension; sockets and fmemopen() are POSIX:
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // uint32_t, uint64_t
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>     // close, unlink, sysconf
+#include <sys/types.h>  // ssize_t
+#include <sys/stat.h>   // stat
+#include <sys/socket.h> // socket, bind, listen, accept, send, recv
+#include <sys/un.h>     // sockaddr_un
+
+#include "parser.h"
+#include "programgraph.h"
+#include "optimizer.h"
+#include "execute.h"
+#include "interpreter.h"
+#include "threadpool.h"
+#include "batch.h" // enum BATCH_STATUS
+#include "util.h"
+#include "daemon.h"
+
+#define DAEMON_CACHE_ENTRIES 256 // least-recently used are evicted
+
+//
+// A cached program graph. An entry is reference counted: the
+// cache holds one reference while the entry is in the cache, and
+// each request running the program holds one, so an entry that
+// is replaced or evicted is freed when the last request finishes.
+//
+struct DAEMON_ENTRY
+{
+  char *path;          // script file, or NULL if source was sent
+  uint64_t hash;       // of the source code
+  size_t length;       // # of bytes of source code
+  struct timespec mtime; // file's mtime and size when last
+  off_t size;            // checked (unused if path is NULL)
+
+  struct STMT *program;
+  int refs;
+
+  struct DAEMON_ENTRY *next; // more recently used first
+};
+
+struct Daemon
+{
+  pthread_mutex_t lock; // protects the cache
+  struct DAEMON_ENTRY *entries;
+  int num_entries;
+};
+
+//
+// One client connection, which is one request.
+//
+struct CONNECTION
+{
+  struct Daemon *daemon;
+  int fd;
+
+  uint32_t input_left; // bytes left in current DAEMON_INPUT frame
+  bool input_done;     // DAEMON_EOF seen, or connection lost
+};
+
+//
+// Private functions:
+//
+
+//
+// recv_full, send_full
+//
+// Receive / send exactly length bytes, retrying on short reads
+// and writes. Return false if the connection is closed or lost.
+//
+static bool recv_full(int fd, void *buffer, size_t length)
+{
+  char *p = (char *)buffer;
+
+  while (length > 0)
+  {
+    ssize_t n = recv(fd, p, length, 0);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+
+    p += n;
+    length -= n;
+  }
+
+  return true;
+}
+
+static bool send_full(int fd, const void *buffer, size_t length)
+{
+  const char *p = (const char *)buffer;
+
+  while (length > 0)
+  {
+    // MSG_NOSIGNAL: a client that went away is an error, not SIGPIPE
+    ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+
+    p += n;
+    length -= n;
+  }
+
+  return true;
+}
+
+//
+// recv_frame_header, send_frame
+//
+static bool recv_frame_header(int fd, char *type, uint32_t *length)
+{
+  char header[DAEMON_FRAME_HEADER];
+
+  if (!recv_full(fd, header, sizeof(header)))
+    return false;
+
+  *type = header[0];
+  memcpy(length, &header[1], sizeof(*length));
+
+  return true;
+}
+
+static bool send_frame(int fd, char type, const void *payload, uint32_t length)
+{
+  char header[DAEMON_FRAME_HEADER];
+
+  header[0] = type;
+  memcpy(&header[1], &length, sizeof(length));
+
+  return send_full(fd, header, sizeof(header)) && send_full(fd, payload, length);
+}
+
+//
+// conn_write, conn_read
+//
+// The stdio callbacks for the script's output and input streams:
+// output is sent as DAEMON_OUTPUT frames, and input comes from the
+// payloads of the client's DAEMON_INPUT frames.
+//
+static ssize_t conn_write(void *cookie, const char *buf, size_t size)
+{
+  struct CONNECTION *conn = (struct CONNECTION *)cookie;
+
+  if (!send_frame(conn->fd, DAEMON_OUTPUT, buf, (uint32_t)size))
+    return -1;
+
+  return size;
+}
+
+static ssize_t conn_read(void *cookie, char *buf, size_t size)
+{
+  struct CONNECTION *conn = (struct CONNECTION *)cookie;
+
+  while (conn->input_left == 0)
+  {
+    char type;
+    uint32_t length;
+
+    if (conn->input_done)
+      return 0;
+
+    if (!recv_frame_header(conn->fd, &type, &length) || type != DAEMON_INPUT)
+    {
+      conn->input_done = true; // DAEMON_EOF, or lost connection
+      return 0;
+    }
+
+    conn->input_left = length;
+  }
+
+  if (size > conn->input_left)
+    size = conn->input_left;
+
+  ssize_t n = recv(conn->fd, buf, size, 0);
+
+  if (n <= 0)
+  {
+    conn->input_done = true;
+    return 0;
+  }
+
+  conn->input_left -= n;
+
+  return n;
+}
+
+//
+// read_file
+//
+// Reads the whole file into a dynamically-allocated buffer,
+// returning NULL if the file cannot be read.
+//
+static char *read_file(char *path, size_t *length)
+{
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL)
+    return NULL;
+
+  size_t capacity = 4096;
+  size_t size = 0;
+  char *buffer = (char *)malloc(capacity);
+
+  while (buffer != NULL)
+  {
+    size += fread(buffer + size, 1, capacity - size, file);
+
+    if (size < capacity || size >= DAEMON_MAX_SOURCE) // end of file (or error):
+      break;
+
+    capacity *= 2;
+
+    char *p = (char *)realloc(buffer, capacity);
+
+    if (p == NULL)
+      free(buffer);
+
+    buffer = p;
+  }
+
+  if (buffer != NULL && (ferror(file) || size >= DAEMON_MAX_SOURCE))
+  {
+    free(buffer);
+    buffer = NULL;
+  }
+
+  fclose(file);
+
+  *length = size;
+
+  return buffer;
+}
+
+//
+// build_program
+//
+// Parses and builds the given source code, returning the program
+// graph, or NULL if there is an error (which has been output).
+//
+static struct STMT *build_program(struct Interpreter *interp, char *source, size_t length)
+{
+  // fmemopen() cannot open an empty buffer:
+  FILE *input = (length > 0) ? fmemopen(source, length, "r") : fmemopen("\n", 1, "r");
+
+  if (input == NULL)
+  {
+    fprintf(interp->output, "**ERROR: out of memory.\n");
+    return NULL;
+  }
+
+  struct TokenQueue *tokens = parser_parse(interp, input);
+
+  fclose(input);
+
+  if (tokens == NULL)
+    return NULL;
+
+  struct STMT *program = programgraph_build(interp, tokens);
+
+  tokenqueue_destroy(tokens);
+
+  if (program != NULL)
+    optimizer_run(interp, program, true, false, NULL);
+
+  return program;
+}
+
+//
+// cache_find
+//
+// Returns the entry for the given path, or if path is NULL, for
+// source code with the given hash and length; NULL if none. The
+// entry becomes the most recently used. Call with the lock held.
+//
+static struct DAEMON_ENTRY *cache_find(struct Daemon *daemon, char *path, uint64_t hash, size_t length)
+{
+  struct DAEMON_ENTRY *prev = NULL;
+
+  for (struct DAEMON_ENTRY *e = daemon->entries; e != NULL; prev = e, e = e->next)
+  {
+    bool match = (path != NULL) ? (e->path != NULL && strcmp(e->path, path) == 0)
+                                : (e->path == NULL && e->hash == hash && e->length == length);
+
+    if (!match)
+      continue;
+
+    if (prev != NULL) // move to the front:
+    {
+      prev->next = e->next;
+      e->next = daemon->entries;
+      daemon->entries = e;
+    }
+
+    return e;
+  }
+
+  return NULL;
+}
+
+//
+// cache_release
+//
+// Drops a reference to the entry, freeing it if that was the
+// last one.
+//
+static void cache_release(struct Daemon *daemon, struct DAEMON_ENTRY *e)
+{
+  pthread_mutex_lock(&daemon->lock);
+  bool last = (--e->refs == 0);
+  pthread_mutex_unlock(&daemon->lock);
+
+  if (last)
+  {
+    programgraph_destroy(e->program);
+    free(e->path);
+    free(e);
+  }
+}
+
+//
+// cache_insert
+//
+// Adds an entry for the newly-built program, replacing any entry
+// with the same key, and returns it with a reference for the
+// caller. Returns NULL if out of memory, and the program is freed.
+//
+static struct DAEMON_ENTRY *cache_insert(struct Daemon *daemon, char *path, uint64_t hash, size_t length,
+                                         struct stat *st, struct STMT *program)
+{
+  struct DAEMON_ENTRY *e = (struct DAEMON_ENTRY *)malloc(sizeof(struct DAEMON_ENTRY));
+
+  if (e == NULL)
+  {
+    programgraph_destroy(program);
+    return NULL;
+  }
+
+  e->path = (path != NULL) ? dupString(path) : NULL;
+  e->hash = hash;
+  e->length = length;
+  e->program = program;
+  e->refs = 2; // the cache's and the caller's
+
+  if (st != NULL)
+  {
+    e->mtime = st->st_mtim;
+    e->size = st->st_size;
+  }
+
+  //
+  // unlink any old entry for the same script (another request
+  // may have built it at the same time) and the least-recently
+  // used entry if the cache is full; they are released below,
+  // outside the lock:
+  //
+  struct DAEMON_ENTRY *old = NULL;
+  struct DAEMON_ENTRY *evicted = NULL;
+
+  pthread_mutex_lock(&daemon->lock);
+
+  old = cache_find(daemon, path, hash, length);
+
+  if (old != NULL) // it's now at the front:
+  {
+    daemon->entries = old->next;
+    daemon->num_entries--;
+  }
+
+  e->next = daemon->entries;
+  daemon->entries = e;
+  daemon->num_entries++;
+
+  if (daemon->num_entries > DAEMON_CACHE_ENTRIES)
+  {
+    struct DAEMON_ENTRY *prev = daemon->entries;
+
+    while (prev->next->next != NULL)
+      prev = prev->next;
+
+    evicted = prev->next;
+    prev->next = NULL;
+    daemon->num_entries--;
+  }
+
+  pthread_mutex_unlock(&daemon->lock);
+
+  if (old != NULL)
+    cache_release(daemon, old);
+  if (evicted != NULL)
+    cache_release(daemon, evicted);
+
+  return e;
+}
+
+//
+// acquire_program
+//
+// Returns a cache entry, with a reference for the caller, for
+// the program in the given file (if path is not NULL) or else
+// the given source code, building the program if it's not in
+// the cache. Returns NULL if the program cannot be opened or
+// built, with an error output and *status set.
+//
+static struct DAEMON_ENTRY *acquire_program(struct Daemon *daemon, struct Interpreter *interp,
+                                            char *path, char *source, size_t length, int *status)
+{
+  struct stat st;
+  struct DAEMON_ENTRY *e;
+  char *buffer = NULL;
+
+  if (path != NULL)
+  {
+    //
+    // file unchanged since we last looked? then no need to read it:
+    //
+    if (stat(path, &st) != 0)
+    {
+      fprintf(interp->output, "**ERROR: unable to open input file '%s' for input.\n", path);
+      *status = BATCH_CANNOT_OPEN;
+      return NULL;
+    }
+
+    pthread_mutex_lock(&daemon->lock);
+
+    e = cache_find(daemon, path, 0, 0);
+
+    if (e != NULL && e->size == st.st_size &&
+        e->mtime.tv_sec == st.st_mtim.tv_sec && e->mtime.tv_nsec == st.st_mtim.tv_nsec)
+    {
+      e->refs++;
+      pthread_mutex_unlock(&daemon->lock);
+      return e;
+    }
+
+    pthread_mutex_unlock(&daemon->lock);
+
+    buffer = read_file(path, &length);
+
+    if (buffer == NULL)
+    {
+      fprintf(interp->output, "**ERROR: unable to open input file '%s' for input.\n", path);
+      *status = BATCH_CANNOT_OPEN;
+      return NULL;
+    }
+
+    source = buffer;
+  }
+
+  //
+  // same content as the cached program?
+  //
+  uint64_t hash = hashBytes(HASH_START, source, length);
+
+  pthread_mutex_lock(&daemon->lock);
+
+  e = cache_find(daemon, path, hash, length);
+
+  if (e != NULL && e->hash == hash && e->length == length)
+  {
+    if (path != NULL) // only touched, remember the new mtime:
+    {
+      e->mtime = st.st_mtim;
+      e->size = st.st_size;
+    }
+
+    e->refs++;
+    pthread_mutex_unlock(&daemon->lock);
+
+    free(buffer);
+    return e;
+  }
+
+  pthread_mutex_unlock(&daemon->lock);
+
+  //
+  // new or changed, build it:
+  //
+  struct STMT *program = build_program(interp, source, length);
+
+  free(buffer);
+
+  if (program == NULL)
+  {
+    *status = BATCH_SYNTAX_ERROR;
+    return NULL;
+  }
+
+  e = cache_insert(daemon, path, hash, length, (path != NULL) ? &st : NULL, program);
+
+  if (e == NULL)
+  {
+    fprintf(interp->output, "**ERROR: out of memory.\n");
+    *status = BATCH_OUT_OF_MEMORY;
+  }
+
+  return e;
+}
+
+//
+// serve
+//
+// Handles one request: reads the script, runs it in a fresh
+// memory with input and output over the connection, and then
+// sends the status.
+//
+static int serve(struct CONNECTION *conn)
+{
+  char type;
+  uint32_t length;
+
+  if (!recv_frame_header(conn->fd, &type, &length) ||
+      (type != DAEMON_PATH && type != DAEMON_SOURCE) || length > DAEMON_MAX_SOURCE)
+    return -1; // not a client, just hang up
+
+  char *payload = (char *)malloc(length + 1);
+
+  if (payload == NULL)
+    return BATCH_OUT_OF_MEMORY;
+
+  if (!recv_full(conn->fd, payload, length))
+  {
+    free(payload);
+    return -1;
+  }
+
+  payload[length] = '\0';
+
+  cookie_io_functions_t in_functions = {conn_read, NULL, NULL, NULL};
+  cookie_io_functions_t out_functions = {NULL, conn_write, NULL, NULL};
+
+  FILE *input = fopencookie(conn, "r", in_functions);
+  FILE *output = fopencookie(conn, "w", out_functions);
+  struct Interpreter *interp = NULL;
+
+  if (input != NULL && output != NULL)
+  {
+    setvbuf(output, NULL, _IOLBF, BUFSIZ); // stream output a line at a time
+
+    interp = interpreter_create(input, output);
+  }
+
+  int status = BATCH_OUT_OF_MEMORY;
+
+  if (interp != NULL)
+  {
+    struct DAEMON_ENTRY *e;
+
+    if (type == DAEMON_PATH)
+      e = acquire_program(conn->daemon, interp, payload, NULL, 0, &status);
+    else
+      e = acquire_program(conn->daemon, interp, NULL, payload, length, &status);
+
+    if (e != NULL)
+    {
+      bool success = optimizer_report_undefined(interp, e->program) == 0 &&
+                     execute(interp, e->program);
+
+      status = success ? BATCH_OK : BATCH_EXECUTION_ERROR;
+
+      cache_release(conn->daemon, e);
+    }
+
+    interpreter_destroy(interp);
+  }
+
+  if (output != NULL)
+    fclose(output); // sends any buffered output
+  if (input != NULL)
+    fclose(input);
+
+  free(payload);
+
+  return status;
+}
+
+//
+// serve_task
+//
+// Thread pool task: serves one connection and closes it.
+//
+static void serve_task(void *arg)
+{
+  struct CONNECTION *conn = (struct CONNECTION *)arg;
+
+  int status = serve(conn);
+
+  if (status >= 0)
+  {
+    char code = (char)status;
+
+    send_frame(conn->fd, DAEMON_EXIT, &code, 1);
+  }
+
+  close(conn->fd);
+  free(conn);
+}
+
+//
+// Public functions:
+//
+
+//
+// daemon_run
+//
+// Listens on the given socket path and serves requests on a
+// pool of num_threads worker threads (if num_threads <= 0,
+// one per CPU). Only returns if the socket cannot be set up.
+//
+int daemon_run(char *socket_path, int num_threads)
+{
+  assert(socket_path != NULL);
+
+  struct sockaddr_un addr;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+  {
+    printf("**ERROR: socket path '%s' is too long.\n", socket_path);
+    return -1;
+  }
+
+  if (num_threads <= 0)
+  {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    num_threads = (num_cpus > 0) ? (int)num_cpus : 1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  unlink(socket_path); // left over from a previous server
+
+  if (listener < 0 ||
+      bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(listener, 64) != 0)
+  {
+    printf("**ERROR: unable to listen on socket '%s': %s.\n", socket_path, strerror(errno));
+
+    if (listener >= 0)
+      close(listener);
+
+    return -1;
+  }
+
+  struct Daemon daemon;
+
+  pthread_mutex_init(&daemon.lock, NULL);
+  daemon.entries = NULL;
+  daemon.num_entries = 0;
+
+  struct ThreadPool *pool = threadpool_create(num_threads);
+
+  if (pool == NULL)
+  {
+    printf("**ERROR: out of memory.\n");
+    close(listener);
+    return -1;
+  }
+
+  printf("**nuPython server listening on '%s' with %d threads\n", socket_path, num_threads);
+  fflush(stdout);
+
+  while (true)
+  {
+    int fd = accept(listener, NULL, NULL);
+
+    if (fd < 0) // e.g. interrupted, or client gave up:
+      continue;
+
+    struct CONNECTION *conn = (struct CONNECTION *)malloc(sizeof(struct CONNECTION));
+
+    if (conn == NULL)
+    {
+      close(fd);
+      continue;
+    }
+
+    conn->daemon = &daemon;
+    conn->fd = fd;
+    conn->input_left = 0;
+    conn->input_done = false;
+
+    if (!threadpool_submit(pool, serve_task, conn))
+    {
+      close(fd);
+      free(conn);
+    }
+  }
+}
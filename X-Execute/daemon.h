@@ -0,0 +1,51 @@
+/*daemon.h*/
+
+//
+// Server mode for nuPython: a long-running process that listens on
+// a Unix domain socket and runs scripts for clients (see client.c),
+// so that short scripts pay neither process startup nor, thanks to
+// an in-memory cache of program graphs, parsing on every run.
+//
+// Each request runs in a fresh memory on a bounded pool of worker
+// threads, and the script's output is streamed back as it is
+// produced.
+//
+// Protocol: both sides send frames, each a 1-byte frame type and a
+// 4-byte length (host byte order, the socket is local), followed by
+// length bytes of payload. The client sends one DAEMON_PATH or
+// DAEMON_SOURCE frame, then the script's input as DAEMON_INPUT
+// frames and a DAEMON_EOF frame. The server replies with any number
+// of DAEMON_OUTPUT frames and then one DAEMON_EXIT frame, whose
+// 1-byte payload is the status (enum BATCH_STATUS, batch.h).
+//
+
+#pragma once
+
+#define DAEMON_DEFAULT_SOCKET "/tmp/nupy.sock"
+
+enum DAEMON_FRAMES
+{
+  DAEMON_PATH = 'P',   // client: run the script in this file
+  DAEMON_SOURCE = 'S', // client: run this source code
+  DAEMON_INPUT = 'I',  // client: more input for input()
+  DAEMON_EOF = 'E',    // client: end of input
+  DAEMON_OUTPUT = 'O', // server: more output from the script
+  DAEMON_EXIT = 'X'    // server: script is done, here is its status
+};
+
+#define DAEMON_FRAME_HEADER 5          // type + length
+#define DAEMON_MAX_SOURCE (16 << 20)   // largest script accepted, bytes
+
+//
+// Public functions:
+//
+
+//
+// daemon_run
+//
+// Listens on the given socket path and serves requests on a
+// pool of num_threads worker threads (if num_threads <= 0,
+// one per CPU). Only returns if the socket cannot be set up,
+// in which case an error message is output and -1 returned.
+//
+int daemon_run(char *socket_path, int num_threads);
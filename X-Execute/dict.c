@@ -0,0 +1,413 @@
+/*dict.c*/
+
+//
+// Dictionaries for nuPython; see dict.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // int8_t, uint64_t, int64_t
+#include <string.h>
+#include <math.h>    // floor
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+#include "dict.h"
+#include "list.h"
+#include "util.h"
+
+#define GROUP_SIZE 16        // slots probed at once
+#define EMPTY ((int8_t)-128) // control byte of an empty slot
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**DICT ERROR\n");
+  printf("**DICT ERROR: %s\n", msg);
+  printf("**DICT ERROR\n");
+
+  exit(-123);
+}
+
+//
+// copy_value, release_value
+//
+// Take and give up ownership of what a value refers to: a string
+// is duplicated and freed, a list or dictionary retained and
+// released.
+//
+static void copy_value(struct RAM_VALUE *value)
+{
+  if (value->value_type == RAM_TYPE_STR)
+    value->types.s = dupString(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_retain(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_retain(value->types.m);
+}
+
+static void release_value(struct RAM_VALUE *value)
+{
+  if (value->value_type == RAM_TYPE_STR)
+    free(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_release(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_release(value->types.m);
+}
+
+//
+// number
+//
+// Returns the value of a numeric key as a real.
+//
+static double number(struct RAM_VALUE key)
+{
+  return (key.value_type == RAM_TYPE_REAL) ? key.types.d : (double)key.types.i;
+}
+
+//
+// hash_key
+//
+// Returns the hash of the key. Numbers that are equal hash the
+// same: an integral real is hashed as the int it equals. FNV-1a's
+// high bits, which give the control bytes, are poorly mixed, so
+// the result is scrambled.
+//
+static uint64_t hash_key(struct RAM_VALUE key)
+{
+  uint64_t hash;
+
+  if (key.value_type == RAM_TYPE_STR)
+  {
+    hash = hashBytes(HASH_START, key.types.s, strlen(key.types.s));
+  }
+  else
+  {
+    double d = number(key);
+
+    if (d == floor(d) && d >= -9e18 && d <= 9e18)
+    {
+      int64_t i = (int64_t)d;
+      hash = hashBytes(HASH_START, &i, sizeof(i));
+    }
+    else
+      hash = hashBytes(HASH_START, &d, sizeof(d));
+  }
+
+  hash ^= hash >> 32;
+  hash *= 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 29;
+
+  return hash;
+}
+
+//
+// keys_equal
+//
+static bool keys_equal(struct RAM_VALUE a, struct RAM_VALUE b)
+{
+  if (a.value_type == RAM_TYPE_STR || b.value_type == RAM_TYPE_STR)
+    return a.value_type == b.value_type && strcmp(a.types.s, b.types.s) == 0;
+
+  return number(a) == number(b);
+}
+
+//
+// group_match
+//
+// Returns a bit mask of the slots of the group, starting at the
+// given control byte, whose control bytes equal the given byte.
+//
+static unsigned group_match(const int8_t *group, int8_t byte)
+{
+#if defined(__SSE2__)
+  __m128i bytes = _mm_loadu_si128((const __m128i *)group);
+
+  return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte)));
+#else
+  unsigned mask = 0;
+
+  for (int k = 0; k < GROUP_SIZE; k++)
+    if (group[k] == byte)
+      mask |= 1u << k;
+
+  return mask;
+#endif
+}
+
+//
+// control_byte
+//
+// Returns the 7 bits of the hash kept in the control bytes: the
+// top ones, since the bottom ones pick the group.
+//
+static int8_t control_byte(uint64_t hash)
+{
+  return (int8_t)(hash >> 57);
+}
+
+//
+// find
+//
+// Returns the position of the entry with the given key, which has
+// the given hash, or -1 if there is none. The groups are probed in
+// the order hash, hash + 1, hash + 1 + 2, ... (mod the # of groups),
+// which visits each group once since that # is a power of 2.
+//
+static int find(struct DICT *dict, struct RAM_VALUE key, uint64_t hash)
+{
+  if (dict->capacity == 0)
+    return -1;
+
+  size_t mask = dict->capacity / GROUP_SIZE - 1;
+  size_t group = hash & mask;
+  int8_t byte = control_byte(hash);
+
+  for (size_t step = 1;; step++)
+  {
+    int8_t *control = dict->control + group * GROUP_SIZE;
+    unsigned matches = group_match(control, byte);
+
+    while (matches != 0)
+    {
+      int e = dict->slots[group * GROUP_SIZE + __builtin_ctz(matches)];
+
+      if (dict->entries[e].hash == hash && keys_equal(dict->entries[e].key, key))
+        return e;
+
+      matches &= matches - 1;
+    }
+
+    if (group_match(control, EMPTY) != 0) // the key would be here:
+      return -1;
+
+    group = (group + step) & mask;
+  }
+}
+
+//
+// place
+//
+// Puts the entry at the given position, with the given hash, in
+// the first empty slot on its probe sequence.
+//
+static void place(struct DICT *dict, uint64_t hash, int e)
+{
+  size_t mask = dict->capacity / GROUP_SIZE - 1;
+  size_t group = hash & mask;
+
+  for (size_t step = 1;; step++)
+  {
+    unsigned empties = group_match(dict->control + group * GROUP_SIZE, EMPTY);
+
+    if (empties != 0)
+    {
+      size_t slot = group * GROUP_SIZE + __builtin_ctz(empties);
+
+      dict->control[slot] = control_byte(hash);
+      dict->slots[slot] = e;
+      return;
+    }
+
+    group = (group + step) & mask;
+  }
+}
+
+//
+// grow
+//
+// Doubles the # of slots, and places the entries again by their
+// cached hashes.
+//
+static void grow(struct DICT *dict)
+{
+  int capacity = (dict->capacity == 0) ? GROUP_SIZE : 2 * dict->capacity;
+
+  free(dict->control);
+  free(dict->slots);
+
+  dict->capacity = capacity;
+  dict->control = (int8_t *)malloc(capacity);
+  dict->slots = (int *)malloc(capacity * sizeof(int));
+
+  if (dict->control == NULL || dict->slots == NULL)
+    panic("out of memory (grow)");
+
+  memset(dict->control, EMPTY, capacity);
+
+  for (int e = 0; e < dict->length; e++)
+    place(dict, dict->entries[e].hash, e);
+}
+
+//
+// Public functions:
+//
+
+//
+// dict_create
+//
+struct DICT *dict_create(void)
+{
+  struct DICT *dict = (struct DICT *)malloc(sizeof(struct DICT));
+
+  if (dict == NULL)
+    panic("out of memory (dict_create)");
+
+  dict->refs = 1;
+  dict->length = 0;
+  dict->capacity = 0;
+  dict->control = NULL;
+  dict->slots = NULL;
+  dict->entries = NULL;
+  dict->entries_capacity = 0;
+  dict->printing = false;
+
+  return dict;
+}
+
+//
+// dict_retain, dict_release
+//
+void dict_retain(struct DICT *dict)
+{
+  if (dict != NULL)
+    dict->refs++;
+}
+
+void dict_release(struct DICT *dict)
+{
+  if (dict == NULL || --dict->refs > 0)
+    return;
+
+  for (int e = 0; e < dict->length; e++)
+  {
+    release_value(&dict->entries[e].key);
+    release_value(&dict->entries[e].value);
+  }
+
+  free(dict->control);
+  free(dict->slots);
+  free(dict->entries);
+  free(dict);
+}
+
+//
+// dict_hashable
+//
+bool dict_hashable(struct RAM_VALUE key)
+{
+  return key.value_type == RAM_TYPE_INT || key.value_type == RAM_TYPE_REAL ||
+         key.value_type == RAM_TYPE_BOOLEAN || key.value_type == RAM_TYPE_STR;
+}
+
+//
+// dict_get
+//
+bool dict_get(struct DICT *dict, struct RAM_VALUE key, struct RAM_VALUE *value)
+{
+  int e = find(dict, key, hash_key(key));
+
+  if (e < 0)
+    return false;
+
+  *value = dict->entries[e].value;
+  copy_value(value);
+
+  return true;
+}
+
+//
+// dict_contains
+//
+bool dict_contains(struct DICT *dict, struct RAM_VALUE key)
+{
+  return find(dict, key, hash_key(key)) >= 0;
+}
+
+//
+// dict_set
+//
+void dict_set(struct DICT *dict, struct RAM_VALUE key, struct RAM_VALUE value)
+{
+  uint64_t hash = hash_key(key);
+  int e = find(dict, key, hash);
+
+  copy_value(&value);
+
+  if (e >= 0) // replace the value:
+  {
+    release_value(&dict->entries[e].value);
+    dict->entries[e].value = value;
+    return;
+  }
+
+  if (8 * (dict->length + 1) > 7 * dict->capacity)
+    grow(dict);
+
+  if (dict->length == dict->entries_capacity)
+  {
+    int capacity = (dict->entries_capacity == 0) ? 8 : 2 * dict->entries_capacity;
+    struct DICT_ENTRY *entries = (struct DICT_ENTRY *)realloc(dict->entries, capacity * sizeof(struct DICT_ENTRY));
+
+    if (entries == NULL)
+      panic("out of memory (dict_set)");
+
+    dict->entries = entries;
+    dict->entries_capacity = capacity;
+  }
+
+  struct DICT_ENTRY *entry = &dict->entries[dict->length];
+
+  copy_value(&key);
+
+  entry->key = key;
+  entry->value = value;
+  entry->hash = hash;
+
+  place(dict, hash, dict->length);
+
+  dict->length++;
+}
+
+//
+// dict_print
+//
+void dict_print(FILE *output, struct DICT *dict)
+{
+  if (dict->printing)
+  {
+    fputs("{...}", output);
+    return;
+  }
+
+  dict->printing = true;
+
+  fputc('{', output);
+
+  for (int e = 0; e < dict->length; e++)
+  {
+    if (e > 0)
+      fputs(", ", output);
+
+    list_print_item(output, dict->entries[e].key);
+    fputs(": ", output);
+    list_print_item(output, dict->entries[e].value);
+  }
+
+  fputc('}', output);
+
+  dict->printing = false;
+}
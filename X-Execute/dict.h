@@ -0,0 +1,124 @@
+/*dict.h*/
+
+//
+// Dictionaries for nuPython, e.g. d = {'apple': 1, 'pear': 2}.
+//
+// A dictionary is an open-addressing hash table in the style of a
+// Swiss table. Alongside the table's slots is an array of control
+// bytes, one per slot: EMPTY, or 7 bits of the hash of the key in
+// the slot. Slots are probed in groups of 16, and a whole group's
+// control bytes are compared to the key's 7 bits at once (with SSE2
+// where available), so a lookup usually compares just one key, and
+// stops at the first group with an empty slot. The table is kept at
+// most 7/8 full, doubling when it would be fuller.
+//
+// The entries themselves are kept in an array in the order they
+// were inserted, which is the order they are printed in (as in
+// Python), and the table's slots hold their positions. Each entry
+// caches the hash of its key, so growing the table doesn't hash
+// any key again, and a string key is only compared with strcmp
+// when the hashes match.
+//
+// Keys may be ints, reals, booleans or strings; as in Python,
+// numbers that are equal are the same key, e.g. 1, 1.0 and True.
+// Entries are never removed.
+//
+// Dictionaries are values with reference semantics, like lists
+// (see list.h), and are freed when the last reference goes away;
+// a dictionary that holds itself is never freed.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // int8_t, uint64_t
+
+#include "ram.h"
+
+struct DICT_ENTRY
+{
+  struct RAM_VALUE key;
+  struct RAM_VALUE value;
+  uint64_t hash; // of the key
+};
+
+struct DICT
+{
+  int refs;   // # of references to the dictionary
+  int length; // # of entries
+
+  int capacity;    // # of slots, 0 or a power of 2 >= 16
+  int8_t *control; // per slot: EMPTY, or 7 bits of its key's hash
+  int *slots;      // per slot: the position of its entry
+
+  struct DICT_ENTRY *entries; // 0..length-1, in insertion order
+  int entries_capacity;
+
+  bool printing; // being printed, to stop at a cycle
+};
+
+//
+// Public functions:
+//
+
+//
+// dict_create
+//
+// Returns a new, empty dictionary, with one reference, which the
+// caller owns.
+//
+struct DICT *dict_create(void);
+
+//
+// dict_retain, dict_release
+//
+// Add and remove a reference to the dictionary; when the last one
+// is removed, the dictionary is freed. NULL is ignored.
+//
+void dict_retain(struct DICT *dict);
+void dict_release(struct DICT *dict);
+
+//
+// dict_hashable
+//
+// Returns true if the value can be a key: an int, real, boolean
+// or string.
+//
+bool dict_hashable(struct RAM_VALUE key);
+
+//
+// dict_get
+//
+// Looks up the given key, which must be hashable. If found, returns
+// true and a copy of its value via the reference parameter, which
+// the caller owns: a string is duplicated, a list or dictionary
+// retained. Returns false if not found.
+//
+bool dict_get(struct DICT *dict, struct RAM_VALUE key, struct RAM_VALUE *value);
+
+//
+// dict_contains
+//
+// Returns true if the given key, which must be hashable, is in the
+// dictionary.
+//
+bool dict_contains(struct DICT *dict, struct RAM_VALUE key);
+
+//
+// dict_set
+//
+// Maps the given key, which must be hashable, to a copy of the
+// given value, adding an entry at the end if the key is new. The
+// key and value are only borrowed.
+//
+void dict_set(struct DICT *dict, struct RAM_VALUE key, struct RAM_VALUE value);
+
+//
+// dict_print
+//
+// Outputs the dictionary as Python does, e.g. {'a': 1, 2: [3]},
+// without a newline. A dictionary holding itself is output as
+// {...} where it recurs.
+//
+void dict_print(FILE *output, struct DICT *dict);
@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include <stdio.h>
+#include <stdbool.h> // true, false
+
 #include "programgraph.h"
 #include "ram.h"
+#include "interpreter.h"
 
 //
 // Public functions:
@@ -17,10 +21,60 @@
 //
 // execute
 //
-// Given a nuPython program graph and a memory,
-// executes the statements in the program graph.
+// Given a nuPython program graph, executes the
+// statements in the program graph using the
+// interpreter's memory. input() reads lines from
+// the interpreter's input stream, and all output
+// goes to the interpreter's output stream.
 // If a semantic error occurs (e.g. type error),
-// and error message is output, execution stops,
-// and the function returns.
+// an error message is output, execution stops,
+// and false is returned. Returns true if the
+// program ran to completion.
+//
+// A call to a function the program defines runs
+// the function's body in a new frame on the
+// interpreter's call stack, which holds its
+// locals (see STMT_DEF); a return of a call runs
+// that call in the returning call's frame. The
+// body is typed for the types of the arguments
+// where the call site's cache has a copy typed
+// for them (see callcache.h). The caches refer to
+// the program, so they must be destroyed before
+// the interpreter executes another program.
+//
+// NOTE: execute() keeps no global state, so different
+// interpreters can execute programs at the same time
+// on different threads.
+//
+bool execute(struct Interpreter *interp, struct STMT *program);
+
+//
+// execute_statement
+//
+// Executes just the given assignment or function call statement,
+// exactly as execute() does, but not the statements after it.
+// Returns true if successful, false if not (after outputting an
+// error message).
+//
+bool execute_statement(struct Interpreter *interp, struct STMT *stmt);
+
+//
+// execute_expr
+//
+// Evaluates the expression, part of the given statement, exactly
+// as execute() does, returning its value via the reference
+// parameter. Returns true if successful, false if not (after
+// outputting an error message). A string value is a copy, which
+// the caller must free.
+//
+bool execute_expr(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *expr, struct RAM_VALUE *result);
+
+//
+// execute_operator
+//
+// Applies a binary operator (enum OPERATORS) to two values, with
+// the same semantics as when a program runs, and returns the
+// result via the reference parameter. Returns true if successful,
+// false if not (after outputting an error message).
 //
-void execute(struct STMT *program, struct RAM *memory);
+bool execute_operator(struct Interpreter *interp, struct STMT *stmt, int operator, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result);
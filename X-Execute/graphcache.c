@@ -0,0 +1,1462 @@
+/*graphcache.c*/
+
+//
+// Persistent cache of compiled nuPython programs.
+//
+// A cache file is an image of the program graph's nodes, laid out
+// exactly as they are in memory, except that every pointer holds
+// the file offset of what it points to (0 for NULL). The image is
+// followed by a relocation table: the file offsets of all the
+// pointers. Loading a program is then one mmap() of the file plus
+// one pass over the relocation table, turning offsets back into
+// addresses; no nodes are allocated. The graph is cached once it's
+// optimized, so the image also holds the program's listing from
+// before (a string the header points to), for printing.
+//
+//   +-----------------------+  offset 0
+//   | GRAPHCACHE_HEADER     |
+//   +-----------------------+
+//   | nodes and strings     |
+//   +-----------------------+  header.image_end
+//   | relocations (uint64)  |
+//   +-----------------------+
+//
+// The header records the format version and a signature of the
+// node layout, so a file written by a different build is simply
+// a cache miss. So is a damaged file: the header has a hash of
+// the whole file, and the graph is checked before it's used
+// (see check_graph), so that a file whose hash matches can't
+// point the interpreter outside of the image either. What the
+// optimizer proved about the program (expr->types and
+// element->defined) is only range-checked, and is trusted as
+// written, as are the compiled programs cached alongside (see
+// aot.h).
+//
+
+// mmap(), mkstemp() and fdopen() are POSIX, not C11:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // uint64_t, uintptr_t
+#include <stddef.h>  // offsetof
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>    // open
+#include <unistd.h>   // close, unlink
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat, mkdir
+
+#include "programgraph.h"
+#include "graphcache.h"
+#include "builtins.h"
+#include "util.h"
+
+#define GRAPHCACHE_MAGIC "nuPyPG\r\n"
+#define GRAPHCACHE_VERSION 16
+
+// nodes hold ints, bools and pointers:
+#define NODE_ALIGN _Alignof(void *)
+
+struct GRAPHCACHE_HEADER
+{
+  char magic[8];          // GRAPHCACHE_MAGIC
+  uint32_t version;       // GRAPHCACHE_VERSION
+  uint32_t layout;        // layout_signature() of the writer
+  uint64_t source_hash;   // hash of the source code
+  uint64_t source_length; // # of bytes of source code
+  uint64_t image_end;     // offset of the relocation table
+  uint64_t num_relocs;    // # of entries in relocation table
+  uint64_t root;          // offset of the program's first STMT
+  uint64_t listing;       // offset of the program's listing, or 0
+  uint64_t file_hash;     // hash of the file, but for this field (last)
+};
+
+struct GraphCache
+{
+  char *path;             // cache file for this source
+  char *dir;              // directory containing path
+  uint64_t source_hash;
+  uint64_t source_length;
+
+  void *mapping;          // loaded cache file, or NULL
+  size_t mapping_size;
+  const char *listing;    // in the mapping, or NULL
+};
+
+//
+// An image being written: a growable byte buffer, the offsets
+// of the pointers within it, and a map from the statements
+// already written to their offsets, since statements can be
+// shared (and loops point back to earlier statements).
+//
+struct IMAGE
+{
+  char *bytes;
+  size_t size;
+  size_t capacity;
+
+  uint64_t *relocs;
+  size_t num_relocs;
+  size_t relocs_capacity;
+
+  struct IMAGE_STMT *stmts; // hash table: STMT* => offset
+  size_t stmts_capacity;    // power of 2
+  size_t num_stmts;
+
+  struct IMAGE_STMT *pending; // statements whose contents
+  size_t num_pending;         // still need writing
+  size_t pending_capacity;
+
+  bool out_of_memory;
+};
+
+struct IMAGE_STMT
+{
+  struct STMT *stmt;
+  uint64_t offset;
+};
+
+//
+// Private functions:
+//
+
+//
+// layout_signature
+//
+// Hash of the sizes and pointer offsets of the graph's nodes;
+// the cache image is only valid for builds that agree on these.
+//
+static uint32_t layout_signature(void)
+{
+  size_t layout[] = {
+      sizeof(void *),
+      sizeof(struct STMT), offsetof(struct STMT, types),
+      sizeof(struct STMT_ASSIGNMENT), offsetof(struct STMT_ASSIGNMENT, var_name),
+      offsetof(struct STMT_ASSIGNMENT, slot), offsetof(struct STMT_ASSIGNMENT, index),
+      offsetof(struct STMT_ASSIGNMENT, rhs), offsetof(struct STMT_ASSIGNMENT, next_stmt),
+      sizeof(struct STMT_FUNCTION_CALL), offsetof(struct STMT_FUNCTION_CALL, function_name),
+      offsetof(struct STMT_FUNCTION_CALL, builtin), offsetof(struct STMT_FUNCTION_CALL, object),
+      offsetof(struct STMT_FUNCTION_CALL, function), offsetof(struct STMT_FUNCTION_CALL, num_parameters),
+      offsetof(struct STMT_FUNCTION_CALL, parameters), offsetof(struct STMT_FUNCTION_CALL, next_stmt),
+      sizeof(struct STMT_IF_THEN_ELSE), offsetof(struct STMT_IF_THEN_ELSE, condition),
+      offsetof(struct STMT_IF_THEN_ELSE, true_path), offsetof(struct STMT_IF_THEN_ELSE, false_path),
+      sizeof(struct STMT_WHILE_LOOP), offsetof(struct STMT_WHILE_LOOP, condition),
+      offsetof(struct STMT_WHILE_LOOP, loop_body), offsetof(struct STMT_WHILE_LOOP, next_stmt),
+      offsetof(struct STMT_WHILE_LOOP, preheader),
+      sizeof(struct STMT_FOR_LOOP), offsetof(struct STMT_FOR_LOOP, var_name), offsetof(struct STMT_FOR_LOOP, slot),
+      offsetof(struct STMT_FOR_LOOP, start), offsetof(struct STMT_FOR_LOOP, stop),
+      offsetof(struct STMT_FOR_LOOP, step), offsetof(struct STMT_FOR_LOOP, loop_body),
+      offsetof(struct STMT_FOR_LOOP, next_stmt),
+      sizeof(struct STMT_PASS), offsetof(struct STMT_PASS, next_stmt),
+      sizeof(struct STMT_DEF), offsetof(struct STMT_DEF, function_name),
+      offsetof(struct STMT_DEF, num_locals), offsetof(struct STMT_DEF, locals),
+      offsetof(struct STMT_DEF, body), offsetof(struct STMT_DEF, next_stmt),
+      sizeof(struct STMT_RETURN), offsetof(struct STMT_RETURN, value), offsetof(struct STMT_RETURN, next_stmt),
+      sizeof(struct VALUE), offsetof(struct VALUE, types),
+      sizeof(struct VALUE_FUNCTION_CALL), offsetof(struct VALUE_FUNCTION_CALL, function_name),
+      offsetof(struct VALUE_FUNCTION_CALL, builtin),
+      offsetof(struct VALUE_FUNCTION_CALL, function), offsetof(struct VALUE_FUNCTION_CALL, num_parameters),
+      offsetof(struct VALUE_FUNCTION_CALL, parameters),
+      sizeof(struct VALUE_LIST), offsetof(struct VALUE_LIST, elements),
+      sizeof(struct VALUE_DICT), offsetof(struct VALUE_DICT, keys), offsetof(struct VALUE_DICT, values),
+      sizeof(struct VALUE_EXPR), offsetof(struct VALUE_EXPR, lhs), offsetof(struct VALUE_EXPR, rhs),
+      offsetof(struct VALUE_EXPR, types), offsetof(struct VALUE_EXPR, num_steps), offsetof(struct VALUE_EXPR, steps),
+      sizeof(struct CONDITION), offsetof(struct CONDITION, expr),
+      offsetof(struct CONDITION, lhs), offsetof(struct CONDITION, rhs),
+      sizeof(struct UNARY_EXPR), offsetof(struct UNARY_EXPR, element),
+      offsetof(struct UNARY_EXPR, index), offsetof(struct UNARY_EXPR, end), offsetof(struct UNARY_EXPR, expr),
+      sizeof(struct ELEMENT), offsetof(struct ELEMENT, element_value), offsetof(struct ELEMENT, defined),
+      offsetof(struct ELEMENT, slot)};
+
+  uint64_t hash = hashBytes(HASH_START, layout, sizeof(layout));
+
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+//
+// hash_words
+//
+// Hash of the file, which is 8-byte words: the header's fields pack
+// into words, and the image is padded to the alignment of the
+// relocations. Taken a word at a time, rather than by hashBytes,
+// since it's computed each time a program is loaded; any one damaged
+// word changes it. The header is hashed up to file_hash, and then
+// the rest of the file, so that e.g. a damaged root is caught too.
+//
+static uint64_t hash_words(uint64_t hash, const void *bytes, size_t length)
+{
+  const char *p = (const char *)bytes;
+
+  assert(length % sizeof(uint64_t) == 0);
+
+  for (size_t i = 0; i < length; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+
+    memcpy(&word, p + i, sizeof(word));
+
+    hash ^= word;
+    hash = ((hash << 29) | (hash >> 35)) * 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+//
+// img_grow
+//
+// Makes sure the array has room for one more element, doubling
+// its capacity as needed. Returns false if out of memory.
+//
+static bool img_grow(struct IMAGE *img, void **array, size_t count, size_t *capacity, size_t element_size)
+{
+  if (count < *capacity)
+    return true;
+
+  size_t new_capacity = (*capacity == 0) ? 64 : *capacity * 2;
+  void *p = realloc(*array, new_capacity * element_size);
+
+  if (p == NULL)
+  {
+    img->out_of_memory = true;
+    return false;
+  }
+
+  *array = p;
+  *capacity = new_capacity;
+
+  return true;
+}
+
+//
+// img_alloc
+//
+// Reserves size bytes of zeroes in the image at the given
+// alignment, and returns their offset (0 if out of memory;
+// offset 0 is the header, so never a node).
+//
+static uint64_t img_alloc(struct IMAGE *img, size_t size, size_t align)
+{
+  size_t offset = (img->size + align - 1) & ~(align - 1);
+  size_t needed = offset + size;
+
+  if (needed > img->capacity)
+  {
+    size_t capacity = (img->capacity == 0) ? 4096 : img->capacity;
+
+    while (capacity < needed)
+      capacity *= 2;
+
+    char *bytes = (char *)realloc(img->bytes, capacity);
+
+    if (bytes == NULL)
+    {
+      img->out_of_memory = true;
+      return 0;
+    }
+
+    img->bytes = bytes;
+    img->capacity = capacity;
+  }
+
+  memset(img->bytes + img->size, 0, needed - img->size);
+  img->size = needed;
+
+  return offset;
+}
+
+//
+// img_node
+//
+// Copies a node into the image, returning its offset. The
+// caller then fixes up the node's pointers with img_pointer.
+//
+static uint64_t img_node(struct IMAGE *img, const void *node, size_t size)
+{
+  uint64_t offset = img_alloc(img, size, NODE_ALIGN);
+
+  if (offset != 0)
+    memcpy(img->bytes + offset, node, size);
+
+  return offset;
+}
+
+//
+// img_pointer
+//
+// Sets the pointer at the given offset in the image to refer
+// to the given target offset, and records it for relocation.
+//
+static void img_pointer(struct IMAGE *img, uint64_t field, uint64_t target)
+{
+  if (img->out_of_memory) // the node may not have been written:
+    return;
+
+  uintptr_t value = (uintptr_t)target;
+
+  memcpy(img->bytes + field, &value, sizeof(value));
+
+  if (target == 0) // NULL, nothing to relocate:
+    return;
+
+  if (!img_grow(img, (void **)&img->relocs, img->num_relocs, &img->relocs_capacity, sizeof(uint64_t)))
+    return;
+
+  img->relocs[img->num_relocs++] = field;
+}
+
+//
+// img_builtin
+//
+// Writes the function ID of a call site at the given offset.
+// Natives are numbered by each interpreter as they're registered,
+// so their call sites are left to be looked up again when loaded.
+//
+static void img_builtin(struct IMAGE *img, uint64_t field, int builtin)
+{
+  if (img->out_of_memory) // the node may not have been written:
+    return;
+
+  if (builtin >= BUILTIN_NATIVES)
+    builtin = BUILTIN_UNRESOLVED;
+
+  memcpy(img->bytes + field, &builtin, sizeof(builtin));
+}
+
+//
+// img_string, img_strings, img_element, img_elements, img_unary,
+// img_expr, img_condition, img_value
+//
+// Copy the given string or expression (and everything it
+// points to) into the image, returning its offset, or 0 if
+// given NULL.
+//
+static uint64_t img_string(struct IMAGE *img, const char *s)
+{
+  if (s == NULL)
+    return 0;
+
+  size_t length = strlen(s) + 1;
+  uint64_t offset = img_alloc(img, length, 1);
+
+  if (offset != 0)
+    memcpy(img->bytes + offset, s, length);
+
+  return offset;
+}
+
+//
+// an array of strings, like an array of elements below:
+//
+static uint64_t img_strings(struct IMAGE *img, char **strings, int count)
+{
+  if (count == 0)
+    return 0;
+
+  uint64_t at = img_alloc(img, count * sizeof(char *), NODE_ALIGN);
+
+  for (int i = 0; at != 0 && i < count; i++)
+    img_pointer(img, at + i * sizeof(char *), img_string(img, strings[i]));
+
+  return at;
+}
+
+static uint64_t img_element(struct IMAGE *img, struct ELEMENT *element)
+{
+  if (element == NULL)
+    return 0;
+
+  uint64_t at = img_node(img, element, sizeof(struct ELEMENT));
+
+  img_pointer(img, at + offsetof(struct ELEMENT, element_value), img_string(img, element->element_value));
+
+  return at;
+}
+
+//
+// an array of elements is an array of pointers, each relocated:
+//
+static uint64_t img_elements(struct IMAGE *img, struct ELEMENT **elements, int count)
+{
+  if (count == 0)
+    return 0;
+
+  uint64_t at = img_alloc(img, count * sizeof(struct ELEMENT *), NODE_ALIGN);
+
+  for (int i = 0; at != 0 && i < count; i++)
+    img_pointer(img, at + i * sizeof(struct ELEMENT *), img_element(img, elements[i]));
+
+  return at;
+}
+
+//
+// a nested operand refers to a step of the outermost expression,
+// whose steps are imaged as one array at steps_at:
+//
+static uint64_t img_unary(struct IMAGE *img, struct UNARY_EXPR *unary, struct VALUE_EXPR *steps, uint64_t steps_at)
+{
+  if (unary == NULL)
+    return 0;
+
+  uint64_t at = img_node(img, unary, sizeof(struct UNARY_EXPR));
+
+  img_pointer(img, at + offsetof(struct UNARY_EXPR, element), img_element(img, unary->element));
+  img_pointer(img, at + offsetof(struct UNARY_EXPR, index), img_element(img, unary->index));
+  img_pointer(img, at + offsetof(struct UNARY_EXPR, end), img_element(img, unary->end));
+
+  if (unary->expr_type == UNARY_NESTED)
+    img_pointer(img, at + offsetof(struct UNARY_EXPR, expr),
+                steps_at + (unary->expr - steps) * sizeof(struct VALUE_EXPR));
+
+  return at;
+}
+
+static uint64_t img_expr(struct IMAGE *img, struct VALUE_EXPR *expr)
+{
+  if (expr == NULL)
+    return 0;
+
+  uint64_t at = img_node(img, expr, sizeof(struct VALUE_EXPR));
+  uint64_t steps_at = 0;
+
+  if (expr->num_steps > 0)
+  {
+    steps_at = img_alloc(img, expr->num_steps * sizeof(struct VALUE_EXPR), NODE_ALIGN);
+
+    if (steps_at != 0)
+      memcpy(img->bytes + steps_at, expr->steps, expr->num_steps * sizeof(struct VALUE_EXPR));
+
+    for (int i = 0; steps_at != 0 && i < expr->num_steps; i++)
+    {
+      uint64_t step = steps_at + i * sizeof(struct VALUE_EXPR);
+
+      img_pointer(img, step + offsetof(struct VALUE_EXPR, lhs), img_unary(img, expr->steps[i].lhs, expr->steps, steps_at));
+      img_pointer(img, step + offsetof(struct VALUE_EXPR, rhs), img_unary(img, expr->steps[i].rhs, expr->steps, steps_at));
+    }
+  }
+
+  img_pointer(img, at + offsetof(struct VALUE_EXPR, steps), steps_at);
+  img_pointer(img, at + offsetof(struct VALUE_EXPR, lhs), img_unary(img, expr->lhs, expr->steps, steps_at));
+  img_pointer(img, at + offsetof(struct VALUE_EXPR, rhs), img_unary(img, expr->rhs, expr->steps, steps_at));
+
+  return at;
+}
+
+static uint64_t img_condition(struct IMAGE *img, struct CONDITION *condition)
+{
+  if (condition == NULL)
+    return 0;
+
+  uint64_t at = img_node(img, condition, sizeof(struct CONDITION));
+
+  img_pointer(img, at + offsetof(struct CONDITION, expr), img_expr(img, condition->expr));
+  img_pointer(img, at + offsetof(struct CONDITION, lhs), img_condition(img, condition->lhs));
+  img_pointer(img, at + offsetof(struct CONDITION, rhs), img_condition(img, condition->rhs));
+
+  return at;
+}
+
+static uint64_t img_stmt(struct IMAGE *img, struct STMT *stmt);
+
+static uint64_t img_value(struct IMAGE *img, struct VALUE *value)
+{
+  if (value == NULL)
+    return 0;
+
+  uint64_t at = img_node(img, value, sizeof(struct VALUE));
+  uint64_t target;
+
+  if (value->value_type == VALUE_FUNCTION_CALL)
+  {
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+    target = img_node(img, call, sizeof(struct VALUE_FUNCTION_CALL));
+
+    img_pointer(img, target + offsetof(struct VALUE_FUNCTION_CALL, function_name), img_string(img, call->function_name));
+    img_builtin(img, target + offsetof(struct VALUE_FUNCTION_CALL, builtin), call->builtin);
+    img_pointer(img, target + offsetof(struct VALUE_FUNCTION_CALL, function), img_stmt(img, call->function));
+    img_pointer(img, target + offsetof(struct VALUE_FUNCTION_CALL, parameters), img_elements(img, call->parameters, call->num_parameters));
+  }
+  else if (value->value_type == VALUE_LIST)
+  {
+    struct VALUE_LIST *list = value->types.list;
+
+    target = img_node(img, list, sizeof(struct VALUE_LIST));
+
+    img_pointer(img, target + offsetof(struct VALUE_LIST, elements), img_elements(img, list->elements, list->num_elements));
+  }
+  else if (value->value_type == VALUE_DICT)
+  {
+    struct VALUE_DICT *dict = value->types.dict;
+
+    target = img_node(img, dict, sizeof(struct VALUE_DICT));
+
+    img_pointer(img, target + offsetof(struct VALUE_DICT, keys), img_elements(img, dict->keys, dict->num_entries));
+    img_pointer(img, target + offsetof(struct VALUE_DICT, values), img_elements(img, dict->values, dict->num_entries));
+  }
+  else
+  {
+    assert(value->value_type == VALUE_EXPR);
+
+    target = img_expr(img, value->types.expr);
+  }
+
+  img_pointer(img, at + offsetof(struct VALUE, types), target);
+
+  return at;
+}
+
+//
+// img_stmt
+//
+// Returns the offset of the given statement in the image. The
+// first time a statement is seen, the STMT node is copied and
+// queued, and its contents are written later by img_contents;
+// this keeps long chains of statements from recursing deeply.
+//
+static uint64_t img_stmt(struct IMAGE *img, struct STMT *stmt)
+{
+  if (stmt == NULL)
+    return 0;
+
+  //
+  // already written? the table is at most half full, so
+  // there is always an empty slot to stop the search:
+  //
+  size_t mask = img->stmts_capacity - 1;
+  size_t i = ((uintptr_t)stmt >> 4) & mask;
+
+  while (img->stmts[i].stmt != NULL)
+  {
+    if (img->stmts[i].stmt == stmt)
+      return img->stmts[i].offset;
+
+    i = (i + 1) & mask;
+  }
+
+  uint64_t at = img_node(img, stmt, sizeof(struct STMT));
+  if (at == 0)
+    return 0;
+
+  img->stmts[i].stmt = stmt;
+  img->stmts[i].offset = at;
+  img->num_stmts++;
+
+  if (img->num_stmts * 2 > img->stmts_capacity) // rehash into a table twice the size:
+  {
+    size_t capacity = img->stmts_capacity * 2;
+    struct IMAGE_STMT *table = (struct IMAGE_STMT *)calloc(capacity, sizeof(struct IMAGE_STMT));
+
+    if (table == NULL)
+    {
+      img->out_of_memory = true;
+      return 0;
+    }
+
+    for (size_t j = 0; j < img->stmts_capacity; j++)
+    {
+      if (img->stmts[j].stmt == NULL)
+        continue;
+
+      size_t k = ((uintptr_t)img->stmts[j].stmt >> 4) & (capacity - 1);
+
+      while (table[k].stmt != NULL)
+        k = (k + 1) & (capacity - 1);
+
+      table[k] = img->stmts[j];
+    }
+
+    free(img->stmts);
+    img->stmts = table;
+    img->stmts_capacity = capacity;
+  }
+
+  if (img_grow(img, (void **)&img->pending, img->num_pending, &img->pending_capacity, sizeof(struct IMAGE_STMT)))
+  {
+    img->pending[img->num_pending].stmt = stmt;
+    img->pending[img->num_pending].offset = at;
+    img->num_pending++;
+  }
+
+  return at;
+}
+
+//
+// img_contents
+//
+// Writes the type-specific part of a queued statement.
+//
+static void img_contents(struct IMAGE *img, struct STMT *stmt, uint64_t at)
+{
+  uint64_t target;
+
+  switch (stmt->stmt_type)
+  {
+  case STMT_ASSIGNMENT:
+  {
+    struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+    target = img_node(img, assign, sizeof(struct STMT_ASSIGNMENT));
+
+    img_pointer(img, target + offsetof(struct STMT_ASSIGNMENT, var_name), img_string(img, assign->var_name));
+    img_pointer(img, target + offsetof(struct STMT_ASSIGNMENT, index), img_element(img, assign->index));
+    img_pointer(img, target + offsetof(struct STMT_ASSIGNMENT, rhs), img_value(img, assign->rhs));
+    img_pointer(img, target + offsetof(struct STMT_ASSIGNMENT, next_stmt), img_stmt(img, assign->next_stmt));
+    break;
+  }
+  case STMT_FUNCTION_CALL:
+  {
+    struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+    target = img_node(img, call, sizeof(struct STMT_FUNCTION_CALL));
+
+    img_pointer(img, target + offsetof(struct STMT_FUNCTION_CALL, function_name), img_string(img, call->function_name));
+    img_builtin(img, target + offsetof(struct STMT_FUNCTION_CALL, builtin), call->builtin);
+    img_pointer(img, target + offsetof(struct STMT_FUNCTION_CALL, object), img_element(img, call->object));
+    img_pointer(img, target + offsetof(struct STMT_FUNCTION_CALL, function), img_stmt(img, call->function));
+    img_pointer(img, target + offsetof(struct STMT_FUNCTION_CALL, parameters), img_elements(img, call->parameters, call->num_parameters));
+    img_pointer(img, target + offsetof(struct STMT_FUNCTION_CALL, next_stmt), img_stmt(img, call->next_stmt));
+    break;
+  }
+  case STMT_IF_THEN_ELSE:
+  {
+    struct STMT_IF_THEN_ELSE *ifte = stmt->types.if_then_else;
+
+    target = img_node(img, ifte, sizeof(struct STMT_IF_THEN_ELSE));
+
+    img_pointer(img, target + offsetof(struct STMT_IF_THEN_ELSE, condition), img_condition(img, ifte->condition));
+    img_pointer(img, target + offsetof(struct STMT_IF_THEN_ELSE, true_path), img_stmt(img, ifte->true_path));
+    img_pointer(img, target + offsetof(struct STMT_IF_THEN_ELSE, false_path), img_stmt(img, ifte->false_path));
+    break;
+  }
+  case STMT_WHILE_LOOP:
+  {
+    struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+    target = img_node(img, loop, sizeof(struct STMT_WHILE_LOOP));
+
+    img_pointer(img, target + offsetof(struct STMT_WHILE_LOOP, condition), img_condition(img, loop->condition));
+    img_pointer(img, target + offsetof(struct STMT_WHILE_LOOP, preheader), img_stmt(img, loop->preheader));
+    img_pointer(img, target + offsetof(struct STMT_WHILE_LOOP, loop_body), img_stmt(img, loop->loop_body));
+    img_pointer(img, target + offsetof(struct STMT_WHILE_LOOP, next_stmt), img_stmt(img, loop->next_stmt));
+    break;
+  }
+  case STMT_FOR_LOOP:
+  {
+    struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+    target = img_node(img, loop, sizeof(struct STMT_FOR_LOOP));
+
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, var_name), img_string(img, loop->var_name));
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, start), img_element(img, loop->start));
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, stop), img_element(img, loop->stop));
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, step), img_element(img, loop->step));
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, loop_body), img_stmt(img, loop->loop_body));
+    img_pointer(img, target + offsetof(struct STMT_FOR_LOOP, next_stmt), img_stmt(img, loop->next_stmt));
+    break;
+  }
+  case STMT_DEF:
+  {
+    struct STMT_DEF *def = stmt->types.def;
+
+    target = img_node(img, def, sizeof(struct STMT_DEF));
+
+    img_pointer(img, target + offsetof(struct STMT_DEF, function_name), img_string(img, def->function_name));
+    img_pointer(img, target + offsetof(struct STMT_DEF, locals), img_strings(img, def->locals, def->num_locals));
+    img_pointer(img, target + offsetof(struct STMT_DEF, body), img_stmt(img, def->body));
+    img_pointer(img, target + offsetof(struct STMT_DEF, next_stmt), img_stmt(img, def->next_stmt));
+    break;
+  }
+  case STMT_RETURN:
+  {
+    struct STMT_RETURN *ret = stmt->types.return_stmt;
+
+    target = img_node(img, ret, sizeof(struct STMT_RETURN));
+
+    img_pointer(img, target + offsetof(struct STMT_RETURN, value), img_value(img, ret->value));
+    img_pointer(img, target + offsetof(struct STMT_RETURN, next_stmt), img_stmt(img, ret->next_stmt));
+    break;
+  }
+  default:
+  {
+    assert(stmt->stmt_type == STMT_PASS);
+
+    struct STMT_PASS *pass = stmt->types.pass;
+
+    target = img_node(img, pass, sizeof(struct STMT_PASS));
+
+    img_pointer(img, target + offsetof(struct STMT_PASS, next_stmt), img_stmt(img, pass->next_stmt));
+    break;
+  }
+  }
+
+  img_pointer(img, at + offsetof(struct STMT, types), target);
+}
+
+//
+// write_file
+//
+// Writes the bytes to a temporary file in the cache directory
+// and renames it into place, so that readers never see a
+// partially-written file, even with several writers at once.
+//
+static bool write_file(struct GraphCache *cache, struct IMAGE *img)
+{
+  size_t length = strlen(cache->dir) + 16;
+  char *temp = (char *)malloc(length);
+
+  if (temp == NULL)
+    return false;
+
+  snprintf(temp, length, "%s/.tmpXXXXXX", cache->dir);
+
+  int fd = mkstemp(temp);
+
+  if (fd < 0 && errno == ENOENT) // create the directory and try again:
+  {
+    mkdir(cache->dir, 0777);
+    snprintf(temp, length, "%s/.tmpXXXXXX", cache->dir);
+
+    fd = mkstemp(temp);
+  }
+
+  if (fd < 0)
+  {
+    free(temp);
+    return false;
+  }
+
+  FILE *file = fdopen(fd, "wb");
+  bool success = (file != NULL);
+
+  if (success)
+  {
+    success = fwrite(img->bytes, 1, img->size, file) == img->size &&
+              fwrite(img->relocs, sizeof(uint64_t), img->num_relocs, file) == img->num_relocs;
+
+    success = (fclose(file) == 0) && success;
+  }
+  else
+  {
+    close(fd);
+  }
+
+  if (success)
+    success = (rename(temp, cache->path) == 0);
+
+  if (!success)
+    unlink(temp);
+
+  free(temp);
+
+  return success;
+}
+
+//
+// check_node, check_string, check_bool, check_slot,
+// check_element, check_elements, check_unary, check_step,
+// check_expr, check_condition, check_stmt, check_function,
+// check_builtin, check_value, check_contents
+//
+// Validate a relocated image before it's used, since the file
+// may be damaged: every pointer must be NULL or lie within the
+// image, every enum and count be in range, the nested operands
+// of an expression be popped in the order the steps push them
+// (see VALUE_EXPR), and a local's slot be in the frame of the
+// function it's in. Each returns false if the given part of the
+// graph is invalid; the statements it points to are queued on
+// the CHECK, so that loops and long chains don't recurse.
+//
+struct CHECK
+{
+  char *begin; // the nodes, after the header
+  char *end;   // header.image_end
+
+  uint32_t *contexts; // per NODE_ALIGN unit: 0, or 1 + the # of locals
+                      // of a statement's frame once it's queued, or
+                      // UINT32_MAX for a condition once it's checked
+  struct STMT **stmts;
+  size_t num_stmts;
+
+  int num_locals; // of the frame of the statement being checked
+};
+
+static bool check_node(struct CHECK *check, const void *node, size_t size)
+{
+  uintptr_t p = (uintptr_t)node;
+
+  return p >= (uintptr_t)check->begin && p <= (uintptr_t)check->end &&
+         size <= (uintptr_t)check->end - p && p % NODE_ALIGN == 0;
+}
+
+static bool check_string(struct CHECK *check, const char *s)
+{
+  // the image ends in '\0', see graphcache_load:
+  return (uintptr_t)s >= (uintptr_t)check->begin && (uintptr_t)s < (uintptr_t)check->end;
+}
+
+static bool check_bool(const bool *b)
+{
+  unsigned char byte;
+
+  memcpy(&byte, b, sizeof(byte));
+
+  return byte <= 1;
+}
+
+static bool check_slot(struct CHECK *check, int slot)
+{
+  return slot >= -1 && slot < check->num_locals;
+}
+
+static bool check_element(struct CHECK *check, struct ELEMENT *element)
+{
+  return check_node(check, element, sizeof(struct ELEMENT)) &&
+         element->element_type >= ELEMENT_IDENTIFIER && element->element_type <= ELEMENT_NONE &&
+         element->defined >= ELEMENT_DEFINED_UNKNOWN && element->defined <= ELEMENT_DEFINED_NEVER &&
+         (element->element_type != ELEMENT_IDENTIFIER || check_slot(check, element->slot)) &&
+         check_string(check, element->element_value);
+}
+
+static bool check_optional_element(struct CHECK *check, struct ELEMENT *element)
+{
+  return element == NULL || check_element(check, element);
+}
+
+static bool check_elements(struct CHECK *check, struct ELEMENT **elements, int count)
+{
+  if (count < 0 || (count == 0) != (elements == NULL))
+    return false;
+
+  if (count > 0 && !check_node(check, elements, count * sizeof(struct ELEMENT *)))
+    return false;
+
+  for (int i = 0; i < count; i++)
+    if (!check_element(check, elements[i]))
+      return false;
+
+  return true;
+}
+
+//
+// a nested operand must refer to one of the steps:
+//
+static bool check_unary(struct CHECK *check, struct UNARY_EXPR *unary, struct VALUE_EXPR *steps, int num_steps)
+{
+  if (!check_node(check, unary, sizeof(struct UNARY_EXPR)) ||
+      unary->expr_type < UNARY_PTR_DEREF || unary->expr_type > UNARY_NESTED)
+    return false;
+
+  if (unary->expr_type == UNARY_NESTED)
+  {
+    uintptr_t step = (uintptr_t)unary->expr;
+    uintptr_t first = (uintptr_t)steps;
+
+    return unary->element == NULL && unary->index == NULL && unary->end == NULL && num_steps > 0 &&
+           step >= first && step - first < num_steps * sizeof(struct VALUE_EXPR) &&
+           (step - first) % sizeof(struct VALUE_EXPR) == 0;
+  }
+
+  return unary->expr == NULL && check_element(check, unary->element) &&
+         check_optional_element(check, unary->index) && check_optional_element(check, unary->end);
+}
+
+//
+// a step or the expression itself, whose nested operands are
+// popped from the indices of the steps on the stack:
+//
+static bool check_step(struct CHECK *check, struct VALUE_EXPR *step, struct VALUE_EXPR *steps, int num_steps,
+                       int *stack, int *depth)
+{
+  if (!check_bool(&step->isBinaryExpr) || step->types < EXPR_TYPES_UNKNOWN || step->types > EXPR_TYPES_STR_STR ||
+      !check_unary(check, step->lhs, steps, num_steps))
+    return false;
+
+  if (step->isBinaryExpr)
+  {
+    if (step->operator < OPERATOR_PLUS || step->operator >= OPERATOR_NO_OP ||
+        !check_unary(check, step->rhs, steps, num_steps))
+      return false;
+
+    if (step->rhs->expr_type == UNARY_NESTED && (*depth == 0 || &steps[stack[--(*depth)]] != step->rhs->expr))
+      return false;
+  }
+  else if (step->rhs != NULL)
+    return false;
+
+  if (step->lhs->expr_type == UNARY_NESTED && (*depth == 0 || &steps[stack[--(*depth)]] != step->lhs->expr))
+    return false;
+
+  return true;
+}
+
+static bool check_expr(struct CHECK *check, struct VALUE_EXPR *expr)
+{
+  if (!check_node(check, expr, sizeof(struct VALUE_EXPR)) || expr->num_steps < 0 ||
+      (expr->num_steps == 0) != (expr->steps == NULL))
+    return false;
+
+  int num_steps = expr->num_steps;
+
+  if (num_steps > 0 && !check_node(check, expr->steps, num_steps * sizeof(struct VALUE_EXPR)))
+    return false;
+
+  int *stack = (num_steps > 0) ? (int *)malloc(num_steps * sizeof(int)) : NULL;
+  int depth = 0;
+  bool valid = (num_steps == 0 || stack != NULL);
+
+  for (int i = 0; valid && i < num_steps; i++)
+  {
+    struct VALUE_EXPR *step = &expr->steps[i];
+
+    valid = step->num_steps == 0 && step->steps == NULL && check_step(check, step, expr->steps, num_steps, stack, &depth);
+
+    stack[depth++] = i;
+  }
+
+  valid = valid && check_step(check, expr, expr->steps, num_steps, stack, &depth) && depth == 0;
+
+  free(stack);
+
+  return valid;
+}
+
+//
+// conditions are trees, so a condition met twice is invalid,
+// which also keeps a damaged one from recursing forever:
+//
+static bool check_condition(struct CHECK *check, struct CONDITION *condition)
+{
+  if (!check_node(check, condition, sizeof(struct CONDITION)))
+    return false;
+
+  uint32_t *context = &check->contexts[((char *)condition - check->begin) / NODE_ALIGN];
+
+  if (*context != 0)
+    return false;
+
+  *context = UINT32_MAX;
+
+  switch (condition->condition_type)
+  {
+  case CONDITION_EXPR:
+    return check_expr(check, condition->expr) && condition->lhs == NULL && condition->rhs == NULL;
+  case CONDITION_AND:
+  case CONDITION_OR:
+    return condition->expr == NULL && check_condition(check, condition->lhs) && check_condition(check, condition->rhs);
+  case CONDITION_NOT:
+    return condition->expr == NULL && check_condition(check, condition->lhs) && condition->rhs == NULL;
+  default:
+    return false;
+  }
+}
+
+//
+// a statement is queued the first time it's met, and must be in
+// the same frame every time:
+//
+static bool check_stmt(struct CHECK *check, struct STMT *stmt)
+{
+  if (stmt == NULL)
+    return true;
+
+  if (!check_node(check, stmt, sizeof(struct STMT)))
+    return false;
+
+  uint32_t *context = &check->contexts[((char *)stmt - check->begin) / NODE_ALIGN];
+
+  if (*context != 0)
+    return *context == (uint32_t)check->num_locals + 1;
+
+  *context = (uint32_t)check->num_locals + 1;
+  check->stmts[check->num_stmts++] = stmt;
+
+  return true;
+}
+
+//
+// a function called must be a def, which is at the top level, and
+// whose body is checked in its own frame when the def is:
+//
+static bool check_function(struct CHECK *check, struct STMT *function)
+{
+  if (function == NULL)
+    return true;
+
+  int num_locals = check->num_locals;
+
+  check->num_locals = 0;
+
+  bool valid = check_stmt(check, function);
+
+  check->num_locals = num_locals;
+
+  return valid && function->stmt_type == STMT_DEF;
+}
+
+static bool check_builtin(int builtin)
+{
+  // natives are never cached, see img_builtin:
+  return builtin >= BUILTIN_UNRESOLVED && builtin < BUILTIN_NATIVES;
+}
+
+static bool check_value(struct CHECK *check, struct VALUE *value)
+{
+  if (!check_node(check, value, sizeof(struct VALUE)))
+    return false;
+
+  switch (value->value_type)
+  {
+  case VALUE_FUNCTION_CALL:
+  {
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+    return check_node(check, call, sizeof(struct VALUE_FUNCTION_CALL)) &&
+           check_string(check, call->function_name) && check_builtin(call->builtin) &&
+           check_function(check, call->function) &&
+           check_elements(check, call->parameters, call->num_parameters);
+  }
+  case VALUE_EXPR:
+    return check_expr(check, value->types.expr);
+  case VALUE_LIST:
+  {
+    struct VALUE_LIST *list = value->types.list;
+
+    return check_node(check, list, sizeof(struct VALUE_LIST)) &&
+           check_elements(check, list->elements, list->num_elements);
+  }
+  case VALUE_DICT:
+  {
+    struct VALUE_DICT *dict = value->types.dict;
+
+    return check_node(check, dict, sizeof(struct VALUE_DICT)) &&
+           check_elements(check, dict->keys, dict->num_entries) &&
+           check_elements(check, dict->values, dict->num_entries);
+  }
+  default:
+    return false;
+  }
+}
+
+static bool check_contents(struct CHECK *check, struct STMT *stmt)
+{
+  switch (stmt->stmt_type)
+  {
+  case STMT_ASSIGNMENT:
+  {
+    struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+    return check_node(check, assign, sizeof(struct STMT_ASSIGNMENT)) &&
+           check_string(check, assign->var_name) && check_slot(check, assign->slot) &&
+           check_bool(&assign->isPtrDeref) && check_optional_element(check, assign->index) &&
+           check_value(check, assign->rhs) && check_stmt(check, assign->next_stmt);
+  }
+  case STMT_FUNCTION_CALL:
+  {
+    struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+    return check_node(check, call, sizeof(struct STMT_FUNCTION_CALL)) &&
+           check_string(check, call->function_name) && check_builtin(call->builtin) &&
+           check_function(check, call->function) && check_optional_element(check, call->object) &&
+           check_elements(check, call->parameters, call->num_parameters) &&
+           check_stmt(check, call->next_stmt);
+  }
+  case STMT_IF_THEN_ELSE:
+  {
+    struct STMT_IF_THEN_ELSE *ifte = stmt->types.if_then_else;
+
+    return check_node(check, ifte, sizeof(struct STMT_IF_THEN_ELSE)) &&
+           check_condition(check, ifte->condition) &&
+           check_stmt(check, ifte->true_path) && check_stmt(check, ifte->false_path);
+  }
+  case STMT_WHILE_LOOP:
+  {
+    struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+    return check_node(check, loop, sizeof(struct STMT_WHILE_LOOP)) &&
+           check_condition(check, loop->condition) && check_stmt(check, loop->preheader) &&
+           check_stmt(check, loop->loop_body) && check_stmt(check, loop->next_stmt);
+  }
+  case STMT_FOR_LOOP:
+  {
+    struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+    return check_node(check, loop, sizeof(struct STMT_FOR_LOOP)) &&
+           check_string(check, loop->var_name) && check_slot(check, loop->slot) &&
+           check_element(check, loop->start) && check_element(check, loop->stop) &&
+           check_element(check, loop->step) && check_stmt(check, loop->loop_body) &&
+           check_stmt(check, loop->next_stmt);
+  }
+  case STMT_PASS:
+  {
+    struct STMT_PASS *pass = stmt->types.pass;
+
+    return check_node(check, pass, sizeof(struct STMT_PASS)) && check_stmt(check, pass->next_stmt);
+  }
+  case STMT_DEF:
+  {
+    struct STMT_DEF *def = stmt->types.def;
+
+    if (!check_node(check, def, sizeof(struct STMT_DEF)) || check->num_locals != 0 ||
+        def->num_params < 0 || def->num_params > def->num_locals ||
+        (def->num_locals == 0) != (def->locals == NULL) || !check_string(check, def->function_name))
+      return false;
+
+    if (def->num_locals > 0 && !check_node(check, def->locals, def->num_locals * sizeof(char *)))
+      return false;
+
+    for (int i = 0; i < def->num_locals; i++)
+      if (!check_string(check, def->locals[i]))
+        return false;
+
+    check->num_locals = def->num_locals; // the body is in the def's frame:
+
+    bool valid = check_stmt(check, def->body);
+
+    check->num_locals = 0;
+
+    return valid && check_stmt(check, def->next_stmt);
+  }
+  case STMT_RETURN:
+  {
+    struct STMT_RETURN *ret = stmt->types.return_stmt;
+
+    return check_node(check, ret, sizeof(struct STMT_RETURN)) &&
+           (ret->value == NULL || check_value(check, ret->value)) && check_stmt(check, ret->next_stmt);
+  }
+  default:
+    return false;
+  }
+}
+
+//
+// check_graph
+//
+// Returns true if the relocated image of the graph at root is
+// valid, checking every statement reachable from it.
+//
+static bool check_graph(char *base, uint64_t image_end, struct STMT *root)
+{
+  struct CHECK check;
+  size_t units = image_end / NODE_ALIGN;
+
+  check.begin = base + sizeof(struct GRAPHCACHE_HEADER);
+  check.end = base + image_end;
+  check.contexts = (uint32_t *)calloc(units, sizeof(uint32_t));
+  check.stmts = (struct STMT **)malloc(units * sizeof(struct STMT *)); // at most 1 per unit
+  check.num_stmts = 0;
+  check.num_locals = 0;
+
+  bool valid = check.contexts != NULL && check.stmts != NULL && check_stmt(&check, root);
+
+  while (valid && check.num_stmts > 0)
+  {
+    struct STMT *stmt = check.stmts[--check.num_stmts];
+
+    check.num_locals = (int)check.contexts[((char *)stmt - check.begin) / NODE_ALIGN] - 1;
+
+    valid = check_contents(&check, stmt);
+  }
+
+  free(check.contexts);
+  free(check.stmts);
+
+  return valid;
+}
+
+//
+// Public functions:
+//
+
+//
+// graphcache_dir
+//
+// Returns the cache directory for the given source file, or NULL
+// if the cache is disabled (or out of memory).
+//
+char *graphcache_dir(char *filename)
+{
+  char *env = getenv("NUPY_CACHE_DIR");
+
+  if (env != NULL)
+  {
+    if (env[0] == '\0') // disabled:
+      return NULL;
+
+    return strdup(env);
+  }
+
+  char *slash = strrchr(filename, '/');
+  int dir_length = (slash == NULL) ? 0 : (int)(slash - filename + 1);
+
+  size_t length = dir_length + strlen("__nupycache__") + 1;
+  char *dir = (char *)malloc(length);
+
+  if (dir != NULL)
+    snprintf(dir, length, "%.*s__nupycache__", dir_length, filename);
+
+  return dir;
+}
+
+//
+// graphcache_open
+//
+// Reads the given source file to compute its hash, and then
+// rewinds it so it can still be parsed. Returns NULL if the
+// cache is disabled or the file could not be read.
+//
+struct GraphCache *graphcache_open(FILE *source, char *filename)
+{
+  assert(source != NULL);
+  assert(filename != NULL);
+
+  char *dir = graphcache_dir(filename);
+
+  if (dir == NULL)
+    return NULL;
+
+  //
+  // hash the source, including the format version so a new
+  // format never even finds an old file:
+  //
+  uint32_t version = GRAPHCACHE_VERSION;
+  uint64_t hash = hashBytes(HASH_START, &version, sizeof(version));
+  uint64_t length = 0;
+
+  char buffer[8192];
+  size_t n;
+
+  while ((n = fread(buffer, 1, sizeof(buffer), source)) > 0)
+  {
+    hash = hashBytes(hash, buffer, n);
+    length += n;
+  }
+
+  if (ferror(source) || fseek(source, 0, SEEK_SET) != 0)
+  {
+    clearerr(source);
+    free(dir);
+    return NULL;
+  }
+
+  struct GraphCache *cache = (struct GraphCache *)malloc(sizeof(struct GraphCache));
+  size_t path_length = strlen(dir) + 32;
+  char *path = (char *)malloc(path_length);
+
+  if (cache == NULL || path == NULL)
+  {
+    free(cache);
+    free(path);
+    free(dir);
+    return NULL;
+  }
+
+  snprintf(path, path_length, "%s/%016llx.npg", dir, (unsigned long long)hash);
+
+  cache->path = path;
+  cache->dir = dir;
+  cache->source_hash = hash;
+  cache->source_length = length;
+  cache->mapping = NULL;
+  cache->mapping_size = 0;
+  cache->listing = NULL;
+
+  return cache;
+}
+
+//
+// graphcache_load
+//
+// Returns the cached program graph for the source, or NULL
+// if there is no valid cache entry for it.
+//
+struct STMT *graphcache_load(struct GraphCache *cache)
+{
+  if (cache == NULL || cache->mapping != NULL)
+    return NULL;
+
+  int fd = open(cache->path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct GRAPHCACHE_HEADER))
+  {
+    close(fd);
+    return NULL;
+  }
+
+  //
+  // a private mapping, so the relocations below modify just
+  // our copy of the pages and never the file itself:
+  //
+  size_t size = (size_t)st.st_size;
+  char *base = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (base == MAP_FAILED)
+    return NULL;
+
+  struct GRAPHCACHE_HEADER *header = (struct GRAPHCACHE_HEADER *)base;
+
+  bool valid = memcmp(header->magic, GRAPHCACHE_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == GRAPHCACHE_VERSION &&
+               header->layout == layout_signature() &&
+               header->source_hash == cache->source_hash &&
+               header->source_length == cache->source_length &&
+               header->image_end > sizeof(struct GRAPHCACHE_HEADER) &&
+               header->image_end <= size &&
+               (size - header->image_end) / sizeof(uint64_t) == header->num_relocs &&
+               (size - header->image_end) % sizeof(uint64_t) == 0 &&
+               header->root > 0 && header->root < header->image_end &&
+               (header->listing == 0 || (header->listing >= sizeof(*header) && header->listing < header->image_end)) &&
+               base[header->image_end - 1] == '\0' && // so strings end in the image
+               header->image_end % sizeof(uint64_t) == 0 &&
+               header->file_hash == hash_words(hash_words(HASH_START, base, offsetof(struct GRAPHCACHE_HEADER, file_hash)),
+                                               base + sizeof(*header), size - sizeof(*header));
+
+  //
+  // relocate: each pointer holds an offset into the image:
+  //
+  uint64_t *relocs = (uint64_t *)(base + header->image_end);
+
+  for (uint64_t i = 0; valid && i < header->num_relocs; i++)
+  {
+    uint64_t field = relocs[i];
+    uintptr_t target;
+
+    if (field < sizeof(struct GRAPHCACHE_HEADER) || field % sizeof(uintptr_t) != 0 ||
+        field > header->image_end - sizeof(uintptr_t))
+    {
+      valid = false;
+      break;
+    }
+
+    memcpy(&target, base + field, sizeof(target));
+
+    if (target == 0 || target >= header->image_end)
+    {
+      valid = false;
+      break;
+    }
+
+    target = (uintptr_t)(base + target);
+    memcpy(base + field, &target, sizeof(target));
+  }
+
+  if (!valid || !check_graph(base, header->image_end, (struct STMT *)(base + header->root)))
+  {
+    munmap(base, size);
+    return NULL;
+  }
+
+  cache->mapping = base;
+  cache->mapping_size = size;
+  cache->listing = (header->listing == 0) ? NULL : base + header->listing;
+
+  return (struct STMT *)(base + header->root);
+}
+
+//
+// graphcache_listing
+//
+// Returns the listing stored with the loaded program graph.
+//
+const char *graphcache_listing(struct GraphCache *cache)
+{
+  return (cache == NULL) ? NULL : cache->listing;
+}
+
+//
+// graphcache_store
+//
+// Writes the program graph for the source to the cache, with
+// its listing. Returns true if successful, false if not.
+//
+bool graphcache_store(struct GraphCache *cache, struct STMT *program, const char *listing)
+{
+  if (cache == NULL || program == NULL)
+    return false;
+
+  struct IMAGE img = {0};
+
+  img.stmts_capacity = 64;
+  img.stmts = (struct IMAGE_STMT *)calloc(img.stmts_capacity, sizeof(struct IMAGE_STMT));
+
+  bool success = false;
+
+  if (img.stmts != NULL)
+  {
+    img_alloc(&img, sizeof(struct GRAPHCACHE_HEADER), NODE_ALIGN); // at offset 0
+    uint64_t root = img_stmt(&img, program);
+    uint64_t listing_at = img_string(&img, listing);
+
+    while (img.num_pending > 0 && !img.out_of_memory)
+    {
+      struct IMAGE_STMT next = img.pending[--img.num_pending];
+
+      img_contents(&img, next.stmt, next.offset);
+    }
+
+    img_alloc(&img, 1, 1); // trailing '\0', see graphcache_load
+
+    //
+    // the relocation table follows, so pad to its alignment:
+    //
+    img_alloc(&img, 0, sizeof(uint64_t));
+
+    if (!img.out_of_memory)
+    {
+      struct GRAPHCACHE_HEADER *h = (struct GRAPHCACHE_HEADER *)img.bytes;
+
+      memcpy(h->magic, GRAPHCACHE_MAGIC, sizeof(h->magic));
+      h->version = GRAPHCACHE_VERSION;
+      h->layout = layout_signature();
+      h->source_hash = cache->source_hash;
+      h->source_length = cache->source_length;
+      h->image_end = img.size;
+      h->num_relocs = img.num_relocs;
+      h->root = root;
+      h->listing = listing_at;
+
+      uint64_t hash = hash_words(HASH_START, img.bytes, offsetof(struct GRAPHCACHE_HEADER, file_hash));
+
+      hash = hash_words(hash, img.bytes + sizeof(*h), img.size - sizeof(*h));
+
+      h->file_hash = hash_words(hash, img.relocs, img.num_relocs * sizeof(uint64_t));
+
+      success = write_file(cache, &img);
+    }
+  }
+
+  free(img.bytes);
+  free(img.relocs);
+  free(img.stmts);
+  free(img.pending);
+
+  return success;
+}
+
+//
+// graphcache_close
+//
+// Unmaps any loaded program graph and frees the cache.
+//
+void graphcache_close(struct GraphCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  if (cache->mapping != NULL)
+    munmap(cache->mapping, cache->mapping_size);
+
+  free(cache->path);
+  free(cache->dir);
+  free(cache);
+}
@@ -0,0 +1,103 @@
+/*graphcache.h*/
+
+//
+// Persistent cache of compiled nuPython programs. Once a program
+// graph has been built, it is written to a cache directory in a
+// compact binary format, keyed by a hash of the source code. The
+// next time the same source is run, the graph is mapped straight
+// back into memory with mmap(), so the program is not scanned,
+// parsed or built again.
+//
+// The cache directory is $NUPY_CACHE_DIR if set, otherwise the
+// __nupycache__ directory next to the source file. Setting
+// NUPY_CACHE_DIR to the empty string disables the cache.
+//
+// Usage:
+//
+//   struct GraphCache *cache = graphcache_open(input, filename);
+//   struct STMT *program = graphcache_load(cache);
+//
+//   if (program == NULL) // not cached:
+//   {
+//     ... parse and build program ...
+//     char *listing = programgraph_listing(program);
+//     ... optimize program ...
+//     graphcache_store(cache, program, listing);
+//   }
+//
+//   ... execute program ...
+//
+//   graphcache_close(cache); // program is unmapped if cached
+//
+// A loaded graph lives in the cache's mapping, so it must NOT
+// be passed to programgraph_destroy().
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+
+struct GraphCache; // opaque
+
+//
+// Public functions:
+//
+
+//
+// graphcache_dir
+//
+// Returns the cache directory for the given source file, as
+// described above, or NULL if the cache is disabled. Other
+// caches of compiled programs live there too (see aot.h).
+// The caller frees the string.
+//
+char *graphcache_dir(char *filename);
+
+//
+// graphcache_open
+//
+// Reads the given source file to compute its hash, and then
+// rewinds it so it can still be parsed. Returns NULL if the
+// cache is disabled or the file could not be read; the other
+// functions treat a NULL cache as always empty.
+//
+struct GraphCache *graphcache_open(FILE *source, char *filename);
+
+//
+// graphcache_load
+//
+// Returns the cached program graph for the source, or NULL
+// if there is no valid cache entry for it; a file that has been
+// damaged, or doesn't hold a well-formed graph, is not valid.
+//
+struct STMT *graphcache_load(struct GraphCache *cache);
+
+//
+// graphcache_listing
+//
+// Returns the listing stored with the loaded program graph,
+// or NULL if none was.
+//
+const char *graphcache_listing(struct GraphCache *cache);
+
+//
+// graphcache_store
+//
+// Writes the program graph for the source to the cache, with
+// the given listing of the program as it was built (see
+// programgraph_listing), which may be NULL: the cached graph is
+// optimized, and no longer prints as the source program does.
+// Returns true if successful, false if not; a program that
+// cannot be cached still runs, so failures are silent.
+//
+bool graphcache_store(struct GraphCache *cache, struct STMT *program, const char *listing);
+
+//
+// graphcache_close
+//
+// Unmaps any loaded program graph and frees the cache.
+//
+void graphcache_close(struct GraphCache *cache);
@@ -0,0 +1,364 @@
+/*induction.c*/
+
+//
+// Runs counting loops without iterating them; see induction.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // int64_t, uint32_t, uint64_t
+#include <string.h>
+#include <limits.h>  // INT_MIN, INT_MAX
+
+#include "induction.h"
+#include "ram.h"
+
+//
+// Loops with more variables than this are left to the executor:
+//
+#define MAX_UPDATES 8
+
+//
+// An assignment v = v + operand or v = v - operand in the body
+// of a loop:
+//
+struct Update
+{
+  int address;            // of v in memory
+  int sign;               // +1 for +, -1 for -
+  int operand;            // index of the update of the operand, or -1
+  struct RAM_VALUE step;  // the operand, if the loop doesn't assign it
+  struct RAM_VALUE value; // v
+};
+
+//
+// Private functions:
+//
+
+//
+// element_value
+//
+// Returns the value of an int or real literal, or of a variable
+// holding an int or real, via the reference parameter; returns
+// false for anything else, including undefined variables.
+//
+static bool element_value(struct Interpreter *interp, struct ELEMENT *element, struct RAM_VALUE *value)
+{
+  if (element->element_type == ELEMENT_INT_LITERAL)
+  {
+    value->value_type = RAM_TYPE_INT;
+    value->types.i = atoi(element->element_value);
+    return true;
+  }
+
+  if (element->element_type == ELEMENT_REAL_LITERAL)
+  {
+    value->value_type = RAM_TYPE_REAL;
+    value->types.d = atof(element->element_value);
+    return true;
+  }
+
+  if (element->element_type != ELEMENT_IDENTIFIER)
+    return false;
+
+  int address = ram_get_addr(interp->memory, element->element_value);
+
+  if (address < 0)
+    return false;
+
+  *value = interp->memory->cells[address].value;
+
+  return value->value_type == RAM_TYPE_INT || value->value_type == RAM_TYPE_REAL;
+}
+
+//
+// find_update
+//
+// Returns the index of the update of the variable the element
+// names, or -1 if it's not a variable the loop assigns.
+//
+static int find_update(struct STMT **stmts, int num_updates, struct ELEMENT *element)
+{
+  if (element->element_type != ELEMENT_IDENTIFIER)
+    return -1;
+
+  for (int u = 0; u < num_updates; u++)
+    if (strcmp(stmts[u]->types.assignment->var_name, element->element_value) == 0)
+      return u;
+
+  return -1;
+}
+
+//
+// parse_body
+//
+// Fills in the updates making up the loop body, in order, with
+// the current values of their variables and operands, and their
+// statements, and returns how many; returns -1 if the body has
+// any other kind of statement, or the values are not all ints
+// and reals.
+//
+static int parse_body(struct Interpreter *interp, struct STMT *stmt, struct Update updates[MAX_UPDATES], struct STMT *stmts[MAX_UPDATES])
+{
+  struct ELEMENT *operands[MAX_UPDATES];
+  int num_updates = 0;
+
+  while (stmt != NULL)
+  {
+    if (stmt->stmt_type == STMT_PASS)
+    {
+      stmt = stmt->types.pass->next_stmt;
+      continue;
+    }
+
+    if (stmt->stmt_type != STMT_ASSIGNMENT || num_updates == MAX_UPDATES)
+      return -1;
+
+    struct STMT_ASSIGNMENT *assignment = stmt->types.assignment;
+
+    if (assignment->isPtrDeref || assignment->index != NULL || assignment->rhs->value_type != VALUE_EXPR)
+      return -1;
+
+    struct VALUE_EXPR *expr = assignment->rhs->types.expr;
+
+    if (!expr->isBinaryExpr || expr->lhs->expr_type != UNARY_ELEMENT || expr->rhs->expr_type != UNARY_ELEMENT)
+      return -1;
+
+    if (expr->operator != OPERATOR_PLUS && expr->operator != OPERATOR_MINUS)
+      return -1;
+
+    struct ELEMENT *lhs = expr->lhs->element;
+    struct ELEMENT *rhs = expr->rhs->element;
+    char *name = assignment->var_name;
+    bool lhs_is_var = lhs->element_type == ELEMENT_IDENTIFIER && strcmp(lhs->element_value, name) == 0;
+    bool rhs_is_var = rhs->element_type == ELEMENT_IDENTIFIER && strcmp(rhs->element_value, name) == 0;
+
+    if (lhs_is_var == rhs_is_var) // v = v + v, or v isn't updated
+      return -1;
+    if (rhs_is_var && expr->operator == OPERATOR_MINUS) // v = x - v
+      return -1;
+    if (find_update(stmts, num_updates, lhs_is_var ? lhs : rhs) >= 0) // v assigned twice
+      return -1;
+
+    struct Update *update = &updates[num_updates];
+
+    update->address = ram_get_addr(interp->memory, name);
+    update->sign = (expr->operator == OPERATOR_PLUS) ? 1 : -1;
+
+    if (update->address < 0)
+      return -1;
+
+    update->value = interp->memory->cells[update->address].value;
+
+    if (update->value.value_type != RAM_TYPE_INT && update->value.value_type != RAM_TYPE_REAL)
+      return -1;
+
+    stmts[num_updates] = stmt;
+    operands[num_updates] = lhs_is_var ? rhs : lhs;
+    num_updates++;
+
+    stmt = assignment->next_stmt;
+  }
+
+  //
+  // now that all the variables the loop assigns are known, an
+  // operand is either one of those or a value that doesn't change:
+  //
+  for (int u = 0; u < num_updates; u++)
+  {
+    updates[u].operand = find_update(stmts, num_updates, operands[u]);
+
+    if (updates[u].operand < 0 && !element_value(interp, operands[u], &updates[u].step))
+      return -1;
+  }
+
+  return num_updates;
+}
+
+//
+// trip_count
+//
+// Returns how many times a loop whose condition is currently true
+// runs, if its condition compares an int variable with a bound the
+// loop doesn't change, and the variable is only updated by adding
+// or subtracting an int constant, without wrapping around. Returns
+// 0 if not.
+//
+static int64_t trip_count(struct Interpreter *interp, struct VALUE_EXPR *condition, struct STMT **stmts, struct Update *updates, int num_updates)
+{
+  if (!condition->isBinaryExpr || condition->lhs->expr_type != UNARY_ELEMENT || condition->rhs->expr_type != UNARY_ELEMENT)
+    return 0;
+
+  int operator = condition->operator;
+  struct ELEMENT *counter = condition->lhs->element;
+  struct ELEMENT *bound = condition->rhs->element;
+  int u = find_update(stmts, num_updates, counter);
+
+  if (u < 0) // bound < i => i > bound, etc.:
+  {
+    counter = condition->rhs->element;
+    bound = condition->lhs->element;
+    u = find_update(stmts, num_updates, counter);
+
+    if (operator == OPERATOR_LT)
+      operator = OPERATOR_GT;
+    else if (operator == OPERATOR_LTE)
+      operator = OPERATOR_GTE;
+    else if (operator == OPERATOR_GT)
+      operator = OPERATOR_LT;
+    else if (operator == OPERATOR_GTE)
+      operator = OPERATOR_LTE;
+  }
+
+  struct RAM_VALUE limit;
+
+  if (u < 0 || find_update(stmts, num_updates, bound) >= 0 || !element_value(interp, bound, &limit))
+    return 0;
+
+  if (updates[u].operand >= 0 || updates[u].value.value_type != RAM_TYPE_INT ||
+      updates[u].step.value_type != RAM_TYPE_INT || limit.value_type != RAM_TYPE_INT)
+    return 0;
+
+  int64_t start = updates[u].value.types.i;
+  int64_t step = (int64_t)updates[u].sign * updates[u].step.types.i;
+  int64_t distance = (int64_t)limit.types.i - start;
+  int64_t n;
+
+  if ((operator == OPERATOR_LT || operator == OPERATOR_LTE) && step > 0)
+    n = (operator == OPERATOR_LT) ? (distance + step - 1) / step : distance / step + 1;
+  else if ((operator == OPERATOR_GT || operator == OPERATOR_GTE) && step < 0)
+    n = (operator == OPERATOR_GT) ? (-distance - step - 1) / -step : distance / step + 1;
+  else if (operator == OPERATOR_NOT_EQUAL && step != 0 && distance % step == 0 && distance / step > 0)
+    n = distance / step;
+  else
+    return 0;
+
+  int64_t last = start + n * step;
+
+  return (last < INT_MIN || last > INT_MAX) ? 0 : n;
+}
+
+//
+// closed_form
+//
+// Computes the values of the variables after n iterations, for
+// ints only: a variable whose operand doesn't change grows by n
+// times the operand, and one whose operand is such a variable j
+// grows by the sum of an arithmetic sequence, j's values over
+// the iterations. Ints wrap around as the executor's do, so the
+// arithmetic is done modulo 2^32.
+//
+static void closed_form(struct Update *updates, int num_updates, int64_t n)
+{
+  uint32_t after[MAX_UPDATES];
+  uint64_t triangle_after = (n % 2 == 0) ? (uint64_t)(n / 2) * (uint64_t)(n + 1) : (uint64_t)n * (uint64_t)((n + 1) / 2);
+  uint64_t triangle_before = (n % 2 == 0) ? (uint64_t)(n / 2) * (uint64_t)(n - 1) : (uint64_t)n * (uint64_t)((n - 1) / 2);
+
+  for (int u = 0; u < num_updates; u++)
+  {
+    uint32_t start = (uint32_t)updates[u].value.types.i;
+    uint32_t sum;
+
+    if (updates[u].operand < 0)
+      sum = (uint32_t)n * (uint32_t)updates[u].step.types.i;
+    else
+    {
+      //
+      // j's values are j0 + t*c for t = 1..n if j is updated first,
+      // t = 0..n-1 otherwise:
+      //
+      struct Update *j = &updates[updates[u].operand];
+      uint32_t c = (uint32_t)j->sign * (uint32_t)j->step.types.i;
+      uint32_t triangle = (uint32_t)((updates[u].operand < u) ? triangle_after : triangle_before);
+
+      sum = (uint32_t)n * (uint32_t)j->value.types.i + c * triangle;
+    }
+
+    after[u] = start + (uint32_t)updates[u].sign * sum;
+  }
+
+  for (int u = 0; u < num_updates; u++)
+    updates[u].value.types.i = (int)(int32_t)after[u];
+}
+
+//
+// native_loop
+//
+// Runs the n iterations on the values, with the executor's
+// semantics for + and -: an int and a real give a real, and ints
+// wrap around.
+//
+static void native_loop(struct Update *updates, int num_updates, int64_t n)
+{
+  for (int64_t t = 0; t < n; t++)
+  {
+    for (int u = 0; u < num_updates; u++)
+    {
+      struct RAM_VALUE *v = &updates[u].value;
+      struct RAM_VALUE *x = (updates[u].operand < 0) ? &updates[u].step : &updates[updates[u].operand].value;
+
+      if (v->value_type == RAM_TYPE_INT && x->value_type == RAM_TYPE_INT)
+        v->types.i = (int)(int32_t)((uint32_t)v->types.i + (uint32_t)updates[u].sign * (uint32_t)x->types.i);
+      else
+      {
+        double lhs = (v->value_type == RAM_TYPE_INT) ? v->types.i : v->types.d;
+        double rhs = (x->value_type == RAM_TYPE_INT) ? x->types.i : x->types.d;
+
+        v->value_type = RAM_TYPE_REAL;
+        v->types.d = (updates[u].sign > 0) ? lhs + rhs : lhs - rhs;
+      }
+    }
+  }
+}
+
+//
+// Public functions:
+//
+
+//
+// induction_run
+//
+bool induction_run(struct Interpreter *interp, struct STMT *stmt)
+{
+  struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+  struct Update updates[MAX_UPDATES];
+  struct STMT *stmts[MAX_UPDATES];
+  if (loop->condition->condition_type != CONDITION_EXPR) // a single comparison only
+    return false;
+
+  int num_updates = parse_body(interp, loop->loop_body, updates, stmts);
+
+  if (num_updates <= 0)
+    return false;
+
+  int64_t n = trip_count(interp, loop->condition->expr, stmts, updates, num_updates);
+
+  if (n <= 0)
+    return false;
+
+  bool ints = true;
+
+  for (int u = 0; u < num_updates; u++)
+  {
+    int operand = updates[u].operand;
+
+    if (updates[u].value.value_type != RAM_TYPE_INT)
+      ints = false;
+    else if (operand < 0)
+      ints = ints && updates[u].step.value_type == RAM_TYPE_INT;
+    else
+      ints = ints && updates[operand].operand < 0 && updates[operand].value.value_type == RAM_TYPE_INT &&
+             updates[operand].step.value_type == RAM_TYPE_INT;
+  }
+
+  if (ints)
+    closed_form(updates, num_updates, n);
+  else
+    native_loop(updates, num_updates, n);
+
+  for (int u = 0; u < num_updates; u++)
+    ram_write_cell_by_addr(interp->memory, updates[u].value, updates[u].address);
+
+  return true;
+}
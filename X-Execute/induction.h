@@ -0,0 +1,47 @@
+/*induction.h*/
+
+//
+// Runs counting loops without iterating them. A while loop such as
+//
+//   while i < n:
+//   {
+//     s = s + i
+//     i = i + 1
+//   }
+//
+// whose body only adds to and subtracts from its variables, and
+// whose condition compares one of them with a bound the loop
+// doesn't change, runs a number of times that can be computed
+// when it's entered; so can the final values of the variables,
+// in closed form when they are ints and otherwise by a tight
+// native loop, with exactly the results iterating would give.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+#include "interpreter.h"
+
+//
+// Public functions:
+//
+
+//
+// induction_run
+//
+// Given a while loop whose condition has just been found true
+// (and whose preheader has run), tries to run the rest of the
+// loop as above, with the types the variables hold now: if it
+// can, writes the variables' final values to memory and returns
+// true. Returns false, having changed nothing, if the loop or
+// the variables' types don't have the required form; the caller
+// then runs the loop as usual.
+//
+// The loops run this way cannot fail, but ints wrap around on
+// overflow, as they do when the loop is run as usual. Loops that
+// would not terminate, or whose counter would wrap around, are
+// left to the caller.
+//
+bool induction_run(struct Interpreter *interp, struct STMT *stmt);
@@ -0,0 +1,100 @@
+/*interpreter.c*/
+
+//
+// Interpreter context for nuPython. An interpreter owns everything
+// needed to compile and run programs: the scanner and parser state
+// for the source being compiled, the memory holding the program's
+// variables, and the streams that input() reads from and that
+// print() and all messages write to.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "interpreter.h"
+#include "jit.h"
+#include "callcache.h"
+
+//
+// Public functions:
+//
+
+//
+// interpreter_create
+//
+// Returns a pointer to a dynamically-allocated interpreter
+// with an empty memory. input() reads lines from the given
+// input stream, and the program's output, syntax errors and
+// execution errors are written to the given output stream.
+// Returns NULL if out of memory.
+//
+struct Interpreter *interpreter_create(FILE *input, FILE *output)
+{
+  assert(input != NULL);
+  assert(output != NULL);
+
+  struct Interpreter *interp = (struct Interpreter *)malloc(sizeof(struct Interpreter));
+  if (interp == NULL)
+    return NULL;
+
+  //
+  // the scanner is set up by each call to parser_parse:
+  //
+  interp->scanner.input = NULL;
+  interp->scanner.output = output;
+  interp->scanner.value = NULL;
+  interp->scanner.capacity = 0;
+  interp->tokens = NULL;
+
+  interp->reader = linereader_create(input);
+  if (interp->reader == NULL)
+  {
+    free(interp);
+    return NULL;
+  }
+
+  interp->builtins = builtins_create();
+  if (interp->builtins == NULL)
+  {
+    linereader_destroy(interp->reader);
+    free(interp);
+    return NULL;
+  }
+
+  interp->memory = ram_init();
+  interp->input = input;
+  interp->output = output;
+  interp->jit = NULL;
+
+  interp->stack = NULL; // allocated at the first call
+  interp->stack_top = 0;
+  interp->depth = 0;
+  interp->frame = NULL;
+  interp->returning = false;
+  interp->tail_call = NULL;
+  interp->calls = NULL; // allocated at the first call
+
+  return interp;
+}
+
+//
+// interpreter_destroy
+//
+// Frees the interpreter, including its memory, call stack, call
+// caches, JIT and registry of functions.
+//
+void interpreter_destroy(struct Interpreter *interp)
+{
+  if (interp == NULL)
+    return;
+
+  ram_destroy(interp->memory);
+  linereader_destroy(interp->reader);
+  jit_destroy(interp->jit);
+  builtins_destroy(interp->builtins);
+  callcache_destroy(interp->calls);
+
+  free(interp->stack);
+  free(interp);
+}
@@ -0,0 +1,105 @@
+/*interpreter.h*/
+
+//
+// Interpreter context for nuPython. An interpreter owns everything
+// needed to compile and run programs: the scanner and parser state
+// for the source being compiled, the memory holding the program's
+// variables, and the streams that input() reads from and that
+// print() and all messages write to. Every stage of the pipeline
+// (parser_parse, programgraph_build, execute) takes the interpreter,
+// so there is no global state, and independent interpreters can
+// run on different threads at the same time.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h> // true, false
+
+#include "scanner.h"
+#include "tokenqueue.h"
+#include "ram.h"
+#include "linereader.h"
+#include "builtins.h"
+
+struct Interpreter
+{
+  //
+  // front end: scanner state for the source being parsed, and
+  // the tokens the parser is working through (NULL when no
+  // parse is in progress):
+  //
+  struct Scanner scanner;
+  struct TokenQueue *tokens;
+
+  //
+  // back end: the program's variables, and its input / output:
+  //
+  struct RAM *memory;
+  struct LineReader *reader; // lines for input()
+  FILE *input;               // stream input() reads from
+  FILE *output;              // print() output and all messages
+
+  //
+  // the functions programs can call: the builtins, plus natives
+  // registered by an embedder (see builtins.h):
+  //
+  struct Builtins *builtins;
+
+  //
+  // calls of the functions the program defines: the locals of
+  // each call in progress are a frame of values on one stack,
+  // allocated at the first call, and the running call's frame
+  // is the last (NULL at the top level); a return unwinds the
+  // running call with its value in result, or, for a return of
+  // a call, with the call in tail_call and its arguments above
+  // the frame, to be run in the frame (see execute.h):
+  //
+  struct RAM_VALUE *stack;
+  int stack_top; // # of values in use
+  int depth;     // # of calls in progress
+  struct RAM_VALUE *frame;
+  bool returning;
+  struct RAM_VALUE result;
+  struct VALUE_FUNCTION_CALL *tail_call;
+
+  //
+  // the bodies the call sites run, typed for the arguments they
+  // pass, allocated at the first call (see callcache.h):
+  //
+  struct CallCache *calls;
+
+  //
+  // compiler from hot loops to machine code, NULL => loops are
+  // not compiled (see jit.h):
+  //
+  struct Jit *jit;
+};
+
+//
+// Public functions:
+//
+
+//
+// interpreter_create
+//
+// Returns a pointer to a dynamically-allocated interpreter
+// with an empty memory. input() reads lines from the given
+// input stream, and the program's output, syntax errors and
+// execution errors are written to the given output stream.
+// Returns NULL if out of memory.
+//
+// Hot loops are not compiled to machine code unless the caller
+// sets interp->jit to jit_create().
+//
+// NOTE: the streams are not closed by interpreter_destroy().
+//
+struct Interpreter *interpreter_create(FILE *input, FILE *output);
+
+//
+// interpreter_destroy
+//
+// Frees the interpreter, including its memory, call stack, call
+// caches, JIT and registry of functions.
+//
+void interpreter_destroy(struct Interpreter *interp);
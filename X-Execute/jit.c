@@ -0,0 +1,561 @@
+/*jit.c*/
+
+//
+// Just-in-time compiler from arithmetic loops to x86-64 machine
+// code; see jit.h.
+//
+
+// for MAP_ANONYMOUS:
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <stdint.h>  // uint8_t, uint32_t, uint64_t
+#include <string.h>
+#include <math.h>     // pow, fmod
+#include <sys/mman.h> // mmap, mprotect, munmap
+
+#include "jit.h"
+#include "programgraph.h"
+#include "ram.h"
+#include "util.h"
+
+//
+// Code is only generated for x86-64:
+//
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_X86_64
+#endif
+
+#ifdef JIT_X86_64
+
+//
+// Code being generated:
+//
+struct Code
+{
+  uint8_t *bytes;
+  int size;
+  int capacity;
+  bool failed; // out of memory
+
+  int *bail_at;     // offsets of the jumps to the bail-outs,
+  int *bail_op;     // and the statements they're for
+  int num_bails;
+};
+
+//
+// x86-64 registers, by number:
+//
+#define EAX 0
+#define ECX 1
+#define EDX 2
+#define XMM0 0
+#define XMM1 1
+#define XMM2 2
+#define XMM3 3
+
+//
+// Private functions:
+//
+
+//
+// emit
+//
+// Appends bytes to the code.
+//
+static void emit_bytes(struct Code *code, const uint8_t *bytes, int n)
+{
+  if (code->size + n > code->capacity)
+  {
+    int capacity = 2 * code->capacity + n;
+    uint8_t *grown = (uint8_t *)realloc(code->bytes, capacity);
+
+    if (grown == NULL)
+    {
+      code->failed = true;
+      return;
+    }
+
+    code->bytes = grown;
+    code->capacity = capacity;
+  }
+
+  memcpy(code->bytes + code->size, bytes, n);
+  code->size += n;
+}
+
+#define emit(code, ...)                                   \
+  do                                                      \
+  {                                                       \
+    const uint8_t bytes_[] = {__VA_ARGS__};               \
+    emit_bytes(code, bytes_, (int)sizeof(bytes_));        \
+  } while (0)
+
+static void emit_u32(struct Code *code, uint32_t value)
+{
+  emit(code, value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24);
+}
+
+static void emit_u64(struct Code *code, uint64_t value)
+{
+  emit_u32(code, (uint32_t)value);
+  emit_u32(code, (uint32_t)(value >> 32));
+}
+
+//
+// emit_slot
+//
+// Appends the ModRM byte and displacement addressing the slot, as
+// [rbx + 8*slot], with the given register in the reg field.
+//
+static void emit_slot(struct Code *code, int reg, int slot)
+{
+  emit(code, 0x80 | (reg << 3) | 3);
+  emit_u32(code, 8 * slot);
+}
+
+//
+// Instructions:
+//
+static void load_int(struct Code *code, int reg, int slot) // mov reg, [slot]
+{
+  emit(code, 0x8B);
+  emit_slot(code, reg, slot);
+}
+
+static void store_int(struct Code *code, int reg, int slot) // mov [slot], reg
+{
+  emit(code, 0x89);
+  emit_slot(code, reg, slot);
+}
+
+static void load_real(struct Code *code, int xmm, int slot, int type) // movsd / cvtsi2sd xmm, [slot]
+{
+  //
+  // cvtsi2sd only writes the low half of the register, so clear it
+  // first, else it waits on whatever last wrote the register:
+  //
+  if (type == RAM_TYPE_INT)
+    emit(code, 0x66, 0x0F, 0x57, 0xC0 | (xmm << 3) | xmm); // xorpd xmm, xmm
+
+  emit(code, 0xF2, 0x0F, (type == RAM_TYPE_INT) ? 0x2A : 0x10);
+  emit_slot(code, xmm, slot);
+}
+
+static void store_real(struct Code *code, int xmm, int slot) // movsd [slot], xmm
+{
+  emit(code, 0xF2, 0x0F, 0x11);
+  emit_slot(code, xmm, slot);
+}
+
+static void sse(struct Code *code, uint8_t prefix, uint8_t opcode, int dst, int src) // e.g. addsd dst, src
+{
+  emit(code, prefix, 0x0F, opcode, 0xC0 | (dst << 3) | src);
+}
+
+static void load_constant(struct Code *code, int xmm, double value) // mov rax, value; movq xmm, rax
+{
+  uint64_t bits;
+
+  memcpy(&bits, &value, sizeof(bits));
+  emit(code, 0x48, 0xB8);
+  emit_u64(code, bits);
+  emit(code, 0x66, 0x48, 0x0F, 0x6E, 0xC0 | (xmm << 3));
+}
+
+static void call(struct Code *code, double (*function)(double, double)) // mov rax, function; call rax
+{
+  uint64_t address;
+
+  memcpy(&address, &function, sizeof(address));
+  emit(code, 0x48, 0xB8);
+  emit_u64(code, address);
+  emit(code, 0xFF, 0xD0);
+}
+
+static void set_result(struct Code *code, uint8_t setcc, int slot) // setcc al; movzx eax, al; mov [slot], eax
+{
+  emit(code, 0x0F, setcc, 0xC0);
+  emit(code, 0x0F, 0xB6, 0xC0);
+  store_int(code, EAX, slot);
+}
+
+//
+// bail_if
+//
+// Appends a conditional jump (0F jcc rel32) to the bail-out for
+// statement # op, which is appended after the loop.
+//
+static void bail_if(struct Code *code, uint8_t jcc, int op)
+{
+  int *at = (int *)realloc(code->bail_at, (code->num_bails + 1) * sizeof(int));
+  int *ops = (at == NULL) ? NULL : (int *)realloc(code->bail_op, (code->num_bails + 1) * sizeof(int));
+
+  if (at != NULL)
+    code->bail_at = at;
+  if (ops != NULL)
+    code->bail_op = ops;
+
+  if (at == NULL || ops == NULL)
+  {
+    code->failed = true;
+    return;
+  }
+
+  emit(code, 0x0F, jcc);
+  code->bail_at[code->num_bails] = code->size;
+  code->bail_op[code->num_bails] = op;
+  code->num_bails++;
+  emit_u32(code, 0); // patched by compile_loop
+}
+
+//
+// compile_int_op
+//
+// Appends the code for an operator applied to two ints, with the
+// semantics of execute_int_operator.
+//
+static void compile_int_op(struct Code *code, struct JitOp *op, int index)
+{
+  switch (op->operator)
+  {
+  case OPERATOR_PLUS:
+  case OPERATOR_MINUS:
+  case OPERATOR_ASTERISK:
+    load_int(code, EAX, op->lhs);
+    if (op->operator == OPERATOR_PLUS)
+      emit(code, 0x03); // add eax, [rhs]
+    else if (op->operator == OPERATOR_MINUS)
+      emit(code, 0x2B); // sub eax, [rhs]
+    else
+      emit(code, 0x0F, 0xAF); // imul eax, [rhs]
+    emit_slot(code, EAX, op->rhs);
+    store_int(code, EAX, op->result);
+    return;
+  case OPERATOR_POWER:
+    load_real(code, XMM0, op->lhs, RAM_TYPE_INT);
+    load_real(code, XMM1, op->rhs, RAM_TYPE_INT);
+    call(code, pow);
+    emit(code, 0xF2, 0x0F, 0x2C, 0xC0); // cvttsd2si eax, xmm0
+    store_int(code, EAX, op->result);
+    return;
+  case OPERATOR_MOD:
+  case OPERATOR_DIV:
+    load_int(code, ECX, op->rhs);
+    emit(code, 0x85, 0xC9); // test ecx, ecx
+    bail_if(code, 0x84, index); // jz
+    emit(code, 0x83, 0xF9, 0xFF); // cmp ecx, -1: INT_MIN / -1 traps, so
+    bail_if(code, 0x84, index);   // je, the executor divides by -1
+    load_int(code, EAX, op->lhs);
+    emit(code, 0x99);       // cdq
+    emit(code, 0xF7, 0xF9); // idiv ecx
+    store_int(code, (op->operator == OPERATOR_DIV) ? EAX : EDX, op->result);
+    return;
+  default:
+    break;
+  }
+
+  static const uint8_t setcc[] = {
+      0x94, // OPERATOR_EQUAL: sete
+      0x95, // OPERATOR_NOT_EQUAL: setne
+      0x9C, // OPERATOR_LT: setl
+      0x9E, // OPERATOR_LTE: setle
+      0x9F, // OPERATOR_GT: setg
+      0x9D  // OPERATOR_GTE: setge
+  };
+
+  load_int(code, EAX, op->lhs);
+  emit(code, 0x3B); // cmp eax, [rhs]
+  emit_slot(code, EAX, op->rhs);
+  set_result(code, setcc[op->operator - OPERATOR_EQUAL], op->result);
+}
+
+//
+// compile_real_op
+//
+// Appends the code for an operator applied to two reals, or an int
+// and a real, with the semantics of execute_real_operator: the lhs
+// is in xmm0 and the rhs in xmm1.
+//
+static void compile_real_op(struct Code *code, struct JitOp *op, int index)
+{
+  load_real(code, XMM0, op->lhs, op->lhs_type);
+  load_real(code, XMM1, op->rhs, op->rhs_type);
+
+  switch (op->operator)
+  {
+  case OPERATOR_PLUS:
+    sse(code, 0xF2, 0x58, XMM0, XMM1); // addsd
+    store_real(code, XMM0, op->result);
+    return;
+  case OPERATOR_MINUS:
+    sse(code, 0xF2, 0x5C, XMM0, XMM1); // subsd
+    store_real(code, XMM0, op->result);
+    return;
+  case OPERATOR_ASTERISK:
+    sse(code, 0xF2, 0x59, XMM0, XMM1); // mulsd
+    store_real(code, XMM0, op->result);
+    return;
+  case OPERATOR_POWER:
+    call(code, pow);
+    store_real(code, XMM0, op->result);
+    return;
+  case OPERATOR_MOD:
+  case OPERATOR_DIV:
+    //
+    // rhs == 0.0: equal and ordered (not NaN)
+    //
+    sse(code, 0x66, 0x57, XMM2, XMM2); // xorpd xmm2, xmm2
+    sse(code, 0x66, 0x2E, XMM1, XMM2); // ucomisd xmm1, xmm2
+    emit(code, 0x7A, 0x06);             // jp over the je
+    bail_if(code, 0x84, index);         // je
+    if (op->operator == OPERATOR_DIV)
+      sse(code, 0xF2, 0x5E, XMM0, XMM1); // divsd
+    else
+      call(code, fmod);
+    store_real(code, XMM0, op->result);
+    return;
+  case OPERATOR_EQUAL:
+  case OPERATOR_NOT_EQUAL:
+    sse(code, 0xF2, 0x5C, XMM0, XMM1); // subsd
+    emit(code, 0x48, 0xB8);            // mov rax, the mask for fabs
+    emit_u64(code, 0x7FFFFFFFFFFFFFFFULL);
+    emit(code, 0x66, 0x48, 0x0F, 0x6E, 0xD8); // movq xmm3, rax
+    sse(code, 0x66, 0x54, XMM0, XMM3);        // andpd xmm0, xmm3
+    load_constant(code, XMM2, 0.001);
+    if (op->operator == OPERATOR_EQUAL)
+      sse(code, 0x66, 0x2E, XMM2, XMM0); // ucomisd: 0.001 > |lhs - rhs|
+    else
+      sse(code, 0x66, 0x2E, XMM0, XMM2); // ucomisd: |lhs - rhs| > 0.001
+    set_result(code, 0x97, op->result);  // seta
+    return;
+  case OPERATOR_LT:
+    sse(code, 0x66, 0x2E, XMM1, XMM0);  // ucomisd: rhs > lhs
+    set_result(code, 0x97, op->result); // seta
+    return;
+  case OPERATOR_LTE:
+    load_constant(code, XMM2, 0.0001);
+    sse(code, 0xF2, 0x58, XMM1, XMM2);  // addsd
+    sse(code, 0x66, 0x2E, XMM1, XMM0);  // ucomisd: rhs + 0.0001 >= lhs
+    set_result(code, 0x93, op->result); // setae
+    return;
+  case OPERATOR_GT:
+  case OPERATOR_GTE:
+    load_constant(code, XMM2, 0.0001);
+    sse(code, 0xF2, (op->operator == OPERATOR_GT) ? 0x58 : 0x5C, XMM1, XMM2); // addsd / subsd
+    sse(code, 0x66, 0x2E, XMM0, XMM1);  // ucomisd: lhs > rhs +/- 0.0001
+    set_result(code, 0x97, op->result); // seta
+    return;
+  default:
+    return;
+  }
+}
+
+//
+// compile_loop
+//
+// Generates the code for the loop, with the slots addressed through
+// rbx, which is callee-saved and so survives calls to pow and fmod.
+//
+static void compile_loop(struct Code *code, struct JitLoop *loop)
+{
+  emit(code, 0x53);             // push rbx, which also aligns the stack for calls
+  emit(code, 0x48, 0x89, 0xFB); // mov rbx, rdi
+
+  int top = code->size;
+
+  for (int k = 0; k < loop->num_ops; k++)
+  {
+    struct JitOp *op = &loop->ops[k];
+
+    if (op->operator == OPERATOR_NO_OP)
+    {
+      emit(code, 0x48, 0x8B); // mov rax, [lhs]
+      emit_slot(code, EAX, op->lhs);
+      emit(code, 0x48, 0x89); // mov [result], rax
+      emit_slot(code, EAX, op->result);
+    }
+    else if (op->lhs_type == RAM_TYPE_INT && op->rhs_type == RAM_TYPE_INT)
+      compile_int_op(code, op, k);
+    else
+      compile_real_op(code, op, k);
+  }
+
+  //
+  // the condition is the last op: loop while it's true
+  //
+  load_int(code, EAX, loop->ops[loop->num_ops - 1].result);
+  emit(code, 0x85, 0xC0);   // test eax, eax
+  emit(code, 0x0F, 0x85);   // jnz top
+  emit_u32(code, (uint32_t)(top - (code->size + 4)));
+
+  emit(code, 0xB8);         // mov eax, -1
+  emit_u32(code, (uint32_t)-1);
+  emit(code, 0x5B, 0xC3);   // pop rbx; ret
+
+  for (int b = 0; b < code->num_bails && !code->failed; b++)
+  {
+    uint32_t rel = (uint32_t)(code->size - (code->bail_at[b] + 4));
+
+    memcpy(code->bytes + code->bail_at[b], &rel, sizeof(rel));
+
+    emit(code, 0xB8); // mov eax, op
+    emit_u32(code, (uint32_t)code->bail_op[b]);
+    emit(code, 0x5B, 0xC3); // pop rbx; ret
+  }
+}
+
+#endif // JIT_X86_64
+
+//
+// Public functions:
+//
+
+//
+// jit_create
+//
+struct Jit *jit_create(void)
+{
+  struct Jit *jit = (struct Jit *)malloc(sizeof(struct Jit));
+
+  if (jit == NULL)
+    return NULL;
+
+  jit->loops = NULL;
+  jit->num_loops = 0;
+  jit->capacity = 0;
+
+  return jit;
+}
+
+//
+// jit_destroy
+//
+void jit_destroy(struct Jit *jit)
+{
+  if (jit == NULL)
+    return;
+
+  for (int l = 0; l < jit->num_loops; l++)
+  {
+    if (jit->loops[l]->pages != NULL)
+      munmap(jit->loops[l]->pages, jit->loops[l]->size);
+
+    free(jit->loops[l]->ops);
+    free(jit->loops[l]);
+  }
+
+  free(jit->loops);
+  free(jit);
+}
+
+//
+// jit_find
+//
+struct JitLoop *jit_find(struct Jit *jit, struct JitOp *ops, int num_ops)
+{
+  size_t size = num_ops * sizeof(struct JitOp);
+  uint32_t hash = (uint32_t)hashBytes(HASH_START, ops, size);
+
+  for (int l = 0; l < jit->num_loops; l++)
+  {
+    struct JitLoop *loop = jit->loops[l];
+
+    if (loop->hash == hash && loop->num_ops == num_ops && memcmp(loop->ops, ops, size) == 0)
+      return loop;
+  }
+
+  if (jit->num_loops == jit->capacity)
+  {
+    int capacity = (jit->capacity == 0) ? 8 : 2 * jit->capacity;
+    struct JitLoop **loops = (struct JitLoop **)realloc(jit->loops, capacity * sizeof(struct JitLoop *));
+
+    if (loops == NULL)
+      return NULL;
+
+    jit->loops = loops;
+    jit->capacity = capacity;
+  }
+
+  struct JitLoop *loop = (struct JitLoop *)malloc(sizeof(struct JitLoop));
+  struct JitOp *copy = (struct JitOp *)malloc(size);
+
+  if (loop == NULL || copy == NULL)
+  {
+    free(loop);
+    free(copy);
+    return NULL;
+  }
+
+  memcpy(copy, ops, size);
+
+  loop->hash = hash;
+  loop->ops = copy;
+  loop->num_ops = num_ops;
+  loop->iterations = 0;
+  loop->code = NULL;
+  loop->failed = false;
+  loop->pages = NULL;
+  loop->size = 0;
+
+  jit->loops[jit->num_loops++] = loop;
+
+  return loop;
+}
+
+//
+// jit_compile
+//
+JitCode jit_compile(struct JitLoop *loop)
+{
+  if (loop->code != NULL || loop->failed)
+    return loop->code;
+
+  loop->failed = true; // until it's compiled
+
+#ifdef JIT_X86_64
+  struct Code code = {NULL, 0, 0, false, NULL, NULL, 0};
+
+  compile_loop(&code, loop);
+
+  free(code.bail_at);
+  free(code.bail_op);
+
+  if (code.failed)
+  {
+    free(code.bytes);
+    return NULL;
+  }
+
+  //
+  // the pages are writable while the code is copied in, and then
+  // only executable:
+  //
+  void *pages = mmap(NULL, code.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (pages == MAP_FAILED)
+  {
+    free(code.bytes);
+    return NULL;
+  }
+
+  memcpy(pages, code.bytes, code.size);
+  free(code.bytes);
+
+  if (mprotect(pages, code.size, PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(pages, code.size);
+    return NULL;
+  }
+
+  loop->pages = pages;
+  loop->size = code.size;
+  loop->failed = false;
+
+  memcpy(&loop->code, &pages, sizeof(loop->code));
+#endif
+
+  return loop->code;
+}
@@ -0,0 +1,112 @@
+/*jit.h*/
+
+//
+// Just-in-time compiler from the arithmetic loops loopkernel.c runs
+// to x86-64 machine code. A loop is compiled once it's been hot for
+// JIT_THRESHOLD iterations, and its code then runs the loop on the
+// same native variables the kernels use, without a call per
+// statement. On other platforms nothing is compiled, and the
+// kernels keep running loops.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+#include <stdint.h>  // uint32_t
+
+//
+// Iterations a loop runs on kernels before it's compiled:
+//
+#define JIT_THRESHOLD 1000
+
+//
+// A statement of a loop, as compiled by loopkernel.c:
+//
+//   slots[result] = slots[lhs] operator slots[rhs]
+//
+// where each slot is 8 bytes holding an int or a double, and the
+// types are RAM_TYPE_INT or RAM_TYPE_REAL. OPERATOR_NO_OP copies
+// slots[lhs]. A comparison stores 1 or 0, as an int. The last
+// statement of a loop is its condition.
+//
+struct JitOp
+{
+  int operator; // enum OPERATORS
+  int lhs_type;
+  int rhs_type;
+  int result;
+  int lhs;
+  int rhs;
+};
+
+//
+// Compiled code for a loop: runs the loop's statements and then its
+// condition until the condition is false, and returns -1; or, if
+// statement # k would divide by zero, returns k without running it.
+//
+typedef int (*JitCode)(void *slots);
+
+//
+// A loop known to the JIT: how many iterations it has run, and its
+// code once compiled.
+//
+struct JitLoop
+{
+  uint32_t hash; // of the ops
+  struct JitOp *ops;
+  int num_ops;
+
+  long iterations;
+  JitCode code;   // NULL => not compiled (yet)
+  bool failed;    // could not be compiled
+  void *pages;    // holding the code
+  size_t size;
+};
+
+//
+// The JIT's loops, for one interpreter:
+//
+struct Jit
+{
+  struct JitLoop **loops;
+  int num_loops;
+  int capacity;
+};
+
+//
+// Public functions:
+//
+
+//
+// jit_create
+//
+// Returns a new JIT with no loops, or NULL if out of memory.
+//
+struct Jit *jit_create(void);
+
+//
+// jit_destroy
+//
+// Frees the JIT, including all the code it compiled.
+//
+void jit_destroy(struct Jit *jit);
+
+//
+// jit_find
+//
+// Returns the loop with the given statements, adding it if it's
+// not known yet. Loops are identified by their compiled statements,
+// including the types of the operands, so code is never run on
+// variables of other types than it was compiled for; the same loop
+// entered with other types is another loop to the JIT. Returns
+// NULL if out of memory.
+//
+struct JitLoop *jit_find(struct Jit *jit, struct JitOp *ops, int num_ops);
+
+//
+// jit_compile
+//
+// Returns the loop's code, compiling it the first time. Returns
+// NULL if it can't be compiled, e.g. on another platform.
+//
+JitCode jit_compile(struct JitLoop *loop);
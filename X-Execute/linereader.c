@@ -0,0 +1,92 @@
+/*linereader.c*/
+
+//
+// Buffered line reader for nuPython's input() function. Lines of
+// any length are read into a buffer owned by the reader, which is
+// reused from one call to the next.
+//
+
+// getline() is POSIX, not C11:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sys/types.h> // ssize_t
+
+#include "linereader.h"
+
+//
+// Public functions:
+//
+
+//
+// linereader_create
+//
+// Returns a pointer to a dynamically-allocated reader
+// for the given input stream, or NULL if out of memory.
+//
+struct LineReader *linereader_create(FILE *input)
+{
+  assert(input != NULL);
+
+  struct LineReader *reader = (struct LineReader *)malloc(sizeof(struct LineReader));
+  if (reader == NULL)
+    return NULL;
+
+  reader->input = input;
+  reader->buffer = NULL; // getline() allocates on first read
+  reader->capacity = 0;
+
+  return reader;
+}
+
+//
+// linereader_destroy
+//
+// Frees the reader and its line buffer. The input stream
+// is not closed.
+//
+void linereader_destroy(struct LineReader *reader)
+{
+  if (reader == NULL)
+    return;
+
+  free(reader->buffer);
+  free(reader);
+}
+
+//
+// linereader_readline
+//
+// Reads the next line from the input stream, with EOL
+// characters (\n, \r) removed. Returns NULL at end of
+// input.
+//
+// getline() takes the stream lock once per line and scans
+// the stdio buffer for the newline, instead of going through
+// fgetc() a character at a time; the buffer only grows, so
+// once it is big enough for the longest line, reading a line
+// does no allocation at all.
+//
+char *linereader_readline(struct LineReader *reader)
+{
+  assert(reader != NULL);
+
+  ssize_t length = getline(&reader->buffer, &reader->capacity, reader->input);
+
+  if (length < 0) // EOF (or read error):
+    return NULL;
+
+  //
+  // strip the EOL chars, which are only ever at the end:
+  //
+  while (length > 0 && (reader->buffer[length - 1] == '\n' || reader->buffer[length - 1] == '\r'))
+  {
+    length--;
+  }
+
+  reader->buffer[length] = '\0';
+
+  return reader->buffer;
+}
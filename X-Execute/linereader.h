@@ -0,0 +1,52 @@
+/*linereader.h*/
+
+//
+// Buffered line reader for nuPython's input() function. Lines of
+// any length are read into a buffer owned by the reader, which is
+// reused from one call to the next.
+//
+
+#pragma once
+
+#include <stdio.h>
+
+struct LineReader
+{
+  FILE *input;     // stream we are reading lines from
+  char *buffer;    // current line, grown as needed
+  size_t capacity; // # of bytes allocated for buffer
+};
+
+//
+// Public functions:
+//
+
+//
+// linereader_create
+//
+// Returns a pointer to a dynamically-allocated reader
+// for the given input stream, or NULL if out of memory.
+//
+struct LineReader *linereader_create(FILE *input);
+
+//
+// linereader_destroy
+//
+// Frees the reader and its line buffer. The input stream
+// is not closed.
+//
+void linereader_destroy(struct LineReader *reader);
+
+//
+// linereader_readline
+//
+// Reads the next line from the input stream, with EOL
+// characters (\n, \r) removed. Returns NULL at end of
+// input.
+//
+// NOTE: the returned string is owned by the reader, and is
+// only valid until the next call to linereader_readline().
+// Callers that need to keep the line must copy it (writing
+// it to RAM does this).
+//
+char *linereader_readline(struct LineReader *reader);
@@ -0,0 +1,501 @@
+/*list.c*/
+
+//
+// Lists for nuPython; see list.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+#include <limits.h> // INT_MIN, INT_MAX
+
+#include "list.h"
+#include "dict.h"
+#include "util.h"
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**LIST ERROR\n");
+  printf("**LIST ERROR: %s\n", msg);
+  printf("**LIST ERROR\n");
+
+  exit(-123);
+}
+
+//
+// item_size
+//
+// Returns the size of an item in a buffer of the given kind.
+//
+static size_t item_size(int kind)
+{
+  if (kind == LIST_INT)
+    return sizeof(int);
+  else if (kind == LIST_REAL)
+    return sizeof(double);
+  else
+    return sizeof(struct RAM_VALUE);
+}
+
+//
+// kind_of
+//
+// Returns the kind of buffer that holds the value unboxed, or
+// LIST_BOXED if none does.
+//
+static int kind_of(struct RAM_VALUE value)
+{
+  if (value.value_type == RAM_TYPE_INT)
+    return LIST_INT;
+  else if (value.value_type == RAM_TYPE_REAL)
+    return LIST_REAL;
+  else
+    return LIST_BOXED;
+}
+
+//
+// copy_value, release_value
+//
+// Take and give up ownership of what a value refers to: a string
+// is duplicated and freed, a list or dictionary retained and
+// released.
+//
+static void copy_value(struct RAM_VALUE *value)
+{
+  if (value->value_type == RAM_TYPE_STR)
+    value->types.s = dupString(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_retain(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_retain(value->types.m);
+}
+
+static void release_value(struct RAM_VALUE *value)
+{
+  if (value->value_type == RAM_TYPE_STR)
+    free(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_release(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_release(value->types.m);
+}
+
+//
+// buffer_create
+//
+// Returns a new buffer of the given kind, with room for the given
+// # of items and one reference.
+//
+static struct LIST_BUFFER *buffer_create(int kind, int capacity)
+{
+  struct LIST_BUFFER *buffer = (struct LIST_BUFFER *)malloc(sizeof(struct LIST_BUFFER));
+
+  if (buffer == NULL)
+    panic("out of memory (buffer_create)");
+
+  buffer->refs = 1;
+  buffer->kind = kind;
+  buffer->capacity = capacity;
+  buffer->used = 0;
+  buffer->items.i = NULL;
+
+  if (capacity > 0)
+  {
+    buffer->items.i = (int *)malloc(capacity * item_size(kind));
+
+    if (buffer->items.i == NULL)
+      panic("out of memory (buffer_create)");
+  }
+
+  return buffer;
+}
+
+//
+// buffer_release
+//
+// Removes a reference to the buffer, freeing it, and the items it
+// owns, if that was the last one.
+//
+static void buffer_release(struct LIST_BUFFER *buffer)
+{
+  if (--buffer->refs > 0)
+    return;
+
+  if (buffer->kind == LIST_BOXED)
+    for (int p = 0; p < buffer->used; p++)
+      release_value(&buffer->items.boxed[p]);
+
+  free(buffer->items.i);
+  free(buffer);
+}
+
+//
+// peek_item
+//
+// Returns the item at the given position of the buffer, which is
+// only borrowed.
+//
+static struct RAM_VALUE peek_item(struct LIST_BUFFER *buffer, int p)
+{
+  struct RAM_VALUE value;
+
+  if (buffer->kind == LIST_INT)
+  {
+    value.value_type = RAM_TYPE_INT;
+    value.types.i = buffer->items.i[p];
+  }
+  else if (buffer->kind == LIST_REAL)
+  {
+    value.value_type = RAM_TYPE_REAL;
+    value.types.d = buffer->items.d[p];
+  }
+  else
+  {
+    value = buffer->items.boxed[p];
+  }
+
+  return value;
+}
+
+//
+// store_item
+//
+// Stores a copy of the value at the given position of the buffer,
+// at most used, which must be of the value's kind unless boxed.
+// The copy is made before the old item is released, in case the
+// old item is what's being stored.
+//
+static void store_item(struct LIST_BUFFER *buffer, int p, struct RAM_VALUE value)
+{
+  if (buffer->kind == LIST_INT)
+  {
+    buffer->items.i[p] = value.types.i;
+  }
+  else if (buffer->kind == LIST_REAL)
+  {
+    buffer->items.d[p] = value.types.d;
+  }
+  else
+  {
+    copy_value(&value);
+
+    if (p < buffer->used)
+      release_value(&buffer->items.boxed[p]);
+
+    buffer->items.boxed[p] = value;
+  }
+
+  if (p == buffer->used)
+    buffer->used++;
+}
+
+//
+// rebuffer
+//
+// Gives the list a buffer of its own of the given kind, the same
+// as the buffer's or LIST_BOXED, with room for capacity items from
+// the list's start, holding its items. A buffer only the list has,
+// of the same kind, is grown in place; otherwise the items are
+// copied, boxing them if need be, and the old buffer released.
+//
+static void rebuffer(struct LIST *list, int kind, int capacity)
+{
+  struct LIST_BUFFER *old = list->buffer;
+
+  if (old->refs == 1 && old->kind == kind)
+  {
+    if (list->start + capacity > old->capacity)
+    {
+      void *items = realloc(old->items.i, (list->start + capacity) * item_size(kind));
+
+      if (items == NULL)
+        panic("out of memory (rebuffer)");
+
+      old->items.i = (int *)items;
+      old->capacity = list->start + capacity;
+    }
+
+    return;
+  }
+
+  struct LIST_BUFFER *buffer = buffer_create(kind, capacity);
+
+  for (int k = 0; k < list->length; k++)
+    store_item(buffer, k, peek_item(old, list->start + k));
+
+  buffer_release(old);
+
+  list->buffer = buffer;
+  list->start = 0;
+}
+
+//
+// is_number, number
+//
+// Numbers, which compare by value, are ints, reals and booleans.
+//
+static bool is_number(struct RAM_VALUE value)
+{
+  return value.value_type == RAM_TYPE_INT || value.value_type == RAM_TYPE_REAL || value.value_type == RAM_TYPE_BOOLEAN;
+}
+
+static double number(struct RAM_VALUE value)
+{
+  return (value.value_type == RAM_TYPE_REAL) ? value.types.d : (double)value.types.i;
+}
+
+//
+// items_equal
+//
+// Does the item equal the value? See list_contains.
+//
+static bool items_equal(struct RAM_VALUE item, struct RAM_VALUE value)
+{
+  if (is_number(item) && is_number(value))
+    return number(item) == number(value);
+
+  if (item.value_type != value.value_type)
+    return false;
+
+  switch (value.value_type)
+  {
+  case RAM_TYPE_STR:
+    return strcmp(item.types.s, value.types.s) == 0;
+  case RAM_TYPE_LIST:
+    return item.types.l == value.types.l;
+  case RAM_TYPE_DICT:
+    return item.types.m == value.types.m;
+  case RAM_TYPE_PTR:
+    return item.types.i == value.types.i;
+  default: // None
+    return true;
+  }
+}
+
+//
+// Public functions:
+//
+
+//
+// list_print_item
+//
+void list_print_item(FILE *output, struct RAM_VALUE value)
+{
+  switch (value.value_type)
+  {
+  case RAM_TYPE_INT:
+  case RAM_TYPE_PTR:
+    fprintf(output, "%d", value.types.i);
+    break;
+  case RAM_TYPE_REAL:
+    fprintf(output, "%lf", value.types.d);
+    break;
+  case RAM_TYPE_STR:
+    fprintf(output, "'%s'", value.types.s);
+    break;
+  case RAM_TYPE_BOOLEAN:
+    fputs(value.types.i ? "True" : "False", output);
+    break;
+  case RAM_TYPE_LIST:
+    list_print(output, value.types.l);
+    break;
+  case RAM_TYPE_DICT:
+    dict_print(output, value.types.m);
+    break;
+  default:
+    fputs("None", output);
+    break;
+  }
+}
+
+//
+// list_create
+//
+struct LIST *list_create(void)
+{
+  struct LIST *list = (struct LIST *)malloc(sizeof(struct LIST));
+
+  if (list == NULL)
+    panic("out of memory (list_create)");
+
+  list->refs = 1;
+  list->buffer = buffer_create(LIST_INT, 0);
+  list->start = 0;
+  list->length = 0;
+  list->printing = false;
+
+  return list;
+}
+
+//
+// list_retain, list_release
+//
+void list_retain(struct LIST *list)
+{
+  if (list != NULL)
+    list->refs++;
+}
+
+void list_release(struct LIST *list)
+{
+  if (list == NULL || --list->refs > 0)
+    return;
+
+  buffer_release(list->buffer);
+  free(list);
+}
+
+//
+// list_get
+//
+void list_get(struct LIST *list, int position, struct RAM_VALUE *value)
+{
+  *value = peek_item(list->buffer, list->start + position);
+
+  copy_value(value);
+}
+
+//
+// list_contains
+//
+// A list of ints or reals is searched without boxing its items,
+// and holds no value that isn't a number.
+//
+bool list_contains(struct LIST *list, struct RAM_VALUE value)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+  int end = list->start + list->length;
+
+  if (buffer->kind != LIST_BOXED && !is_number(value))
+    return false;
+
+  if (buffer->kind == LIST_INT)
+  {
+    double wanted = number(value);
+
+    if (!(wanted >= INT_MIN && wanted <= INT_MAX) || (double)(int)wanted != wanted)
+      return false; // not an int, so equals no item
+
+    int key = (int)wanted;
+    const int *items = buffer->items.i;
+
+    for (int p = list->start; p < end; p++)
+      if (items[p] == key)
+        return true;
+  }
+  else if (buffer->kind == LIST_REAL)
+  {
+    double key = number(value);
+    const double *items = buffer->items.d;
+
+    for (int p = list->start; p < end; p++)
+      if (items[p] == key)
+        return true;
+  }
+  else
+  {
+    for (int p = list->start; p < end; p++)
+      if (items_equal(buffer->items.boxed[p], value))
+        return true;
+  }
+
+  return false;
+}
+
+//
+// list_set
+//
+void list_set(struct LIST *list, int position, struct RAM_VALUE value)
+{
+  int kind = kind_of(value);
+
+  if (kind != list->buffer->kind)
+    kind = LIST_BOXED;
+
+  if (list->buffer->refs > 1 || kind != list->buffer->kind)
+    rebuffer(list, kind, list->length);
+
+  store_item(list->buffer, list->start + position, value);
+}
+
+//
+// list_append
+//
+void list_append(struct LIST *list, struct RAM_VALUE value)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+  int kind = kind_of(value);
+
+  if (kind != buffer->kind && list->length > 0) // mixed types:
+    kind = LIST_BOXED;
+
+  //
+  // the buffer doubles in size when it's full:
+  //
+  if (buffer->refs > 1 || kind != buffer->kind || list->start + list->length == buffer->capacity)
+    rebuffer(list, kind, (list->length < 4) ? 8 : 2 * list->length);
+
+  store_item(list->buffer, list->start + list->length, value);
+
+  list->length++;
+}
+
+//
+// list_slice
+//
+struct LIST *list_slice(struct LIST *list, int start, int end)
+{
+  struct LIST *slice = (struct LIST *)malloc(sizeof(struct LIST));
+
+  if (slice == NULL)
+    panic("out of memory (list_slice)");
+
+  slice->refs = 1;
+  slice->buffer = list->buffer;
+  slice->start = list->start + start;
+  slice->length = end - start;
+  slice->printing = false;
+
+  slice->buffer->refs++;
+
+  return slice;
+}
+
+//
+// list_print
+//
+void list_print(FILE *output, struct LIST *list)
+{
+  if (list->printing)
+  {
+    fputs("[...]", output);
+    return;
+  }
+
+  list->printing = true;
+
+  fputc('[', output);
+
+  for (int k = 0; k < list->length; k++)
+  {
+    if (k > 0)
+      fputs(", ", output);
+
+    list_print_item(output, peek_item(list->buffer, list->start + k));
+  }
+
+  fputc(']', output);
+
+  list->printing = false;
+}
@@ -0,0 +1,149 @@
+/*list.h*/
+
+//
+// Lists for nuPython, e.g. x = [1, 2, 3].
+//
+// A list's items live in a buffer. While they are all ints, or all
+// reals, the buffer is a plain C array of int or double, so reading
+// and writing an item is one load or store, with no type tags and
+// nothing to free; a list holding anything else, or a mix of types,
+// is boxed: its buffer is an array of RAM_VALUEs, which own their
+// strings. An empty list takes the kind of the first item appended.
+//
+// Appending doubles the buffer when it's full, so appending n items
+// takes O(n) time overall. A slice x[i:j] doesn't copy the items: it
+// is a new list viewing the same buffer, which is shared until one
+// of the lists sharing it is changed, and only then is that list's
+// range copied (copy on write). Indexing is O(1), slicing O(1), and
+// assigning an item O(1) unless the buffer is shared.
+//
+// Lists are values with reference semantics, as in Python: after
+// y = x, x and y are the same list, and x.append(1) changes both.
+// A list is freed when the last reference to it goes away, i.e.
+// every variable, value being evaluated, and item of another list
+// holding it releases it. A list that holds itself, directly or
+// through other lists, is never freed.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h> // true, false
+
+#include "ram.h"
+
+//
+// The kinds of buffer:
+//
+enum LIST_KINDS
+{
+  LIST_INT = 0,
+  LIST_REAL,
+  LIST_BOXED
+};
+
+struct LIST_BUFFER
+{
+  int refs;     // # of lists sharing the buffer
+  int kind;     // enum LIST_KINDS
+  int capacity; // # of items there is room for
+  int used;     // # of items written, 0..used-1, and owned if boxed
+
+  union
+  {
+    int *i;                  // LIST_INT
+    double *d;               // LIST_REAL
+    struct RAM_VALUE *boxed; // LIST_BOXED
+  } items;
+};
+
+struct LIST
+{
+  int refs; // # of references to the list
+  struct LIST_BUFFER *buffer;
+  int start;     // the list's 1st item in the buffer,
+  int length;    // and # of items
+  bool printing; // being printed, to stop at a cycle
+};
+
+//
+// Public functions:
+//
+
+//
+// list_create
+//
+// Returns a new, empty list, with one reference, which the caller
+// owns.
+//
+struct LIST *list_create(void);
+
+//
+// list_retain, list_release
+//
+// Add and remove a reference to the list; when the last one is
+// removed, the list is freed. NULL is ignored.
+//
+void list_retain(struct LIST *list);
+void list_release(struct LIST *list);
+
+//
+// list_get
+//
+// Returns a copy of the item at the given position, 0..length-1,
+// via the reference parameter. The caller owns the copy: a string
+// is duplicated, and a list retained.
+//
+void list_get(struct LIST *list, int position, struct RAM_VALUE *value);
+
+//
+// list_contains
+//
+// Returns true if an item of the list equals the value, as Python's
+// in operator does: numbers (and booleans) are compared by value,
+// strings by their contents, and anything else only equals itself,
+// e.g. a list is only found in a list that holds that same list.
+//
+bool list_contains(struct LIST *list, struct RAM_VALUE value);
+
+//
+// list_set
+//
+// Replaces the item at the given position, 0..length-1, with a
+// copy of the given value, which is only borrowed.
+//
+void list_set(struct LIST *list, int position, struct RAM_VALUE value);
+
+//
+// list_append
+//
+// Adds a copy of the given value, which is only borrowed, to the
+// end of the list.
+//
+void list_append(struct LIST *list, struct RAM_VALUE value);
+
+//
+// list_slice
+//
+// Returns a new list of the items from position start up to, but
+// not including, end, where 0 <= start <= end <= length, sharing
+// the list's buffer. The caller owns the new list's reference.
+//
+struct LIST *list_slice(struct LIST *list, int start, int end);
+
+//
+// list_print_item
+//
+// Outputs a value as Python does as an item of a list, e.g. 'abc'
+// rather than abc, without a newline.
+//
+void list_print_item(FILE *output, struct RAM_VALUE value);
+
+//
+// list_print
+//
+// Outputs the list as Python does, e.g. [1, 'abc', [2.500000]],
+// without a newline; reals are output as print() outputs them. A
+// list holding itself is output as [...] where it recurs.
+//
+void list_print(FILE *output, struct LIST *list);
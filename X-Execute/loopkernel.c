@@ -0,0 +1,727 @@
+/*loopkernel.c*/
+
+//
+// Runs while and for loops that only do arithmetic on native values;
+// see loopkernel.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+#include <math.h>    // pow, fmod, fabs
+#include <limits.h>  // INT_MIN, INT_MAX
+
+#include "loopkernel.h"
+#include "ram.h"
+#include "jit.h"
+
+//
+// Loops with more variables and literals, or statements, than
+// this are left to the executor:
+//
+#define MAX_SLOTS 32
+#define MAX_OPS 32
+
+//
+// A variable or literal, while the loop runs; its type is known
+// when the loop is compiled, so it's not stored:
+//
+union Slot
+{
+  int i;    // RAM_TYPE_INT
+  double d; // RAM_TYPE_REAL
+};
+
+//
+// A kernel applies one operator to operands of given types, with
+// exactly the semantics of execute_operator. Returns false on
+// division by zero.
+//
+typedef bool (*Kernel)(union Slot *result, union Slot *lhs, union Slot *rhs);
+
+//
+// The kernels are instantiated from these templates, for each
+// operator and pair of operand types: L and R are the members of
+// union Slot (i or d) holding the operands. Ints wrap around, and
+// an int and a real give a real, as they do in the executor; the
+// real comparisons have the executor's tolerances.
+//
+#define KERNEL(name, L, R, statement)                                   \
+  static bool name##_##L##R(union Slot *result, union Slot *lhs, union Slot *rhs) \
+  {                                                                     \
+    statement;                                                          \
+    return true;                                                        \
+  }
+
+#define INT_KERNELS                                                                            \
+  KERNEL(add, i, i, result->i = (int)((unsigned)lhs->i + (unsigned)rhs->i))                   \
+  KERNEL(sub, i, i, result->i = (int)((unsigned)lhs->i - (unsigned)rhs->i))                   \
+  KERNEL(mul, i, i, result->i = (int)((unsigned)lhs->i * (unsigned)rhs->i))                   \
+  KERNEL(pow, i, i, result->i = pow(lhs->i, rhs->i))                                          \
+  KERNEL(mod, i, i, if (rhs->i == 0) return false; result->i = (rhs->i == -1) ? 0 : lhs->i % rhs->i) \
+  KERNEL(div, i, i, if (rhs->i == 0) return false; result->i = (rhs->i == -1) ? (int)(0u - (unsigned)lhs->i) : lhs->i / rhs->i) \
+  KERNEL(eq, i, i, result->i = (lhs->i == rhs->i))                                            \
+  KERNEL(ne, i, i, result->i = (lhs->i != rhs->i))                                            \
+  KERNEL(lt, i, i, result->i = (lhs->i < rhs->i))                                             \
+  KERNEL(lte, i, i, result->i = (lhs->i <= rhs->i))                                           \
+  KERNEL(gt, i, i, result->i = (lhs->i > rhs->i))                                             \
+  KERNEL(gte, i, i, result->i = (lhs->i >= rhs->i))
+
+#define REAL_KERNELS(L, R)                                                                     \
+  KERNEL(add, L, R, result->d = (double)lhs->L + (double)rhs->R)                              \
+  KERNEL(sub, L, R, result->d = (double)lhs->L - (double)rhs->R)                              \
+  KERNEL(mul, L, R, result->d = (double)lhs->L * (double)rhs->R)                              \
+  KERNEL(pow, L, R, result->d = pow((double)lhs->L, (double)rhs->R))                          \
+  KERNEL(mod, L, R, if ((double)rhs->R == 0.0) return false; result->d = fmod((double)lhs->L, (double)rhs->R)) \
+  KERNEL(div, L, R, if ((double)rhs->R == 0.0) return false; result->d = (double)lhs->L / (double)rhs->R) \
+  KERNEL(eq, L, R, result->i = (fabs((double)lhs->L - (double)rhs->R) < 0.001))                \
+  KERNEL(ne, L, R, result->i = (fabs((double)lhs->L - (double)rhs->R) > 0.001))                \
+  KERNEL(lt, L, R, result->i = ((double)lhs->L < (double)rhs->R))                             \
+  KERNEL(lte, L, R, result->i = ((double)lhs->L <= (double)rhs->R + 0.0001))                  \
+  KERNEL(gt, L, R, result->i = ((double)lhs->L > (double)rhs->R + 0.0001))                    \
+  KERNEL(gte, L, R, result->i = ((double)lhs->L > (double)rhs->R - 0.0001))
+
+INT_KERNELS
+REAL_KERNELS(i, d)
+REAL_KERNELS(d, i)
+REAL_KERNELS(d, d)
+
+KERNEL(copy, i, i, result->i = lhs->i)
+KERNEL(copy, d, d, result->d = lhs->d)
+
+//
+// The kernels by operand types (int-int, int-real, real-int,
+// real-real) and operator (enum OPERATORS, + through >=):
+//
+#define KERNEL_ROW(L, R)                                                        \
+  {                                                                             \
+    add_##L##R, sub_##L##R, mul_##L##R, pow_##L##R, mod_##L##R, div_##L##R,     \
+        eq_##L##R, ne_##L##R, lt_##L##R, lte_##L##R, gt_##L##R, gte_##L##R      \
+  }
+
+static const Kernel kernels[4][OPERATOR_GTE + 1] = {
+    KERNEL_ROW(i, i),
+    KERNEL_ROW(i, d),
+    KERNEL_ROW(d, i),
+    KERNEL_ROW(d, d)};
+
+//
+// A statement of the loop, compiled:
+//
+struct Op
+{
+  Kernel kernel;
+  int result; // slots
+  int lhs;
+  int rhs;
+  int type;          // of the result
+  struct JitOp jit;  // the same, for jit_compile
+  struct STMT *stmt; // compiled
+};
+
+//
+// A variable of the loop:
+//
+struct Var
+{
+  char *name;
+  int slot;
+  int address;    // in memory, -1 => created by the loop
+  int entry_type; // RAM type on entry to the loop, -1 => neither int nor real
+  int first_op;   // that assigns it, -1 => none
+};
+
+//
+// A loop, compiled:
+//
+struct Loop
+{
+  union Slot slots[MAX_SLOTS]; // variables and literals
+  int types[MAX_SLOTS];        // RAM_TYPE_INT, RAM_TYPE_REAL, or -1 => unassigned
+  int num_slots;
+
+  struct Var vars[MAX_SLOTS];
+  int num_vars;
+
+  struct Op ops[MAX_OPS];
+  int num_ops;
+  struct Op condition;
+
+  int counter; // slot of a for loop's counter, -1 => a while loop
+
+  struct VALUE_EXPR *steps;  // of the statement being compiled, else NULL,
+  int step_slots[MAX_OPS];   // and the slots of their values (see compile_steps)
+};
+
+//
+// Private functions:
+//
+
+//
+// find_var
+//
+// Returns the variable with the given name, adding it (with its
+// value in memory, if it's an int or real) if it's not there yet.
+// Returns NULL if there's no room.
+//
+static struct Var *find_var(struct Interpreter *interp, struct Loop *loop, char *name)
+{
+  for (int v = 0; v < loop->num_vars; v++)
+    if (strcmp(loop->vars[v].name, name) == 0)
+      return &loop->vars[v];
+
+  if (loop->num_slots == MAX_SLOTS)
+    return NULL;
+
+  struct Var *var = &loop->vars[loop->num_vars++];
+  int s = loop->num_slots++;
+
+  var->name = name;
+  var->slot = s;
+  var->address = ram_get_addr(interp->memory, name);
+  var->entry_type = -1;
+  var->first_op = -1;
+
+  if (var->address >= 0)
+  {
+    struct RAM_VALUE *value = &interp->memory->cells[var->address].value;
+
+    if (value->value_type == RAM_TYPE_INT)
+    {
+      var->entry_type = RAM_TYPE_INT;
+      loop->slots[s].i = value->types.i;
+    }
+    else if (value->value_type == RAM_TYPE_REAL)
+    {
+      var->entry_type = RAM_TYPE_REAL;
+      loop->slots[s].d = value->types.d;
+    }
+  }
+
+  loop->types[s] = var->entry_type;
+
+  return var;
+}
+
+//
+// element_slot
+//
+// Returns the slot of the element, an int or real literal or a
+// variable, which must then hold an int or real at this point of
+// the loop, or of the value of a nested operand's step. Returns
+// -1 if not.
+//
+static int element_slot(struct Interpreter *interp, struct Loop *loop, struct UNARY_EXPR *unary)
+{
+  if (unary->expr_type == UNARY_NESTED)
+    return (loop->steps == NULL) ? -1 : loop->step_slots[unary->expr - loop->steps];
+
+  if (unary->expr_type != UNARY_ELEMENT)
+    return -1;
+
+  struct ELEMENT *element = unary->element;
+
+  if (element->element_type == ELEMENT_IDENTIFIER)
+  {
+    struct Var *var = find_var(interp, loop, element->element_value);
+
+    return (var == NULL || loop->types[var->slot] < 0) ? -1 : var->slot;
+  }
+
+  if (loop->num_slots == MAX_SLOTS)
+    return -1;
+
+  int s = loop->num_slots;
+
+  if (element->element_type == ELEMENT_INT_LITERAL)
+  {
+    loop->types[s] = RAM_TYPE_INT;
+    loop->slots[s].i = atoi(element->element_value);
+  }
+  else if (element->element_type == ELEMENT_REAL_LITERAL)
+  {
+    loop->types[s] = RAM_TYPE_REAL;
+    loop->slots[s].d = atof(element->element_value);
+  }
+  else
+    return -1;
+
+  return loop->num_slots++;
+}
+
+//
+// compile_expr
+//
+// Compiles the expression into op, choosing the kernel for the
+// types of its operands at this point of the loop, and returns
+// the type of its result: RAM_TYPE_INT or RAM_TYPE_REAL for
+// arithmetic, RAM_TYPE_BOOLEAN for a comparison. Returns -1 if
+// there's no kernel for it.
+//
+static int compile_expr(struct Interpreter *interp, struct Loop *loop, struct VALUE_EXPR *expr, struct Op *op)
+{
+  op->lhs = element_slot(interp, loop, expr->lhs);
+
+  if (op->lhs < 0)
+    return -1;
+
+  memset(&op->jit, 0, sizeof(op->jit));
+  op->jit.lhs = op->lhs;
+  op->jit.lhs_type = loop->types[op->lhs];
+
+  if (!expr->isBinaryExpr)
+  {
+    op->rhs = op->jit.rhs = op->lhs;
+    op->jit.rhs_type = op->jit.lhs_type;
+    op->jit.operator = OPERATOR_NO_OP;
+    op->kernel = (loop->types[op->lhs] == RAM_TYPE_INT) ? copy_ii : copy_dd;
+    return loop->types[op->lhs];
+  }
+
+  op->rhs = element_slot(interp, loop, expr->rhs);
+
+  if (op->rhs < 0 || expr->operator > OPERATOR_GTE)
+    return -1;
+
+  bool lhs_int = loop->types[op->lhs] == RAM_TYPE_INT;
+  bool rhs_int = loop->types[op->rhs] == RAM_TYPE_INT;
+
+  op->kernel = kernels[(lhs_int ? 0 : 2) + (rhs_int ? 0 : 1)][expr->operator];
+  op->jit.operator = expr->operator;
+  op->jit.rhs = op->rhs;
+  op->jit.rhs_type = loop->types[op->rhs];
+
+  if (expr->operator >= OPERATOR_EQUAL)
+    return RAM_TYPE_BOOLEAN;
+
+  return (lhs_int && rhs_int) ? RAM_TYPE_INT : RAM_TYPE_REAL;
+}
+
+//
+// compile_steps
+//
+// Compiles the steps of the statement's expression (see VALUE_EXPR)
+// into ops writing slots of their own, which the ops of the later
+// steps read; a step that's just an element is its slot. An op
+// that fails hands the whole statement back to the executor, as
+// no variable has been written yet. Returns false if there's no
+// room, or a step there's no kernel for, or that's a comparison.
+//
+static bool compile_steps(struct Interpreter *interp, struct Loop *loop, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  if (expr->num_steps > MAX_OPS)
+    return false;
+
+  loop->steps = expr->steps;
+
+  for (int i = 0; i < expr->num_steps; i++)
+  {
+    struct VALUE_EXPR *step = &expr->steps[i];
+
+    if (!step->isBinaryExpr)
+    {
+      loop->step_slots[i] = element_slot(interp, loop, step->lhs);
+
+      if (loop->step_slots[i] < 0)
+        return false;
+
+      continue;
+    }
+
+    if (loop->num_ops == MAX_OPS)
+      return false;
+
+    struct Op *op = &loop->ops[loop->num_ops];
+    int type = compile_expr(interp, loop, step, op);
+
+    if ((type != RAM_TYPE_INT && type != RAM_TYPE_REAL) || loop->num_slots == MAX_SLOTS)
+      return false;
+
+    op->result = op->jit.result = loop->step_slots[i] = loop->num_slots++;
+    op->type = type;
+    op->stmt = stmt;
+    loop->types[op->result] = type;
+    loop->num_ops++;
+  }
+
+  return true;
+}
+
+//
+// compile_body
+//
+// Compiles the statements of the loop's body into ops, after any
+// ops already compiled. Returns false if there's a statement or
+// type there's no kernel for.
+//
+static bool compile_body(struct Interpreter *interp, struct Loop *loop, struct STMT *body)
+{
+  for (struct STMT *stmt = body; stmt != NULL;)
+  {
+    if (stmt->stmt_type == STMT_PASS)
+    {
+      stmt = stmt->types.pass->next_stmt;
+      continue;
+    }
+
+    if (stmt->stmt_type != STMT_ASSIGNMENT || loop->num_ops == MAX_OPS)
+      return false;
+
+    struct STMT_ASSIGNMENT *assignment = stmt->types.assignment;
+
+    if (assignment->isPtrDeref || assignment->index != NULL || assignment->rhs->value_type != VALUE_EXPR)
+      return false;
+
+    if (!compile_steps(interp, loop, stmt, assignment->rhs->types.expr) || loop->num_ops == MAX_OPS)
+      return false;
+
+    struct Op *op = &loop->ops[loop->num_ops];
+    int type = compile_expr(interp, loop, assignment->rhs->types.expr, op);
+
+    loop->steps = NULL;
+
+    if (type != RAM_TYPE_INT && type != RAM_TYPE_REAL)
+      return false;
+
+    struct Var *var = find_var(interp, loop, assignment->var_name);
+
+    if (var == NULL)
+      return false;
+
+    if (var->first_op < 0)
+      var->first_op = loop->num_ops;
+
+    op->result = op->jit.result = var->slot;
+    op->type = type;
+    op->stmt = stmt;
+    loop->types[var->slot] = type;
+    loop->num_ops++;
+
+    stmt = assignment->next_stmt;
+  }
+
+  return true;
+}
+
+//
+// types_fit
+//
+// Returns false if a variable's type at the end of the body is not
+// the one it had at the start, so the kernels chosen for the first
+// iteration would not fit the next.
+//
+static bool types_fit(struct Loop *loop)
+{
+  for (int v = 0; v < loop->num_vars; v++)
+  {
+    struct Var *var = &loop->vars[v];
+
+    if (var->first_op >= 0 && var->address >= 0 && loop->types[var->slot] != var->entry_type)
+      return false;
+  }
+
+  return true;
+}
+
+//
+// compile_loop
+//
+// Compiles the while loop's body and condition, given the values
+// in memory. Returns false if there's a statement or type there's
+// no kernel for, or the types don't fit (see types_fit).
+//
+static bool compile_loop(struct Interpreter *interp, struct Loop *loop, struct STMT_WHILE_LOOP *while_loop)
+{
+  loop->num_slots = 0;
+  loop->num_vars = 0;
+  loop->num_ops = 0;
+  loop->counter = -1;
+  loop->steps = NULL;
+
+  if (!compile_body(interp, loop, while_loop->loop_body) || !types_fit(loop))
+    return false;
+
+  //
+  // the condition's result goes in a slot of its own:
+  //
+  if (loop->num_slots == MAX_SLOTS)
+    return false;
+
+  loop->condition.result = loop->num_slots++;
+
+  if (while_loop->condition->condition_type != CONDITION_EXPR) // one op, so no and/or/not
+    return false;
+
+  if (compile_expr(interp, loop, while_loop->condition->expr, &loop->condition) != RAM_TYPE_BOOLEAN)
+    return false;
+
+  loop->condition.jit.result = loop->condition.result;
+
+  return true;
+}
+
+//
+// int_op
+//
+// Appends an op applying the int kernel for the operator to the
+// given slots, or with OPERATOR_NO_OP, copying lhs. Returns false
+// if there's no room.
+//
+static bool int_op(struct Loop *loop, struct Op *op, int operator, int result, int lhs, int rhs)
+{
+  if (op == NULL)
+  {
+    if (loop->num_ops == MAX_OPS)
+      return false;
+
+    op = &loop->ops[loop->num_ops++];
+  }
+
+  op->kernel = (operator == OPERATOR_NO_OP) ? copy_ii : kernels[0][operator];
+  op->result = result;
+  op->lhs = lhs;
+  op->rhs = rhs;
+  op->type = (operator >= OPERATOR_EQUAL && operator <= OPERATOR_GTE) ? RAM_TYPE_BOOLEAN : RAM_TYPE_INT;
+  op->stmt = NULL; // can't fail
+
+  memset(&op->jit, 0, sizeof(op->jit));
+  op->jit.operator = operator;
+  op->jit.result = result;
+  op->jit.lhs = lhs;
+  op->jit.rhs = rhs;
+  op->jit.lhs_type = op->jit.rhs_type = RAM_TYPE_INT;
+
+  return true;
+}
+
+//
+// compile_for
+//
+// Compiles the for loop over range(start, stop, step) as if it
+// were the while loop
+//
+//   counter = start
+//   while counter < stop:      (> for a negative step)
+//   {
+//     x = counter
+//     ...
+//     counter = counter + step
+//   }
+//
+// where counter is a slot of its own, not a variable. Returns
+// false as compile_loop does, or if the counter could overflow.
+//
+static bool compile_for(struct Interpreter *interp, struct Loop *loop, struct STMT_FOR_LOOP *for_loop, int start, int stop, int step)
+{
+  loop->num_slots = 0;
+  loop->num_vars = 0;
+  loop->num_ops = 0;
+  loop->steps = NULL;
+
+  if ((long long)stop + step > INT_MAX || (long long)stop + step < INT_MIN)
+    return false;
+
+  int counter = loop->num_slots++;
+  int stop_slot = loop->num_slots++;
+  int step_slot = loop->num_slots++;
+
+  loop->counter = counter;
+  loop->types[counter] = loop->types[stop_slot] = loop->types[step_slot] = RAM_TYPE_INT;
+  loop->slots[counter].i = start;
+  loop->slots[stop_slot].i = stop;
+  loop->slots[step_slot].i = step;
+
+  struct Var *var = find_var(interp, loop, for_loop->var_name);
+
+  if (var == NULL)
+    return false;
+
+  var->first_op = 0;
+  loop->types[var->slot] = RAM_TYPE_INT;
+  int_op(loop, NULL, OPERATOR_NO_OP, var->slot, counter, counter);
+
+  if (!compile_body(interp, loop, for_loop->loop_body) ||
+      !int_op(loop, NULL, OPERATOR_PLUS, counter, counter, step_slot) || !types_fit(loop))
+    return false;
+
+  if (loop->num_slots == MAX_SLOTS)
+    return false;
+
+  int_op(loop, &loop->condition, (step > 0) ? OPERATOR_LT : OPERATOR_GT, loop->num_slots++, counter, stop_slot);
+
+  return true;
+}
+
+//
+// write_back
+//
+// Writes the variables the loop assigned to memory: those that
+// were already there, and those the loop created, in the order it
+// created them. If the loop stopped before op # stopped_at of an
+// iteration, a variable has the type that op or the last one
+// before it that assigned it gave it, and if that's the 1st
+// iteration, the variables not assigned yet are left out.
+//
+static void write_back(struct Interpreter *interp, struct Loop *loop, int stopped_at, bool first)
+{
+  for (int k = 0; k < loop->num_ops; k++)
+  {
+    for (int v = 0; v < loop->num_vars; v++)
+    {
+      struct Var *var = &loop->vars[v];
+
+      if (var->first_op != k || (first && k >= stopped_at))
+        continue;
+
+      struct RAM_VALUE value;
+
+      value.value_type = loop->types[var->slot];
+
+      for (int j = 0; j < stopped_at; j++)
+        if (loop->ops[j].result == var->slot)
+          value.value_type = loop->ops[j].type;
+
+      if (value.value_type == RAM_TYPE_INT)
+        value.types.i = loop->slots[var->slot].i;
+      else
+        value.types.d = loop->slots[var->slot].d;
+
+      if (var->address >= 0)
+        ram_write_cell_by_addr(interp->memory, value, var->address);
+      else
+        ram_write_cell_by_id(interp->memory, value, var->name);
+    }
+  }
+}
+
+//
+// Public functions:
+//
+
+//
+// run_compiled
+//
+// Runs the rest of the loop, after an iteration on kernels, with
+// its compiled code, if it has been hot long enough to compile.
+// Returns the op the code stopped before, or -1 if it ran the
+// loop to the end; returns -2 if there's no code.
+//
+static int run_compiled(struct Jit *jit, struct Loop *loop, struct JitLoop **jit_loop)
+{
+  if (*jit_loop == NULL)
+  {
+    struct JitOp ops[MAX_OPS + 1];
+
+    for (int k = 0; k < loop->num_ops; k++)
+      ops[k] = loop->ops[k].jit;
+    ops[loop->num_ops] = loop->condition.jit;
+
+    *jit_loop = jit_find(jit, ops, loop->num_ops + 1);
+
+    if (*jit_loop == NULL)
+      return -2;
+  }
+
+  if (++(*jit_loop)->iterations < JIT_THRESHOLD)
+    return -2;
+
+  JitCode code = jit_compile(*jit_loop);
+
+  return (code == NULL) ? -2 : code(loop->slots);
+}
+
+//
+// run
+//
+// Runs the compiled loop, whose condition has just been found
+// true, as loopkernel_run describes.
+//
+static bool run(struct Interpreter *interp, struct Loop *loop, struct STMT **resume)
+{
+  struct Op *ops = loop->ops;
+  union Slot *slots = loop->slots;
+  struct Op *condition = &loop->condition;
+  struct JitLoop *jit_loop = NULL;
+  bool compiled = interp->jit != NULL;
+  bool first = true;
+
+  while (true)
+  {
+    for (int k = 0; k < loop->num_ops; k++)
+    {
+      if (!ops[k].kernel(&slots[ops[k].result], &slots[ops[k].lhs], &slots[ops[k].rhs]))
+      {
+        //
+        // division by zero: the executor takes over from here, and
+        // outputs the error
+        //
+        write_back(interp, loop, k, first);
+        *resume = ops[k].stmt;
+        return false;
+      }
+    }
+
+    first = false;
+
+    condition->kernel(&slots[condition->result], &slots[condition->lhs], &slots[condition->rhs]);
+
+    if (!slots[condition->result].i)
+      break;
+
+    if (compiled)
+    {
+      int stopped_at = run_compiled(interp->jit, loop, &jit_loop);
+
+      if (stopped_at == -1)
+        break;
+      else if (stopped_at >= 0)
+      {
+        write_back(interp, loop, stopped_at, false);
+        *resume = ops[stopped_at].stmt;
+        return false;
+      }
+
+      compiled = jit_loop != NULL && !jit_loop->failed;
+    }
+  }
+
+  write_back(interp, loop, loop->num_ops, false);
+
+  return true;
+}
+
+//
+// Public functions:
+//
+
+//
+// loopkernel_run
+//
+bool loopkernel_run(struct Interpreter *interp, struct STMT *stmt, struct STMT **resume)
+{
+  struct Loop loop;
+
+  if (!compile_loop(interp, &loop, stmt->types.while_loop))
+    return false;
+
+  return run(interp, &loop, resume);
+}
+
+//
+// loopkernel_run_for
+//
+bool loopkernel_run_for(struct Interpreter *interp, struct STMT *stmt, int *counter, int stop, int step, struct STMT **resume)
+{
+  struct Loop loop;
+
+  if (!compile_for(interp, &loop, stmt->types.for_loop, *counter, stop, step))
+    return false;
+
+  if (run(interp, &loop, resume))
+    return true;
+
+  *counter = loop.slots[loop.counter].i;
+
+  return false;
+}
@@ -0,0 +1,57 @@
+/*loopkernel.h*/
+
+//
+// Runs while and for loops that only do arithmetic on native
+// values. When the body of a loop is just assignments of int and
+// real arithmetic, and a while loop's condition is a comparison,
+// each statement maps onto a precompiled kernel for its operator
+// and operand types, e.g. x = y * 2.5 with y an int onto the
+// int * real kernel. The loop's variables are then kept in native
+// locals while it runs, rather than being read and written in
+// memory as RAM_VALUEs by each statement, and are written back to
+// memory when the loop ends. A for loop over a range is run as a
+// while loop on a counter of its own, which is copied to the
+// loop's variable each iteration.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+#include "interpreter.h"
+
+//
+// Public functions:
+//
+
+//
+// loopkernel_run
+//
+// Given a while loop whose condition has just been found true
+// (and whose preheader has run), tries to run the rest of the
+// loop with kernels, given the types the variables hold now, and
+// returns true if it ran to the end. If the interpreter has a JIT
+// (see jit.h), a loop that gets hot is compiled and runs the
+// rest of the way as machine code.
+//
+// Returns false, having changed nothing, if the loop has a
+// statement or type there's no kernel for, or a variable's type
+// would change from one iteration to the next; the caller then
+// runs the loop as usual. Also returns false if a statement would
+// divide by zero: then the variables are written to memory as
+// they are at that point, and *resume is set to the statement,
+// for the caller to carry on from, and output the error.
+//
+bool loopkernel_run(struct Interpreter *interp, struct STMT *stmt, struct STMT **resume);
+
+//
+// loopkernel_run_for
+//
+// The same for a for loop over range(*counter, stop, step), whose
+// range has been checked and is not empty: returns true if the
+// loop ran to the end. If it returns false having stopped partway
+// through an iteration, *resume is set as above and *counter to
+// that iteration's value, for the caller to carry on from.
+//
+bool loopkernel_run_for(struct Interpreter *interp, struct STMT *stmt, int *counter, int stop, int step, struct STMT **resume);
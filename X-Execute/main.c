@@ -25,21 +25,106 @@
 #include "programgraph.h"
 #include "ram.h"
 #include "execute.h"
+#include "interpreter.h"
+#include "batch.h"
+#include "graphcache.h"
+#include "optimizer.h"
+#include "daemon.h"
+#include "jit.h"
+#include "aot.h"
+#include "closure.h"
+#include "callcache.h"
 
 //
 // main
 //
-// usage: program.exe [filename.py]
+// usage: program.exe [-v] [--jit] [--aot] [--closures] [filename.py]
+//        program.exe --batch [-j threads] file1.py file2.py ...
+//        program.exe --serve [-j threads] [socket]
 //
 // If a filename is given, the file is opened and serves as
 // input to the scanner. If a filename is not given, then
-// input is taken from the keyboard until $ is input.
+// input is taken from the keyboard until $ is input. The program
+// graph is printed as built, before it's optimized. With -v, the
+// optimizations applied to the program, and the hit rate of the
+// call sites' caches, are reported. With
+// --jit, hot loops are compiled to machine code (see jit.h), and
+// with --aot the whole program is compiled to native code by the
+// C compiler before it runs (see aot.h). With --closures, the
+// program graph is compiled into closures, which are run instead
+// of walking the graph (see closure.h).
+//
+// In batch mode, the given files are run in parallel on a
+// pool of threads (by default one per CPU), and just their
+// output and status is printed, in order.
+//
+// In server mode, programs are run for clients (see client.c)
+// that connect to the given Unix domain socket.
+//
+// The program graph of a file is cached (see graphcache.h),
+// so running an unchanged file again skips parsing (and
+// optimizing, so -v then reports nothing).
 //
 int main(int argc, char *argv[])
 {
   FILE *input = NULL;
   bool keyboardInput = false;
 
+  if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+  {
+    int first = 2;
+    int num_threads = 0; // one per CPU
+
+    if (argc >= 4 && strcmp(argv[2], "-j") == 0)
+    {
+      num_threads = atoi(argv[3]);
+      first = 4;
+    }
+
+    int num_failed = batch_run(&argv[first], argc - first, num_threads);
+
+    return (num_failed == 0) ? 0 : 1;
+  }
+
+  if (argc >= 2 && strcmp(argv[1], "--serve") == 0)
+  {
+    int next = 2;
+    int num_threads = 0; // one per CPU
+
+    if (argc >= 4 && strcmp(argv[2], "-j") == 0)
+    {
+      num_threads = atoi(argv[3]);
+      next = 4;
+    }
+
+    char *socket_path = (argc > next) ? argv[next] : DAEMON_DEFAULT_SOCKET;
+
+    daemon_run(socket_path, num_threads); // only returns on error
+
+    return 1;
+  }
+
+  bool verbose = false;
+  bool jit = false;
+  bool aot = false;
+  bool closures = false;
+
+  while (argc >= 2 && (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--jit") == 0 || strcmp(argv[1], "--aot") == 0 ||
+                       strcmp(argv[1], "--closures") == 0))
+  {
+    if (strcmp(argv[1], "-v") == 0)
+      verbose = true;
+    else if (strcmp(argv[1], "--jit") == 0)
+      jit = true;
+    else if (strcmp(argv[1], "--aot") == 0)
+      aot = true;
+    else
+      closures = true;
+
+    argc--;
+    argv++;
+  }
+
   if (argc < 2)
   {
     //
@@ -72,13 +157,44 @@ int main(int argc, char *argv[])
   }
 
   //
-  // call parser to check program syntax:
+  // the interpreter reads input() lines from the keyboard and
+  // writes everything to the console:
   //
-  parser_init();
+  struct Interpreter *interp = interpreter_create(stdin, stdout);
+
+  if (interp != NULL && jit)
+  {
+    interp->jit = jit_create();
 
-  struct TokenQueue *tokens = parser_parse(input);
+    if (interp->jit == NULL)
+    {
+      interpreter_destroy(interp);
+      interp = NULL;
+    }
+  }
 
-  if (tokens == NULL)
+  if (interp == NULL)
+  {
+    printf("**ERROR: out of memory.\n");
+
+    if (!keyboardInput)
+      fclose(input);
+
+    return 0;
+  }
+
+  //
+  // if the program was compiled before, load its graph from the
+  // cache; otherwise call parser to check program syntax:
+  //
+  struct GraphCache *cache = keyboardInput ? NULL : graphcache_open(input, argv[1]);
+  struct STMT *cached = graphcache_load(cache);
+  struct TokenQueue *tokens = NULL;
+
+  if (cached == NULL)
+    tokens = parser_parse(interp, input);
+
+  if (cached == NULL && tokens == NULL)
   {
     //
     // program has a syntax error, error msg already output:
@@ -92,24 +208,90 @@ int main(int argc, char *argv[])
     printf("**no syntax errors...\n");
     printf("**building program graph...\n");
 
-    struct STMT *program = programgraph_build(tokens);
+    struct STMT *program = cached;
+    char *listing = NULL; // the program as built, before optimizing
 
-    programgraph_print(program);
+    if (program == NULL)
+    {
+      program = programgraph_build(interp, tokens);
 
-    //
-    // now execute the program:
-    //
-    printf("**executing...\n");
+      if (program != NULL)
+      {
+        struct OptimizerStats stats;
 
-    struct RAM *memory = ram_init();
+        listing = programgraph_listing(program);
 
-    execute(program, memory);
+        optimizer_run(interp, program, true, verbose, &stats);
 
-    printf("**done\n");
+        if (verbose && stats.simplified > 0)
+          printf("**simplified %d expressions...\n", stats.simplified);
+        if (verbose && stats.specialized > 0)
+          printf("**specialized %d expressions...\n", stats.specialized);
+        if (verbose && stats.hoisted > 0)
+          printf("**hoisted %d assignments out of loops...\n", stats.hoisted);
+      }
 
-    ram_print(memory);
+      graphcache_store(cache, program, listing);
+    }
+
+    if (program != NULL) // else error msg already output:
+    {
+      const char *printed = (program == cached) ? graphcache_listing(cache) : listing;
+
+      if (printed != NULL)
+        fputs(printed, interp->output);
+      else // out of memory when built: the optimized graph
+        programgraph_print(interp, program);
+
+      //
+      // reads of variables that are never assigned are reported
+      // now, before the program has done anything; otherwise
+      // execute the program:
+      //
+      if (optimizer_report_undefined(interp, program) == 0)
+      {
+        struct AotProgram *native = aot ? aot_compile(interp, program, keyboardInput ? NULL : argv[1], verbose) : NULL;
+        struct ClosureProgram *compiled = (closures && native == NULL) ? closure_compile(program) : NULL;
+
+        printf("**executing...\n");
+
+        if (native != NULL)
+          aot_run(native, interp);
+        else if (compiled != NULL)
+          closure_run(compiled, interp);
+        else
+          execute(interp, program);
+
+        printf("**done\n");
+
+        if (verbose && interp->calls != NULL)
+        {
+          struct CallCache *calls = interp->calls;
+          long lookups = calls->hits + calls->misses;
+
+          printf("**call sites: %ld hits, %ld misses (%.1f%% hits), %ld tail calls\n", calls->hits, calls->misses,
+                 lookups > 0 ? 100.0 * calls->hits / lookups : 0.0, calls->tail_calls);
+        }
+
+        aot_destroy(native);
+        closure_destroy(compiled);
+
+        ram_print(interp->memory);
+      }
+
+      if (program != cached) // cached graph is freed with the cache
+        programgraph_destroy(program);
+    }
+
+    free(listing);
+
+    if (tokens != NULL)
+      tokenqueue_destroy(tokens);
   }
 
+  graphcache_close(cache);
+  interpreter_destroy(interp);
+
   //
   // done:
   //
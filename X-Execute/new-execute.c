@@ -1,6 +1,6 @@
 /*execute.c*/
 
-// << THIS FILE DEFINES C FUNCTIONS THAT EXECUTES PYTHON CODE GIVEN A PROGRAM GRAPH. IT HANDLES EVALUATING EXPRESSION AND EXPRESSION TYPES, EXECUTING STATEMENTS, ASSIGNMENTS, AND FUNCTION CALLS(PRINT(), INT(), FLOAT(), INPUT()), PERFORMING ITERATIONS THROUGH WHILE LOOPS, ALLOCATING MEMORY FOR VARIOUS DATA TYPES, AND READING FROM AND WRITING TO MEMORY>>
+// << THIS FILE DEFINES C FUNCTIONS THAT EXECUTES PYTHON CODE GIVEN A PROGRAM GRAPH. IT HANDLES EVALUATING EXPRESSION AND EXPRESSION TYPES, EXECUTING STATEMENTS, ASSIGNMENTS, AND FUNCTION CALLS(PRINT(), INT(), FLOAT(), INPUT()), PERFORMING ITERATIONS THROUGH WHILE AND FOR LOOPS, ALLOCATING MEMORY FOR VARIOUS DATA TYPES, AND READING FROM AND WRITING TO MEMORY>>
 //
 // << JAY KIPTOO YEGON >>
 // << NORTHWESTERN UNIVERSITY >>
@@ -13,16 +13,191 @@
 #include <string.h>
 #include <assert.h> //debugging assertions
 #include <math.h>   //math functions
+#include <limits.h> //INT_MIN, INT_MAX
+#include <ctype.h>  //isspace, isdigit
 
 #include "programgraph.h" //program graph
 #include "ram.h"          //Random Access Memory (RAM) - functions for reading and writing from memory
 #include "execute.h"      //execution-related functionality
 #include "util.h"         //utility functions
+#include "linereader.h"   //buffered line input for input()
+#include "interpreter.h"  //interpreter context: memory and I/O streams
+#include "induction.h"    //counting loops run without iterating
+#include "loopkernel.h"   //arithmetic loops run on native values
+#include "list.h"         //lists, e.g. [1, 2, 3]
+#include "dict.h"         //dictionaries, e.g. {'a': 1}
+#include "strsearch.h"    //substring search for in
+#include "reduce.h"       //sum(), min(), max() and dot() over lists
+#include "builtins.h"     //the functions programs can call, by ID
+#include "callcache.h"    //the bodies call sites run, typed for their arguments
+
+//
+// the call stack (see execute.h) has room for this many values, in
+// the frames of at most MAX_DEPTH calls; UNBOUND is the type of a
+// local that hasn't been assigned yet
+//
+#define STACK_VALUES 65536
+#define MAX_DEPTH 1000
+#define UNBOUND -1
 
 //
 // Private functions:
 //
 
+// str_to_int
+//
+// Converts the given string to an integer the way int() does: optional
+// leading/trailing whitespace, an optional sign, and at least one digit.
+// Returns true and stores the result if the whole string is a valid
+// integer that fits in an int, false if not. Unlike atoi(), "abc" and
+// "12abc" are rejected instead of quietly becoming 0 and 12.
+
+static bool str_to_int(char *s, int *result)
+{
+    // skip leading whitespace
+    while (isspace((unsigned char)*s))
+        s++;
+    // optional sign
+    bool negative = false;
+    if (*s == '+' || *s == '-')
+    {
+        negative = (*s == '-');
+        s++;
+    }
+    // must have at least one digit
+    if (!isdigit((unsigned char)*s))
+        return false;
+    // accumulate as a negative number, since INT_MIN has no positive counterpart
+    long long value = 0;
+    while (isdigit((unsigned char)*s))
+    {
+        value = value * 10 - (*s - '0');
+        if (value < INT_MIN) // overflow
+            return false;
+        s++;
+    }
+    // skip trailing whitespace, then we must be at the end
+    while (isspace((unsigned char)*s))
+        s++;
+    if (*s != '\0')
+        return false;
+
+    if (!negative)
+    {
+        if (-value > INT_MAX)
+            return false;
+        value = -value;
+    }
+    *result = (int)value;
+    return true;
+}
+
+// str_to_real
+//
+// Converts the given string to a real the way float() does: optional
+// leading/trailing whitespace, an optional sign, digits with an optional
+// decimal point (at least one digit overall), and an optional exponent.
+// Returns true and stores the result if the whole string is valid, false
+// if not.
+
+// Short decimals like "3.14" are converted directly: when the digits fit
+// in 2^53 and the power of ten is at most 10^22, both are exact doubles
+// and a single division gives the correctly-rounded result. Anything
+// else is handed to strtod() once the syntax has been validated here.
+
+static bool str_to_real(char *s, double *result)
+{
+    static const double powers_of_10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    // skip leading whitespace
+    while (isspace((unsigned char)*s))
+        s++;
+    char *start = s;
+    // optional sign
+    bool negative = false;
+    if (*s == '+' || *s == '-')
+    {
+        negative = (*s == '-');
+        s++;
+    }
+    // digits, with an optional decimal point
+    unsigned long long mantissa = 0;
+    int num_digits = 0;
+    int num_fraction_digits = 0;
+    bool exact = true; // does mantissa hold every digit?
+    while (isdigit((unsigned char)*s))
+    {
+        if (mantissa < (1ULL << 53) / 10)
+            mantissa = mantissa * 10 + (*s - '0');
+        else
+            exact = false;
+        num_digits++;
+        s++;
+    }
+    if (*s == '.')
+    {
+        s++;
+        while (isdigit((unsigned char)*s))
+        {
+            if (mantissa < (1ULL << 53) / 10)
+                mantissa = mantissa * 10 + (*s - '0');
+            else
+                exact = false;
+            num_digits++;
+            num_fraction_digits++;
+            s++;
+        }
+    }
+    if (num_digits == 0)
+        return false;
+    // optional exponent
+    if (*s == 'e' || *s == 'E')
+    {
+        exact = false;
+        s++;
+        if (*s == '+' || *s == '-')
+            s++;
+        if (!isdigit((unsigned char)*s))
+            return false;
+        while (isdigit((unsigned char)*s))
+            s++;
+    }
+    char *end = s;
+    // skip trailing whitespace, then we must be at the end
+    while (isspace((unsigned char)*s))
+        s++;
+    if (*s != '\0')
+        return false;
+
+    if (exact && num_fraction_digits <= 22)
+    { // fast path
+        double value = (double)mantissa / powers_of_10[num_fraction_digits];
+        *result = negative ? -value : value;
+        return true;
+    }
+    // slow path: syntax is valid, so strtod() will consume exactly [start, end)
+    char *strtod_end;
+    *result = strtod(start, &strtod_end);
+    assert(strtod_end == end);
+    return true;
+}
+
+//
+// retain_value
+//
+// Makes a value read from memory or a frame the reader's own: a
+// string is copied, and a list or dictionary retained.
+//
+static void retain_value(struct RAM_VALUE *value)
+{
+    if (value->value_type == RAM_TYPE_STR)
+        value->types.s = dupString(value->types.s);
+    else if (value->value_type == RAM_TYPE_LIST)
+        list_retain(value->types.l);
+    else if (value->value_type == RAM_TYPE_DICT)
+        dict_retain(value->types.m);
+}
+
 //
 // get_element_value
 //
@@ -30,12 +205,15 @@
 // "x" or some kind of literal like 123 --- the value of
 // this identifier or literal is returned via the reference
 // parameter. Returns true if successful, false if not.
+// A string value is always a copy, and a list or dictionary
+// value a new reference, which the caller must free via
+// release_value().
 //
 // Why would it fail? If the identifier does not exist in
 // memory. This is a semantic error, and an error message is
 // output before returning.
 //
-static bool get_element_value(struct STMT *stmt, struct RAM *memory, struct ELEMENT *element, struct RAM_VALUE *value)
+static bool get_element_value(struct Interpreter *interp, struct STMT *stmt, struct ELEMENT *element, struct RAM_VALUE *value)
 { // check element type
     if (element->element_type == ELEMENT_INT_LITERAL)
     { // integer literal
@@ -46,7 +224,7 @@ static bool get_element_value(struct STMT *stmt, struct RAM *memory, struct ELEM
     else if (element->element_type == ELEMENT_STR_LITERAL)
     { // string literal
         value->value_type = RAM_TYPE_STR;
-        value->types.s = element->element_value;
+        value->types.s = dupString(element->element_value);
     }
     else if (element->element_type == ELEMENT_REAL_LITERAL)
     { // real/floating point literal
@@ -66,22 +244,200 @@ static bool get_element_value(struct STMT *stmt, struct RAM *memory, struct ELEM
         value->value_type = RAM_TYPE_BOOLEAN;
         value->types.i = 0;
     }
+    else if (element->slot >= 0)
+    {
+        // a local of the running function, read from its frame
+        *value = interp->frame[element->slot];
+        if (value->value_type == UNBOUND)
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", element->element_value, stmt->line);
+            return false;
+        }
+        retain_value(value);
+    }
+    else if (element->defined == ELEMENT_DEFINED_ALWAYS)
+    {
+        // variable proven to be assigned before it's read (see
+        // optimizer_types), so read its cell without the checks:
+        int address = ram_get_addr(interp->memory, element->element_value);
+
+        assert(address >= 0);
+        *value = interp->memory->cells[address].value;
+        retain_value(value);
+    }
     else
     {
         // identifier => variable
         char *var_name = element->element_value;
         // read value from RAM using the variable name
-        struct RAM_VALUE *ram_value = ram_read_cell_by_id(memory, var_name);
+        struct RAM_VALUE *ram_value = ram_read_cell_by_id(interp->memory, var_name);
         // if value is not defined, output error
         if (ram_value == NULL)
         {
-            printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
+            fprintf(interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
             return false;
         }
-        // copy value from RAM to provided RAM_VALUE struct
+        // copy value from RAM to provided RAM_VALUE struct; the
+        // caller now owns any string, so only free the struct
         *value = *ram_value;
+        free(ram_value);
+    }
+
+    return true;
+}
+
+//
+// release_value
+//
+// Values read from memory are copies, so a string value is
+// owned by whoever read it, as is a reference to a list or
+// dictionary; frees the string, or releases the list or
+// dictionary, once the value is no longer needed.
+//
+static void release_value(struct RAM_VALUE *value)
+{
+    if (value->value_type == RAM_TYPE_STR)
+        free(value->types.s);
+    else if (value->value_type == RAM_TYPE_LIST)
+        list_release(value->types.l);
+    else if (value->value_type == RAM_TYPE_DICT)
+        dict_release(value->types.m);
+}
+
+//
+// get_dict_value
+//
+// Given d[k], where d is a dictionary, returns the value of the
+// key k via the reference parameter, owned by the caller. Returns
+// true if successful, false if not (after outputting an error).
+//
+static bool get_dict_value(struct Interpreter *interp, struct STMT *stmt, struct UNARY_EXPR *unary, struct DICT *dict, struct RAM_VALUE *value)
+{
+    struct RAM_VALUE key;
+
+    if (unary->expr_type == UNARY_SLICE)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        return false;
+    }
+
+    if (!get_element_value(interp, stmt, unary->index, &key))
+        return false;
+
+    bool success = dict_hashable(key);
+
+    if (!success)
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+    else if (!(success = dict_get(dict, key, value)))
+        fprintf(interp->output, "**EXECUTION ERROR: key not found (line %d)\n", stmt->line);
+
+    release_value(&key);
+
+    return success;
+}
+
+//
+// get_subscript_value
+//
+// Given x[i] or x[i:j], where x is a list or a string, returns
+// the item or the slice via the reference parameter, owned by
+// the caller; x may also be a dictionary, x[key]. As in Python, a negative index counts from the
+// end, an index out of range is an error, and the bounds of a
+// slice are clamped to the list. A slice of a list shares its
+// items (see list.h); a string is copied.
+//
+static bool get_subscript_value(struct Interpreter *interp, struct STMT *stmt, struct UNARY_EXPR *unary, struct RAM_VALUE *value)
+{
+    struct RAM_VALUE container;
+
+    if (!get_element_value(interp, stmt, unary->element, &container))
+        return false;
+
+    int length;
+
+    if (container.value_type == RAM_TYPE_DICT)
+    {
+        bool success = get_dict_value(interp, stmt, unary, container.types.m, value);
+
+        release_value(&container);
+        return success;
+    }
+    else if (container.value_type == RAM_TYPE_LIST)
+        length = container.types.l->length;
+    else if (container.value_type == RAM_TYPE_STR)
+        length = (int)strlen(container.types.s);
+    else
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        release_value(&container);
+        return false;
+    }
+    // the index, or the start and end of the slice, which default
+    // to the whole list
+    struct ELEMENT *elements[2] = {unary->index, unary->end};
+    int bounds[2] = {0, length};
+
+    for (int k = 0; k < 2; k++)
+    {
+        struct RAM_VALUE bound;
+
+        if (elements[k] == NULL)
+            continue;
+
+        if (!get_element_value(interp, stmt, elements[k], &bound))
+        {
+            release_value(&container);
+            return false;
+        }
+
+        if (bound.value_type != RAM_TYPE_INT)
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+            release_value(&bound);
+            release_value(&container);
+            return false;
+        }
+
+        bounds[k] = (bound.types.i < 0) ? bound.types.i + length : bound.types.i;
+    }
+
+    if (unary->expr_type == UNARY_INDEX)
+    {
+        int i = bounds[0];
+
+        if (i < 0 || i >= length)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: index out of range (line %d)\n", stmt->line);
+            release_value(&container);
+            return false;
+        }
+
+        bounds[1] = i + 1;
+    }
+    else
+    { // clamp the slice to 0 <= start <= end <= length
+        bounds[0] = (bounds[0] < 0) ? 0 : (bounds[0] > length) ? length : bounds[0];
+        bounds[1] = (bounds[1] < bounds[0]) ? bounds[0] : (bounds[1] > length) ? length : bounds[1];
+    }
+
+    if (container.value_type == RAM_TYPE_STR)
+    {
+        value->value_type = RAM_TYPE_STR;
+        value->types.s = dupString(container.types.s + bounds[0]);
+        value->types.s[bounds[1] - bounds[0]] = '\0';
+    }
+    else if (unary->expr_type == UNARY_INDEX)
+    {
+        list_get(container.types.l, bounds[0], value);
+    }
+    else
+    {
+        value->value_type = RAM_TYPE_LIST;
+        value->types.l = list_slice(container.types.l, bounds[0], bounds[1]);
     }
 
+    release_value(&container);
+
     return true;
 }
 
@@ -90,7 +446,9 @@ static bool get_element_value(struct STMT *stmt, struct RAM *memory, struct ELEM
 //
 // Given a unary expr, returns the value that it represents.
 // This could be the result of a literal 123 or the value
-// from memory for an identifier such as "x". Unary values
+// from memory for an identifier such as "x", or an item or
+// slice of a list or string, x[i] or x[i:j], or the value of
+// a key of a dictionary, x[key]. Unary values
 // may have unary operators, such as + or -, applied.
 // This value is "returned" via the reference parameter.
 // Returns true if successful, false if not.
@@ -99,16 +457,22 @@ static bool get_element_value(struct STMT *stmt, struct RAM *memory, struct ELEM
 // memory. This is a semantic error, and an error message is
 // output before returning.
 //
-static bool get_unary_value(struct STMT *stmt, struct RAM *memory, struct UNARY_EXPR *unary, struct RAM_VALUE *value)
+static bool get_unary_value(struct Interpreter *interp, struct STMT *stmt, struct UNARY_EXPR *unary, struct RAM_VALUE *value)
 {
+    if (unary->expr_type == UNARY_INDEX || unary->expr_type == UNARY_SLICE)
+        return get_subscript_value(interp, stmt, unary, value);
     //
-    // we only have simple elements so far (no unary operators):
-    // so assert the unary expression type is UNARY_ELEMENT
-    assert(unary->expr_type == UNARY_ELEMENT);
+    // we only have simple elements so far: the unary operators
+    // (+x, -x, *x, &x) aren't supported yet
+    if (unary->expr_type != UNARY_ELEMENT)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: unsupported unary operator (line %d)\n", stmt->line);
+        return false;
+    }
     // get element from the unary expression
     struct ELEMENT *element = unary->element;
     // get value of element by calling helper function get_element_value
-    bool success = get_element_value(stmt, memory, element, value);
+    bool success = get_element_value(interp, stmt, element, value);
 
     return success;
 }
@@ -121,7 +485,7 @@ static bool get_unary_value(struct STMT *stmt, struct RAM *memory, struct UNARY_
 
 // program throws semantic error if the operands can't be added / invalid operand types
 
-static bool handle_addition(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_addition(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 {
     // Handle addition for different types
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
@@ -144,7 +508,7 @@ static bool handle_addition(struct STMT *stmt, struct RAM_VALUE lhs_value, struc
     }
     else
     { // invalid operand types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true from successful addition
@@ -158,7 +522,7 @@ static bool handle_addition(struct STMT *stmt, struct RAM_VALUE lhs_value, struc
 
 // program throws semantic error if invalid operand types
 
-static bool handle_subtraction(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_subtraction(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 {
     // Handle subtraction for different types
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
@@ -173,7 +537,7 @@ static bool handle_subtraction(struct STMT *stmt, struct RAM_VALUE lhs_value, st
     }
     else
     { // invalid operand types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true for successful subtraction
@@ -188,7 +552,7 @@ static bool handle_subtraction(struct STMT *stmt, struct RAM_VALUE lhs_value, st
 
 // If the operand types are not valid for multiplication, it outputs a semantic error.
 
-static bool handle_multiplication(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_multiplication(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform multiplication
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer multiplication
@@ -203,7 +567,7 @@ static bool handle_multiplication(struct STMT *stmt, struct RAM_VALUE lhs_value,
     else
     {
         // Invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true from successful multiplication
@@ -217,7 +581,7 @@ static bool handle_multiplication(struct STMT *stmt, struct RAM_VALUE lhs_value,
 
 // If the operand types are not valid for power operation, it outputs a semantic error.
 
-static bool handle_power(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_power(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer power
@@ -231,7 +595,7 @@ static bool handle_power(struct STMT *stmt, struct RAM_VALUE lhs_value, struct R
     }
     else
     { // Invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful power operation
@@ -249,23 +613,24 @@ static bool handle_power(struct STMT *stmt, struct RAM_VALUE lhs_value, struct R
 // Then, the function checks the types of the operands and performs division accordingly.
 // If the operand types are not valid for division, it outputs a semantic error.
 
-static bool handle_division(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_division(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check for division by zero errors
     if (rhs_value.value_type == RAM_TYPE_INT && rhs_value.types.i == 0)
     { // division by zero error for integer division
-        printf("**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+        fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
         return false;
     }
     else if (rhs_value.value_type == RAM_TYPE_REAL && rhs_value.types.d == 0.0)
     { // division by zero error for real division
-        printf("**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+        fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
         return false;
     }
     // Check operand types
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer division
         result->value_type = RAM_TYPE_INT;
-        result->types.i = lhs_value.types.i / rhs_value.types.i;
+        // INT_MIN / -1 overflows (and traps), so negate instead, wrapping as + and * do
+        result->types.i = (rhs_value.types.i == -1) ? (int)(0u - (unsigned)lhs_value.types.i) : lhs_value.types.i / rhs_value.types.i;
     }
     else if (lhs_value.value_type == RAM_TYPE_REAL && rhs_value.value_type == RAM_TYPE_REAL)
     { // real division
@@ -275,7 +640,7 @@ static bool handle_division(struct STMT *stmt, struct RAM_VALUE lhs_value, struc
     else
     {
         // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful division
@@ -293,18 +658,18 @@ static bool handle_division(struct STMT *stmt, struct RAM_VALUE lhs_value, struc
 // Then, the function checks the types of the operands and performs modulus accordingly.
 // If the operand types are not valid for modulus operation, it outputs a semantic error.
 
-static bool handle_modulus(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_modulus(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // Check for division by zero errors
     if (rhs_value.value_type == RAM_TYPE_INT && rhs_value.types.i == 0)
     {
         // division by zero error for integer modulus
-        printf("**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+        fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
         return false;
     }
     else if (rhs_value.value_type == RAM_TYPE_REAL && rhs_value.types.d == 0.0)
     {
         // division by zero error for real modulus
-        printf("**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+        fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
         return false;
     }
     // Check operand types and perform modulus
@@ -312,7 +677,8 @@ static bool handle_modulus(struct STMT *stmt, struct RAM_VALUE lhs_value, struct
     {
         // integer modulus
         result->value_type = RAM_TYPE_INT;
-        result->types.i = lhs_value.types.i % rhs_value.types.i;
+        // x % -1 is 0, but INT_MIN % -1 traps:
+        result->types.i = (rhs_value.types.i == -1) ? 0 : lhs_value.types.i % rhs_value.types.i;
     }
     else if (lhs_value.value_type == RAM_TYPE_REAL && rhs_value.value_type == RAM_TYPE_REAL)
     {
@@ -323,7 +689,7 @@ static bool handle_modulus(struct STMT *stmt, struct RAM_VALUE lhs_value, struct
     else
     {
         // invalid operands, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true for successful modulus operation
@@ -338,7 +704,7 @@ static bool handle_modulus(struct STMT *stmt, struct RAM_VALUE lhs_value, struct
 // The function checks the types of the operands and performs equality comparison accordingly.
 // If the operand types are not valid for equality comparison, it outputs a semantic error.
 
-static bool handle_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_equal(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform equality comparison
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer equality comparison
@@ -350,14 +716,14 @@ static bool handle_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct R
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (fabs(lhs_value.types.d - rhs_value.types.d) < 0.001) ? 1 : 0;
     }
-    else if (lhs_value.value_type == RAM_TYPE_STR && lhs_value.value_type == RAM_TYPE_STR)
+    else if (lhs_value.value_type == RAM_TYPE_STR && rhs_value.value_type == RAM_TYPE_STR)
     { // string equality comparison
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (strcmp(lhs_value.types.s, rhs_value.types.s) == 0) ? 1 : 0;
     }
     else
     { // invalid operands, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful equality comparison
@@ -372,7 +738,7 @@ static bool handle_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct R
 // The function checks the types of the operands and performs inequality comparison accordingly.
 // If the operand types are not valid for inequality comparison, it outputs a semantic error.
 
-static bool handle_not_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_not_equal(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform inequality comparison
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer inequality comparison
@@ -384,14 +750,14 @@ static bool handle_not_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, stru
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (fabs(lhs_value.types.d - rhs_value.types.d) > 0.001) ? 1 : 0;
     }
-    else if (lhs_value.value_type == RAM_TYPE_STR && lhs_value.value_type == RAM_TYPE_STR)
+    else if (lhs_value.value_type == RAM_TYPE_STR && rhs_value.value_type == RAM_TYPE_STR)
     { // string inequality comparison
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (strcmp(lhs_value.types.s, rhs_value.types.s) != 0) ? 1 : 0;
     }
     else
     { // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful inequality comparison
@@ -406,7 +772,7 @@ static bool handle_not_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, stru
 // The function checks the types of the operands and performs less-than comparison.
 // If the operand types are invalid for less-than comparison, it outputs a semantic error.
 
-static bool handle_less_than(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_less_than(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // Check operand types and perform less-than comparison
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer less-than comparison
@@ -418,14 +784,14 @@ static bool handle_less_than(struct STMT *stmt, struct RAM_VALUE lhs_value, stru
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (lhs_value.types.d < rhs_value.types.d) ? 1 : 0;
     }
-    else if (lhs_value.value_type == RAM_TYPE_STR && lhs_value.value_type == RAM_TYPE_STR)
+    else if (lhs_value.value_type == RAM_TYPE_STR && rhs_value.value_type == RAM_TYPE_STR)
     { // string less-than comparison
         result->value_type = RAM_TYPE_BOOLEAN;
         result->types.i = (strcmp(lhs_value.types.s, rhs_value.types.s) < 0) ? 1 : 0;
     }
     else
     { // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful less-than comparison
@@ -440,7 +806,7 @@ static bool handle_less_than(struct STMT *stmt, struct RAM_VALUE lhs_value, stru
 // The function checks the types of the operands and performs less-than-or-equal-to comparison accordingly.
 // If the operand types are not valid for less-than-or-equal-to comparison, it outputs a semantic error.
 
-static bool handle_less_than_or_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_less_than_or_equal(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform less-than-or-equal-to comparison
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer less-than-or-equal-to comparison
@@ -459,7 +825,7 @@ static bool handle_less_than_or_equal(struct STMT *stmt, struct RAM_VALUE lhs_va
     }
     else
     { // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful less-than-or-equal-to comparison
@@ -474,7 +840,7 @@ static bool handle_less_than_or_equal(struct STMT *stmt, struct RAM_VALUE lhs_va
 // The function checks the types of the operands and performs greater-than comparison accordingly.
 // If the operand types are not valid for greater-than comparison, it outputs a semantic error.
 
-static bool handle_greater_than(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_greater_than(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform greater-than comparison
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer greater-than comparison
@@ -493,7 +859,7 @@ static bool handle_greater_than(struct STMT *stmt, struct RAM_VALUE lhs_value, s
     }
     else
     { // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful greater-than comparison
@@ -508,7 +874,7 @@ static bool handle_greater_than(struct STMT *stmt, struct RAM_VALUE lhs_value, s
 // The function checks the types of the operands and performs greater-than-or-equal comparison accordingly.
 // If the operand types are not valid for greater-than-or-equal comparison, it outputs a semantic error.
 
-static bool handle_greater_than_or_equal(struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+static bool handle_greater_than_or_equal(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
 { // check operand types and perform greater-than-or-equal comparison accordingly
     if (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_INT)
     { // integer greater-than-or-equal comparison
@@ -527,243 +893,1282 @@ static bool handle_greater_than_or_equal(struct STMT *stmt, struct RAM_VALUE lhs
     }
     else
     { // invalid operation for the given types, output semantic error and return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
     // return true to indicate successful greater-than-or-equal comparison
     return true;
 }
-//
-// execute_binary_expr
-//
-// Given two values and an operator, performs the operation
-// and updates the value in the lhs (which can be updated
-// because a pointer to the value is passed in). Returns
-// true if successful and false if not.
-//
 
-static bool execute_binary_expr(struct STMT *stmt, struct RAM *memory, struct VALUE_EXPR *binary, struct RAM_VALUE *result)
-{
-    // ensure the binary expression has a valid left-hand side and operator
-    assert(binary->lhs != NULL);
-    assert(binary->operator!= OPERATOR_NO_OP);
-    // initialize variables to store the left-hand side (lhs) and right-hand side (rhs) values
-    struct RAM_VALUE lhs_value, rhs_value;
-    // Retrieve left-hand side value
-    bool success = get_unary_value(stmt, memory, binary->lhs, &lhs_value);
+// handle_in
+//
+// Given the lhs_value and rhs_value, this helper function performs
+// a membership test, lhs in rhs, and stores the result in the struct result.
 
-    if (!success)
-        return false;
-    // if the binary expression is not a unary operation, retrieve the value of the right-hand side
-    if (binary->isBinaryExpr)
-    {
-        assert(binary->rhs != NULL);
-        success = get_unary_value(stmt, memory, binary->rhs, &rhs_value);
+// A string is searched for the lhs as a substring (see strsearch.h), a list for an item
+// equal to it, and a dictionary for it as a key, by hash lookup. Any other rhs, or an lhs
+// that a string or dictionary can't hold, is a semantic error.
 
-        if (!success)
-            return false;
+static bool handle_in(struct Interpreter *interp, struct STMT *stmt, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+{ // check operand types and perform the membership test accordingly
+    if (lhs_value.value_type == RAM_TYPE_STR && rhs_value.value_type == RAM_TYPE_STR)
+    { // substring search
+        result->value_type = RAM_TYPE_BOOLEAN;
+        result->types.i = str_contains(rhs_value.types.s, lhs_value.types.s) ? 1 : 0;
     }
-    // perform type conversion if one operand is real and the other is integer
-    if ((lhs_value.value_type == RAM_TYPE_REAL && rhs_value.value_type == RAM_TYPE_INT) || (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_REAL))
-    { // convert left-hand side to real if needed
-        if (lhs_value.value_type != RAM_TYPE_REAL)
-        {
-            lhs_value.value_type = RAM_TYPE_REAL;
-            lhs_value.types.d = (double)lhs_value.types.i;
-        }
-        // convert the right-hand side to real if needed
-        if (rhs_value.value_type != RAM_TYPE_REAL)
-        {
-            rhs_value.value_type = RAM_TYPE_REAL;
-            rhs_value.types.d = (double)rhs_value.types.i;
-        }
+    else if (rhs_value.value_type == RAM_TYPE_LIST)
+    { // linear search of the items
+        result->value_type = RAM_TYPE_BOOLEAN;
+        result->types.i = list_contains(rhs_value.types.l, lhs_value) ? 1 : 0;
     }
-    //
-    // perform specified binary operation based on the operator
-    //
-    switch (binary->operator)
+    else if (rhs_value.value_type == RAM_TYPE_DICT && dict_hashable(lhs_value))
+    { // key lookup
+        result->value_type = RAM_TYPE_BOOLEAN;
+        result->types.i = dict_contains(rhs_value.types.m, lhs_value) ? 1 : 0;
+    }
+    else
+    { // invalid operation for the given types, output semantic error and return false
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        return false;
+    }
+    // return true to indicate a successful membership test
+    return true;
+}
+
+//
+// execute_int_operator
+//
+// Applies a binary operator to two ints, with the same semantics
+// as the handle_* functions above but no type checks, for
+// expressions whose operand types were proven before the program
+// ran (see optimizer_types). Returns true if successful and false
+// if not.
+//
+static bool execute_int_operator(struct Interpreter *interp, struct STMT *stmt, int operator, int lhs, int rhs, struct RAM_VALUE *result)
+{
+    result->value_type = RAM_TYPE_INT;
+
+    switch (operator)
     {
     case OPERATOR_PLUS:
-        return handle_addition(stmt, lhs_value, rhs_value, result);
+        result->types.i = lhs + rhs;
+        return true;
     case OPERATOR_MINUS:
-        return handle_subtraction(stmt, lhs_value, rhs_value, result);
+        result->types.i = lhs - rhs;
+        return true;
     case OPERATOR_ASTERISK:
-        return handle_multiplication(stmt, lhs_value, rhs_value, result);
+        result->types.i = lhs * rhs;
+        return true;
     case OPERATOR_POWER:
-        return handle_power(stmt, lhs_value, rhs_value, result);
+        result->types.i = pow(lhs, rhs);
+        return true;
     case OPERATOR_DIV:
-        return handle_division(stmt, lhs_value, rhs_value, result);
     case OPERATOR_MOD:
-        return handle_modulus(stmt, lhs_value, rhs_value, result);
+        if (rhs == 0)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+            return false;
+        }
+        if (rhs == -1) // INT_MIN / -1 and INT_MIN % -1 trap, see handle_division
+            result->types.i = (operator == OPERATOR_DIV) ? (int)(0u - (unsigned)lhs) : 0;
+        else
+            result->types.i = (operator == OPERATOR_DIV) ? lhs / rhs : lhs % rhs;
+        return true;
+    default:
+        break;
+    }
+
+    result->value_type = RAM_TYPE_BOOLEAN;
+
+    switch (operator)
+    {
     case OPERATOR_EQUAL:
-        return handle_equal(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs == rhs) ? 1 : 0;
+        return true;
     case OPERATOR_NOT_EQUAL:
-        return handle_not_equal(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs != rhs) ? 1 : 0;
+        return true;
     case OPERATOR_LT:
-        return handle_less_than(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs < rhs) ? 1 : 0;
+        return true;
     case OPERATOR_LTE:
-        return handle_less_than_or_equal(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs <= rhs) ? 1 : 0;
+        return true;
     case OPERATOR_GT:
-        return handle_greater_than(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs > rhs) ? 1 : 0;
+        return true;
     case OPERATOR_GTE:
-        return handle_greater_than_or_equal(stmt, lhs_value, rhs_value, result);
+        result->types.i = (lhs >= rhs) ? 1 : 0;
+        return true;
     default:
-        //
-        // did we miss something? return semantic error for invalid operator
-        // return false
-        printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
         return false;
     }
-    // return true to indicate successful execution of the binary expression
-    return true;
 }
 
 //
-// execute_assignment
-//
-// Executes an assignment statement, returning true if
-// successful and false if not (an error message will be
-// output before false is returned, so the caller doesn't
-// need to output anything).
+// execute_real_operator
 //
-// Examples: x = 123
-//           y = x ** 2
+// Same as execute_int_operator, for two reals (an int operand
+// having been promoted), including the comparison tolerances
+// of the handle_* functions.
 //
+static bool execute_real_operator(struct Interpreter *interp, struct STMT *stmt, int operator, double lhs, double rhs, struct RAM_VALUE *result)
+{
+    result->value_type = RAM_TYPE_REAL;
 
-static bool execute_assignment(struct STMT *stmt, struct RAM *memory)
-{ // extract assignment details of assignment
-    struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
-    char *var_name = assign->var_name;
-    // validate assignment does not involve pointer dereferencing
-    assert(assign->isPtrDeref == false);
-    // ensure right-hand side (rhs) of the assignment is a valid expression
-    assert(assign->rhs->value_type == VALUE_EXPR || assign->rhs->value_type == VALUE_FUNCTION_CALL);
-    // initialize a variable to store the computed value of right-hand side
-    struct RAM_VALUE value;
-    // process the right-hand side based on its type (expression or function call)
-    if (assign->rhs->value_type == VALUE_EXPR)
+    switch (operator)
     {
-        struct VALUE_EXPR *expr = assign->rhs->types.expr;
-        assert(expr->lhs != NULL);                                       // ensure expression has valid left-hand side (lhs)
-        bool success = get_unary_value(stmt, memory, expr->lhs, &value); // retrieve left-hand side value
-
-        if (!success)
-            return false;
-        // if expression involves binary operation, handle it
-        if (expr->isBinaryExpr)
+    case OPERATOR_PLUS:
+        result->types.d = lhs + rhs;
+        return true;
+    case OPERATOR_MINUS:
+        result->types.d = lhs - rhs;
+        return true;
+    case OPERATOR_ASTERISK:
+        result->types.d = lhs * rhs;
+        return true;
+    case OPERATOR_POWER:
+        result->types.d = pow(lhs, rhs);
+        return true;
+    case OPERATOR_DIV:
+    case OPERATOR_MOD:
+        if (rhs == 0.0)
         {
-            assert(expr->rhs != NULL);
-            assert(expr->operator!= OPERATOR_NO_OP);
-            struct RAM_VALUE rhs_value;
-            success = get_unary_value(stmt, memory, expr->rhs, &rhs_value); // retrieve right-hand side value
-
-            if (!success)
-            {
-                return false;
-            }
-            // compute result of binary operation and assign it to 'value'
-            struct RAM_VALUE result;
-            success = execute_binary_expr(stmt, memory, expr, &result);
-
-            if (!success)
-                return false;
-
-            value = result;
+            fprintf(interp->output, "**EXECUTION ERROR: division by zero (line %d)\n", stmt->line);
+            return false;
         }
+        result->types.d = (operator == OPERATOR_DIV) ? lhs / rhs : fmod(lhs, rhs);
+        return true;
+    default:
+        break;
     }
-    else if (assign->rhs->value_type == VALUE_FUNCTION_CALL)
-    {
-        struct VALUE_FUNCTION_CALL *func_call = assign->rhs->types.function_call;
-        // handle the input() function
-        if (strcmp(func_call->function_name, "input") == 0)
-        { // assert function call has a string literal parameter
-            assert(func_call->parameter->element_type == ELEMENT_STR_LITERAL);
-            printf("%s", func_call->parameter->element_value);
 
-            char line[256];
-            fgets(line, sizeof(line), stdin); // dynamically allocate memory to hold user's input
-            line[strcspn(line, "\n")] = '\0'; // delete EOL chars from input
-
-            value.value_type = RAM_TYPE_STR;
-            value.types.s = dupString(line); // Duplicate the input string and assign it to 'value'
-        }
-        // Handle int() logic
-        else if (strcmp(func_call->function_name, "int") == 0)
-        {
-            struct ELEMENT *param = func_call->parameter;
-            // ensure function call has a valid parameter of type identifier
-            if (param != NULL && param->element_type == ELEMENT_IDENTIFIER)
-            {
-                struct RAM_VALUE param_value;
-                bool success = get_element_value(stmt, memory, param, &param_value); // retrieve the value associated with the identifier
+    result->value_type = RAM_TYPE_BOOLEAN;
+
+    switch (operator)
+    {
+    case OPERATOR_EQUAL:
+        result->types.i = (fabs(lhs - rhs) < 0.001) ? 1 : 0;
+        return true;
+    case OPERATOR_NOT_EQUAL:
+        result->types.i = (fabs(lhs - rhs) > 0.001) ? 1 : 0;
+        return true;
+    case OPERATOR_LT:
+        result->types.i = (lhs < rhs) ? 1 : 0;
+        return true;
+    case OPERATOR_LTE:
+        result->types.i = (lhs <= rhs + 0.0001) ? 1 : 0;
+        return true;
+    case OPERATOR_GT:
+        result->types.i = (lhs > rhs + 0.0001) ? 1 : 0;
+        return true;
+    case OPERATOR_GTE:
+        result->types.i = (lhs > rhs - 0.0001) ? 1 : 0;
+        return true;
+    default:
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        return false;
+    }
+}
+
+//
+// execute_str_operator
+//
+// Same as execute_int_operator, for two strings: + concatenates,
+// into new memory that the caller owns, in searches, and the
+// comparisons compare; the operands are only borrowed.
+//
+static bool execute_str_operator(struct Interpreter *interp, struct STMT *stmt, int operator, char *lhs, char *rhs, struct RAM_VALUE *result)
+{
+    if (operator == OPERATOR_PLUS)
+    {
+        result->value_type = RAM_TYPE_STR;
+        result->types.s = dupStrings(lhs, rhs);
+        return true;
+    }
+
+    if (operator == OPERATOR_IN)
+    {
+        result->value_type = RAM_TYPE_BOOLEAN;
+        result->types.i = str_contains(rhs, lhs) ? 1 : 0;
+        return true;
+    }
+
+    int cmp = strcmp(lhs, rhs);
+
+    result->value_type = RAM_TYPE_BOOLEAN;
+
+    switch (operator)
+    {
+    case OPERATOR_EQUAL:
+        result->types.i = (cmp == 0) ? 1 : 0;
+        return true;
+    case OPERATOR_NOT_EQUAL:
+        result->types.i = (cmp != 0) ? 1 : 0;
+        return true;
+    case OPERATOR_LT:
+        result->types.i = (cmp < 0) ? 1 : 0;
+        return true;
+    case OPERATOR_LTE:
+        result->types.i = (cmp <= 0) ? 1 : 0;
+        return true;
+    case OPERATOR_GT:
+        result->types.i = (cmp > 0) ? 1 : 0;
+        return true;
+    case OPERATOR_GTE:
+        result->types.i = (cmp >= 0) ? 1 : 0;
+        return true;
+    default:
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        return false;
+    }
+}
+
+//
+// peek_element_value
+//
+// Like get_element_value, but a string value is not copied:
+// it points into the program graph, memory or a frame, so it
+// is only valid until the variable is next written.
+//
+static bool peek_element_value(struct Interpreter *interp, struct STMT *stmt, struct ELEMENT *element, struct RAM_VALUE *value)
+{
+    if (element->element_type == ELEMENT_INT_LITERAL)
+    {
+        value->value_type = RAM_TYPE_INT;
+        value->types.i = atoi(element->element_value);
+    }
+    else if (element->element_type == ELEMENT_REAL_LITERAL)
+    {
+        value->value_type = RAM_TYPE_REAL;
+        value->types.d = atof(element->element_value);
+    }
+    else if (element->element_type == ELEMENT_STR_LITERAL)
+    {
+        value->value_type = RAM_TYPE_STR;
+        value->types.s = element->element_value;
+    }
+    else if (element->element_type == ELEMENT_IDENTIFIER && element->slot >= 0)
+    {
+        *value = interp->frame[element->slot];
+        if (value->value_type == UNBOUND)
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", element->element_value, stmt->line);
+            return false;
+        }
+    }
+    else if (element->element_type == ELEMENT_IDENTIFIER)
+    {
+        int address = ram_get_addr(interp->memory, element->element_value);
+
+        // no check if proven to be assigned (see optimizer_types):
+        if (element->defined != ELEMENT_DEFINED_ALWAYS && address < 0)
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", element->element_value, stmt->line);
+            return false;
+        }
+        assert(address >= 0);
+        *value = interp->memory->cells[address].value;
+    }
+    else // True, False: never proven operands
+    {
+        return get_element_value(interp, stmt, element, value);
+    }
+
+    return true;
+}
+
+//
+// execute_typed_expr
+//
+// Evaluates a binary expression whose operand types are known
+// (expr->types != EXPR_TYPES_UNKNOWN): the operands are read
+// without copying and handed straight to the operator for those
+// types. Returns true if successful and false if not.
+//
+static bool execute_typed_operator(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *expr, struct RAM_VALUE lhs, struct RAM_VALUE rhs, struct RAM_VALUE *result)
+{
+    switch (expr->types)
+    {
+    case EXPR_TYPES_INT_INT:
+        return execute_int_operator(interp, stmt, expr->operator, lhs.types.i, rhs.types.i, result);
+    case EXPR_TYPES_INT_REAL:
+        return execute_real_operator(interp, stmt, expr->operator, (double)lhs.types.i, rhs.types.d, result);
+    case EXPR_TYPES_REAL_INT:
+        return execute_real_operator(interp, stmt, expr->operator, lhs.types.d, (double)rhs.types.i, result);
+    case EXPR_TYPES_REAL_REAL:
+        return execute_real_operator(interp, stmt, expr->operator, lhs.types.d, rhs.types.d, result);
+    default: // EXPR_TYPES_STR_STR
+        return execute_str_operator(interp, stmt, expr->operator, lhs.types.s, rhs.types.s, result);
+    }
+}
+
+static bool execute_typed_expr(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *expr, struct RAM_VALUE *result)
+{
+    struct RAM_VALUE lhs, rhs;
+
+    if (!peek_element_value(interp, stmt, expr->lhs->element, &lhs) ||
+        !peek_element_value(interp, stmt, expr->rhs->element, &rhs))
+        return false;
+
+    return execute_typed_operator(interp, stmt, expr, lhs, rhs, result);
+}
+
+//
+// execute_steps
+//
+// Evaluates an expression lowered to steps (see VALUE_EXPR) on a
+// stack of values: each step pops the values of its nested
+// operands, the rhs from above the lhs, reads its other operand,
+// and pushes its value; the expression itself is the last step,
+// its value returned via the reference parameter. Each step
+// pushes at most one value, so the stack is on the C stack unless
+// there are more than EXPR_STACK_SIZE steps. Returns true if
+// successful and false if not, after releasing the values on the
+// stack.
+//
+static bool execute_steps(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *expr, struct RAM_VALUE *result)
+{
+    struct RAM_VALUE small[EXPR_STACK_SIZE];
+    struct RAM_VALUE *stack = small;
+    int depth = 0;
+    bool success = true;
+
+    if (expr->num_steps > EXPR_STACK_SIZE)
+    {
+        stack = (struct RAM_VALUE *)malloc(expr->num_steps * sizeof(struct RAM_VALUE));
+
+        if (stack == NULL)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: out of memory (line %d)\n", stmt->line);
+            return false;
+        }
+    }
+
+    for (int i = 0; i <= expr->num_steps; i++)
+    {
+        struct VALUE_EXPR *step = (i < expr->num_steps) ? &expr->steps[i] : expr;
+
+        bool nested_lhs = (step->lhs->expr_type == UNARY_NESTED);
+        bool nested_rhs = step->isBinaryExpr && step->rhs->expr_type == UNARY_NESTED;
+        bool typed = (step->types != EXPR_TYPES_UNKNOWN);
+
+        // popped values are released here, as are copies read
+        // from memory; peeked operands of typed steps are not:
+        struct RAM_VALUE lhs, rhs;
+        bool have_lhs = nested_lhs, have_rhs = nested_rhs;
+
+        if (nested_rhs)
+            rhs = stack[--depth];
+        if (nested_lhs)
+            lhs = stack[--depth];
+        else if (typed)
+            have_lhs = peek_element_value(interp, stmt, step->lhs->element, &lhs);
+        else
+            have_lhs = get_unary_value(interp, stmt, step->lhs, &lhs);
+
+        if (have_lhs && step->isBinaryExpr && !nested_rhs)
+        {
+            if (typed)
+                have_rhs = peek_element_value(interp, stmt, step->rhs->element, &rhs);
+            else
+                have_rhs = get_unary_value(interp, stmt, step->rhs, &rhs);
+        }
+
+        struct RAM_VALUE *value = (step == expr) ? result : &stack[depth];
+        success = have_lhs && (have_rhs || !step->isBinaryExpr);
+
+        if (success && !step->isBinaryExpr) // an operand of its own, moved:
+        {
+            *value = lhs;
+            have_lhs = false;
+        }
+        else if (success && typed)
+            success = execute_typed_operator(interp, stmt, step, lhs, rhs, value);
+        else if (success)
+            success = execute_operator(interp, stmt, step->operator, lhs, rhs, value);
+
+        if (have_lhs && (nested_lhs || !typed))
+            release_value(&lhs);
+        if (have_rhs && (nested_rhs || !typed))
+            release_value(&rhs);
+
+        if (!success)
+        {
+            while (depth > 0)
+                release_value(&stack[--depth]);
+            break;
+        }
+
+        if (step != expr)
+            depth++;
+    }
+
+    if (stack != small)
+        free(stack);
+
+    return success;
+}
+
+//
+// execute_binary_expr
+//
+// Given two values and an operator, performs the operation
+// and updates the value in the lhs (which can be updated
+// because a pointer to the value is passed in). Returns
+// true if successful and false if not.
+//
+
+static bool execute_binary_expr(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *binary, struct RAM_VALUE *result)
+{
+    // ensure the binary expression has a valid left-hand side and operator
+    assert(binary->lhs != NULL);
+    assert(binary->operator!= OPERATOR_NO_OP);
+    // initialize variables to store the left-hand side (lhs) and right-hand side (rhs) values
+    struct RAM_VALUE lhs_value, rhs_value;
+    // Retrieve left-hand side value
+    bool success = get_unary_value(interp, stmt, binary->lhs, &lhs_value);
+
+    if (!success)
+        return false;
+    // if the binary expression is not a unary operation, retrieve the value of the right-hand side
+    if (binary->isBinaryExpr)
+    {
+        assert(binary->rhs != NULL);
+        success = get_unary_value(interp, stmt, binary->rhs, &rhs_value);
+
+        if (!success)
+        {
+            release_value(&lhs_value);
+            return false;
+        }
+    }
+    success = execute_operator(interp, stmt, binary->operator, lhs_value, rhs_value, result);
+
+    // the operands were copies, the result (if a string) is new memory
+    release_value(&lhs_value);
+    release_value(&rhs_value);
+
+    return success;
+}
+
+//
+// assign_item
+//
+// Executes x[i] = value, where x must be a list and i an int
+// in range, negative indices counting from the end, or x is a
+// dictionary and i a key, which is added if it's new. x may be
+// a local of the running function. The value is copied into the
+// list or dictionary. Returns true if successful and false if
+// not (after outputting an error message).
+//
+static bool assign_item(struct Interpreter *interp, struct STMT *stmt, struct STMT_ASSIGNMENT *assign, struct RAM_VALUE value)
+{
+    struct RAM_VALUE *cell = NULL; // a copy read from memory, freed at the end
+    struct RAM_VALUE *container;
+
+    if (assign->slot >= 0)
+        container = &interp->frame[assign->slot];
+    else
+        container = cell = ram_read_cell_by_id(interp->memory, assign->var_name);
+
+    if (container == NULL || container->value_type == UNBOUND)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", assign->var_name, stmt->line);
+        return false;
+    }
+
+    struct RAM_VALUE index;
+    bool success = get_element_value(interp, stmt, assign->index, &index);
+
+    if (success && container->value_type == RAM_TYPE_DICT)
+    {
+        if (dict_hashable(index))
+            dict_set(container->types.m, index, value);
+        else
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+            success = false;
+        }
+
+        release_value(&index);
+        if (cell != NULL)
+            ram_free_value(cell);
+        return success;
+    }
+
+    if (success && (container->value_type != RAM_TYPE_LIST || index.value_type != RAM_TYPE_INT))
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        release_value(&index);
+        success = false;
+    }
+
+    if (success)
+    {
+        struct LIST *list = container->types.l;
+        int i = (index.types.i < 0) ? index.types.i + list->length : index.types.i;
+
+        if (i < 0 || i >= list->length)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: index out of range (line %d)\n", stmt->line);
+            success = false;
+        }
+        else
+            list_set(list, i, value);
+    }
+
+    if (cell != NULL)
+        ram_free_value(cell);
+
+    return success;
+}
+
+//
+// store_local
+//
+// Writes the value to the given slot of the running function's
+// frame, releasing the value there. The frame takes the value if
+// take is true; otherwise it stores its own copy, as memory does.
+//
+static void store_local(struct Interpreter *interp, int slot, struct RAM_VALUE value, bool take)
+{
+    struct RAM_VALUE *local = &interp->frame[slot];
+
+    // copy before releasing the old value, which may be the same
+    if (!take)
+        retain_value(&value);
+
+    release_value(local);
+    *local = value;
+}
+
+//
+// get_calls
+//
+// Returns the interpreter's call caches, creating them at the first
+// call; NULL if out of memory (after outputting an error message).
+//
+static struct CallCache *get_calls(struct Interpreter *interp, struct STMT *stmt)
+{
+    if (interp->calls == NULL)
+    {
+        interp->calls = callcache_create();
+        if (interp->calls == NULL)
+            fprintf(interp->output, "**EXECUTION ERROR: out of memory (line %d)\n", stmt->line);
+    }
+
+    return interp->calls;
+}
+
+//
+// resolve_call
+//
+// Returns the function called at a call site, given its name and the
+// ID stored there, after checking the number of parameters passed. A
+// name that wasn't registered when the graph was built, e.g. a native
+// registered since, is looked up in this interpreter's registry, once
+// per site (see callcache_builtin): the graph is shared, so the ID is
+// not stored there. Returns NULL if there's no such function or it
+// takes another number of parameters (after outputting an error
+// message).
+//
+static const struct BUILTIN *resolve_call(struct Interpreter *interp, struct STMT *stmt, const void *site, char *name, int builtin,
+                                          bool method, int num_params)
+{
+    if (builtin == BUILTIN_UNRESOLVED)
+    {
+        struct CallCache *calls = get_calls(interp, stmt);
+
+        if (calls == NULL)
+            return NULL;
+
+        builtin = callcache_builtin(calls, site, interp->builtins, name, method);
+    }
+
+    const struct BUILTIN *function = builtins_get(interp->builtins, builtin);
+
+    if (function == NULL)
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: Unknown function call: %s (line %d)\n", name, stmt->line);
+        return NULL;
+    }
+    if (num_params < function->min_params || num_params > function->max_params)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for %s() (line %d)\n", name, stmt->line);
+        return NULL;
+    }
+
+    return function;
+}
+
+//
+// execute_native
+//
+// Calls a native function registered by an embedder with the values
+// of the given parameters, as many as it takes, which must be of
+// types it accepts, and returns its result via the reference
+// parameter, owned by the caller. Returns true if successful and
+// false if not (after outputting an error message).
+//
+static bool execute_native(struct Interpreter *interp, struct STMT *stmt, const struct BUILTIN *function,
+                           struct ELEMENT **parameters, struct RAM_VALUE *result)
+{
+    struct RAM_VALUE args[2];
+    int num_args = 0;
+    bool success = true;
+
+    while (success && num_args < function->max_params)
+    {
+        if (!get_element_value(interp, stmt, parameters[num_args], &args[num_args]))
+        {
+            success = false;
+            break;
+        }
+
+        num_args++; // to be released
+
+        if ((BUILTIN_TYPE(args[num_args - 1].value_type) & function->param_types) == 0)
+        {
+            fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for %s() (line %d)\n", function->name, stmt->line);
+            success = false;
+        }
+    }
+
+    if (success)
+    {
+        result->value_type = RAM_TYPE_NONE;
+
+        if (!function->native(function->userdata, args, num_args, result))
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: %s() failed (line %d)\n", function->name, stmt->line);
+            success = false;
+        }
+        else if ((BUILTIN_TYPE(result->value_type) & function->result_types) == 0)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: %s() returned an invalid type (line %d)\n", function->name, stmt->line);
+            success = false;
+        }
+    }
+
+    for (int i = 0; i < num_args; i++)
+        release_value(&args[i]);
+
+    return success;
+}
+
+//
+// execute_numeric_builtin
+//
+// Calls sum(x), min(x), max(x), abs(x) or dot(x, y), returning
+// the result via the reference parameter. x and y must be lists
+// of numbers, reduced by the kernels in reduce.c, except that
+// abs() takes a number, and min() and max() also take a list of
+// strings. The number of parameters has been checked. Returns true
+// if successful and false if not (after outputting an error message).
+//
+static bool execute_numeric_builtin(struct Interpreter *interp, struct STMT *stmt, struct VALUE_FUNCTION_CALL *call, struct RAM_VALUE *value)
+{
+    char *name = call->function_name;
+    bool dot = (call->builtin == BUILTIN_DOT);
+    struct RAM_VALUE x, y;
+
+    if (!get_element_value(interp, stmt, call->parameters[0], &x))
+        return false;
+
+    y.value_type = RAM_TYPE_NONE; // nothing to release unless dot()
+
+    if (dot && !get_element_value(interp, stmt, call->parameters[1], &y))
+    {
+        release_value(&x);
+        return false;
+    }
+
+    bool success = true;
+
+    if (call->builtin == BUILTIN_ABS)
+    { // ints wrap around, so abs() of the smallest int is itself
+        if (x.value_type == RAM_TYPE_INT || x.value_type == RAM_TYPE_BOOLEAN)
+        {
+            value->value_type = RAM_TYPE_INT;
+            value->types.i = (x.types.i < 0) ? (int)(0u - (unsigned)x.types.i) : x.types.i;
+        }
+        else if (x.value_type == RAM_TYPE_REAL)
+        {
+            value->value_type = RAM_TYPE_REAL;
+            value->types.d = fabs(x.types.d);
+        }
+        else
+            success = false;
+    }
+    else if (x.value_type != RAM_TYPE_LIST || (dot && y.value_type != RAM_TYPE_LIST))
+    {
+        success = false;
+    }
+    else if (dot && x.types.l->length != y.types.l->length)
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: dot() args must be the same length (line %d)\n", stmt->line);
+        release_value(&x);
+        release_value(&y);
+        return false;
+    }
+    else if (dot)
+    {
+        success = reduce_dot(x.types.l, y.types.l, value);
+    }
+    else if (call->builtin == BUILTIN_SUM)
+    {
+        success = reduce_sum(x.types.l, value);
+    }
+    else if (x.types.l->length == 0) // min(), max()
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: %s() arg is an empty sequence (line %d)\n", name, stmt->line);
+        release_value(&x);
+        return false;
+    }
+    else
+    {
+        success = (call->builtin == BUILTIN_MIN) ? reduce_min(x.types.l, value) : reduce_max(x.types.l, value);
+    }
+
+    if (!success)
+        fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for %s() (line %d)\n", name, stmt->line);
+
+    release_value(&x);
+    release_value(&y);
+
+    return success;
+}
+
+//
+// execute_call
+//
+// Calls a function the program defines, given its def, with the
+// given parameters, which are read in the caller's frame, and
+// returns the call's result via the reference parameter, owned by
+// the caller: the value of the return that ended the call, else
+// None. The callee's locals are a new frame pushed on the call
+// stack, so a call allocates nothing once the stack exists, and
+// the values in the frame are released as it is popped. The body
+// run is the one the call site's cache holds for the types of the
+// arguments (see callcache.h), site being the call in the graph.
+// A return of a call runs that call in the same frame, so tail
+// recursion doesn't count towards MAX_DEPTH. Returns true if
+// successful and false if not (after outputting an error message).
+//
+static bool execute_call(struct Interpreter *interp, struct STMT *stmt, const void *site, struct STMT *function,
+                         int num_params, struct ELEMENT **parameters, struct RAM_VALUE *result)
+{
+    struct STMT_DEF *def = function->types.def;
+
+    if (num_params != def->num_params)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: %s() takes %d parameters but %d were given (line %d)\n",
+                def->function_name, def->num_params, num_params, stmt->line);
+        return false;
+    }
+    if (interp->depth == MAX_DEPTH || interp->stack_top + def->num_locals > STACK_VALUES)
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: maximum recursion depth exceeded (line %d)\n", stmt->line);
+        return false;
+    }
+    if (interp->stack == NULL)
+    {
+        interp->stack = (struct RAM_VALUE *)malloc(STACK_VALUES * sizeof(struct RAM_VALUE));
+        if (interp->stack == NULL)
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: out of memory (line %d)\n", stmt->line);
+            return false;
+        }
+    }
+    if (get_calls(interp, stmt) == NULL)
+        return false;
+    // the parameters go straight into the new frame; the rest of
+    // the locals are unbound until assigned
+    struct RAM_VALUE *frame = &interp->stack[interp->stack_top];
+
+    for (int i = 0; i < num_params; i++)
+    {
+        if (!get_element_value(interp, stmt, parameters[i], &frame[i]))
+        {
+            while (--i >= 0)
+                release_value(&frame[i]);
+            return false;
+        }
+    }
+    for (int i = num_params; i < def->num_locals; i++)
+        frame[i].value_type = UNBOUND;
+
+    struct RAM_VALUE *caller = interp->frame;
+
+    interp->frame = frame;
+    interp->stack_top += def->num_locals;
+    interp->depth++;
+
+    bool success;
+
+    for (;;)
+    {
+        success = execute(interp, callcache_body(interp->calls, site, function, frame, def->num_params));
+
+        if (!success || interp->tail_call == NULL)
+            break;
+        // a return of a call: its arguments were evaluated above the
+        // frame, and replace the locals of this call
+        struct VALUE_FUNCTION_CALL *call = interp->tail_call;
+
+        interp->tail_call = NULL;
+        interp->returning = false;
+        interp->calls->tail_calls++;
+
+        for (int i = 0; i < def->num_locals; i++)
+            release_value(&frame[i]);
+
+        site = call;
+        function = call->function;
+        def = function->types.def;
+
+        memmove(frame, &interp->stack[interp->stack_top], def->num_params * sizeof(struct RAM_VALUE));
+
+        for (int i = def->num_params; i < def->num_locals; i++)
+            frame[i].value_type = UNBOUND;
+
+        interp->stack_top = (int)(frame - interp->stack) + def->num_locals;
+    }
+
+    if (success && interp->returning)
+        *result = interp->result;
+    else
+        result->value_type = RAM_TYPE_NONE;
+
+    interp->returning = false;
+
+    for (int i = 0; i < def->num_locals; i++)
+        release_value(&frame[i]);
+
+    interp->depth--;
+    interp->stack_top = (int)(frame - interp->stack);
+    interp->frame = caller;
+
+    return success;
+}
+
+//
+// execute_value
+//
+// Evaluates the right-hand side of an assignment, or the value
+// of a return, returning it via the reference parameter, and via
+// owned whether it's the caller's to release once stored; a line
+// read by input() belongs to the reader. Returns true if
+// successful and false if not (after outputting an error message).
+//
+// Examples: 123
+//           x ** 2
+//           input('Enter a value> ')
+//           [1, 2, 3]
+//           {'a': 1, 'b': x}
+//           len(x)
+//           fib(n)
+//
+// Lines for input() are read via the interpreter's reader.
+//
+static bool execute_value(struct Interpreter *interp, struct STMT *stmt, struct VALUE *rhs, struct RAM_VALUE *value, bool *owned)
+{
+    // ensure right-hand side (rhs) is a valid value
+    assert(rhs->value_type == VALUE_EXPR || rhs->value_type == VALUE_FUNCTION_CALL ||
+           rhs->value_type == VALUE_LIST || rhs->value_type == VALUE_DICT);
+    // input() lines belong to the reader
+    *owned = (rhs->value_type != VALUE_FUNCTION_CALL);
+    // process the right-hand side based on its type (expression or function call)
+    if (rhs->value_type == VALUE_EXPR)
+    {
+        struct VALUE_EXPR *expr = rhs->types.expr;
+        // evaluate the unary or binary expression into 'value'
+        bool success = execute_expr(interp, stmt, expr, value);
+
+        if (!success)
+            return false;
+    }
+    else if (rhs->value_type == VALUE_LIST)
+    { // build a new list from the elements, in order
+        struct VALUE_LIST *items = rhs->types.list;
+
+        value->value_type = RAM_TYPE_LIST;
+        value->types.l = list_create();
+
+        for (int i = 0; i < items->num_elements; i++)
+        {
+            struct RAM_VALUE item;
+
+            if (!get_element_value(interp, stmt, items->elements[i], &item))
+            {
+                release_value(value);
+                return false;
+            }
+            list_append(value->types.l, item);
+            release_value(&item);
+        }
+    }
+    else if (rhs->value_type == VALUE_DICT)
+    { // build a new dictionary from the entries, in order
+        struct VALUE_DICT *entries = rhs->types.dict;
+
+        value->value_type = RAM_TYPE_DICT;
+        value->types.m = dict_create();
+
+        for (int i = 0; i < entries->num_entries; i++)
+        {
+            struct RAM_VALUE key, item;
+
+            if (!get_element_value(interp, stmt, entries->keys[i], &key))
+            {
+                release_value(value);
+                return false;
+            }
+            if (!dict_hashable(key))
+            {
+                fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+                release_value(&key);
+                release_value(value);
+                return false;
+            }
+            if (!get_element_value(interp, stmt, entries->values[i], &item))
+            {
+                release_value(&key);
+                release_value(value);
+                return false;
+            }
+            dict_set(value->types.m, key, item);
+            release_value(&key);
+            release_value(&item);
+        }
+    }
+    else if (rhs->value_type == VALUE_FUNCTION_CALL)
+    {
+        struct VALUE_FUNCTION_CALL *func_call = rhs->types.function_call;
+        // a function the program defines
+        if (func_call->function != NULL)
+        {
+            *owned = true;
+            return execute_call(interp, stmt, func_call, func_call->function, func_call->num_parameters,
+                                func_call->parameters, value);
+        }
+        // else look up the function, checking the number of parameters
+        const struct BUILTIN *function = resolve_call(interp, stmt, func_call, func_call->function_name, func_call->builtin, false,
+                                                      func_call->num_parameters);
+
+        if (function == NULL)
+            return false;
+        // handle the input() function
+        if (func_call->builtin == BUILTIN_INPUT)
+        { // the prompt must be a string literal
+            if (func_call->parameters[0]->element_type != ELEMENT_STR_LITERAL)
+            {
+                fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for input() (line %d)\n", stmt->line);
+                return false;
+            }
+            fprintf(interp->output, "%s", func_call->parameters[0]->element_value);
+            fflush(interp->output); // make sure the prompt is visible before we block
+
+            char *line = linereader_readline(interp->reader); // EOL chars already removed
+            if (line == NULL)
+            {
+                fprintf(interp->output, "**EXECUTION ERROR: EOF when reading a line (line %d)\n", stmt->line);
+                return false;
+            }
+            // the line is owned by the reader; RAM makes its own copy when the value is written
+            value->value_type = RAM_TYPE_STR;
+            value->types.s = line;
+        }
+        // Handle int() logic
+        else if (func_call->builtin == BUILTIN_INT)
+        {
+            struct ELEMENT *param = func_call->parameters[0];
+            // ensure function call has a valid parameter of type identifier
+            if (param != NULL && param->element_type == ELEMENT_IDENTIFIER)
+            {
+                struct RAM_VALUE param_value;
+                bool success = get_element_value(interp, stmt, param, &param_value); // retrieve the value associated with the identifier
 
                 if (!success || param_value.value_type != RAM_TYPE_STR)
                 {
-                    printf("**SEMANTIC ERROR: Invalid parameter for int() (line %d)\n", stmt->line);
+                    fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for int() (line %d)\n", stmt->line);
                     return false;
                 }
-                int int_value = atoi(param_value.types.s); // Convert the string value to an integer
-                // check for invalid string representation of an integer
-                if (int_value == 0 && param_value.types.s[0] != '0')
+                int int_value;
+                // convert the string value to an integer, rejecting invalid strings
+                bool valid = str_to_int(param_value.types.s, &int_value);
+                release_value(&param_value);
+                if (!valid)
                 {
-                    printf("**SEMANTIC ERROR: invalid string for int() (line %d)\n", stmt->line);
+                    fprintf(interp->output, "**SEMANTIC ERROR: invalid string for int() (line %d)\n", stmt->line);
                     return false;
                 }
                 // Successfully converted to int? assign it to 'value'
-                value.value_type = RAM_TYPE_INT;
-                value.types.i = int_value;
+                value->value_type = RAM_TYPE_INT;
+                value->types.i = int_value;
             }
             else
             {
-                printf("**SEMANTIC ERROR: Invalid parameter for int() (line %d)\n", stmt->line);
+                fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for int() (line %d)\n", stmt->line);
                 return false;
             }
         }
         // Handle float() logic
-        else if (strcmp(func_call->function_name, "float") == 0)
+        else if (func_call->builtin == BUILTIN_FLOAT)
         {
-            struct ELEMENT *param = func_call->parameter;
+            struct ELEMENT *param = func_call->parameters[0];
             // ensure function call has a valid parameter of type identifier
             if (param != NULL && param->element_type == ELEMENT_IDENTIFIER)
             {
                 struct RAM_VALUE param_value;
-                bool success = get_element_value(stmt, memory, param, &param_value); // retrieve the value associated with the identifier
+                bool success = get_element_value(interp, stmt, param, &param_value); // retrieve the value associated with the identifier
+
+                if (!success || param_value.value_type != RAM_TYPE_STR)
+                {
+                    fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for float() (line %d)\n", stmt->line);
+                    return false;
+                }
+                double float_value;
+                // convert the string value to a float, rejecting invalid strings
+                bool valid = str_to_real(param_value.types.s, &float_value);
+                release_value(&param_value);
+                if (!valid)
+                {
+                    fprintf(interp->output, "**SEMANTIC ERROR: invalid string for float() (line %d)\n", stmt->line);
+                    return false;
+                }
+                // Successfully converted to float? assign it to 'value'
+                value->value_type = RAM_TYPE_REAL;
+                value->types.d = float_value;
+            }
+            else
+            {
+                fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for float() (line %d)\n", stmt->line);
+                return false;
+            }
+        }
+        // Handle len() logic, for lists, dictionaries and strings
+        else if (func_call->builtin == BUILTIN_LEN)
+        {
+            struct ELEMENT *param = func_call->parameters[0];
+            struct RAM_VALUE param_value;
+
+            if (param == NULL)
+            {
+                fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for len() (line %d)\n", stmt->line);
+                return false;
+            }
+            if (!get_element_value(interp, stmt, param, &param_value))
+                return false;
+
+            value->value_type = RAM_TYPE_INT;
+
+            if (param_value.value_type == RAM_TYPE_LIST)
+                value->types.i = param_value.types.l->length;
+            else if (param_value.value_type == RAM_TYPE_DICT)
+                value->types.i = param_value.types.m->length;
+            else if (param_value.value_type == RAM_TYPE_STR)
+                value->types.i = (int)strlen(param_value.types.s);
+            else
+            {
+                fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for len() (line %d)\n", stmt->line);
+                release_value(&param_value);
+                return false;
+            }
+            release_value(&param_value);
+        }
+        // Handle sum(), min(), max(), abs() and dot()
+        else if (func_call->builtin == BUILTIN_SUM || func_call->builtin == BUILTIN_MIN || func_call->builtin == BUILTIN_MAX ||
+                 func_call->builtin == BUILTIN_ABS || func_call->builtin == BUILTIN_DOT)
+        {
+            if (!execute_numeric_builtin(interp, stmt, func_call, value))
+                return false;
+            *owned = true; // e.g. the copy of a string from min()
+        }
+        // Handle a native function registered by an embedder
+        else if (function->native != NULL)
+        {
+            if (!execute_native(interp, stmt, function, func_call->parameters, value))
+                return false;
+            *owned = true;
+        }
+        else
+        {
+            fprintf(interp->output, "**EXECUTION ERROR: Unknown function call: %s (line %d)\n", func_call->function_name, stmt->line);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// execute_tail_call
+//
+// Executes a return of a call of a function the program defines,
+// e.g. return f(n - 1, acc): the call's arguments are evaluated
+// onto the stack above the running call's frame, and left for
+// execute_call to run the call in that frame once the statements
+// executing have stopped. Returns true if successful and false if
+// not (after outputting an error message).
+//
+static bool execute_tail_call(struct Interpreter *interp, struct STMT *stmt, struct VALUE_FUNCTION_CALL *call)
+{
+    struct STMT_DEF *def = call->function->types.def;
+
+    if (call->num_parameters != def->num_params)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: %s() takes %d parameters but %d were given (line %d)\n",
+                def->function_name, def->num_params, call->num_parameters, stmt->line);
+        return false;
+    }
+    if (interp->stack_top + def->num_locals > STACK_VALUES)
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: maximum recursion depth exceeded (line %d)\n", stmt->line);
+        return false;
+    }
+
+    struct RAM_VALUE *args = &interp->stack[interp->stack_top];
 
-                if (!success || param_value.value_type != RAM_TYPE_STR)
-                {
-                    printf("**SEMANTIC ERROR: Invalid parameter for float() (line %d)\n", stmt->line);
-                    return false;
-                }
-                double float_value = atof(param_value.types.s); // Convert the string value to a float
-                // check for invalid string representation of a float
-                if (float_value == 0.0 && param_value.types.s[0] != '0')
-                {
-                    printf("**SEMANTIC ERROR: invalid string for float() (line %d)\n", stmt->line);
-                    return false;
-                }
-                // Successfully converted to float? assign it to 'value'
-                value.value_type = RAM_TYPE_REAL;
-                value.types.d = float_value;
-            }
-            else
-            {
-                printf("**SEMANTIC ERROR: Invalid parameter for float() (line %d)\n", stmt->line);
-                return false;
-            }
-        }
-        else
+    for (int i = 0; i < call->num_parameters; i++)
+    {
+        if (!get_element_value(interp, stmt, call->parameters[i], &args[i]))
         {
-            printf("**EXECUTION ERROR: Unknown function call: %s (line %d)\n", func_call->function_name, stmt->line);
+            while (--i >= 0)
+                release_value(&args[i]);
             return false;
         }
     }
-    struct RAM_VALUE ram_value;
-    ram_value = value;
-    bool success = ram_write_cell_by_id(memory, ram_value, var_name); // write the computed value to the specified variable in the RAM
+
+    interp->tail_call = call;
+    interp->returning = true;
+
+    return true;
+}
+
+//
+// execute_return
+//
+// Executes a return statement, in the body of a function: the
+// value returned, None if there is none, is kept as the result
+// of the running call, and the statements executing stop as they
+// see interp->returning set. Returns true if successful and false
+// if not (after outputting an error message).
+//
+static bool execute_return(struct Interpreter *interp, struct STMT *stmt)
+{
+    struct VALUE *value = stmt->types.return_stmt->value;
+    bool owned = true;
+
+    if (value != NULL && value->value_type == VALUE_FUNCTION_CALL && value->types.function_call->function != NULL)
+        return execute_tail_call(interp, stmt, value->types.function_call);
+
+    if (value == NULL)
+        interp->result.value_type = RAM_TYPE_NONE;
+    else if (!execute_value(interp, stmt, value, &interp->result, &owned))
+        return false;
+
+    if (!owned) // e.g. a line read by input()
+        retain_value(&interp->result);
+
+    interp->returning = true;
+
+    return true;
+}
+
+//
+// execute_assignment
+//
+// Executes an assignment statement, returning true if
+// successful and false if not (an error message will be
+// output before false is returned, so the caller doesn't
+// need to output anything).
+//
+// Examples: x = 123
+//           y = x ** 2
+//           s = input('Enter a value> ')
+//           x[0] = y
+//           n = fib(x)
+//
+// The variable assigned may be a local of the running function,
+// stored in its frame, or else is in memory.
+//
+
+static bool execute_assignment(struct Interpreter *interp, struct STMT *stmt)
+{ // extract assignment details of assignment
+    struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+    char *var_name = assign->var_name;
+    // validate assignment does not involve pointer dereferencing
+    assert(assign->isPtrDeref == false);
+    // compute the value of the right-hand side
+    struct RAM_VALUE value;
+    bool owned;
+
+    if (!execute_value(interp, stmt, assign->rhs, &value, &owned))
+        return false;
+
+    bool success;
+
+    if (assign->index != NULL)
+    { // x[i] = value: replace an item of the list x
+        success = assign_item(interp, stmt, assign, value);
+    }
+    else if (assign->slot >= 0)
+    { // a local: the frame takes the value if it's ours
+        store_local(interp, assign->slot, value, owned);
+        return true;
+    }
+    else
+    {
+        struct RAM_VALUE ram_value;
+        ram_value = value;
+        success = ram_write_cell_by_id(interp->memory, ram_value, var_name); // write the computed value to the specified variable in the RAM
+    }
+    // RAM (or the list) stored its own copy
+    if (owned)
+        release_value(&value);
 
     return success;
 }
 
+//
+// execute_method_call
+//
+// Executes a call of a method on an object, which so far is
+// x.append(value) on a list x, returning true if successful
+// and false if not (after outputting an error message). The
+// method and the number of parameters have been checked.
+//
+static bool execute_method_call(struct Interpreter *interp, struct STMT *stmt)
+{
+    struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+    struct RAM_VALUE object, value;
+
+    if (!get_element_value(interp, stmt, call->object, &object))
+        return false;
+
+    if (object.value_type != RAM_TYPE_LIST)
+    {
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        release_value(&object);
+        return false;
+    }
+    if (!get_element_value(interp, stmt, call->parameters[0], &value))
+    {
+        release_value(&object);
+        return false;
+    }
+
+    list_append(object.types.l, value);
+
+    release_value(&value);
+    release_value(&object);
+
+    return true;
+}
+
 //
 // execute_function_call
 //
@@ -775,21 +2180,52 @@ static bool execute_assignment(struct STMT *stmt, struct RAM *memory)
 // Examples: print()
 //           print(x)
 //           print(123)
+//           x.append(123)
+//           f(x, 2)
 //
-static bool execute_function_call(struct STMT *stmt, struct RAM *memory)
+static bool execute_function_call(struct Interpreter *interp, struct STMT *stmt)
 {
     struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
 
-    //
-    // for now we are assuming it's a call to print:
-    //
-    char *function_name = call->function_name;
+    if (call->function != NULL) // a function the program defines, whose result isn't used:
+    {
+        struct RAM_VALUE result;
+
+        if (!execute_call(interp, stmt, call, call->function, call->num_parameters, call->parameters, &result))
+            return false;
+
+        release_value(&result);
+        return true;
+    }
+
+    const struct BUILTIN *function = resolve_call(interp, stmt, call, call->function_name, call->builtin, call->object != NULL,
+                                                  call->num_parameters);
+    if (function == NULL)
+        return false;
+
+    if (call->builtin == BUILTIN_APPEND)
+        return execute_method_call(interp, stmt);
+
+    if (function->native != NULL) // its result isn't used:
+    {
+        struct RAM_VALUE result;
+
+        if (!execute_native(interp, stmt, function, call->parameters, &result))
+            return false;
 
-    assert(strcmp(function_name, "print") == 0);
+        release_value(&result);
+        return true;
+    }
+
+    if (call->builtin != BUILTIN_PRINT) // e.g. len(x), which only has a result
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: Unknown function call: %s (line %d)\n", call->function_name, stmt->line);
+        return false;
+    }
 
-    if (call->parameter == NULL)
+    if (call->num_parameters == 0)
     {
-        printf("\n");
+        fprintf(interp->output, "\n");
     }
     else
     {
@@ -798,27 +2234,28 @@ static bool execute_function_call(struct STMT *stmt, struct RAM *memory)
         // Note that a parameter is a simple element, i.e.
         // identifier or literal (or True, False, None):
         //
-        char *element_value = call->parameter->element_value;
+        struct ELEMENT *parameter = call->parameters[0];
+        char *element_value = parameter->element_value;
 
-        if (call->parameter->element_type == ELEMENT_STR_LITERAL)
+        if (parameter->element_type == ELEMENT_STR_LITERAL)
         {
-            printf("%s\n", element_value);
+            fprintf(interp->output, "%s\n", element_value);
         }
-        else if (call->parameter->element_type == ELEMENT_INT_LITERAL)
+        else if (parameter->element_type == ELEMENT_INT_LITERAL)
         {
-            printf("%d\n", atoi(element_value));
+            fprintf(interp->output, "%d\n", atoi(element_value));
         }
-        else if (call->parameter->element_type == ELEMENT_REAL_LITERAL)
+        else if (parameter->element_type == ELEMENT_REAL_LITERAL)
         {
-            printf("%lf\n", atof(element_value));
+            fprintf(interp->output, "%lf\n", atof(element_value));
         }
-        else if (call->parameter->element_type == ELEMENT_TRUE)
+        else if (parameter->element_type == ELEMENT_TRUE)
         {
-            printf("%s\n", element_value);
+            fprintf(interp->output, "%s\n", element_value);
         }
-        else if (call->parameter->element_type == ELEMENT_FALSE)
+        else if (parameter->element_type == ELEMENT_FALSE)
         {
-            printf("%s\n", element_value);
+            fprintf(interp->output, "%s\n", element_value);
         }
         else
         {
@@ -828,30 +2265,41 @@ static bool execute_function_call(struct STMT *stmt, struct RAM *memory)
             // integer value:
             struct RAM_VALUE value;
 
-            bool success = get_element_value(stmt, memory, call->parameter, &value);
+            bool success = get_element_value(interp, stmt, parameter, &value);
 
             if (!success)
                 return false;
 
             if (value.value_type == RAM_TYPE_BOOLEAN)
             {
-                printf("%s\n", value.types.i ? "True" : "False");
+                fprintf(interp->output, "%s\n", value.types.i ? "True" : "False");
             }
             else
             {
                 switch (value.value_type)
                 {
                 case RAM_TYPE_INT:
-                    printf("%d\n", value.types.i);
+                    fprintf(interp->output, "%d\n", value.types.i);
                     break;
                 case RAM_TYPE_REAL:
-                    printf("%lf\n", value.types.d);
+                    fprintf(interp->output, "%lf\n", value.types.d);
                     break;
                 case RAM_TYPE_STR:
-                    printf("%s\n", value.types.s);
+                    fprintf(interp->output, "%s\n", value.types.s);
+                    release_value(&value);
+                    break;
+                case RAM_TYPE_LIST:
+                    list_print(interp->output, value.types.l);
+                    fprintf(interp->output, "\n");
+                    release_value(&value);
+                    break;
+                case RAM_TYPE_DICT:
+                    dict_print(interp->output, value.types.m);
+                    fprintf(interp->output, "\n");
+                    release_value(&value);
                     break;
                 default:
-                    printf("**ERROR: Unsupported data type in print statement\n");
+                    fprintf(interp->output, "**ERROR: Unsupported data type in print statement\n");
                     return false;
                 }
             }
@@ -861,71 +2309,261 @@ static bool execute_function_call(struct STMT *stmt, struct RAM *memory)
     return true;
 }
 
+// execute_for_loop
+//
+// Given a for loop over range(start, stop, step), evaluates the start, stop and step once, which
+// must be ints with a step other than 0, and then executes the loop body once per value in the
+// range. The values are counted on a native counter, with no list and no expression evaluated
+// per iteration; each is written to the loop variable's cell in memory, which is looked up once,
+// or to its slot in the frame if it's a local. A return in the body ends the loop.
+
+static bool execute_for_loop(struct Interpreter *interp, struct STMT *stmt)
+{
+    struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+    struct ELEMENT *elements[3] = {loop->start, loop->stop, loop->step};
+    struct RAM_VALUE range[3];
+    // evaluate the start, stop and step, in that order
+    for (int i = 0; i < 3; i++)
+    {
+        if (!get_element_value(interp, stmt, elements[i], &range[i]))
+            return false;
+        if (range[i].value_type != RAM_TYPE_INT)
+        {
+            release_value(&range[i]);
+            fprintf(interp->output, "**SEMANTIC ERROR: Invalid parameter for range() (line %d)\n", stmt->line);
+            return false;
+        }
+    }
+    if (range[2].types.i == 0)
+    {
+        fprintf(interp->output, "**EXECUTION ERROR: range() arg 3 must not be zero (line %d)\n", stmt->line);
+        return false;
+    }
+    // count in a wider type, so stepping past the stop can't overflow
+    long long stop = range[1].types.i;
+    long long step = range[2].types.i;
+    long long i = range[0].types.i;
+    int address = -1;
+    // a loop doing arithmetic on ints and reals may be run on native values (see loopkernel.h),
+    // except in a function, whose locals aren't in memory; if that stops partway through an
+    // iteration, the rest of it runs here, from resume
+    if (interp->frame == NULL && ((step > 0) ? i < stop : i > stop))
+    {
+        struct STMT *resume = loop->loop_body;
+        int counter = range[0].types.i;
+        if (loopkernel_run_for(interp, stmt, &counter, range[1].types.i, range[2].types.i, &resume))
+            return true;
+        i = counter;
+        if (resume != loop->loop_body)
+        {
+            if (!execute(interp, resume))
+                return false;
+            i += step;
+        }
+    }
+    for (; (step > 0) ? i < stop : i > stop; i += step)
+    {
+        struct RAM_VALUE value;
+        value.value_type = RAM_TYPE_INT;
+        value.types.i = (int)i;
+        // the variable may not exist until the first write
+        if (loop->slot >= 0)
+        {
+            store_local(interp, loop->slot, value, true);
+        }
+        else if (address < 0)
+        {
+            ram_write_cell_by_id(interp->memory, value, loop->var_name);
+            address = ram_get_addr(interp->memory, loop->var_name);
+        }
+        else
+        {
+            ram_write_cell_by_addr(interp->memory, value, address);
+        }
+        if (!execute(interp, loop->loop_body))
+            return false;
+        if (interp->returning)
+            break;
+    }
+    return true;
+}
+
+//
+// execute_condition
+//
+// Decides a loop's or if's condition, returning whether it holds
+// via truth: an and or an or evaluates its rhs only if its lhs
+// doesn't decide it, and a comparison of two proven ints is made
+// on the C ints, so no boolean value is made along the way.
+// Returns true if successful and false if not; an expression
+// that isn't a boolean fails without a message, as it always has.
+//
+static bool execute_condition(struct Interpreter *interp, struct STMT *stmt, struct CONDITION *condition, bool *truth)
+{
+    if (condition->condition_type == CONDITION_AND || condition->condition_type == CONDITION_OR)
+    {
+        if (!execute_condition(interp, stmt, condition->lhs, truth))
+            return false;
+        // an and is decided by a false lhs, an or by a true one
+        if (*truth == (condition->condition_type == CONDITION_OR))
+            return true;
+        return execute_condition(interp, stmt, condition->rhs, truth);
+    }
+    if (condition->condition_type == CONDITION_NOT)
+    {
+        if (!execute_condition(interp, stmt, condition->lhs, truth))
+            return false;
+        *truth = !*truth;
+        return true;
+    }
+
+    struct VALUE_EXPR *expr = condition->expr;
+
+    if (expr->isBinaryExpr && expr->types == EXPR_TYPES_INT_INT && expr->num_steps == 0 &&
+        expr->operator >= OPERATOR_EQUAL && expr->operator <= OPERATOR_GTE)
+    {
+        struct RAM_VALUE lhs, rhs;
+
+        if (!peek_element_value(interp, stmt, expr->lhs->element, &lhs) ||
+            !peek_element_value(interp, stmt, expr->rhs->element, &rhs))
+            return false;
+
+        switch (expr->operator)
+        {
+        case OPERATOR_EQUAL:
+            *truth = (lhs.types.i == rhs.types.i);
+            break;
+        case OPERATOR_NOT_EQUAL:
+            *truth = (lhs.types.i != rhs.types.i);
+            break;
+        case OPERATOR_LT:
+            *truth = (lhs.types.i < rhs.types.i);
+            break;
+        case OPERATOR_LTE:
+            *truth = (lhs.types.i <= rhs.types.i);
+            break;
+        case OPERATOR_GT:
+            *truth = (lhs.types.i > rhs.types.i);
+            break;
+        default: // OPERATOR_GTE
+            *truth = (lhs.types.i >= rhs.types.i);
+            break;
+        }
+        return true;
+    }
+
+    struct RAM_VALUE value;
+
+    if (!execute_expr(interp, stmt, expr, &value))
+        return false;
+    if (value.value_type != RAM_TYPE_BOOLEAN)
+    {
+        release_value(&value);
+        return false;
+    }
+    *truth = (value.types.i != 0);
+    return true;
+}
+
 // execute_while_loop
 //
-// Given a while loop statement, this function evaluates the condition expression and iteratively executes
+// Given a while loop statement, this function evaluates the condition and iteratively executes
 // the statements within the loop body as long as the condition remains true. It handles assignments, function
-// calls, and nested while loops. The function returns true if the loop is executed successfully.
+// calls, nested while and for loops, and returns, which end the loop. The function returns true if the loop
+// is executed successfully.
 
-static bool execute_while_loop(struct STMT *stmt, struct RAM *memory)
-{ // retrieve the condition expression and loop body from the while loop statement
-    struct VALUE_EXPR *condition_expr = stmt->types.while_loop->condition;
+static bool execute_while_loop(struct Interpreter *interp, struct STMT *stmt)
+{ // retrieve the condition and loop body from the while loop statement
+    struct CONDITION *condition = stmt->types.while_loop->condition;
+    struct STMT *preheader = stmt->types.while_loop->preheader;
     struct STMT *loop_body = stmt->types.while_loop->loop_body;
     // save the next_stmt pointer before entering the loop
     struct STMT *next_stmt = stmt->types.while_loop->next_stmt;
     // evaluate the condition only once before entering the loop
-    struct RAM_VALUE condition_value;
-    bool success = execute_binary_expr(stmt, memory, condition_expr, &condition_value);
+    bool truth;
+    bool success = execute_condition(interp, stmt, condition, &truth);
     // check for errors in the condition evaluation
-    if (!success || condition_value.value_type != RAM_TYPE_BOOLEAN)
-    {
+    if (!success)
         return false;
+    // statements hoisted out of the body (see optimizer_licm) run
+    // once, if the loop is entered
+    if (truth && preheader != NULL)
+    {
+        if (!execute(interp, preheader))
+            return false;
+    }
+    // a counting loop may be run without iterating (see induction.h),
+    // except in a function, whose locals aren't in memory
+    bool top_level = (interp->frame == NULL);
+    if (top_level && truth && induction_run(interp, stmt))
+    {
+        return true;
+    }
+    // as may a loop doing arithmetic on ints and reals, on native
+    // values (see loopkernel.h); if that stops partway through an
+    // iteration, the rest of it runs here, from resume
+    struct STMT *resume = loop_body;
+    if (top_level && truth && loopkernel_run(interp, stmt, &resume))
+    {
+        return true;
     }
     // enter the while loop based on the evaluated condition
-    while (condition_value.types.i != 0)
+    while (truth)
     { // execute the statements within the while loop body
-        struct STMT *current_stmt = loop_body;
-        // iterate over each statement in the while loop body
-        while (current_stmt != NULL && current_stmt != next_stmt)
+        struct STMT *current_stmt = resume;
+        resume = loop_body;
+        // iterate over each statement in the while loop body, until a return
+        while (current_stmt != NULL && current_stmt != next_stmt && !interp->returning)
         {
             if (current_stmt->stmt_type == STMT_ASSIGNMENT)
             { // execute an assignment statement and move to the next statement
-                success = execute_assignment(current_stmt, memory);
+                success = execute_assignment(interp, current_stmt);
                 if (!success)
                     return false;
                 current_stmt = current_stmt->types.assignment->next_stmt;
             }
             else if (current_stmt->stmt_type == STMT_FUNCTION_CALL)
             { // execute a function call statement and move to the next statement
-                success = execute_function_call(current_stmt, memory);
+                success = execute_function_call(interp, current_stmt);
                 if (!success)
                     return false;
                 current_stmt = current_stmt->types.function_call->next_stmt;
             }
             else if (current_stmt->stmt_type == STMT_WHILE_LOOP)
             { // recursively execute a nested while loop and move to the next statement
-                success = execute_while_loop(current_stmt, memory);
+                success = execute_while_loop(interp, current_stmt);
                 if (!success)
                     return false;
                 current_stmt = current_stmt->types.while_loop->next_stmt;
             }
+            else if (current_stmt->stmt_type == STMT_FOR_LOOP)
+            { // execute a nested for loop and move to the next statement
+                success = execute_for_loop(interp, current_stmt);
+                if (!success)
+                    return false;
+                current_stmt = current_stmt->types.for_loop->next_stmt;
+            }
+            else if (current_stmt->stmt_type == STMT_RETURN)
+            { // execute a return, which ends the loop
+                success = execute_return(interp, current_stmt);
+                if (!success)
+                    return false;
+            }
             else
             { // Assertion: Unknown statement type (should be STMT_PASS)
                 assert(current_stmt->stmt_type == STMT_PASS);
                 current_stmt = current_stmt->types.pass->next_stmt;
             }
         }
+        if (interp->returning)
+            return true;
         // evaluate the condition again at the end of each iteration
-        success = execute_binary_expr(stmt, memory, condition_expr, &condition_value);
+        success = execute_condition(interp, stmt, condition, &truth);
 
         // check for errors in the condition evaluation
-        if (!success || condition_value.value_type != RAM_TYPE_BOOLEAN)
-        {
+        if (!success)
             return false;
-        }
     }
-    // restore the next_stmt pointer after exiting the loop
-    stmt->types.while_loop->next_stmt = next_stmt;
     // the loop executed successfully
     return true;
 }
@@ -934,53 +2572,208 @@ static bool execute_while_loop(struct STMT *stmt, struct RAM *memory)
 // Public functions:
 //
 
+//
+// execute_operator
+//
+// Applies a binary operator to two values, promoting an int
+// to a real if the other value is real, and returns the
+// result via the reference parameter. Returns true if
+// successful, false if not (after outputting an error).
+// The values are not freed.
+//
+
+bool execute_operator(struct Interpreter *interp, struct STMT *stmt, int operator, struct RAM_VALUE lhs_value, struct RAM_VALUE rhs_value, struct RAM_VALUE *result)
+{
+    bool success;
+
+    // perform type conversion if one operand is real and the other is integer
+    if ((lhs_value.value_type == RAM_TYPE_REAL && rhs_value.value_type == RAM_TYPE_INT) || (lhs_value.value_type == RAM_TYPE_INT && rhs_value.value_type == RAM_TYPE_REAL))
+    { // convert left-hand side to real if needed
+        if (lhs_value.value_type != RAM_TYPE_REAL)
+        {
+            lhs_value.value_type = RAM_TYPE_REAL;
+            lhs_value.types.d = (double)lhs_value.types.i;
+        }
+        // convert the right-hand side to real if needed
+        if (rhs_value.value_type != RAM_TYPE_REAL)
+        {
+            rhs_value.value_type = RAM_TYPE_REAL;
+            rhs_value.types.d = (double)rhs_value.types.i;
+        }
+    }
+    //
+    // perform specified binary operation based on the operator
+    //
+    switch (operator)
+    {
+    case OPERATOR_PLUS:
+        success = handle_addition(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_MINUS:
+        success = handle_subtraction(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_ASTERISK:
+        success = handle_multiplication(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_POWER:
+        success = handle_power(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_DIV:
+        success = handle_division(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_MOD:
+        success = handle_modulus(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_EQUAL:
+        success = handle_equal(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_NOT_EQUAL:
+        success = handle_not_equal(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_LT:
+        success = handle_less_than(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_LTE:
+        success = handle_less_than_or_equal(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_GT:
+        success = handle_greater_than(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_GTE:
+        success = handle_greater_than_or_equal(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    case OPERATOR_IN:
+        success = handle_in(interp, stmt, lhs_value, rhs_value, result);
+        break;
+    default:
+        //
+        // did we miss something? return semantic error for invalid operator
+        // return false
+        fprintf(interp->output, "**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+        success = false;
+    }
+
+    return success;
+}
+
+//
+// execute_expr
+//
+// Evaluates an expression, which is either a unary expression,
+// a binary one or one lowered to steps, returning its value via
+// the reference parameter. Returns true if successful and false
+// if not.
+//
+
+bool execute_expr(struct Interpreter *interp, struct STMT *stmt, struct VALUE_EXPR *expr, struct RAM_VALUE *result)
+{
+    assert(expr->lhs != NULL);
+
+    if (expr->num_steps > 0)
+        return execute_steps(interp, stmt, expr, result);
+
+    if (!expr->isBinaryExpr)
+        return get_unary_value(interp, stmt, expr->lhs, result);
+
+    if (expr->types != EXPR_TYPES_UNKNOWN)
+        return execute_typed_expr(interp, stmt, expr, result);
+
+    return execute_binary_expr(interp, stmt, expr, result);
+}
+
+//
+// execute_statement
+//
+// Executes just the given assignment or function call, not the
+// statements after it, returning true if successful and false
+// if not (after outputting an error message).
+//
+
+bool execute_statement(struct Interpreter *interp, struct STMT *stmt)
+{
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+        return execute_assignment(interp, stmt);
+
+    assert(stmt->stmt_type == STMT_FUNCTION_CALL);
+
+    return execute_function_call(interp, stmt);
+}
+
 //
 // execute
 //
-// Given a nuPython program graph and a memory,
-// executes the statements in the program graph.
+// Given a nuPython program graph, executes the
+// statements in the program graph using the
+// interpreter's memory. input() reads lines from
+// the interpreter's input stream, and all output
+// goes to the interpreter's output stream.
 // If a semantic error occurs (e.g. type error),
 // an error message is output, execution stops,
-// and the function returns.
+// and false is returned. Returns true if the
+// program ran to completion.
 //
 
-void execute(struct STMT *program, struct RAM *memory)
+bool execute(struct Interpreter *interp, struct STMT *program)
 {
     struct STMT *stmt = program;
+    bool success = true;
 
     //
-    // traverse through the program statements:
+    // traverse through the program statements, until a return
+    // from the running function:
     //
-    while (stmt != NULL)
+    while (stmt != NULL && !interp->returning)
     {
 
         if (stmt->stmt_type == STMT_ASSIGNMENT)
         {
 
-            bool success = execute_assignment(stmt, memory);
+            success = execute_assignment(interp, stmt);
 
             if (!success)
-                return;
+                break;
 
             stmt = stmt->types.assignment->next_stmt; // advance
         }
         else if (stmt->stmt_type == STMT_FUNCTION_CALL)
         {
 
-            bool success = execute_function_call(stmt, memory);
+            success = execute_function_call(interp, stmt);
 
             if (!success)
-                return;
+                break;
 
             stmt = stmt->types.function_call->next_stmt;
         }
         else if (stmt->stmt_type == STMT_WHILE_LOOP)
         {
-            bool success = execute_while_loop(stmt, memory);
+            success = execute_while_loop(interp, stmt);
             if (!success)
-                return;
+                break;
             stmt = stmt->types.while_loop->next_stmt;
         }
+        else if (stmt->stmt_type == STMT_FOR_LOOP)
+        {
+            success = execute_for_loop(interp, stmt);
+            if (!success)
+                break;
+            stmt = stmt->types.for_loop->next_stmt;
+        }
+        else if (stmt->stmt_type == STMT_DEF)
+        {
+            //
+            // nothing to do: calls are bound to the function
+            // when the program graph is built
+            //
+            stmt = stmt->types.def->next_stmt;
+        }
+        else if (stmt->stmt_type == STMT_RETURN)
+        {
+            success = execute_return(interp, stmt);
+            if (!success)
+                break;
+            stmt = stmt->types.return_stmt->next_stmt;
+        }
         else
         {
             assert(stmt->stmt_type == STMT_PASS);
@@ -996,5 +2789,5 @@ void execute(struct STMT *program, struct RAM *memory)
     //
     // done:
     //
-    return;
+    return success;
 }
\ No newline at end of file
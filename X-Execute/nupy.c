@@ -0,0 +1,365 @@
+/*nupy.c*/
+
+//
+// libnupy: an API for embedding nuPython in another program.
+// The interpreter's streams are custom stdio streams whose reads
+// and writes call the embedder's callbacks, so the parser and
+// executor are used unchanged.
+//
+
+// fopencookie() is a GNU extension, fmemopen() is POSIX:
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <assert.h>
+#include <sys/types.h> // ssize_t
+
+#include "parser.h"
+#include "programgraph.h"
+#include "optimizer.h"
+#include "ram.h"
+#include "execute.h"
+#include "interpreter.h"
+#include "builtins.h"
+#include "callcache.h"
+#include "util.h"
+#include "nupy.h"
+
+struct NuPy
+{
+  struct Interpreter *interp;
+
+  nupy_output_fn output; // NULL => stdout
+  nupy_input_fn input;   // NULL => always at end of input
+  void *userdata;
+
+  FILE *out; // streams calling the callbacks above
+  FILE *in;
+};
+
+struct NuPyProgram
+{
+  struct STMT *graph;
+};
+
+//
+// Private functions:
+//
+
+//
+// cookie_write, cookie_read
+//
+// The stdio callbacks for the custom streams; they pass the
+// data through to the embedder's callbacks.
+//
+static ssize_t cookie_write(void *cookie, const char *buf, size_t size)
+{
+  struct NuPy *nupy = (struct NuPy *)cookie;
+
+  nupy->output(nupy->userdata, buf, size);
+
+  return size;
+}
+
+static ssize_t cookie_read(void *cookie, char *buf, size_t size)
+{
+  struct NuPy *nupy = (struct NuPy *)cookie;
+
+  if (nupy->input == NULL)
+    return 0;
+
+  return nupy->input(nupy->userdata, buf, size);
+}
+
+//
+// lookup
+//
+// Returns the memory cell value of the named variable, or
+// NULL if it is not defined.
+//
+static struct RAM_VALUE *lookup(struct RAM *memory, const char *name)
+{
+  assert(memory != NULL);
+  assert(name != NULL);
+
+  int address = ram_get_addr(memory, (char *)name);
+
+  if (address < 0)
+    return NULL;
+
+  return &memory->cells[address].value;
+}
+
+//
+// Public functions:
+//
+
+//
+// nupy_create
+//
+// Returns a new interpreter with an empty memory, sending
+// output to the given callback and reading input() from the
+// given callback. Returns NULL if out of memory.
+//
+struct NuPy *nupy_create(nupy_output_fn output, nupy_input_fn input, void *userdata)
+{
+  struct NuPy *nupy = (struct NuPy *)malloc(sizeof(struct NuPy));
+  if (nupy == NULL)
+    return NULL;
+
+  nupy->output = output;
+  nupy->input = input;
+  nupy->userdata = userdata;
+
+  cookie_io_functions_t in_functions = {cookie_read, NULL, NULL, NULL};
+  cookie_io_functions_t out_functions = {NULL, cookie_write, NULL, NULL};
+
+  nupy->in = fopencookie(nupy, "r", in_functions);
+  nupy->out = (output == NULL) ? stdout : fopencookie(nupy, "w", out_functions);
+
+  if (nupy->in == NULL || nupy->out == NULL)
+  {
+    if (nupy->in != NULL)
+      fclose(nupy->in);
+    if (nupy->out != NULL && nupy->out != stdout)
+      fclose(nupy->out);
+
+    free(nupy);
+    return NULL;
+  }
+
+  nupy->interp = interpreter_create(nupy->in, nupy->out);
+  if (nupy->interp == NULL)
+  {
+    fclose(nupy->in);
+    if (nupy->out != stdout)
+      fclose(nupy->out);
+
+    free(nupy);
+    return NULL;
+  }
+
+  return nupy;
+}
+
+//
+// nupy_destroy
+//
+// Frees the interpreter, including its memory.
+//
+void nupy_destroy(struct NuPy *nupy)
+{
+  if (nupy == NULL)
+    return;
+
+  interpreter_destroy(nupy->interp);
+
+  fclose(nupy->in);
+  if (nupy->out == stdout)
+    fflush(stdout);
+  else
+    fclose(nupy->out); // flushes any remaining output
+
+  free(nupy);
+}
+
+//
+// nupy_register
+//
+// Registers a native C function that programs can call.
+//
+bool nupy_register(struct NuPy *nupy, const char *name, int num_params, int param_types, int result_types,
+                   builtin_native_fn native, void *userdata)
+{
+  assert(nupy != NULL);
+
+  return builtins_register(nupy->interp->builtins, name, num_params, param_types, result_types, native, userdata) !=
+         BUILTIN_UNRESOLVED;
+}
+
+//
+// nupy_compile
+//
+// Compiles the given buffer of nuPython source code. Returns
+// the program, or NULL if the program has a syntax error.
+//
+struct NuPyProgram *nupy_compile(struct NuPy *nupy, const char *source, size_t length)
+{
+  assert(nupy != NULL);
+  assert(source != NULL);
+
+  //
+  // fmemopen() cannot open an empty buffer, so an empty
+  // program is given as a single blank line:
+  //
+  FILE *input = (length > 0) ? fmemopen((void *)source, length, "r")
+                             : fmemopen("\n", 1, "r");
+  if (input == NULL)
+  {
+    fprintf(nupy->out, "**NUPY ERROR: unable to open source buffer\n");
+    fflush(nupy->out);
+    return NULL;
+  }
+
+  struct TokenQueue *tokens = parser_parse(nupy->interp, input);
+
+  fclose(input);
+
+  struct STMT *graph = NULL;
+
+  if (tokens != NULL)
+  {
+    // the graph has its own copies of the names and values:
+    graph = programgraph_build(nupy->interp, tokens);
+
+    tokenqueue_destroy(tokens);
+
+    //
+    // the program may run in a memory the caller has filled in,
+    // so no assumptions about the types of its variables:
+    //
+    if (graph != NULL)
+      optimizer_run(nupy->interp, graph, false, false, NULL);
+  }
+
+  fflush(nupy->out);
+
+  if (graph == NULL)
+    return NULL;
+
+  struct NuPyProgram *program = (struct NuPyProgram *)malloc(sizeof(struct NuPyProgram));
+  if (program == NULL)
+  {
+    programgraph_destroy(graph);
+    return NULL;
+  }
+
+  program->graph = graph;
+
+  return program;
+}
+
+//
+// nupy_program_destroy
+//
+// Frees a program returned by nupy_compile.
+//
+void nupy_program_destroy(struct NuPyProgram *program)
+{
+  if (program == NULL)
+    return;
+
+  programgraph_destroy(program->graph);
+  free(program);
+}
+
+//
+// nupy_execute
+//
+// Executes the program with the given memory, or with the
+// interpreter's own memory if memory is NULL. Returns true
+// if the program ran to completion, false if not.
+//
+bool nupy_execute(struct NuPy *nupy, struct NuPyProgram *program, struct RAM *memory)
+{
+  assert(nupy != NULL);
+  assert(program != NULL);
+
+  struct RAM *own = nupy->interp->memory;
+
+  if (memory != NULL)
+    nupy->interp->memory = memory;
+
+  bool success = execute(nupy->interp, program->graph);
+
+  nupy->interp->memory = own;
+
+  //
+  // the call caches refer to the program, which may be freed
+  // before the next is run:
+  //
+  callcache_destroy(nupy->interp->calls);
+  nupy->interp->calls = NULL;
+
+  fflush(nupy->out);
+
+  return success;
+}
+
+//
+// nupy_memory
+//
+// Returns the interpreter's own memory.
+//
+struct RAM *nupy_memory(struct NuPy *nupy)
+{
+  assert(nupy != NULL);
+
+  return nupy->interp->memory;
+}
+
+//
+// nupy_get_type
+//
+// Returns the RAM_TYPE_... of the named variable, or -1
+// if it is not defined.
+//
+int nupy_get_type(struct RAM *memory, const char *name)
+{
+  struct RAM_VALUE *cell = lookup(memory, name);
+
+  return (cell == NULL) ? -1 : cell->value_type;
+}
+
+//
+// nupy_get_int, nupy_get_real, nupy_get_bool, nupy_get_str
+//
+// If the named variable is defined and has the requested
+// type, stores its value in *value and returns true.
+// Otherwise returns false.
+//
+bool nupy_get_int(struct RAM *memory, const char *name, int *value)
+{
+  struct RAM_VALUE *cell = lookup(memory, name);
+
+  if (cell == NULL || cell->value_type != RAM_TYPE_INT)
+    return false;
+
+  *value = cell->types.i;
+  return true;
+}
+
+bool nupy_get_real(struct RAM *memory, const char *name, double *value)
+{
+  struct RAM_VALUE *cell = lookup(memory, name);
+
+  if (cell == NULL || cell->value_type != RAM_TYPE_REAL)
+    return false;
+
+  *value = cell->types.d;
+  return true;
+}
+
+bool nupy_get_bool(struct RAM *memory, const char *name, bool *value)
+{
+  struct RAM_VALUE *cell = lookup(memory, name);
+
+  if (cell == NULL || cell->value_type != RAM_TYPE_BOOLEAN)
+    return false;
+
+  *value = (cell->types.i != 0);
+  return true;
+}
+
+bool nupy_get_str(struct RAM *memory, const char *name, char **value)
+{
+  struct RAM_VALUE *cell = lookup(memory, name);
+
+  if (cell == NULL || cell->value_type != RAM_TYPE_STR)
+    return false;
+
+  *value = dupString(cell->types.s);
+  return true;
+}
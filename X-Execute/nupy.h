@@ -0,0 +1,154 @@
+/*nupy.h*/
+
+//
+// libnupy: an API for embedding nuPython in another program.
+// Programs are compiled from a memory buffer and executed
+// in-process; print() output and input() lines go through
+// callbacks instead of stdout / stdin, and the values of
+// variables are read back through typed getters.
+//
+// Usage:
+//
+//   struct NuPy *nupy = nupy_create(my_output, NULL, my_data);
+//   struct NuPyProgram *program = nupy_compile(nupy, src, strlen(src));
+//
+//   if (program != NULL && nupy_execute(nupy, program, NULL))
+//   {
+//     int x;
+//     if (nupy_get_int(nupy_memory(nupy), "x", &x))
+//       ...
+//   }
+//
+//   nupy_program_destroy(program);
+//   nupy_destroy(nupy);
+//
+// A NuPy instance must only be used by one thread at a time,
+// but independent instances can run on different threads.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+#include <stddef.h>  // size_t
+
+#include "ram.h"
+#include "builtins.h"
+
+struct NuPy;        // opaque
+struct NuPyProgram; // opaque
+
+//
+// Output callback: called with the next len characters of
+// output (not NUL-terminated), which includes both print()
+// output and syntax / execution error messages.
+//
+typedef void (*nupy_output_fn)(void *userdata, const char *text, size_t len);
+
+//
+// Input callback: fills buf with at most size characters of
+// input for input() and returns the number of characters
+// stored, or 0 at end of input. Characters do not have to be
+// returned a line at a time.
+//
+typedef size_t (*nupy_input_fn)(void *userdata, char *buf, size_t size);
+
+//
+// Public functions:
+//
+
+//
+// nupy_create
+//
+// Returns a new interpreter with an empty memory, sending
+// output to the given callback and reading input() from the
+// given callback; userdata is passed to both. If output is
+// NULL, output goes to stdout; if input is NULL, input() is
+// always at end of input. Returns NULL if out of memory.
+//
+struct NuPy *nupy_create(nupy_output_fn output, nupy_input_fn input, void *userdata);
+
+//
+// nupy_destroy
+//
+// Frees the interpreter, including its memory. Programs
+// compiled by the interpreter remain valid.
+//
+void nupy_destroy(struct NuPy *nupy);
+
+//
+// nupy_register
+//
+// Registers a native C function that programs run by the
+// interpreter can call by name, e.g. y = scale(x), with
+// num_params parameters (0, 1 or 2), each of one of the
+// param_types, a mask such as BUILTIN_TYPE(RAM_TYPE_INT) |
+// BUILTIN_TYPE(RAM_TYPE_REAL) (see builtins.h), returning one
+// of the result_types: ints, reals, booleans, strings or None.
+// The function is called with userdata; see builtin_native_fn.
+// Returns false if the name is taken, e.g. by a builtin, or the
+// types are invalid.
+//
+// Register natives before compiling the programs that call
+// them; a program must run in an interpreter with the same
+// natives, registered in the same order.
+//
+bool nupy_register(struct NuPy *nupy, const char *name, int num_params, int param_types, int result_types,
+                   builtin_native_fn native, void *userdata);
+
+//
+// nupy_compile
+//
+// Compiles the length characters of nuPython source code in
+// the given buffer, which does not have to be NUL-terminated.
+// Returns the program, or NULL if the program has a syntax
+// error; in this case the error was sent to the output.
+//
+struct NuPyProgram *nupy_compile(struct NuPy *nupy, const char *source, size_t length);
+
+//
+// nupy_program_destroy
+//
+// Frees a program returned by nupy_compile. NULL is ignored.
+//
+void nupy_program_destroy(struct NuPyProgram *program);
+
+//
+// nupy_execute
+//
+// Executes the program with the given memory, or with the
+// interpreter's own memory if memory is NULL. Returns true
+// if the program ran to completion, false if an execution
+// error occurred; in this case the error was sent to the
+// output. The memory keeps the values of the variables so
+// they can be read back, and can be reused by later runs.
+//
+bool nupy_execute(struct NuPy *nupy, struct NuPyProgram *program, struct RAM *memory);
+
+//
+// nupy_memory
+//
+// Returns the interpreter's own memory.
+//
+struct RAM *nupy_memory(struct NuPy *nupy);
+
+//
+// nupy_get_type
+//
+// Returns the type of the named variable, one of the
+// RAM_TYPE_... values in ram.h, or -1 if it is not defined.
+//
+int nupy_get_type(struct RAM *memory, const char *name);
+
+//
+// nupy_get_int, nupy_get_real, nupy_get_bool, nupy_get_str
+//
+// If the named variable is defined and has the requested
+// type, stores its value in *value and returns true.
+// Otherwise returns false and *value is unchanged. The
+// string returned by nupy_get_str is a copy that the
+// caller must free.
+//
+bool nupy_get_int(struct RAM *memory, const char *name, int *value);
+bool nupy_get_real(struct RAM *memory, const char *name, double *value);
+bool nupy_get_bool(struct RAM *memory, const char *name, bool *value);
+bool nupy_get_str(struct RAM *memory, const char *name, char **value);
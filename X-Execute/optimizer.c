@@ -0,0 +1,1721 @@
+/*optimizer.c*/
+
+//
+// Optimization passes over a nuPython program graph; see
+// optimizer.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+
+#include "optimizer.h"
+#include "execute.h"
+#include "util.h"
+#include "builtins.h"
+
+//
+// Types of values a variable may hold, as a bit mask of the
+// RAM types (1 << RAM_TYPE_...), plus MASK_UNDEF if it may not
+// have been assigned yet:
+//
+#define MASK_INT (1 << RAM_TYPE_INT)
+#define MASK_REAL (1 << RAM_TYPE_REAL)
+#define MASK_STR (1 << RAM_TYPE_STR)
+#define MASK_PTR (1 << RAM_TYPE_PTR)
+#define MASK_BOOLEAN (1 << RAM_TYPE_BOOLEAN)
+#define MASK_NONE (1 << RAM_TYPE_NONE)
+#define MASK_LIST (1 << RAM_TYPE_LIST)
+#define MASK_DICT (1 << RAM_TYPE_DICT)
+#define MASK_ANY (MASK_INT | MASK_REAL | MASK_STR | MASK_PTR | MASK_BOOLEAN | MASK_NONE | MASK_LIST | MASK_DICT)
+#define MASK_UNDEF (1 << 8)
+
+//
+// expr->types and element->defined while optimizer_types is
+// running, for expressions and reads not reached yet:
+//
+#define TYPES_UNVISITED -1
+#define DEFINED_UNVISITED -1
+
+//
+// The variables of a program, numbered 0..num_vars-1 so that
+// a mask per variable is just an array:
+//
+struct Vars
+{
+  int num_vars;
+  int capacity;
+  char **names; // owned by the graph
+  int *table;   // hash table of indices into names, -1 => empty
+  int table_size;
+};
+
+//
+// Private functions:
+//
+
+//
+// vars_index
+//
+// Returns the index of the given variable, adding it if it's
+// not there yet. Returns -1 if out of memory.
+//
+static int vars_index(struct Vars *vars, char *name)
+{
+  if (2 * (vars->num_vars + 1) > vars->table_size)
+  {
+    int table_size = (vars->table_size == 0) ? 64 : 2 * vars->table_size;
+    int *table = (int *)malloc(table_size * sizeof(int));
+    char **names = (char **)realloc(vars->names, (table_size / 2) * sizeof(char *));
+
+    if (table == NULL || names == NULL)
+    {
+      free(table);
+      if (names != NULL)
+        vars->names = names;
+      return -1;
+    }
+
+    for (int i = 0; i < table_size; i++)
+      table[i] = -1;
+
+    for (int v = 0; v < vars->num_vars; v++)
+    {
+      size_t h = hashBytes(HASH_START, names[v], strlen(names[v])) & (table_size - 1);
+
+      while (table[h] >= 0)
+        h = (h + 1) & (table_size - 1);
+      table[h] = v;
+    }
+
+    free(vars->table);
+    vars->table = table;
+    vars->table_size = table_size;
+    vars->names = names;
+    vars->capacity = table_size / 2;
+  }
+
+  size_t h = hashBytes(HASH_START, name, strlen(name)) & (vars->table_size - 1);
+
+  while (vars->table[h] >= 0)
+  {
+    if (strcmp(vars->names[vars->table[h]], name) == 0)
+      return vars->table[h];
+    h = (h + 1) & (vars->table_size - 1);
+  }
+
+  vars->table[h] = vars->num_vars;
+  vars->names[vars->num_vars] = name;
+
+  return vars->num_vars++;
+}
+
+static void vars_free(struct Vars *vars)
+{
+  free(vars->names);
+  free(vars->table);
+}
+
+//
+// stmt_expr
+//
+// Returns the expression the assignment or return evaluates, if
+// any.
+//
+static struct VALUE_EXPR *stmt_expr(struct STMT *stmt)
+{
+  if (stmt->stmt_type == STMT_ASSIGNMENT)
+  {
+    struct VALUE *rhs = stmt->types.assignment->rhs;
+
+    return (rhs->value_type == VALUE_EXPR) ? rhs->types.expr : NULL;
+  }
+  else if (stmt->stmt_type == STMT_RETURN)
+  {
+    struct VALUE *value = stmt->types.return_stmt->value;
+
+    return (value != NULL && value->value_type == VALUE_EXPR) ? value->types.expr : NULL;
+  }
+  else
+    return NULL;
+}
+
+//
+// stmt_condition
+//
+// Returns the condition of the loop or if, else NULL.
+//
+static struct CONDITION *stmt_condition(struct STMT *stmt)
+{
+  if (stmt->stmt_type == STMT_WHILE_LOOP)
+    return stmt->types.while_loop->condition;
+  else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    return stmt->types.if_then_else->condition;
+  else
+    return NULL;
+}
+
+//
+// stmt_exprs
+//
+// Calls visit(context, stmt, expr) for every expression the
+// statement evaluates: stmt_expr's, or each expression in its
+// condition, each step of an expression (see VALUE_EXPR) before
+// the expression itself.
+//
+typedef void (*VISIT_EXPR)(void *context, struct STMT *stmt, struct VALUE_EXPR *expr);
+
+static void expr_steps(struct STMT *stmt, struct VALUE_EXPR *expr, VISIT_EXPR visit, void *context)
+{
+  for (int i = 0; i < expr->num_steps; i++)
+    visit(context, stmt, &expr->steps[i]);
+
+  visit(context, stmt, expr);
+}
+
+static void condition_exprs(struct STMT *stmt, struct CONDITION *condition, VISIT_EXPR visit, void *context)
+{
+  if (condition == NULL)
+    return;
+
+  if (condition->expr != NULL)
+    expr_steps(stmt, condition->expr, visit, context);
+
+  condition_exprs(stmt, condition->lhs, visit, context);
+  condition_exprs(stmt, condition->rhs, visit, context);
+}
+
+static void stmt_exprs(struct STMT *stmt, VISIT_EXPR visit, void *context)
+{
+  struct VALUE_EXPR *expr = stmt_expr(stmt);
+
+  if (expr != NULL)
+    expr_steps(stmt, expr, visit, context);
+  else
+    condition_exprs(stmt, stmt_condition(stmt), visit, context);
+}
+
+//
+// stmt_reads
+//
+// Calls visit(context, element) for every variable the statement
+// reads: the elements of its expressions and their subscripts, a
+// function's parameters and object, the items of a list or the keys
+// and values of a dictionary, the index of an item assigned, and
+// the range of a for loop; the same for the value of a return.
+//
+typedef void (*VISIT_READ)(void *context, struct ELEMENT *read);
+
+static void element_reads(struct ELEMENT *element, VISIT_READ visit, void *context)
+{
+  if (element != NULL && element->element_type == ELEMENT_IDENTIFIER)
+    visit(context, element);
+}
+
+static void unary_reads(struct UNARY_EXPR *unary, VISIT_READ visit, void *context)
+{
+  if (unary == NULL)
+    return;
+
+  if (unary->expr_type == UNARY_ELEMENT || unary->expr_type == UNARY_INDEX || unary->expr_type == UNARY_SLICE)
+    element_reads(unary->element, visit, context);
+
+  element_reads(unary->index, visit, context);
+  element_reads(unary->end, visit, context);
+}
+
+static void value_reads(struct VALUE *value, VISIT_READ visit, void *context)
+{
+  if (value == NULL)
+    return;
+
+  if (value->value_type == VALUE_FUNCTION_CALL)
+    for (int i = 0; i < value->types.function_call->num_parameters; i++)
+      element_reads(value->types.function_call->parameters[i], visit, context);
+  else if (value->value_type == VALUE_LIST)
+    for (int i = 0; i < value->types.list->num_elements; i++)
+      element_reads(value->types.list->elements[i], visit, context);
+  else if (value->value_type == VALUE_DICT)
+    for (int i = 0; i < value->types.dict->num_entries; i++)
+    {
+      element_reads(value->types.dict->keys[i], visit, context);
+      element_reads(value->types.dict->values[i], visit, context);
+    }
+}
+
+struct ExprReads
+{
+  VISIT_READ visit;
+  void *context;
+};
+
+static void expr_reads(void *context, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  struct ExprReads *reads = (struct ExprReads *)context;
+
+  unary_reads(expr->lhs, reads->visit, reads->context);
+  unary_reads(expr->rhs, reads->visit, reads->context);
+}
+
+static void stmt_reads(struct STMT *stmt, VISIT_READ visit, void *context)
+{
+  struct ExprReads reads = {visit, context};
+
+  stmt_exprs(stmt, expr_reads, &reads);
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT)
+  {
+    value_reads(stmt->types.assignment->rhs, visit, context);
+    element_reads(stmt->types.assignment->index, visit, context);
+  }
+  else if (stmt->stmt_type == STMT_RETURN)
+  {
+    value_reads(stmt->types.return_stmt->value, visit, context);
+  }
+  else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+  {
+    element_reads(stmt->types.function_call->object, visit, context);
+
+    for (int i = 0; i < stmt->types.function_call->num_parameters; i++)
+      element_reads(stmt->types.function_call->parameters[i], visit, context);
+  }
+  else if (stmt->stmt_type == STMT_FOR_LOOP)
+  {
+    element_reads(stmt->types.for_loop->start, visit, context);
+    element_reads(stmt->types.for_loop->stop, visit, context);
+    element_reads(stmt->types.for_loop->step, visit, context);
+  }
+}
+
+//
+// walk_stmts
+//
+// Calls visit(context, stmt) for every statement, in program
+// order, including the statements in loop preheaders and bodies,
+// but not the bodies of functions, whose locals are not the
+// program's variables (see STMT_DEF), and which are left as they
+// are. Stops and returns false as soon as visit does.
+//
+static bool walk_stmts(struct STMT *stmt, bool (*visit)(void *context, struct STMT *stmt), void *context)
+{
+  while (stmt != NULL)
+  {
+    if (!visit(context, stmt))
+      return false;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      stmt = stmt->types.assignment->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      stmt = stmt->types.function_call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      if (!walk_stmts(stmt->types.while_loop->preheader, visit, context))
+        return false;
+
+      if (!walk_stmts(stmt->types.while_loop->loop_body, visit, context))
+        return false;
+
+      stmt = stmt->types.while_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      if (!walk_stmts(stmt->types.for_loop->loop_body, visit, context))
+        return false;
+
+      stmt = stmt->types.for_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    {
+      if (!walk_stmts(stmt->types.if_then_else->true_path, visit, context))
+        return false;
+
+      stmt = stmt->types.if_then_else->false_path;
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      stmt = stmt->types.def->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+
+  return true;
+}
+
+//
+// collect_vars
+//
+// walk_stmts visitor numbering the variables assigned or read.
+//
+struct Collect
+{
+  struct Vars *vars;
+  bool success;
+};
+
+static void collect_read(void *context, struct ELEMENT *read)
+{
+  struct Collect *collect = (struct Collect *)context;
+
+  if (vars_index(collect->vars, read->element_value) < 0)
+    collect->success = false;
+}
+
+static bool collect_vars(void *context, struct STMT *stmt)
+{
+  struct Vars *vars = (struct Vars *)context;
+  struct Collect collect = {vars, true};
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT && vars_index(vars, stmt->types.assignment->var_name) < 0)
+    return false;
+
+  if (stmt->stmt_type == STMT_FOR_LOOP && vars_index(vars, stmt->types.for_loop->var_name) < 0)
+    return false;
+
+  stmt_reads(stmt, collect_read, &collect);
+
+  return collect.success;
+}
+
+//
+// unary_mask
+//
+// Returns the types the unary expression may evaluate to, given
+// the masks of the variables; for a variable, MASK_UNDEF says it
+// may not be defined. A nested operand has the types of its step.
+//
+static int expr_mask(struct Vars *vars, int *masks, struct VALUE_EXPR *expr);
+
+static int unary_mask(struct Vars *vars, int *masks, struct UNARY_EXPR *unary)
+{
+  if (unary->expr_type == UNARY_NESTED)
+    return expr_mask(vars, masks, unary->expr);
+
+  if (unary->expr_type != UNARY_ELEMENT)
+    return MASK_ANY;
+
+  switch (unary->element->element_type)
+  {
+  case ELEMENT_IDENTIFIER:
+    return masks[vars_index(vars, unary->element->element_value)];
+  case ELEMENT_INT_LITERAL:
+    return MASK_INT;
+  case ELEMENT_REAL_LITERAL:
+    return MASK_REAL;
+  case ELEMENT_STR_LITERAL:
+    return MASK_STR;
+  case ELEMENT_TRUE:
+  case ELEMENT_FALSE:
+    return MASK_BOOLEAN;
+  case ELEMENT_NONE:
+    return MASK_NONE;
+  default:
+    return MASK_ANY;
+  }
+}
+
+//
+// expr_mask
+//
+// Returns the types the expression may evaluate to, following
+// execute_operator: int and real operands are promoted to real,
+// and only + applies to strings.
+//
+static int expr_mask(struct Vars *vars, int *masks, struct VALUE_EXPR *expr)
+{
+  int lhs = unary_mask(vars, masks, expr->lhs) & MASK_ANY;
+
+  if (!expr->isBinaryExpr)
+    return lhs;
+
+  int rhs = unary_mask(vars, masks, expr->rhs) & MASK_ANY;
+
+  if (expr->operator >= OPERATOR_EQUAL)
+    return MASK_BOOLEAN;
+
+  int mask = 0;
+
+  if ((lhs & MASK_INT) && (rhs & MASK_INT))
+    mask |= MASK_INT;
+  if (((lhs & MASK_REAL) && (rhs & (MASK_INT | MASK_REAL))) || ((lhs & MASK_INT) && (rhs & MASK_REAL)))
+    mask |= MASK_REAL;
+  if (expr->operator == OPERATOR_PLUS && (lhs & MASK_STR) && (rhs & MASK_STR))
+    mask |= MASK_STR;
+
+  return mask;
+}
+
+//
+// assign
+//
+// Updates the masks for the assignment statement: the variable
+// now holds the type(s) of the rhs, or, for *p = ..., any
+// variable may now hold any type. Assigning an item of a list,
+// x[i] = ..., leaves x a list or dictionary. If strong, the variable's old
+// types are replaced, otherwise added to. Returns true if a mask
+// grew.
+//
+static bool assign(struct Vars *vars, int *masks, struct STMT_ASSIGNMENT *assignment, bool strong)
+{
+  bool grew = false;
+
+  if (assignment->isPtrDeref)
+  {
+    for (int v = 0; v < vars->num_vars; v++)
+    {
+      grew = grew || (masks[v] | MASK_ANY) != masks[v];
+      masks[v] |= MASK_ANY;
+    }
+
+    return grew;
+  }
+
+  if (assignment->index != NULL)
+    return false;
+
+  int mask;
+  struct VALUE *rhs = assignment->rhs;
+
+  if (rhs->value_type == VALUE_EXPR)
+    mask = expr_mask(vars, masks, rhs->types.expr);
+  else if (rhs->value_type == VALUE_LIST)
+    mask = MASK_LIST;
+  else if (rhs->value_type == VALUE_DICT)
+    mask = MASK_DICT;
+  else
+  { // the builtin's result types; natives may be registered differently when run,
+    // and a function the program defines may return any type
+    const struct BUILTIN *function = builtins_get(NULL, rhs->types.function_call->builtin);
+
+    mask = (function == NULL || rhs->types.function_call->function != NULL) ? MASK_ANY : function->result_types;
+  }
+
+  int v = vars_index(vars, assignment->var_name);
+
+  grew = (mask & ~masks[v]) != 0;
+  masks[v] = strong ? mask : (masks[v] | mask);
+
+  return grew;
+}
+
+//
+// is_literal
+//
+static bool is_literal(struct UNARY_EXPR *unary)
+{
+  if (unary->expr_type != UNARY_ELEMENT)
+    return false;
+
+  int type = unary->element->element_type;
+
+  return type == ELEMENT_INT_LITERAL || type == ELEMENT_REAL_LITERAL || type == ELEMENT_STR_LITERAL || type == ELEMENT_TRUE || type == ELEMENT_FALSE;
+}
+
+//
+// is_int_literal
+//
+// Is the unary expression the int literal with the given value?
+//
+static bool is_int_literal(struct UNARY_EXPR *unary, int value)
+{
+  return unary->expr_type == UNARY_ELEMENT && unary->element->element_type == ELEMENT_INT_LITERAL && atoi(unary->element->element_value) == value;
+}
+
+//
+// free_unary
+//
+static void free_unary(struct UNARY_EXPR *unary)
+{
+  free(unary->element->element_value);
+  free(unary->element);
+  free(unary);
+}
+
+//
+// make_unary
+//
+// Turns the binary expression into the unary expression keep,
+// which is its lhs or rhs; the other operand is freed.
+//
+static void make_unary(struct VALUE_EXPR *expr, struct UNARY_EXPR *keep)
+{
+  free_unary((keep == expr->lhs) ? expr->rhs : expr->lhs);
+
+  expr->lhs = keep;
+  expr->isBinaryExpr = false;
+  expr->operator = OPERATOR_NO_OP;
+  expr->types = EXPR_TYPES_UNKNOWN;
+  expr->rhs = NULL;
+}
+
+//
+// inline_steps
+//
+// After the steps of an expression have been folded or
+// simplified, which is in postfix order, a step that is now just
+// an element is put back into the operand that's its value, so
+// the folding and identities chain, e.g. 60 * 60 * 24, and
+// x * 1 * 1. The rhs goes first, since a variable read for the lhs
+// must stay a step of its own while the rhs is nested, to be read
+// before it (see VALUE_EXPR). The steps put back are then dropped
+// from the outermost expression, which has none left if all were.
+//
+static bool is_element_step(struct UNARY_EXPR *unary)
+{
+  return unary != NULL && unary->expr_type == UNARY_NESTED && !unary->expr->isBinaryExpr &&
+         unary->expr->lhs->expr_type == UNARY_ELEMENT;
+}
+
+static void inline_step(struct UNARY_EXPR **operand)
+{
+  struct VALUE_EXPR *step = (*operand)->expr;
+
+  free(*operand);
+
+  *operand = step->lhs;
+  step->lhs = NULL; // dropped by drop_steps
+}
+
+static int live_steps(struct VALUE_EXPR *expr, int n)
+{
+  int live = 0;
+
+  for (int i = 0; i < n; i++)
+    live += (expr->steps[i].lhs != NULL);
+
+  return live;
+}
+
+static void renumber_step(struct VALUE_EXPR *expr, struct UNARY_EXPR *unary)
+{
+  if (unary != NULL && unary->expr_type == UNARY_NESTED)
+    unary->expr = &expr->steps[live_steps(expr, (int)(unary->expr - expr->steps))];
+}
+
+static void drop_steps(struct VALUE_EXPR *expr)
+{
+  int live = live_steps(expr, expr->num_steps);
+
+  if (live == expr->num_steps)
+    return;
+
+  if (live == 0)
+  {
+    free(expr->steps);
+    expr->steps = NULL;
+    expr->num_steps = 0;
+    return;
+  }
+
+  //
+  // every step keeps its place among the live ones, so the
+  // nested operands are renumbered first, and then the steps
+  // moved down over the dropped ones:
+  //
+  for (int i = 0; i < expr->num_steps; i++)
+    if (expr->steps[i].lhs != NULL)
+    {
+      renumber_step(expr, expr->steps[i].lhs);
+      renumber_step(expr, expr->steps[i].rhs);
+    }
+
+  renumber_step(expr, expr->lhs);
+  renumber_step(expr, expr->rhs);
+
+  int n = 0;
+
+  for (int i = 0; i < expr->num_steps; i++)
+    if (expr->steps[i].lhs != NULL)
+      expr->steps[n++] = expr->steps[i];
+
+  expr->num_steps = n;
+}
+
+static void inline_steps(struct VALUE_EXPR *expr)
+{
+  if (expr->isBinaryExpr && is_element_step(expr->rhs))
+    inline_step(&expr->rhs);
+
+  bool nested_rhs = expr->isBinaryExpr && expr->rhs->expr_type == UNARY_NESTED;
+
+  if (is_element_step(expr->lhs) && (!nested_rhs || is_literal(expr->lhs->expr->lhs)))
+    inline_step(&expr->lhs);
+
+  if (expr->num_steps > 0) // the outermost expression, visited last:
+    drop_steps(expr);
+}
+
+//
+// fold_literals
+//
+// walk_stmts visitor that evaluates a binary expression of two
+// literals with the executor, whose output goes to the quiet
+// interpreter so that a failure (which is left to happen at
+// runtime) prints nothing, and replaces the expression by a
+// literal of its value.
+//
+struct FoldLiterals
+{
+  struct Interpreter *quiet;
+  int count;
+};
+
+static void fold_expr(void *context, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  struct FoldLiterals *fold = (struct FoldLiterals *)context;
+
+  inline_steps(expr);
+
+  if (!expr->isBinaryExpr || !is_literal(expr->lhs) || !is_literal(expr->rhs))
+    return;
+
+  struct RAM_VALUE value;
+  char buffer[64];
+  char *literal;
+  int type;
+
+  if (!execute_expr(fold->quiet, stmt, expr, &value))
+    return;
+
+  switch (value.value_type)
+  {
+  case RAM_TYPE_INT:
+    snprintf(buffer, sizeof(buffer), "%d", value.types.i);
+    type = ELEMENT_INT_LITERAL;
+    literal = dupString(buffer);
+    break;
+  case RAM_TYPE_REAL:
+    snprintf(buffer, sizeof(buffer), "%.17g", value.types.d); // round-trips through atof
+    type = ELEMENT_REAL_LITERAL;
+    literal = dupString(buffer);
+    break;
+  case RAM_TYPE_STR:
+    type = ELEMENT_STR_LITERAL;
+    literal = value.types.s; // take ownership of the copy
+    break;
+  case RAM_TYPE_BOOLEAN:
+    type = value.types.i ? ELEMENT_TRUE : ELEMENT_FALSE;
+    literal = dupString(value.types.i ? "True" : "False");
+    break;
+  default:
+    return;
+  }
+
+  struct ELEMENT *element = expr->lhs->element;
+
+  free(element->element_value);
+  element->element_type = type;
+  element->element_value = literal;
+
+  make_unary(expr, expr->lhs);
+  fold->count++;
+}
+
+static bool fold_literals(void *context, struct STMT *stmt)
+{
+  stmt_exprs(stmt, fold_expr, context);
+
+  return true;
+}
+
+//
+// infer_all
+//
+// walk_stmts visitor for the flow-insensitive inference used by
+// the identities: a variable's mask is the union of the types of
+// every value assigned to it anywhere in the program.
+//
+struct Inference
+{
+  struct Vars *vars;
+  int *masks;
+  bool changed;
+  int count;
+};
+
+static bool infer_all(void *context, struct STMT *stmt)
+{
+  struct Inference *inference = (struct Inference *)context;
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT &&
+      assign(inference->vars, inference->masks, stmt->types.assignment, false))
+    inference->changed = true;
+
+  if (stmt->stmt_type == STMT_FOR_LOOP) // its variable is an int:
+  {
+    int v = vars_index(inference->vars, stmt->types.for_loop->var_name);
+
+    if ((inference->masks[v] & MASK_INT) == 0)
+      inference->changed = true;
+
+    inference->masks[v] |= MASK_INT;
+  }
+
+  return true;
+}
+
+//
+// simplify
+//
+// walk_stmts visitor applying the identities x + 0, 0 + x (x int)
+// and x * 1, 1 * x, x ** 1 (x int or real).
+//
+static void simplify_expr(void *context, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  struct Inference *inference = (struct Inference *)context;
+
+  inline_steps(expr);
+
+  if (!expr->isBinaryExpr)
+    return;
+
+  int numeric = MASK_INT | MASK_REAL;
+  int lhs = unary_mask(inference->vars, inference->masks, expr->lhs) & MASK_ANY;
+  int rhs = unary_mask(inference->vars, inference->masks, expr->rhs) & MASK_ANY;
+
+  //
+  // the operand that is kept must be an element, since that is
+  // all the executor evaluates as a unary expression:
+  //
+  bool lhs_element = (expr->lhs->expr_type == UNARY_ELEMENT);
+  bool rhs_element = (expr->rhs->expr_type == UNARY_ELEMENT);
+  struct UNARY_EXPR *keep = NULL;
+
+  switch (expr->operator)
+  {
+  case OPERATOR_PLUS: // -0.0 + 0 is 0.0, so ints only
+    if (lhs_element && (lhs & ~MASK_INT) == 0 && is_int_literal(expr->rhs, 0))
+      keep = expr->lhs;
+    else if (rhs_element && (rhs & ~MASK_INT) == 0 && is_int_literal(expr->lhs, 0))
+      keep = expr->rhs;
+    break;
+  case OPERATOR_ASTERISK:
+    if (lhs_element && (lhs & ~numeric) == 0 && is_int_literal(expr->rhs, 1))
+      keep = expr->lhs;
+    else if (rhs_element && (rhs & ~numeric) == 0 && is_int_literal(expr->lhs, 1))
+      keep = expr->rhs;
+    break;
+  case OPERATOR_POWER:
+    if (lhs_element && (lhs & ~numeric) == 0 && is_int_literal(expr->rhs, 1))
+      keep = expr->lhs;
+    break;
+  default:
+    break;
+  }
+
+  if (keep != NULL)
+  {
+    make_unary(expr, keep);
+    inference->count++;
+  }
+}
+
+static bool simplify(void *context, struct STMT *stmt)
+{
+  stmt_exprs(stmt, simplify_expr, context);
+
+  return true;
+}
+
+//
+// expr_types
+//
+// Returns the EXPR_TYPES of the binary expression, given the
+// masks of its operands: only if both are elements or nested,
+// each of exactly one type (and so defined), and the operator
+// applies to those types. Of in, only a substring search is typed.
+//
+static bool is_typed_operand(struct UNARY_EXPR *unary)
+{
+  return unary->expr_type == UNARY_ELEMENT || unary->expr_type == UNARY_NESTED;
+}
+
+static int expr_types(struct Vars *vars, int *masks, struct VALUE_EXPR *expr)
+{
+  if (!is_typed_operand(expr->lhs) || !is_typed_operand(expr->rhs) ||
+      (expr->operator > OPERATOR_GTE && expr->operator != OPERATOR_IN))
+    return EXPR_TYPES_UNKNOWN;
+
+  int lhs = unary_mask(vars, masks, expr->lhs);
+  int rhs = unary_mask(vars, masks, expr->rhs);
+
+  if (expr->operator == OPERATOR_IN)
+    return (lhs == MASK_STR && rhs == MASK_STR) ? EXPR_TYPES_STR_STR : EXPR_TYPES_UNKNOWN;
+  else if (lhs == MASK_INT && rhs == MASK_INT)
+    return EXPR_TYPES_INT_INT;
+  else if (lhs == MASK_INT && rhs == MASK_REAL)
+    return EXPR_TYPES_INT_REAL;
+  else if (lhs == MASK_REAL && rhs == MASK_INT)
+    return EXPR_TYPES_REAL_INT;
+  else if (lhs == MASK_REAL && rhs == MASK_REAL)
+    return EXPR_TYPES_REAL_REAL;
+  else if (lhs == MASK_STR && rhs == MASK_STR && (expr->operator == OPERATOR_PLUS || expr->operator >= OPERATOR_EQUAL))
+    return EXPR_TYPES_STR_STR;
+  else
+    return EXPR_TYPES_UNKNOWN;
+}
+
+//
+// record_stmt
+//
+// Records that the statement runs with the given masks: the types
+// of its expressions' operands, and whether the variables it reads
+// are defined. A statement may be reached with different masks
+// (e.g. in a loop body, first with the types before the loop and
+// then with those after an iteration), and a fact is only kept if
+// it holds for all of them. A loop body may not run (maybe), and
+// the rhs of an and or an or may not be evaluated, so a read there
+// is never known to fail.
+//
+struct Record
+{
+  struct Vars *vars;
+  int *masks;
+  bool maybe; // the reads may not be evaluated
+};
+
+static void record_read(void *context, struct ELEMENT *read)
+{
+  struct Record *record = (struct Record *)context;
+  int mask = record->masks[vars_index(record->vars, read->element_value)];
+  int defined = ELEMENT_DEFINED_UNKNOWN;
+
+  if ((mask & MASK_UNDEF) == 0)
+    defined = ELEMENT_DEFINED_ALWAYS;
+  else if (mask == MASK_UNDEF && !record->maybe)
+    defined = ELEMENT_DEFINED_NEVER;
+
+  if (read->defined == DEFINED_UNVISITED)
+    read->defined = defined;
+  else if (read->defined != defined)
+    read->defined = ELEMENT_DEFINED_UNKNOWN;
+}
+
+static void record_step(void *context, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  struct Record *record = (struct Record *)context;
+
+  if (!expr->isBinaryExpr)
+    return;
+
+  int types = expr_types(record->vars, record->masks, expr);
+
+  if (expr->types == TYPES_UNVISITED)
+    expr->types = types;
+  else if (expr->types != types)
+    expr->types = EXPR_TYPES_UNKNOWN;
+}
+
+static void record_types(struct Record *record, struct VALUE_EXPR *expr)
+{
+  if (expr != NULL)
+    expr_steps(NULL, expr, record_step, record);
+}
+
+static void record_condition(struct Record *record, struct CONDITION *condition)
+{
+  if (condition->condition_type == CONDITION_EXPR)
+  {
+    struct ExprReads reads = {record_read, record};
+
+    record_types(record, condition->expr);
+    expr_steps(NULL, condition->expr, expr_reads, &reads);
+  }
+  else if (condition->condition_type == CONDITION_NOT)
+  {
+    record_condition(record, condition->lhs);
+  }
+  else // and, or:
+  {
+    bool maybe = record->maybe;
+
+    record_condition(record, condition->lhs);
+    record->maybe = true;
+    record_condition(record, condition->rhs);
+    record->maybe = maybe;
+  }
+}
+
+static void record_stmt(struct Vars *vars, int *masks, struct STMT *stmt, bool maybe)
+{
+  struct Record record = {vars, masks, maybe};
+  struct CONDITION *condition = stmt_condition(stmt);
+
+  if (condition != NULL)
+  {
+    record_condition(&record, condition);
+  }
+  else
+  {
+    record_types(&record, stmt_expr(stmt));
+    stmt_reads(stmt, record_read, &record);
+  }
+}
+
+//
+// infer_flow
+//
+// Flow-sensitive inference: given the masks on entry to the
+// statements, updates them to the masks at their end, recording
+// the types of the expressions on the way. A loop is iterated
+// until the masks at its condition stop growing; its preheader is
+// analyzed as if it ran before every iteration, which gives the
+// same masks since its statements don't depend on the loop. A for
+// loop's range is evaluated once, before it, and its body is
+// iterated the same way, with the loop's variable an int. The
+// statements may not run at all if maybe is true, as is the case
+// for loop bodies and preheaders, and the paths of an if.
+// Returns false if out of memory.
+//
+static bool infer_flow(struct Vars *vars, int *masks, struct STMT *stmt, bool maybe)
+{
+  size_t size = vars->num_vars * sizeof(int);
+
+  while (stmt != NULL)
+  {
+    record_stmt(vars, masks, stmt, maybe);
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      assign(vars, masks, stmt->types.assignment, true);
+
+      stmt = stmt->types.assignment->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      stmt = stmt->types.function_call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+      int *body = (int *)malloc(size + 1);
+
+      if (body == NULL)
+        return false;
+
+      while (true)
+      {
+        memcpy(body, masks, size);
+
+        if (!infer_flow(vars, body, loop->preheader, true) || !infer_flow(vars, body, loop->loop_body, true))
+        {
+          free(body);
+          return false;
+        }
+
+        bool grew = false;
+
+        for (int v = 0; v < vars->num_vars; v++)
+        {
+          grew = grew || (body[v] & ~masks[v]) != 0;
+          masks[v] |= body[v];
+        }
+
+        if (!grew)
+          break;
+
+        record_stmt(vars, masks, stmt, maybe); // the condition, again
+      }
+
+      free(body);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+      int x = vars_index(vars, loop->var_name);
+      int *body = (int *)malloc(size + 1);
+
+      if (body == NULL)
+        return false;
+
+      while (true)
+      {
+        memcpy(body, masks, size);
+        body[x] = MASK_INT;
+
+        if (!infer_flow(vars, body, loop->loop_body, true))
+        {
+          free(body);
+          return false;
+        }
+
+        bool grew = false;
+
+        for (int v = 0; v < vars->num_vars; v++)
+        {
+          grew = grew || (body[v] & ~masks[v]) != 0;
+          masks[v] |= body[v];
+        }
+
+        if (!grew)
+          break;
+      }
+
+      free(body);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    {
+      struct STMT_IF_THEN_ELSE *ifthen = stmt->types.if_then_else;
+      int *path = (int *)malloc(size + 1);
+
+      if (path == NULL)
+        return false;
+
+      memcpy(path, masks, size);
+
+      bool success = infer_flow(vars, path, ifthen->true_path, true) &&
+                     infer_flow(vars, masks, ifthen->false_path, true);
+
+      for (int v = 0; v < vars->num_vars; v++)
+        masks[v] |= path[v];
+
+      free(path);
+
+      return success; // the paths run to the end
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      stmt = stmt->types.def->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN) // in a function body (see optimizer_specialize)
+    {
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+
+  return true;
+}
+
+//
+// set_types
+//
+// walk_stmts visitor setting expr->types of every binary expression
+// and element->defined of every read to the given values or, when
+// finishing, turning those never reached into unknown and counting
+// the expressions that have proven types.
+//
+struct SetTypes
+{
+  bool finish;
+  int types;
+  int defined;
+  int count;
+};
+
+static void set_read(void *context, struct ELEMENT *read)
+{
+  struct SetTypes *set = (struct SetTypes *)context;
+
+  if (!set->finish)
+    read->defined = set->defined;
+  else if (read->defined == DEFINED_UNVISITED)
+    read->defined = ELEMENT_DEFINED_UNKNOWN;
+}
+
+static void set_expr(void *context, struct STMT *stmt, struct VALUE_EXPR *expr)
+{
+  struct SetTypes *set = (struct SetTypes *)context;
+
+  if (!expr->isBinaryExpr)
+    return;
+
+  if (!set->finish)
+    expr->types = set->types;
+  else if (expr->types == TYPES_UNVISITED)
+    expr->types = EXPR_TYPES_UNKNOWN;
+  else if (expr->types != EXPR_TYPES_UNKNOWN)
+    set->count++;
+}
+
+static bool set_types(void *context, struct STMT *stmt)
+{
+  stmt_reads(stmt, set_read, context);
+  stmt_exprs(stmt, set_expr, context);
+
+  return true;
+}
+
+//
+// report_undefined
+//
+// walk_stmts visitor outputting an error for every read of a
+// variable that is never defined at that point.
+//
+struct ReportUndefined
+{
+  struct Interpreter *interp;
+  int count;
+  int line; // of the statement being visited
+};
+
+static void report_read(void *context, struct ELEMENT *read)
+{
+  struct ReportUndefined *report = (struct ReportUndefined *)context;
+
+  if (read->defined == ELEMENT_DEFINED_NEVER)
+  {
+    fprintf(report->interp->output, "**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", read->element_value, report->line);
+    report->count++;
+  }
+}
+
+static bool report_undefined(void *context, struct STMT *stmt)
+{
+  struct ReportUndefined *report = (struct ReportUndefined *)context;
+
+  report->line = stmt->line;
+  stmt_reads(stmt, report_read, report);
+
+  return true;
+}
+
+//
+// count_writes
+//
+// walk_stmts visitor counting the assignments to each variable,
+// including by for loops, and whether there is an assignment
+// through a pointer, which may write to any variable.
+//
+struct Writes
+{
+  struct Vars *vars;
+  int *writes;
+  bool ptr_deref;
+};
+
+static bool count_writes(void *context, struct STMT *stmt)
+{
+  struct Writes *w = (struct Writes *)context;
+
+  if (stmt->stmt_type == STMT_FOR_LOOP)
+    w->writes[vars_index(w->vars, stmt->types.for_loop->var_name)]++;
+
+  if (stmt->stmt_type != STMT_ASSIGNMENT)
+    return true;
+
+  if (stmt->types.assignment->isPtrDeref)
+    w->ptr_deref = true;
+  else
+    w->writes[vars_index(w->vars, stmt->types.assignment->var_name)]++;
+
+  return true;
+}
+
+//
+// is_invariant
+//
+// Returns true if the expression only reads variables that are
+// never assigned in the loop, and so has the same value every
+// time the loop body runs; a nested operand is invariant if its
+// step is.
+//
+static bool is_invariant(struct Vars *vars, int *writes, struct UNARY_EXPR *unary)
+{
+  if (unary == NULL || unary->expr_type == UNARY_NESTED)
+    return true;
+
+  if (unary->expr_type != UNARY_ELEMENT)
+    return false;
+
+  if (unary->element->element_type != ELEMENT_IDENTIFIER)
+    return true;
+
+  return writes[vars_index(vars, unary->element->element_value)] == 0;
+}
+
+static bool is_invariant_expr(struct Vars *vars, int *writes, struct VALUE_EXPR *expr)
+{
+  for (int i = 0; i < expr->num_steps; i++)
+    if (!is_invariant(vars, writes, expr->steps[i].lhs) || !is_invariant(vars, writes, expr->steps[i].rhs))
+      return false;
+
+  return is_invariant(vars, writes, expr->lhs) && is_invariant(vars, writes, expr->rhs);
+}
+
+//
+// cannot_fail
+//
+// Returns true if the statement is a pass, or an assignment or
+// print that cannot stop the program with an error: literals
+// (but not None, which the executor looks up as a variable),
+// variables proven to be defined, and operators with proven types
+// other than / and %, which fail on 0, in every step of the
+// expression. Subscripts, methods and the other functions may
+// always fail.
+//
+static bool cannot_fail_unary(struct UNARY_EXPR *unary)
+{
+  if (unary->expr_type == UNARY_NESTED) // if its step can't:
+    return true;
+
+  if (unary->expr_type != UNARY_ELEMENT)
+    return false;
+
+  if (unary->element->element_type == ELEMENT_IDENTIFIER)
+    return unary->element->defined == ELEMENT_DEFINED_ALWAYS;
+
+  return unary->element->element_type != ELEMENT_NONE;
+}
+
+static bool cannot_fail_expr(struct VALUE_EXPR *expr)
+{
+  if (!expr->isBinaryExpr)
+    return cannot_fail_unary(expr->lhs);
+
+  return expr->types != EXPR_TYPES_UNKNOWN && expr->operator != OPERATOR_DIV && expr->operator != OPERATOR_MOD;
+}
+
+static bool cannot_fail(struct STMT *stmt)
+{
+  if (stmt->stmt_type == STMT_PASS)
+    return true;
+
+  if (stmt->stmt_type == STMT_FUNCTION_CALL)
+  {
+    struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+    struct ELEMENT *parameter = (call->num_parameters > 0) ? call->parameters[0] : NULL;
+
+    if (call->object != NULL || call->function != NULL || call->builtin != BUILTIN_PRINT || call->num_parameters > 1)
+      return false;
+
+    return parameter == NULL ||
+           (parameter->element_type != ELEMENT_IDENTIFIER && parameter->element_type != ELEMENT_NONE);
+  }
+
+  struct VALUE_EXPR *expr = stmt_expr(stmt);
+
+  if (stmt->stmt_type != STMT_ASSIGNMENT || stmt->types.assignment->isPtrDeref ||
+      stmt->types.assignment->index != NULL || expr == NULL)
+    return false;
+
+  for (int i = 0; i < expr->num_steps; i++)
+    if (!cannot_fail_expr(&expr->steps[i]))
+      return false;
+
+  return cannot_fail_expr(expr);
+}
+
+//
+// hoist_loop
+//
+// Moves the invariant assignments at the top level of the loop's
+// body to its preheader, which the executor runs once, after the
+// condition is first found true. An assignment x = e is hoisted if
+// e is invariant, x is assigned nowhere else in the loop, and the
+// statements before it in the body don't read x; an item, x[i] = e,
+// is never hoisted. If there are such
+// statements, the move must not be visible either: they and the
+// assignment can't fail, so the same statements run and the same
+// errors are output, and they can't create a variable x would have
+// been created after, so memory lists them in the same order;
+// assigned says which variables are already defined on entry.
+// Returns false if out of memory.
+//
+struct MarkReads
+{
+  struct Vars *vars;
+  bool *read;
+};
+
+static void mark_read(void *context, struct ELEMENT *read)
+{
+  struct MarkReads *mark = (struct MarkReads *)context;
+
+  mark->read[vars_index(mark->vars, read->element_value)] = true;
+}
+
+struct Licm
+{
+  struct Interpreter *interp;
+  struct Vars *vars;
+  bool verbose;
+  int count;
+};
+
+static bool hoist_loop(struct Licm *licm, struct STMT *stmt, bool *assigned)
+{
+  struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+  struct Vars *vars = licm->vars;
+  struct Writes w = {vars, (int *)calloc(vars->num_vars + 1, sizeof(int)), false};
+  bool *read = (bool *)calloc(vars->num_vars + 1, sizeof(bool));
+
+  if (w.writes == NULL || read == NULL)
+  {
+    free(w.writes);
+    free(read);
+    return false;
+  }
+
+  walk_stmts(loop->preheader, count_writes, &w);
+  walk_stmts(loop->loop_body, count_writes, &w);
+
+  struct STMT **tail = &loop->preheader; // the preheader only has assignments
+
+  while (*tail != NULL)
+    tail = &(*tail)->types.assignment->next_stmt;
+
+  struct STMT **link = &loop->loop_body;
+  int num_before = 0;          // statements before this one, not hoisted
+  bool before_safe = true;     // ... that can't fail
+  bool before_assigned = true; // ... that only assign defined variables
+
+  while (!w.ptr_deref && *link != NULL)
+  {
+    struct STMT *body_stmt = *link;
+
+    if (body_stmt->stmt_type == STMT_ASSIGNMENT && !body_stmt->types.assignment->isPtrDeref)
+    {
+      struct STMT_ASSIGNMENT *assignment = body_stmt->types.assignment;
+      struct VALUE_EXPR *expr = stmt_expr(body_stmt);
+      int x = vars_index(vars, assignment->var_name);
+
+      if (expr != NULL && assignment->index == NULL &&
+          is_invariant_expr(vars, w.writes, expr) &&
+          w.writes[x] == 1 && !read[x] &&
+          (num_before == 0 || (before_safe && cannot_fail(body_stmt) && (assigned[x] || before_assigned))))
+      {
+        *link = assignment->next_stmt;
+        assignment->next_stmt = NULL;
+        *tail = body_stmt;
+        tail = &assignment->next_stmt;
+
+        if (licm->verbose)
+          fprintf(licm->interp->output, "**hoisted assignment to '%s' (line %d) out of the while loop (line %d)\n",
+                  assignment->var_name, body_stmt->line, stmt->line);
+
+        licm->count++;
+        continue;
+      }
+
+      before_assigned = before_assigned && assigned[x];
+      link = &assignment->next_stmt;
+    }
+    else if (body_stmt->stmt_type == STMT_FUNCTION_CALL)
+      link = &body_stmt->types.function_call->next_stmt;
+    else if (body_stmt->stmt_type == STMT_PASS)
+      link = &body_stmt->types.pass->next_stmt;
+    else // a nested loop or if, which may fail or assign anything:
+      break;
+
+    struct MarkReads mark = {vars, read};
+
+    stmt_reads(body_stmt, mark_read, &mark);
+
+    if (body_stmt->stmt_type == STMT_ASSIGNMENT && body_stmt->types.assignment->index != NULL)
+      read[vars_index(vars, body_stmt->types.assignment->var_name)] = true;
+
+    before_safe = before_safe && cannot_fail(body_stmt);
+    num_before++;
+  }
+
+  free(w.writes);
+  free(read);
+
+  return true;
+}
+
+//
+// licm_stmts
+//
+// Hoists the invariant assignments out of every loop in the
+// statements, including nested loops. assigned says which variables are defined
+// on entry to the statements, and is updated as they are walked.
+// Returns false if out of memory.
+//
+static bool licm_stmts(struct Licm *licm, struct STMT *stmt, bool *assigned)
+{
+  size_t size = licm->vars->num_vars * sizeof(bool);
+
+  while (stmt != NULL)
+  {
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      if (!stmt->types.assignment->isPtrDeref)
+        assigned[vars_index(licm->vars, stmt->types.assignment->var_name)] = true;
+
+      stmt = stmt->types.assignment->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      stmt = stmt->types.function_call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      bool *body = (bool *)malloc(size + 1);
+
+      if (body == NULL)
+        return false;
+
+      memcpy(body, assigned, size);
+
+      bool success = licm_stmts(licm, stmt->types.while_loop->loop_body, body) &&
+                     hoist_loop(licm, stmt, assigned);
+
+      free(body);
+
+      if (!success)
+        return false;
+
+      stmt = stmt->types.while_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP) // only while loops are hoisted from
+    {
+      bool *body = (bool *)malloc(size + 1);
+
+      if (body == NULL)
+        return false;
+
+      memcpy(body, assigned, size);
+      body[vars_index(licm->vars, stmt->types.for_loop->var_name)] = true;
+
+      bool success = licm_stmts(licm, stmt->types.for_loop->loop_body, body);
+
+      free(body);
+
+      if (!success)
+        return false;
+
+      stmt = stmt->types.for_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    {
+      struct STMT_IF_THEN_ELSE *ifthen = stmt->types.if_then_else;
+      bool *path = (bool *)malloc(size + 1);
+
+      if (path == NULL)
+        return false;
+
+      memcpy(path, assigned, size);
+
+      bool success = licm_stmts(licm, ifthen->true_path, path) &&
+                     licm_stmts(licm, ifthen->false_path, assigned);
+
+      free(path);
+
+      return success; // the paths run to the end
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      stmt = stmt->types.def->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+
+  return true;
+}
+
+//
+// Public functions:
+//
+
+//
+// optimizer_fold
+//
+int optimizer_fold(struct Interpreter *interp, struct STMT *program, bool fresh_memory)
+{
+  //
+  // literals are folded by evaluating them, with output going
+  // nowhere; if /dev/null can't be opened, they are not folded:
+  //
+  struct Interpreter quiet = *interp;
+  struct FoldLiterals fold = {&quiet, 0};
+
+  quiet.output = fopen("/dev/null", "w");
+
+  if (quiet.output != NULL)
+  {
+    walk_stmts(program, fold_literals, &fold);
+
+    fclose(quiet.output);
+  }
+
+  if (!fresh_memory)
+    return fold.count;
+
+  //
+  // then the identities, given the types of the variables; the
+  // masks only grow, so this terminates:
+  //
+  struct Vars vars = {0, 0, NULL, NULL, 0};
+  struct Inference inference = {&vars, NULL, true, 0};
+
+  if (walk_stmts(program, collect_vars, &vars))
+    inference.masks = (int *)calloc(vars.num_vars + 1, sizeof(int));
+
+  if (inference.masks != NULL)
+  {
+    while (inference.changed)
+    {
+      inference.changed = false;
+      walk_stmts(program, infer_all, &inference);
+    }
+
+    walk_stmts(program, simplify, &inference);
+  }
+
+  free(inference.masks);
+  vars_free(&vars);
+
+  return fold.count + inference.count;
+}
+
+//
+// optimizer_types
+//
+int optimizer_types(struct STMT *program, bool fresh_memory)
+{
+  struct Vars vars = {0, 0, NULL, NULL, 0};
+  struct SetTypes set = {false, TYPES_UNVISITED, DEFINED_UNVISITED, 0};
+  int *masks = NULL;
+
+  if (walk_stmts(program, collect_vars, &vars))
+    masks = (int *)malloc((vars.num_vars + 1) * sizeof(int));
+
+  if (masks != NULL)
+  {
+    for (int v = 0; v < vars.num_vars; v++)
+      masks[v] = fresh_memory ? MASK_UNDEF : (MASK_ANY | MASK_UNDEF);
+
+    walk_stmts(program, set_types, &set);
+
+    if (!infer_flow(&vars, masks, program, false)) // out of memory:
+    {
+      set.types = EXPR_TYPES_UNKNOWN;
+      set.defined = ELEMENT_DEFINED_UNKNOWN;
+    }
+    else
+      set.finish = true;
+
+    walk_stmts(program, set_types, &set);
+  }
+
+  free(masks);
+  vars_free(&vars);
+
+  return set.count;
+}
+
+//
+// optimizer_specialize
+//
+int optimizer_specialize(struct STMT *function, struct STMT *body, const int *param_types)
+{
+  struct STMT_DEF *def = function->types.def;
+  struct Vars vars = {0, 0, NULL, NULL, 0};
+  struct SetTypes set = {false, TYPES_UNVISITED, DEFINED_UNVISITED, 0};
+  int *masks = NULL;
+
+  if (walk_stmts(body, collect_vars, &vars))
+    masks = (int *)malloc((vars.num_vars + 1) * sizeof(int));
+
+  if (masks != NULL)
+  {
+    for (int v = 0; v < vars.num_vars; v++)
+    {
+      int local = -1;
+
+      for (int i = 0; i < def->num_locals && local < 0; i++)
+        if (strcmp(def->locals[i], vars.names[v]) == 0)
+          local = i;
+
+      if (local < 0) // the program's
+        masks[v] = MASK_ANY | MASK_UNDEF;
+      else if (local < def->num_params)
+        masks[v] = 1 << param_types[local];
+      else
+        masks[v] = MASK_UNDEF;
+    }
+
+    walk_stmts(body, set_types, &set);
+
+    if (!infer_flow(&vars, masks, body, false)) // out of memory:
+    {
+      set.types = EXPR_TYPES_UNKNOWN;
+      set.defined = ELEMENT_DEFINED_UNKNOWN;
+    }
+    else
+      set.finish = true;
+
+    walk_stmts(body, set_types, &set);
+  }
+
+  free(masks);
+  vars_free(&vars);
+
+  return set.count;
+}
+
+//
+// optimizer_licm
+//
+int optimizer_licm(struct Interpreter *interp, struct STMT *program, bool verbose)
+{
+  struct Vars vars = {0, 0, NULL, NULL, 0};
+  struct Licm licm = {interp, &vars, verbose, 0};
+  bool *assigned = NULL;
+
+  if (walk_stmts(program, collect_vars, &vars))
+    assigned = (bool *)calloc(vars.num_vars + 1, sizeof(bool));
+
+  if (assigned != NULL)
+    licm_stmts(&licm, program, assigned);
+
+  free(assigned);
+  vars_free(&vars);
+
+  return licm.count;
+}
+
+//
+// optimizer_report_undefined
+//
+int optimizer_report_undefined(struct Interpreter *interp, struct STMT *program)
+{
+  struct ReportUndefined report = {interp, 0, 0};
+
+  walk_stmts(program, report_undefined, &report);
+
+  return report.count;
+}
+
+//
+// optimizer_run
+//
+void optimizer_run(struct Interpreter *interp, struct STMT *program, bool fresh_memory, bool verbose, struct OptimizerStats *stats)
+{
+  int simplified = optimizer_fold(interp, program, fresh_memory);
+  int specialized = optimizer_types(program, fresh_memory);
+  int hoisted = optimizer_licm(interp, program, verbose);
+
+  if (hoisted > 0) // the reads in preheaders are now reached sooner:
+    specialized = optimizer_types(program, fresh_memory);
+
+  if (stats != NULL)
+  {
+    stats->simplified = simplified;
+    stats->specialized = specialized;
+    stats->hoisted = hoisted;
+  }
+}
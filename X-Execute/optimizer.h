@@ -0,0 +1,124 @@
+/*optimizer.h*/
+
+//
+// Optimization passes over a nuPython program graph. The passes
+// rewrite the graph in place and never change what a program
+// outputs; they run after programgraph_build and before execute.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "programgraph.h"
+#include "interpreter.h"
+
+//
+// What the passes did, for reporting:
+//
+struct OptimizerStats
+{
+  int simplified;  // expressions simplified by optimizer_fold
+  int specialized; // expressions given proven types by optimizer_types
+  int hoisted;     // assignments moved out of loops by optimizer_licm
+};
+
+//
+// Public functions:
+//
+
+//
+// optimizer_run
+//
+// Runs all the passes below, in order, on a newly-built program
+// graph. See optimizer_fold for fresh_memory, and optimizer_licm
+// for verbose. If stats is not NULL, what the passes did is
+// returned through it.
+//
+void optimizer_run(struct Interpreter *interp, struct STMT *program, bool fresh_memory, bool verbose, struct OptimizerStats *stats);
+
+//
+// optimizer_fold
+//
+// Constant folding and algebraic simplification. Binary
+// expressions whose operands are both literals, e.g. 60 * 60,
+// are replaced by their value, computed by the executor itself
+// so the semantics are exactly those of the running program;
+// expressions that would fail at runtime, e.g. 1 / 0, are left
+// alone so the error still happens at the right time. Then the
+// identities x + 0, 0 + x (x int), and x * 1, 1 * x, x ** 1
+// (x int or real) are reduced to x, when every value that x
+// could hold is known to have the required type. Both chain
+// through the steps of an expression, so 60 * 60 * 24 is folded
+// to 86400, and x * 1 * 1 reduced to x. Types are
+// inferred from the program's own assignments, so identities are
+// only applied if fresh_memory is true, i.e. the program will run
+// in an empty memory and not one prepared by the caller.
+//
+// Returns the # of expressions simplified.
+//
+int optimizer_fold(struct Interpreter *interp, struct STMT *program, bool fresh_memory);
+
+//
+// optimizer_types
+//
+// Flow-sensitive type inference: computes, at each point of the
+// program, the types each variable may hold (or whether it may be
+// undefined), iterating loops to a fixpoint. Every binary expression
+// whose operands are then proven to have exactly one type each, and
+// be defined, on every path that reaches it, is marked with those
+// types (expr->types), so that the executor can apply the operator
+// for those types without checking them. Likewise every read of a
+// variable is marked (element->defined) if the variable is proven
+// to be assigned whenever it's read, so the executor can skip the
+// check, or if it's never assigned at that point, for
+// optimizer_report_undefined. If fresh_memory is false, variables
+// may hold anything until the program assigns them.
+//
+// Returns the # of expressions whose types were proven.
+//
+int optimizer_types(struct STMT *program, bool fresh_memory);
+
+//
+// optimizer_specialize
+//
+// optimizer_types for the body of a function, given the types
+// of its parameters (RAM types, one per parameter) on entry:
+// the body's other locals start out undefined, and the program's
+// variables it reads may hold anything. body is a copy of the
+// function's body (see programgraph_copy), which is only valid
+// for calls with those types, since the function's own body runs
+// for any (see callcache.h).
+//
+// Returns the # of expressions whose types were proven.
+//
+int optimizer_specialize(struct STMT *function, struct STMT *body, const int *param_types);
+
+//
+// optimizer_licm
+//
+// Loop-invariant code motion: an assignment in a while loop's body
+// whose right-hand side only reads variables the loop never assigns,
+// e.g. limit = n * 2, computes the same value every iteration, so it
+// is moved to the loop's preheader and run once, when the loop is
+// entered; a loop whose condition is false at the start still runs
+// none of it. Assignments are only moved when that can't change what
+// the program outputs or leaves in memory, including its errors.
+// Run after optimizer_types, whose proofs it uses, and run that again
+// after it. If verbose, each assignment moved is reported to the
+// interpreter's output stream.
+//
+// Returns the # of assignments moved.
+//
+int optimizer_licm(struct Interpreter *interp, struct STMT *program, bool verbose);
+
+//
+// optimizer_report_undefined
+//
+// Outputs a semantic error for every read of a variable that
+// optimizer_types proved is never assigned at that point, e.g. a
+// misspelled name, so that it can be reported before the program
+// runs rather than after some of it has. Returns the # of errors
+// output; the program should not be run if > 0.
+//
+int optimizer_report_undefined(struct Interpreter *interp, struct STMT *program);
@@ -0,0 +1,740 @@
+/*parser.c*/
+
+//
+// Recursive-descent parsing functions for nuPython programming language.
+// The parser is responsible for checking if the input follows the syntax
+// ("grammar") rules of nuPython. If successful, a copy of the tokens is
+// returned so the program can be analyzed and executed.
+//
+// The parser works through interp->tokens, and reports syntax errors
+// on the interpreter's output stream.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "token.h"
+#include "scanner.h"
+#include "tokenqueue.h"
+#include "interpreter.h"
+#include "parser.h"
+
+//
+// Private functions:
+//
+
+//
+// syntax_error
+//
+// Outputs a syntax error about the next token, e.g.
+//
+//   **SYNTAX ERROR: expecting ), found ':' @ (3, 12)
+//
+// where expecting is what the user is told we were looking
+// for. Returns false so callers can return the result.
+//
+static bool syntax_error(struct Interpreter *interp, char *expecting)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  fprintf(interp->output, "**SYNTAX ERROR: expecting %s, found '%s' @ (%d, %d)\n",
+          expecting, tokenqueue_peekValue(interp->tokens), T.line, T.col);
+
+  return false;
+}
+
+//
+// match
+//
+// If the next token has the expected id, it is consumed and true
+// is returned. Otherwise a syntax error is output, saying we were
+// expecting the expected value, and false is returned.
+//
+static bool match(struct Interpreter *interp, int expectedID, char *expectedValue)
+{
+  if (tokenqueue_peekToken(interp->tokens).id != expectedID)
+    return syntax_error(interp, expectedValue);
+
+  tokenqueue_dequeue(interp->tokens);
+
+  return true;
+}
+
+//
+// is_element
+//
+// Returns true if the token id starts an element: an identifier,
+// literal, True, False or None.
+//
+static bool is_element(int id)
+{
+  return id == nuPy_IDENTIFIER || id == nuPy_INT_LITERAL ||
+         id == nuPy_REAL_LITERAL || id == nuPy_STR_LITERAL ||
+         id == nuPy_KEYW_TRUE || id == nuPy_KEYW_FALSE ||
+         id == nuPy_KEYW_NONE;
+}
+
+//
+// is_stmt_start
+//
+// Returns true if the token id starts a statement.
+//
+static bool is_stmt_start(int id)
+{
+  return id == nuPy_IDENTIFIER || id == nuPy_ASTERISK ||
+         id == nuPy_KEYW_IF || id == nuPy_KEYW_WHILE ||
+         id == nuPy_KEYW_FOR || id == nuPy_KEYW_PASS ||
+         id == nuPy_KEYW_DEF || id == nuPy_KEYW_RETURN;
+}
+
+
+//
+// <element> ::= IDENTIFIER | INT_LITERAL | REAL_LITERAL
+//             | STR_LITERAL | True | False | None
+//
+static bool parser_element(struct Interpreter *interp)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (!is_element(T.id))
+    return syntax_error(interp, "a value such as x, 123, or 'a string'");
+
+  return match(interp, T.id, tokenqueue_peekValue(interp->tokens));
+}
+
+//
+// <subscript> ::= '[' <element> ']'
+//               | '[' [<element>] ':' [<element>] ']'
+//
+static bool parser_subscript(struct Interpreter *interp)
+{
+  if (!match(interp, nuPy_LEFT_BRACKET, "["))
+    return false;
+
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id != nuPy_COLON && !parser_element(interp))
+    return false;
+
+  T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id == nuPy_COLON) // a slice, with an optional end:
+  {
+    match(interp, nuPy_COLON, ":");
+
+    T = tokenqueue_peekToken(interp->tokens);
+
+    if (T.id != nuPy_RIGHT_BRACKET && !parser_element(interp))
+      return false;
+  }
+
+  return match(interp, nuPy_RIGHT_BRACKET, "]");
+}
+
+//
+// <unary_expr> ::= '*' IDENTIFIER
+//                | '&' IDENTIFIER
+//                | '+' IDENTIFIER | '+' INT_LITERAL | '+' REAL_LITERAL
+//                | '-' IDENTIFIER | '-' INT_LITERAL | '-' REAL_LITERAL
+//                | IDENTIFIER <subscript>
+//                | <element>
+//
+static bool parser_unary_expr(struct Interpreter *interp)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id == nuPy_ASTERISK)
+  {
+    return match(interp, nuPy_ASTERISK, "*") &&
+           match(interp, nuPy_IDENTIFIER, "identifier");
+  }
+  else if (T.id == nuPy_AMPERSAND)
+  {
+    return match(interp, nuPy_AMPERSAND, "&") &&
+           match(interp, nuPy_IDENTIFIER, "identifier");
+  }
+  else if (T.id == nuPy_PLUS || T.id == nuPy_MINUS)
+  {
+    if (!match(interp, T.id, (T.id == nuPy_PLUS) ? "+" : "-"))
+      return false;
+
+    T = tokenqueue_peekToken(interp->tokens);
+
+    if (T.id != nuPy_IDENTIFIER && T.id != nuPy_INT_LITERAL && T.id != nuPy_REAL_LITERAL)
+      return syntax_error(interp, "identifer or numeric literal");
+
+    return match(interp, T.id, tokenqueue_peekValue(interp->tokens));
+  }
+  else if (T.id == nuPy_IDENTIFIER &&
+           tokenqueue_peek2Token(interp->tokens).id == nuPy_LEFT_BRACKET)
+  {
+    return match(interp, nuPy_IDENTIFIER, "identifier") &&
+           parser_subscript(interp);
+  }
+  else
+  {
+    return parser_element(interp);
+  }
+}
+
+static bool parser_expr(struct Interpreter *interp);
+
+//
+// <operand> ::= '(' <expr> ')' | <unary_expr>
+//
+static bool parser_operand(struct Interpreter *interp)
+{
+  if (tokenqueue_peekToken(interp->tokens).id == nuPy_LEFT_PAREN)
+    return match(interp, nuPy_LEFT_PAREN, "(") && parser_expr(interp) &&
+           match(interp, nuPy_RIGHT_PAREN, ")");
+
+  return parser_unary_expr(interp);
+}
+
+//
+// <expr> ::= <operand> {<op> <operand>}
+//
+// Parsed by precedence climbing: an operator's rhs is the operand
+// after it and the operators binding tighter than it (see
+// parser_precedence), or as tightly for **, which groups to the
+// right; the others group to the left. There is at most one
+// comparison, is or in, so a < b < c is an error.
+//
+static bool parser_binary_expr(struct Interpreter *interp, int min_precedence)
+{
+  if (!parser_operand(interp))
+    return false;
+
+  bool compared = false;
+
+  while (true)
+  {
+    struct Token T = tokenqueue_peekToken(interp->tokens);
+    int precedence = parser_precedence(T.id);
+
+    if (precedence == 0 || precedence < min_precedence || (precedence == 1 && compared))
+      return true;
+
+    compared = compared || (precedence == 1);
+
+    if (!match(interp, T.id, tokenqueue_peekValue(interp->tokens)) ||
+        !parser_binary_expr(interp, (T.id == nuPy_POWER) ? precedence : precedence + 1))
+      return false;
+  }
+}
+
+static bool parser_expr(struct Interpreter *interp)
+{
+  return parser_binary_expr(interp, 1);
+}
+
+//
+// <condition> ::= <and_condition> {or <and_condition>}
+//
+// <and_condition> ::= <not_condition> {and <not_condition>}
+//
+// <not_condition> ::= not <not_condition> | <expr>
+//
+static bool parser_not_condition(struct Interpreter *interp)
+{
+  if (tokenqueue_peekToken(interp->tokens).id == nuPy_KEYW_NOT)
+    return match(interp, nuPy_KEYW_NOT, "not") && parser_not_condition(interp);
+
+  return parser_expr(interp);
+}
+
+static bool parser_and_condition(struct Interpreter *interp)
+{
+  if (!parser_not_condition(interp))
+    return false;
+
+  while (tokenqueue_peekToken(interp->tokens).id == nuPy_KEYW_AND)
+    if (!(match(interp, nuPy_KEYW_AND, "and") && parser_not_condition(interp)))
+      return false;
+
+  return true;
+}
+
+static bool parser_condition(struct Interpreter *interp)
+{
+  if (!parser_and_condition(interp))
+    return false;
+
+  while (tokenqueue_peekToken(interp->tokens).id == nuPy_KEYW_OR)
+    if (!(match(interp, nuPy_KEYW_OR, "or") && parser_and_condition(interp)))
+      return false;
+
+  return true;
+}
+
+//
+// <function_call> ::= IDENTIFIER '(' [<element> {',' <element>}] ')'
+//
+// The number of parameters is checked against the function
+// called when the call runs.
+//
+static bool parser_function_call(struct Interpreter *interp)
+{
+  if (!match(interp, nuPy_IDENTIFIER, "identifier"))
+    return false;
+  if (!match(interp, nuPy_LEFT_PAREN, "("))
+    return false;
+
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (is_element(T.id)) // optional parameter(s):
+  {
+    match(interp, T.id, tokenqueue_peekValue(interp->tokens));
+
+    while (tokenqueue_peekToken(interp->tokens).id == nuPy_COMMA)
+      if (!(match(interp, nuPy_COMMA, ",") && parser_element(interp)))
+        return false;
+  }
+
+  return match(interp, nuPy_RIGHT_PAREN, ")");
+}
+
+//
+// <method_call> ::= IDENTIFIER '.' <function_call>
+//
+static bool parser_method_call(struct Interpreter *interp)
+{
+  return match(interp, nuPy_IDENTIFIER, "identifier") &&
+         match(interp, nuPy_DOT, ".") &&
+         parser_function_call(interp);
+}
+
+//
+// <list> ::= '[' [<element> {',' <element>}] ']'
+//
+static bool parser_list(struct Interpreter *interp)
+{
+  if (!match(interp, nuPy_LEFT_BRACKET, "["))
+    return false;
+
+  if (tokenqueue_peekToken(interp->tokens).id != nuPy_RIGHT_BRACKET)
+  {
+    if (!parser_element(interp))
+      return false;
+
+    while (tokenqueue_peekToken(interp->tokens).id == nuPy_COMMA)
+    {
+      if (!(match(interp, nuPy_COMMA, ",") && parser_element(interp)))
+        return false;
+    }
+  }
+
+  return match(interp, nuPy_RIGHT_BRACKET, "]");
+}
+
+//
+// <dict> ::= '{' [<entry> {',' <entry>}] '}'
+//
+// <entry> ::= <element> ':' <element>
+//
+static bool parser_dict(struct Interpreter *interp)
+{
+  if (!match(interp, nuPy_LEFT_BRACE, "{"))
+    return false;
+
+  if (tokenqueue_peekToken(interp->tokens).id != nuPy_RIGHT_BRACE)
+  {
+    do
+    {
+      if (!(parser_element(interp) && match(interp, nuPy_COLON, ":") && parser_element(interp)))
+        return false;
+    } while (tokenqueue_peekToken(interp->tokens).id == nuPy_COMMA && match(interp, nuPy_COMMA, ","));
+  }
+
+  return match(interp, nuPy_RIGHT_BRACE, "}");
+}
+
+//
+// <value> ::= <function_call> | <list> | <dict> | <expr>
+//
+static bool parser_value(struct Interpreter *interp)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id == nuPy_IDENTIFIER &&
+      tokenqueue_peek2Token(interp->tokens).id == nuPy_LEFT_PAREN)
+    return parser_function_call(interp);
+  else if (T.id == nuPy_LEFT_BRACKET)
+    return parser_list(interp);
+  else if (T.id == nuPy_LEFT_BRACE)
+    return parser_dict(interp);
+  else
+    return parser_expr(interp);
+}
+
+//
+// <assignment> ::= '*' IDENTIFIER '=' <value>
+//                | IDENTIFIER ['[' <element> ']'] '=' <value>
+//
+static bool parser_assignment(struct Interpreter *interp)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id == nuPy_ASTERISK)
+    match(interp, nuPy_ASTERISK, "*");
+
+  if (!match(interp, nuPy_IDENTIFIER, "identifier"))
+    return false;
+
+  if (T.id != nuPy_ASTERISK &&
+      tokenqueue_peekToken(interp->tokens).id == nuPy_LEFT_BRACKET) // x[i] = ...
+  {
+    if (!(match(interp, nuPy_LEFT_BRACKET, "[") && parser_element(interp) &&
+          match(interp, nuPy_RIGHT_BRACKET, "]")))
+      return false;
+  }
+
+  return match(interp, nuPy_EQUAL, "=") && parser_value(interp);
+}
+
+static bool parser_body(struct Interpreter *interp);
+
+//
+// <for> ::= for IDENTIFIER in range '(' <range> ')' ':' <body>
+//
+// <range> ::= <element> [',' <element> [',' <element>]]
+//
+static bool parser_for(struct Interpreter *interp)
+{
+  if (!(match(interp, nuPy_KEYW_FOR, "for") && match(interp, nuPy_IDENTIFIER, "identifier") &&
+        match(interp, nuPy_KEYW_IN, "in")))
+    return false;
+
+  if (tokenqueue_peekToken(interp->tokens).id != nuPy_IDENTIFIER ||
+      strcmp(tokenqueue_peekValue(interp->tokens), "range") != 0)
+    return syntax_error(interp, "range");
+
+  if (!(match(interp, nuPy_IDENTIFIER, "range") && match(interp, nuPy_LEFT_PAREN, "(") &&
+        parser_element(interp)))
+    return false;
+
+  for (int args = 1; args < 3 && tokenqueue_peekToken(interp->tokens).id == nuPy_COMMA; args++)
+  {
+    if (!(match(interp, nuPy_COMMA, ",") && parser_element(interp)))
+      return false;
+  }
+
+  return match(interp, nuPy_RIGHT_PAREN, ")") && match(interp, nuPy_COLON, ":") &&
+         parser_body(interp);
+}
+
+//
+// <def> ::= def IDENTIFIER '(' [IDENTIFIER {',' IDENTIFIER}] ')' ':' <body>
+//
+static bool parser_def(struct Interpreter *interp)
+{
+  if (!(match(interp, nuPy_KEYW_DEF, "def") && match(interp, nuPy_IDENTIFIER, "identifier") &&
+        match(interp, nuPy_LEFT_PAREN, "(")))
+    return false;
+
+  if (tokenqueue_peekToken(interp->tokens).id != nuPy_RIGHT_PAREN)
+  {
+    if (!match(interp, nuPy_IDENTIFIER, "identifier"))
+      return false;
+
+    while (tokenqueue_peekToken(interp->tokens).id == nuPy_COMMA)
+    {
+      if (!(match(interp, nuPy_COMMA, ",") && match(interp, nuPy_IDENTIFIER, "identifier")))
+        return false;
+    }
+  }
+
+  return match(interp, nuPy_RIGHT_PAREN, ")") && match(interp, nuPy_COLON, ":") &&
+         parser_body(interp);
+}
+
+//
+// <return> ::= return [<value>]
+//
+// The value, if any, starts on the same line as the return.
+//
+static bool parser_return(struct Interpreter *interp)
+{
+  int line = tokenqueue_peekToken(interp->tokens).line;
+
+  if (!match(interp, nuPy_KEYW_RETURN, "return"))
+    return false;
+
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.line != line || !parser_isValueStart(T.id))
+    return true;
+
+  return parser_value(interp);
+}
+
+//
+// <stmt> ::= <assignment>
+//          | <function_call>
+//          | <method_call>
+//          | if <condition> ':' <body> [<else>]
+//          | while <condition> ':' <body>
+//          | <for>
+//          | pass
+//          | <def>
+//          | <return>
+//
+// <else> ::= elif <condition> ':' <body> [<else>]
+//          | else ':' <body>
+//
+static bool parser_stmt(struct Interpreter *interp)
+{
+  struct Token T = tokenqueue_peekToken(interp->tokens);
+
+  if (T.id == nuPy_IDENTIFIER)
+  {
+    struct Token T2 = tokenqueue_peek2Token(interp->tokens);
+
+    if (T2.id == nuPy_EQUAL || T2.id == nuPy_LEFT_BRACKET)
+      return parser_assignment(interp);
+    if (T2.id == nuPy_LEFT_PAREN)
+      return parser_function_call(interp);
+    if (T2.id == nuPy_DOT)
+      return parser_method_call(interp);
+
+    return syntax_error(interp, "assignment or function call");
+  }
+  else if (T.id == nuPy_ASTERISK)
+  {
+    return parser_assignment(interp);
+  }
+  else if (T.id == nuPy_KEYW_IF)
+  {
+    if (!(match(interp, nuPy_KEYW_IF, "if") && parser_condition(interp) &&
+          match(interp, nuPy_COLON, ":") && parser_body(interp)))
+      return false;
+
+    //
+    // any number of elifs, then an optional else:
+    //
+    while (true)
+    {
+      T = tokenqueue_peekToken(interp->tokens);
+
+      if (T.id == nuPy_KEYW_ELIF)
+      {
+        if (!(match(interp, nuPy_KEYW_ELIF, "elif") && parser_condition(interp) &&
+              match(interp, nuPy_COLON, ":") && parser_body(interp)))
+          return false;
+      }
+      else if (T.id == nuPy_KEYW_ELSE)
+      {
+        return match(interp, nuPy_KEYW_ELSE, "else") &&
+               match(interp, nuPy_COLON, ":") && parser_body(interp);
+      }
+      else
+      {
+        return true;
+      }
+    }
+  }
+  else if (T.id == nuPy_KEYW_WHILE)
+  {
+    return match(interp, nuPy_KEYW_WHILE, "while") && parser_condition(interp) &&
+           match(interp, nuPy_COLON, ":") && parser_body(interp);
+  }
+  else if (T.id == nuPy_KEYW_FOR)
+  {
+    return parser_for(interp);
+  }
+  else if (T.id == nuPy_KEYW_PASS)
+  {
+    return match(interp, nuPy_KEYW_PASS, "pass");
+  }
+  else if (T.id == nuPy_KEYW_DEF)
+  {
+    return parser_def(interp);
+  }
+  else if (T.id == nuPy_KEYW_RETURN)
+  {
+    return parser_return(interp);
+  }
+  else
+  {
+    return syntax_error(interp, "start of a statement (eg if or while)");
+  }
+}
+
+//
+// <stmts> ::= <stmt> [<stmts>]
+//
+static bool parser_stmts(struct Interpreter *interp)
+{
+  if (!parser_stmt(interp))
+    return false;
+
+  while (is_stmt_start(tokenqueue_peekToken(interp->tokens).id))
+  {
+    if (!parser_stmt(interp))
+      return false;
+  }
+
+  return true;
+}
+
+//
+// <body> ::= '{' <stmts> '}'
+//
+static bool parser_body(struct Interpreter *interp)
+{
+  return match(interp, nuPy_LEFT_BRACE, "{") && parser_stmts(interp) &&
+         match(interp, nuPy_RIGHT_BRACE, "}");
+}
+
+//
+// Public functions:
+//
+
+//
+// parser_isOperator
+//
+// Returns true if the token id is a binary operator, e.g.
+// + or <, false if not.
+//
+bool parser_isOperator(int id)
+{
+  switch (id)
+  {
+  case nuPy_PLUS:
+  case nuPy_MINUS:
+  case nuPy_ASTERISK:
+  case nuPy_POWER:
+  case nuPy_PERCENT:
+  case nuPy_SLASH:
+  case nuPy_EQUALEQUAL:
+  case nuPy_NOTEQUAL:
+  case nuPy_LT:
+  case nuPy_LTE:
+  case nuPy_GT:
+  case nuPy_GTE:
+  case nuPy_KEYW_IN:
+  case nuPy_KEYW_IS:
+    return true;
+  default:
+    return false;
+  }
+}
+
+//
+// parser_precedence
+//
+// Returns how tightly the binary operator binds: 4 for **, 3 for
+// *, / and %, 2 for + and -, and 1 for the comparisons, is and
+// in; 0 if the token id isn't a binary operator.
+//
+int parser_precedence(int id)
+{
+  switch (id)
+  {
+  case nuPy_POWER:
+    return 4;
+  case nuPy_ASTERISK:
+  case nuPy_SLASH:
+  case nuPy_PERCENT:
+    return 3;
+  case nuPy_PLUS:
+  case nuPy_MINUS:
+    return 2;
+  default:
+    return parser_isOperator(id) ? 1 : 0;
+  }
+}
+
+//
+// parser_isValueStart
+//
+// Returns true if the token id starts a value: an element, a
+// list, a dictionary, a unary expression with a prefix, or a
+// parenthesized expression.
+//
+bool parser_isValueStart(int id)
+{
+  return is_element(id) || id == nuPy_LEFT_BRACKET || id == nuPy_LEFT_BRACE ||
+         id == nuPy_ASTERISK || id == nuPy_AMPERSAND || id == nuPy_PLUS || id == nuPy_MINUS ||
+         id == nuPy_LEFT_PAREN;
+}
+
+//
+// parser_parse
+//
+// Given an input stream, uses the interpreter's scanner to
+// obtain the tokens and then checks the syntax of the input
+// against the BNF rules for the subset of Python we are
+// supporting:
+//
+//   <program> ::= <stmts> EOS
+//
+// Returns NULL if a syntax error was found; in this case
+// an error message was output. Returns a pointer to a list
+// of tokens -- a Token Queue -- if no syntax errors were
+// detected.
+//
+struct TokenQueue *parser_parse(struct Interpreter *interp, FILE *source)
+{
+  assert(interp != NULL);
+  assert(source != NULL);
+
+  if (!scanner_init(&interp->scanner, source, interp->output))
+  {
+    fprintf(interp->output, "**PARSER ERROR: out of memory\n");
+    return NULL;
+  }
+
+  //
+  // scan the input into a queue of tokens, including EOS:
+  //
+  struct TokenQueue *tokens = tokenqueue_create();
+  struct Token T;
+
+  do
+  {
+    T = scanner_nextToken(&interp->scanner);
+
+    tokenqueue_enqueue(tokens, T, interp->scanner.value);
+  } while (T.id != nuPy_EOS);
+
+  scanner_destroy(&interp->scanner);
+
+  //
+  // parsing consumes the tokens, so keep a copy for the caller:
+  //
+  struct TokenQueue *copy = tokenqueue_duplicate(tokens);
+
+  interp->tokens = tokens;
+
+  bool success = parser_stmts(interp) && match(interp, nuPy_EOS, "$");
+
+  interp->tokens = NULL;
+  tokenqueue_destroy(tokens);
+
+  if (!success)
+  {
+    tokenqueue_destroy(copy);
+    return NULL;
+  }
+
+  //
+  // if the program came from the same stream as input() reads,
+  // e.g. the keyboard, discard the rest of the line after the $
+  // so the program's input starts on a fresh line:
+  //
+  if (source == interp->input)
+  {
+    int c = fgetc(source);
+
+    while (c != '\n' && c != EOF)
+    {
+      c = fgetc(source);
+    }
+  }
+
+  return copy;
+}
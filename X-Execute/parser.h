@@ -14,29 +14,51 @@
 #include <stdbool.h>  // true, false
 
 #include "tokenqueue.h"
+#include "interpreter.h"
 
 
 //
-// parser_init
+// parser_parse
+//
+// Given an input stream, uses the interpreter's scanner to
+// obtain the tokens and then checks the syntax of the input
+// against the BNF rules for the subset of Python we are
+// supporting.
 //
-// Call this once before you start calling parser_parse().
+// Returns NULL if a syntax error was found; in this case
+// an error message was output to the interpreter's output
+// stream. Returns a pointer to a list of tokens -- a Token
+// Queue -- if no syntax errors were detected. This queue
+// contains the complete input in token form for analysis
+// and execution.
 //
-void parser_init(void);
+// NOTE: it is the callers responsibility to free the resources
+// used by the Token Queue.
+//
+struct TokenQueue* parser_parse(struct Interpreter* interp, FILE* input);
 
 //
-// parser_parse
+// parser_isOperator
+//
+// Returns true if the token id is a binary operator, e.g.
+// + or <, false if not.
 //
-// Given an input stream, uses the scanner to obtain the tokens
-// and then checks the syntax of the input against the BNF rules
-// for the subset of Python we are supporting. 
+bool parser_isOperator(int id);
+
 //
-// Returns NULL if a syntax error was found; in this case 
-// an error message was output. Returns a pointer to a list
-// of tokens -- a Token Queue -- if no syntax errors were 
-// detected. This queue contains the complete input in token
-// form for analysis and execution.
+// parser_precedence
 //
-// NOTE: it is the callers responsibility to free the resources
-// used by the Token Queue.
+// Returns how tightly the binary operator binds: 4 for **, 3 for
+// *, / and %, 2 for + and -, and 1 for the comparisons, is and
+// in; 0 if the token id isn't a binary operator.
+//
+int parser_precedence(int id);
+
+//
+// parser_isValueStart
+//
+// Returns true if the token id starts a value, e.g. the value
+// after return: an element, a list, a dictionary, a unary
+// expression with a prefix, or a parenthesized expression.
 //
-struct TokenQueue* parser_parse(FILE* input);
+bool parser_isValueStart(int id);
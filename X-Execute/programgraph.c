@@ -0,0 +1,2128 @@
+/*programgraph.c*/
+
+//
+// Project: program graph data structure for nuPython
+//
+// The program graph is built from the tokens of a program that the
+// parser has already checked, so the builder can assume the syntax
+// is correct.
+//
+
+// open_memstream() is POSIX, not C11:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+#include <assert.h>
+#include <limits.h> // INT_MAX
+
+#include "token.h"
+#include "tokenqueue.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "programgraph.h"
+#include "builtins.h"
+#include "util.h"
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**PROGRAMGRAPH ERROR\n");
+  printf("**PROGRAMGRAPH ERROR: %s\n", msg);
+  printf("**PROGRAMGRAPH ERROR\n");
+
+  exit(-123);
+}
+
+//
+// pg_alloc
+//
+// Allocates N bytes for a node of the graph.
+//
+static void *pg_alloc(size_t N)
+{
+  void *p = malloc(N);
+  if (p == NULL)
+    panic("out of memory (pg_alloc)");
+
+  return p;
+}
+
+//
+// pg_advance
+//
+// Moves cur past the current token, which must have the
+// given id.
+//
+static void pg_advance(struct TokenNode **cur, int id)
+{
+  assert((*cur)->token.id == id);
+
+  *cur = (*cur)->next;
+}
+
+//
+// pg_build_element
+//
+// Builds an element from the current token, and advances
+// past it.
+//
+static struct ELEMENT *pg_build_element(struct TokenNode **cur)
+{
+  struct ELEMENT *element = (struct ELEMENT *)pg_alloc(sizeof(struct ELEMENT));
+
+  element->element_value = dupString((*cur)->value);
+  element->defined = ELEMENT_DEFINED_UNKNOWN;
+  element->slot = -1;
+
+  switch ((*cur)->token.id)
+  {
+  case nuPy_IDENTIFIER:
+    element->element_type = ELEMENT_IDENTIFIER;
+    break;
+  case nuPy_INT_LITERAL:
+    element->element_type = ELEMENT_INT_LITERAL;
+    break;
+  case nuPy_REAL_LITERAL:
+    element->element_type = ELEMENT_REAL_LITERAL;
+    break;
+  case nuPy_STR_LITERAL:
+    element->element_type = ELEMENT_STR_LITERAL;
+    break;
+  case nuPy_KEYW_TRUE:
+    element->element_type = ELEMENT_TRUE;
+    break;
+  case nuPy_KEYW_FALSE:
+    element->element_type = ELEMENT_FALSE;
+    break;
+  case nuPy_KEYW_NONE:
+    element->element_type = ELEMENT_NONE;
+    break;
+  default:
+    panic("unknown element type (pg_build_element)");
+  }
+
+  *cur = (*cur)->next;
+
+  return element;
+}
+
+//
+// pg_int_literal
+//
+// Builds the int literal with the given value, which isn't in
+// the tokens, e.g. the start of range(n).
+//
+static struct ELEMENT *pg_int_literal(char *value)
+{
+  struct ELEMENT *element = (struct ELEMENT *)pg_alloc(sizeof(struct ELEMENT));
+
+  element->element_type = ELEMENT_INT_LITERAL;
+  element->element_value = dupString(value);
+  element->defined = ELEMENT_DEFINED_UNKNOWN;
+  element->slot = -1;
+
+  return element;
+}
+
+//
+// pg_build_unary_expr
+//
+// Builds a unary expression: an element with an optional
+// *, &, + or - in front, or a variable with a subscript,
+// x[i] or x[i:j].
+//
+static struct UNARY_EXPR *pg_build_unary_expr(struct TokenNode **cur)
+{
+  struct UNARY_EXPR *unary = (struct UNARY_EXPR *)pg_alloc(sizeof(struct UNARY_EXPR));
+
+  int id = (*cur)->token.id;
+
+  if (id == nuPy_ASTERISK)
+    unary->expr_type = UNARY_PTR_DEREF;
+  else if (id == nuPy_AMPERSAND)
+    unary->expr_type = UNARY_ADDRESS_OF;
+  else if (id == nuPy_PLUS)
+    unary->expr_type = UNARY_PLUS;
+  else if (id == nuPy_MINUS)
+    unary->expr_type = UNARY_MINUS;
+  else
+    unary->expr_type = UNARY_ELEMENT;
+
+  if (unary->expr_type != UNARY_ELEMENT) // skip past the prefix:
+    *cur = (*cur)->next;
+
+  unary->element = pg_build_element(cur);
+  unary->index = NULL;
+  unary->end = NULL;
+  unary->expr = NULL;
+
+  if (unary->expr_type == UNARY_ELEMENT && (*cur)->token.id == nuPy_LEFT_BRACKET)
+  {
+    unary->expr_type = UNARY_INDEX;
+
+    *cur = (*cur)->next;
+
+    if ((*cur)->token.id != nuPy_COLON)
+      unary->index = pg_build_element(cur);
+
+    if ((*cur)->token.id == nuPy_COLON) // a slice:
+    {
+      unary->expr_type = UNARY_SLICE;
+
+      *cur = (*cur)->next;
+
+      if ((*cur)->token.id != nuPy_RIGHT_BRACKET)
+        unary->end = pg_build_element(cur);
+    }
+
+    pg_advance(cur, nuPy_RIGHT_BRACKET);
+  }
+
+  return unary;
+}
+
+//
+// pg_operator
+//
+// Maps the token id of a binary operator to its enum OPERATORS.
+//
+static int pg_operator(int id)
+{
+  switch (id)
+  {
+  case nuPy_PLUS:
+    return OPERATOR_PLUS;
+  case nuPy_MINUS:
+    return OPERATOR_MINUS;
+  case nuPy_ASTERISK:
+    return OPERATOR_ASTERISK;
+  case nuPy_POWER:
+    return OPERATOR_POWER;
+  case nuPy_PERCENT:
+    return OPERATOR_MOD;
+  case nuPy_SLASH:
+    return OPERATOR_DIV;
+  case nuPy_EQUALEQUAL:
+    return OPERATOR_EQUAL;
+  case nuPy_NOTEQUAL:
+    return OPERATOR_NOT_EQUAL;
+  case nuPy_LT:
+    return OPERATOR_LT;
+  case nuPy_LTE:
+    return OPERATOR_LTE;
+  case nuPy_GT:
+    return OPERATOR_GT;
+  case nuPy_GTE:
+    return OPERATOR_GTE;
+  case nuPy_KEYW_IS:
+    return OPERATOR_IS;
+  case nuPy_KEYW_IN:
+    return OPERATOR_IN;
+  default:
+    panic("unknown operator (pg_operator)");
+    return OPERATOR_NO_OP;
+  }
+}
+
+//
+// pg_build_expr
+//
+// Builds an expression: operands joined by binary operators, an
+// operand being a unary expression or a parenthesized expression.
+// The tree is built by precedence climbing, as it's parsed (see
+// parser_binary_expr), with a nested expression as a UNARY_NESTED
+// operand, and then lowered to the steps of the outermost
+// expression in postfix order (see VALUE_EXPR).
+//
+static struct VALUE_EXPR *pg_expr(struct UNARY_EXPR *lhs)
+{
+  struct VALUE_EXPR *expr = (struct VALUE_EXPR *)pg_alloc(sizeof(struct VALUE_EXPR));
+
+  expr->lhs = lhs;
+  expr->isBinaryExpr = false;
+  expr->operator = OPERATOR_NO_OP;
+  expr->types = EXPR_TYPES_UNKNOWN;
+  expr->rhs = NULL;
+  expr->num_steps = 0;
+  expr->steps = NULL;
+
+  return expr;
+}
+
+static struct UNARY_EXPR *pg_nested(struct VALUE_EXPR *expr)
+{
+  struct UNARY_EXPR *unary = (struct UNARY_EXPR *)pg_alloc(sizeof(struct UNARY_EXPR));
+
+  unary->expr_type = UNARY_NESTED;
+  unary->element = NULL;
+  unary->index = NULL;
+  unary->end = NULL;
+  unary->expr = expr;
+
+  return unary;
+}
+
+static struct VALUE_EXPR *pg_build_tree(struct TokenNode **cur, int min_precedence);
+
+static struct UNARY_EXPR *pg_build_operand(struct TokenNode **cur)
+{
+  if ((*cur)->token.id != nuPy_LEFT_PAREN)
+    return pg_build_unary_expr(cur);
+
+  *cur = (*cur)->next;
+
+  struct VALUE_EXPR *expr = pg_build_tree(cur, 1);
+
+  pg_advance(cur, nuPy_RIGHT_PAREN);
+
+  if (expr->isBinaryExpr)
+    return pg_nested(expr);
+
+  struct UNARY_EXPR *unary = expr->lhs; // (x) is just x
+
+  free(expr);
+
+  return unary;
+}
+
+static struct VALUE_EXPR *pg_build_tree(struct TokenNode **cur, int min_precedence)
+{
+  struct VALUE_EXPR *expr = pg_expr(pg_build_operand(cur));
+  bool compared = false;
+
+  while (true)
+  {
+    int id = (*cur)->token.id;
+    int precedence = parser_precedence(id);
+
+    if (precedence == 0 || precedence < min_precedence || (precedence == 1 && compared))
+      return expr;
+
+    compared = compared || (precedence == 1);
+
+    if (expr->isBinaryExpr) // the expression so far is the lhs:
+      expr = pg_expr(pg_nested(expr));
+
+    expr->isBinaryExpr = true;
+    expr->operator = pg_operator(id);
+
+    *cur = (*cur)->next;
+
+    struct VALUE_EXPR *rhs = pg_build_tree(cur, (id == nuPy_POWER) ? precedence : precedence + 1);
+
+    if (rhs->isBinaryExpr)
+    {
+      expr->rhs = pg_nested(rhs);
+    }
+    else
+    {
+      expr->rhs = rhs->lhs;
+      free(rhs);
+    }
+  }
+}
+
+//
+// pg_count_steps, pg_lower_operands, pg_lower_nested
+//
+// Count and lower the steps of the given expression's operands,
+// in postfix order; an operand evaluated before a nested rhs is
+// lowered to a step of its own.
+//
+static bool pg_is_nested(struct UNARY_EXPR *unary)
+{
+  return unary != NULL && unary->expr_type == UNARY_NESTED;
+}
+
+static int pg_count_steps(struct VALUE_EXPR *expr)
+{
+  int count = 0;
+
+  if (pg_is_nested(expr->lhs))
+    count += pg_count_steps(expr->lhs->expr) + 1;
+  else if (pg_is_nested(expr->rhs))
+    count++;
+
+  if (pg_is_nested(expr->rhs))
+    count += pg_count_steps(expr->rhs->expr) + 1;
+
+  return count;
+}
+
+static void pg_lower_nested(struct UNARY_EXPR *nested, struct VALUE_EXPR *steps, int *num_steps);
+
+static void pg_lower_operands(struct VALUE_EXPR *expr, struct VALUE_EXPR *steps, int *num_steps)
+{
+  if (pg_is_nested(expr->lhs))
+  {
+    pg_lower_nested(expr->lhs, steps, num_steps);
+  }
+  else if (pg_is_nested(expr->rhs))
+  {
+    struct VALUE_EXPR *step = &steps[(*num_steps)++];
+    struct VALUE_EXPR *lhs = pg_expr(expr->lhs);
+
+    *step = *lhs;
+    free(lhs);
+
+    expr->lhs = pg_nested(step);
+  }
+
+  if (pg_is_nested(expr->rhs))
+    pg_lower_nested(expr->rhs, steps, num_steps);
+}
+
+static void pg_lower_nested(struct UNARY_EXPR *nested, struct VALUE_EXPR *steps, int *num_steps)
+{
+  struct VALUE_EXPR *node = nested->expr;
+
+  pg_lower_operands(node, steps, num_steps);
+
+  struct VALUE_EXPR *step = &steps[(*num_steps)++];
+
+  *step = *node;
+  free(node);
+
+  nested->expr = step;
+}
+
+static struct VALUE_EXPR *pg_build_expr(struct TokenNode **cur)
+{
+  struct VALUE_EXPR *expr = pg_build_tree(cur, 1);
+
+  if (!expr->isBinaryExpr && pg_is_nested(expr->lhs)) // (x + 1) is just x + 1
+  {
+    struct VALUE_EXPR *inner = expr->lhs->expr;
+
+    free(expr->lhs);
+    free(expr);
+
+    expr = inner;
+  }
+
+  int count = pg_count_steps(expr);
+
+  if (count > 0)
+  {
+    expr->steps = (struct VALUE_EXPR *)pg_alloc(count * sizeof(struct VALUE_EXPR));
+
+    pg_lower_operands(expr, expr->steps, &expr->num_steps);
+
+    assert(expr->num_steps == count);
+  }
+
+  return expr;
+}
+
+//
+// pg_build_condition
+//
+// Builds a condition: expressions joined by and, or and not, with
+// not binding tighter than and, and and than or; and and or group
+// to the left.
+//
+static struct CONDITION *pg_condition(int type, struct VALUE_EXPR *expr, struct CONDITION *lhs, struct CONDITION *rhs)
+{
+  struct CONDITION *condition = (struct CONDITION *)pg_alloc(sizeof(struct CONDITION));
+
+  condition->condition_type = type;
+  condition->expr = expr;
+  condition->lhs = lhs;
+  condition->rhs = rhs;
+
+  return condition;
+}
+
+static struct CONDITION *pg_build_not_condition(struct TokenNode **cur)
+{
+  if ((*cur)->token.id == nuPy_KEYW_NOT)
+  {
+    *cur = (*cur)->next;
+
+    return pg_condition(CONDITION_NOT, NULL, pg_build_not_condition(cur), NULL);
+  }
+
+  return pg_condition(CONDITION_EXPR, pg_build_expr(cur), NULL, NULL);
+}
+
+static struct CONDITION *pg_build_and_condition(struct TokenNode **cur)
+{
+  struct CONDITION *condition = pg_build_not_condition(cur);
+
+  while ((*cur)->token.id == nuPy_KEYW_AND)
+  {
+    *cur = (*cur)->next;
+
+    condition = pg_condition(CONDITION_AND, NULL, condition, pg_build_not_condition(cur));
+  }
+
+  return condition;
+}
+
+static struct CONDITION *pg_build_condition(struct TokenNode **cur)
+{
+  struct CONDITION *condition = pg_build_and_condition(cur);
+
+  while ((*cur)->token.id == nuPy_KEYW_OR)
+  {
+    *cur = (*cur)->next;
+
+    condition = pg_condition(CONDITION_OR, NULL, condition, pg_build_and_condition(cur));
+  }
+
+  return condition;
+}
+
+//
+// pg_build_elements
+//
+// Builds the elements up to the given closing token, separated
+// by commas, e.g. the items of a list, advancing past the closing
+// token. Returns the array of elements (NULL if there are none),
+// and the number of elements via *count.
+//
+static struct ELEMENT **pg_build_elements(struct TokenNode **cur, int close, int *count)
+{
+  struct ELEMENT **elements = NULL;
+  int capacity = 0;
+
+  *count = 0;
+
+  while ((*cur)->token.id != close)
+  {
+    if (*count == capacity)
+    {
+      capacity = (capacity == 0) ? 4 : 2 * capacity;
+      elements = (struct ELEMENT **)realloc(elements, capacity * sizeof(struct ELEMENT *));
+
+      if (elements == NULL)
+        panic("out of memory (pg_build_elements)");
+    }
+
+    elements[(*count)++] = pg_build_element(cur);
+
+    if ((*cur)->token.id == nuPy_COMMA)
+      *cur = (*cur)->next;
+  }
+
+  pg_advance(cur, close);
+
+  return elements;
+}
+
+//
+// pg_build_call
+//
+// Builds the name and parameters of a function call such as
+// print(x), or of a method call if method is true, advancing
+// past the closing ). The name is looked up in the interpreter's
+// registry, and the function's ID stored in *builtin
+// (BUILTIN_UNRESOLVED if it isn't registered yet); calls of the
+// program's own functions are bound later, by pg_bind_calls.
+//
+static void pg_build_call(struct Interpreter *interp, struct TokenNode **cur, bool method, char **function_name, int *builtin,
+                          int *num_parameters, struct ELEMENT ***parameters)
+{
+  assert((*cur)->token.id == nuPy_IDENTIFIER);
+
+  *function_name = dupString((*cur)->value);
+  *builtin = builtins_resolve(interp->builtins, *function_name, method);
+
+  *cur = (*cur)->next;
+  pg_advance(cur, nuPy_LEFT_PAREN);
+
+  *parameters = pg_build_elements(cur, nuPy_RIGHT_PAREN, num_parameters);
+}
+
+//
+// pg_build_list
+//
+// Builds a list of elements such as [1, x, 'abc'], advancing
+// past the closing ].
+//
+static struct VALUE_LIST *pg_build_list(struct TokenNode **cur)
+{
+  struct VALUE_LIST *list = (struct VALUE_LIST *)pg_alloc(sizeof(struct VALUE_LIST));
+
+  pg_advance(cur, nuPy_LEFT_BRACKET);
+
+  list->elements = pg_build_elements(cur, nuPy_RIGHT_BRACKET, &list->num_elements);
+
+  return list;
+}
+
+//
+// pg_build_dict
+//
+// Builds a dictionary of entries such as {'a': 1, x: y},
+// advancing past the closing }.
+//
+static struct VALUE_DICT *pg_build_dict(struct TokenNode **cur)
+{
+  struct VALUE_DICT *dict = (struct VALUE_DICT *)pg_alloc(sizeof(struct VALUE_DICT));
+  int capacity = 0;
+
+  dict->num_entries = 0;
+  dict->keys = NULL;
+  dict->values = NULL;
+
+  pg_advance(cur, nuPy_LEFT_BRACE);
+
+  while ((*cur)->token.id != nuPy_RIGHT_BRACE)
+  {
+    if (dict->num_entries == capacity)
+    {
+      capacity = (capacity == 0) ? 4 : 2 * capacity;
+      dict->keys = (struct ELEMENT **)realloc(dict->keys, capacity * sizeof(struct ELEMENT *));
+      dict->values = (struct ELEMENT **)realloc(dict->values, capacity * sizeof(struct ELEMENT *));
+
+      if (dict->keys == NULL || dict->values == NULL)
+        panic("out of memory (pg_build_dict)");
+    }
+
+    dict->keys[dict->num_entries] = pg_build_element(cur);
+    pg_advance(cur, nuPy_COLON);
+    dict->values[dict->num_entries] = pg_build_element(cur);
+    dict->num_entries++;
+
+    if ((*cur)->token.id == nuPy_COMMA)
+      *cur = (*cur)->next;
+  }
+
+  pg_advance(cur, nuPy_RIGHT_BRACE);
+
+  return dict;
+}
+
+//
+// pg_build_value
+//
+// Builds the right-hand side of an assignment: a function
+// call, a list, a dictionary or an expression.
+//
+static struct VALUE *pg_build_value(struct Interpreter *interp, struct TokenNode **cur)
+{
+  struct VALUE *value = (struct VALUE *)pg_alloc(sizeof(struct VALUE));
+
+  if ((*cur)->token.id == nuPy_IDENTIFIER && (*cur)->next->token.id == nuPy_LEFT_PAREN)
+  {
+    value->value_type = VALUE_FUNCTION_CALL;
+    value->types.function_call = (struct VALUE_FUNCTION_CALL *)pg_alloc(sizeof(struct VALUE_FUNCTION_CALL));
+
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+    call->function = NULL;
+    pg_build_call(interp, cur, false, &call->function_name, &call->builtin, &call->num_parameters, &call->parameters);
+  }
+  else if ((*cur)->token.id == nuPy_LEFT_BRACKET)
+  {
+    value->value_type = VALUE_LIST;
+    value->types.list = pg_build_list(cur);
+  }
+  else if ((*cur)->token.id == nuPy_LEFT_BRACE)
+  {
+    value->value_type = VALUE_DICT;
+    value->types.dict = pg_build_dict(cur);
+  }
+  else
+  {
+    value->value_type = VALUE_EXPR;
+    value->types.expr = pg_build_expr(cur);
+  }
+
+  return value;
+}
+
+//
+// pg_local
+//
+// Returns the slot of the named local of the function, or -1
+// if it isn't one.
+//
+static int pg_local(struct STMT_DEF *def, char *name)
+{
+  for (int slot = 0; slot < def->num_locals; slot++)
+    if (strcmp(def->locals[slot], name) == 0)
+      return slot;
+
+  return -1;
+}
+
+//
+// pg_add_local
+//
+// Adds the named variable to the function's locals, unless it's
+// one already.
+//
+static void pg_add_local(struct STMT_DEF *def, char *name)
+{
+  if (pg_local(def, name) >= 0)
+    return;
+
+  def->locals = (char **)realloc(def->locals, (def->num_locals + 1) * sizeof(char *));
+  if (def->locals == NULL)
+    panic("out of memory (pg_add_local)");
+
+  def->locals[def->num_locals++] = dupString(name);
+}
+
+//
+// pg_collect_locals
+//
+// Adds the variables the statements assign to the function's
+// locals, as Python does: x in x = ... and in for x in ..., but
+// not in x[i] = ..., which assigns an item of x.
+//
+static void pg_collect_locals(struct STMT_DEF *def, struct STMT *stmt)
+{
+  while (stmt != NULL)
+  {
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+      if (!assign->isPtrDeref && assign->index == NULL)
+        pg_add_local(def, assign->var_name);
+
+      stmt = assign->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      stmt = stmt->types.function_call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      pg_collect_locals(def, stmt->types.while_loop->loop_body);
+
+      stmt = stmt->types.while_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      pg_add_local(def, stmt->types.for_loop->var_name);
+      pg_collect_locals(def, stmt->types.for_loop->loop_body);
+
+      stmt = stmt->types.for_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+}
+
+//
+// pg_slot_element, pg_slot_unary_expr, pg_slot_expr, pg_slot_value,
+// pg_slot_condition
+//
+// Set the slot of every identifier in the given part of the graph
+// that names a local of the function; NULL is ignored.
+//
+static void pg_slot_element(struct STMT_DEF *def, struct ELEMENT *element)
+{
+  if (element != NULL && element->element_type == ELEMENT_IDENTIFIER)
+    element->slot = pg_local(def, element->element_value);
+}
+
+static void pg_slot_unary_expr(struct STMT_DEF *def, struct UNARY_EXPR *unary)
+{
+  if (unary == NULL)
+    return;
+
+  pg_slot_element(def, unary->element);
+  pg_slot_element(def, unary->index);
+  pg_slot_element(def, unary->end);
+}
+
+static void pg_slot_expr(struct STMT_DEF *def, struct VALUE_EXPR *expr)
+{
+  for (int i = 0; i < expr->num_steps; i++)
+    pg_slot_expr(def, &expr->steps[i]);
+
+  pg_slot_unary_expr(def, expr->lhs);
+  pg_slot_unary_expr(def, expr->rhs);
+}
+
+static void pg_slot_condition(struct STMT_DEF *def, struct CONDITION *condition)
+{
+  if (condition == NULL)
+    return;
+
+  if (condition->expr != NULL)
+    pg_slot_expr(def, condition->expr);
+
+  pg_slot_condition(def, condition->lhs);
+  pg_slot_condition(def, condition->rhs);
+}
+
+static void pg_slot_value(struct STMT_DEF *def, struct VALUE *value)
+{
+  if (value == NULL)
+    return;
+
+  if (value->value_type == VALUE_FUNCTION_CALL)
+  {
+    for (int i = 0; i < value->types.function_call->num_parameters; i++)
+      pg_slot_element(def, value->types.function_call->parameters[i]);
+  }
+  else if (value->value_type == VALUE_LIST)
+  {
+    for (int i = 0; i < value->types.list->num_elements; i++)
+      pg_slot_element(def, value->types.list->elements[i]);
+  }
+  else if (value->value_type == VALUE_DICT)
+  {
+    for (int i = 0; i < value->types.dict->num_entries; i++)
+    {
+      pg_slot_element(def, value->types.dict->keys[i]);
+      pg_slot_element(def, value->types.dict->values[i]);
+    }
+  }
+  else
+  {
+    pg_slot_expr(def, value->types.expr);
+  }
+}
+
+//
+// pg_bind_slots
+//
+// Sets the slots of the function's locals in the statements of
+// its body, where they're read and assigned.
+//
+static void pg_bind_slots(struct STMT_DEF *def, struct STMT *stmt)
+{
+  while (stmt != NULL)
+  {
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+      if (!assign->isPtrDeref)
+        assign->slot = pg_local(def, assign->var_name);
+
+      pg_slot_element(def, assign->index);
+      pg_slot_value(def, assign->rhs);
+
+      stmt = assign->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+      pg_slot_element(def, call->object);
+      for (int i = 0; i < call->num_parameters; i++)
+        pg_slot_element(def, call->parameters[i]);
+
+      stmt = call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      pg_slot_condition(def, stmt->types.while_loop->condition);
+      pg_bind_slots(def, stmt->types.while_loop->loop_body);
+
+      stmt = stmt->types.while_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+      loop->slot = pg_local(def, loop->var_name);
+      pg_slot_element(def, loop->start);
+      pg_slot_element(def, loop->stop);
+      pg_slot_element(def, loop->step);
+      pg_bind_slots(def, loop->loop_body);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      pg_slot_value(def, stmt->types.return_stmt->value);
+
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+}
+
+//
+// pg_build_stmts
+//
+// Builds the statements up to (but not including) the given
+// stop token: EOS for the program, } for the body of a loop or
+// function; in_function says if they're in a function's body.
+// The statements are linked together through their next_stmt
+// fields, and the last one's next_stmt is NULL. Returns true
+// if successful; otherwise an error message is output, and
+// false is returned with whatever was built in *first.
+//
+static bool pg_build_stmts(struct Interpreter *interp, struct TokenNode **cur, int stop, bool in_function, struct STMT **first)
+{
+  struct STMT **link = first; // where to store the next stmt
+
+  *link = NULL;
+
+  while ((*cur)->token.id != stop)
+  {
+    struct TokenNode *start = *cur;
+
+    if (start->token.id == nuPy_KEYW_IF)
+    {
+      fprintf(interp->output, "**PROGRAMGRAPH ERROR: if statements are not yet supported (line %d)\n",
+              start->token.line);
+      return false;
+    }
+
+    if (start->token.id == nuPy_KEYW_DEF && stop != nuPy_EOS)
+    {
+      fprintf(interp->output, "**PROGRAMGRAPH ERROR: functions must be defined at the top level (line %d)\n",
+              start->token.line);
+      return false;
+    }
+
+    if (start->token.id == nuPy_KEYW_RETURN && !in_function)
+    {
+      fprintf(interp->output, "**PROGRAMGRAPH ERROR: 'return' outside function (line %d)\n", start->token.line);
+      return false;
+    }
+
+    struct STMT *stmt = (struct STMT *)pg_alloc(sizeof(struct STMT));
+
+    stmt->line = start->token.line;
+
+    *link = stmt;
+
+    if (start->token.id == nuPy_KEYW_PASS)
+    {
+      stmt->stmt_type = STMT_PASS;
+      stmt->types.pass = (struct STMT_PASS *)pg_alloc(sizeof(struct STMT_PASS));
+      stmt->types.pass->next_stmt = NULL;
+
+      *cur = start->next;
+
+      link = &stmt->types.pass->next_stmt;
+    }
+    else if (start->token.id == nuPy_KEYW_DEF)
+    {
+      struct STMT_DEF *def = (struct STMT_DEF *)pg_alloc(sizeof(struct STMT_DEF));
+
+      stmt->stmt_type = STMT_DEF;
+      stmt->types.def = def;
+      def->num_params = 0;
+      def->num_locals = 0;
+      def->locals = NULL;
+      def->body = NULL;
+      def->next_stmt = NULL;
+
+      *cur = start->next;
+
+      def->function_name = dupString((*cur)->value);
+      *cur = (*cur)->next;
+
+      pg_advance(cur, nuPy_LEFT_PAREN);
+
+      while ((*cur)->token.id != nuPy_RIGHT_PAREN)
+      {
+        if (pg_local(def, (*cur)->value) >= 0)
+        {
+          fprintf(interp->output, "**PROGRAMGRAPH ERROR: duplicate parameter '%s' in function definition (line %d)\n",
+                  (*cur)->value, start->token.line);
+          return false;
+        }
+
+        pg_add_local(def, (*cur)->value);
+        def->num_params++;
+
+        *cur = (*cur)->next;
+
+        if ((*cur)->token.id == nuPy_COMMA)
+          *cur = (*cur)->next;
+      }
+
+      pg_advance(cur, nuPy_RIGHT_PAREN);
+      pg_advance(cur, nuPy_COLON);
+      pg_advance(cur, nuPy_LEFT_BRACE);
+
+      if (!pg_build_stmts(interp, cur, nuPy_RIGHT_BRACE, true, &def->body))
+        return false;
+
+      pg_advance(cur, nuPy_RIGHT_BRACE);
+
+      pg_collect_locals(def, def->body);
+      pg_bind_slots(def, def->body);
+
+      link = &def->next_stmt;
+    }
+    else if (start->token.id == nuPy_KEYW_RETURN)
+    {
+      struct STMT_RETURN *ret = (struct STMT_RETURN *)pg_alloc(sizeof(struct STMT_RETURN));
+
+      stmt->stmt_type = STMT_RETURN;
+      stmt->types.return_stmt = ret;
+      ret->value = NULL;
+      ret->next_stmt = NULL;
+
+      *cur = start->next;
+
+      if ((*cur)->token.line == start->token.line && parser_isValueStart((*cur)->token.id))
+        ret->value = pg_build_value(interp, cur);
+
+      link = &ret->next_stmt;
+    }
+    else if (start->token.id == nuPy_KEYW_WHILE)
+    {
+      struct STMT_WHILE_LOOP *loop = (struct STMT_WHILE_LOOP *)pg_alloc(sizeof(struct STMT_WHILE_LOOP));
+
+      stmt->stmt_type = STMT_WHILE_LOOP;
+      stmt->types.while_loop = loop;
+      loop->preheader = NULL; // see optimizer_licm
+      loop->loop_body = NULL;
+      loop->next_stmt = NULL;
+
+      *cur = start->next;
+
+      loop->condition = pg_build_condition(cur);
+
+      pg_advance(cur, nuPy_COLON);
+      pg_advance(cur, nuPy_LEFT_BRACE);
+
+      if (!pg_build_stmts(interp, cur, nuPy_RIGHT_BRACE, in_function, &loop->loop_body))
+        return false;
+
+      pg_advance(cur, nuPy_RIGHT_BRACE);
+
+      link = &loop->next_stmt;
+    }
+    else if (start->token.id == nuPy_KEYW_FOR)
+    {
+      struct STMT_FOR_LOOP *loop = (struct STMT_FOR_LOOP *)pg_alloc(sizeof(struct STMT_FOR_LOOP));
+      struct ELEMENT *args[3];
+      int num_args = 0;
+
+      stmt->stmt_type = STMT_FOR_LOOP;
+      stmt->types.for_loop = loop;
+      loop->loop_body = NULL;
+      loop->next_stmt = NULL;
+
+      *cur = start->next;
+
+      loop->var_name = dupString((*cur)->value);
+      loop->slot = -1;
+      *cur = (*cur)->next;
+
+      pg_advance(cur, nuPy_KEYW_IN);
+      pg_advance(cur, nuPy_IDENTIFIER); // range
+      pg_advance(cur, nuPy_LEFT_PAREN);
+
+      args[num_args++] = pg_build_element(cur);
+
+      while ((*cur)->token.id == nuPy_COMMA)
+      {
+        *cur = (*cur)->next;
+        args[num_args++] = pg_build_element(cur);
+      }
+
+      pg_advance(cur, nuPy_RIGHT_PAREN);
+
+      loop->start = (num_args == 1) ? pg_int_literal("0") : args[0];
+      loop->stop = (num_args == 1) ? args[0] : args[1];
+      loop->step = (num_args == 3) ? args[2] : pg_int_literal("1");
+
+      pg_advance(cur, nuPy_COLON);
+      pg_advance(cur, nuPy_LEFT_BRACE);
+
+      if (!pg_build_stmts(interp, cur, nuPy_RIGHT_BRACE, in_function, &loop->loop_body))
+        return false;
+
+      pg_advance(cur, nuPy_RIGHT_BRACE);
+
+      link = &loop->next_stmt;
+    }
+    else if (start->token.id == nuPy_IDENTIFIER &&
+             (start->next->token.id == nuPy_LEFT_PAREN || start->next->token.id == nuPy_DOT))
+    {
+      struct STMT_FUNCTION_CALL *call = (struct STMT_FUNCTION_CALL *)pg_alloc(sizeof(struct STMT_FUNCTION_CALL));
+
+      stmt->stmt_type = STMT_FUNCTION_CALL;
+      stmt->types.function_call = call;
+      call->function = NULL;
+      call->object = NULL;
+      call->next_stmt = NULL;
+
+      if (start->next->token.id == nuPy_DOT) // x.append(1):
+      {
+        call->object = pg_build_element(cur);
+        pg_advance(cur, nuPy_DOT);
+      }
+
+      pg_build_call(interp, cur, call->object != NULL, &call->function_name, &call->builtin, &call->num_parameters,
+                    &call->parameters);
+
+      link = &call->next_stmt;
+    }
+    else // assignment:
+    {
+      struct STMT_ASSIGNMENT *assign = (struct STMT_ASSIGNMENT *)pg_alloc(sizeof(struct STMT_ASSIGNMENT));
+
+      stmt->stmt_type = STMT_ASSIGNMENT;
+      stmt->types.assignment = assign;
+      assign->next_stmt = NULL;
+      assign->rhs = NULL;
+
+      assign->isPtrDeref = (start->token.id == nuPy_ASTERISK);
+      if (assign->isPtrDeref)
+        *cur = (*cur)->next;
+
+      assert((*cur)->token.id == nuPy_IDENTIFIER);
+      assign->var_name = dupString((*cur)->value);
+      assign->slot = -1;
+      *cur = (*cur)->next;
+
+      assign->index = NULL;
+
+      if ((*cur)->token.id == nuPy_LEFT_BRACKET) // x[i] = ...
+      {
+        *cur = (*cur)->next;
+        assign->index = pg_build_element(cur);
+        pg_advance(cur, nuPy_RIGHT_BRACKET);
+      }
+
+      pg_advance(cur, nuPy_EQUAL);
+
+      assign->rhs = pg_build_value(interp, cur);
+
+      link = &assign->next_stmt;
+    }
+  }
+
+  return true;
+}
+
+//
+// pg_find_def
+//
+// Returns the STMT_DEF of the named function, or NULL if the
+// program doesn't define one.
+//
+static struct STMT *pg_find_def(struct STMT **defs, int num_defs, char *name)
+{
+  for (int i = 0; i < num_defs; i++)
+    if (strcmp(defs[i]->types.def->function_name, name) == 0)
+      return defs[i];
+
+  return NULL;
+}
+
+//
+// pg_bind_calls
+//
+// Binds the calls in the statements, including those in loop and
+// function bodies, to the functions the program defines, given
+// their defs; these take the place of any builtins with the same
+// names.
+//
+static void pg_bind_calls(struct STMT *stmt, struct STMT **defs, int num_defs)
+{
+  while (stmt != NULL)
+  {
+    if (stmt->stmt_type == STMT_ASSIGNMENT || stmt->stmt_type == STMT_RETURN)
+    {
+      struct VALUE *value = (stmt->stmt_type == STMT_ASSIGNMENT) ? stmt->types.assignment->rhs : stmt->types.return_stmt->value;
+
+      if (value != NULL && value->value_type == VALUE_FUNCTION_CALL)
+      {
+        struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+        call->function = pg_find_def(defs, num_defs, call->function_name);
+        if (call->function != NULL)
+          call->builtin = BUILTIN_UNRESOLVED;
+      }
+
+      stmt = (stmt->stmt_type == STMT_ASSIGNMENT) ? stmt->types.assignment->next_stmt : stmt->types.return_stmt->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+      if (call->object == NULL)
+        call->function = pg_find_def(defs, num_defs, call->function_name);
+      if (call->function != NULL)
+        call->builtin = BUILTIN_UNRESOLVED;
+
+      stmt = call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      pg_bind_calls(stmt->types.while_loop->loop_body, defs, num_defs);
+
+      stmt = stmt->types.while_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      pg_bind_calls(stmt->types.for_loop->loop_body, defs, num_defs);
+
+      stmt = stmt->types.for_loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      pg_bind_calls(stmt->types.def->body, defs, num_defs);
+
+      stmt = stmt->types.def->next_stmt;
+    }
+    else // STMT_PASS
+    {
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }
+}
+
+//
+// pg_bind_program
+//
+// Collects the functions the program defines, and binds the calls
+// of them. Returns true if successful; if a function is defined
+// twice, an error message is output and false is returned.
+//
+static bool pg_bind_program(struct Interpreter *interp, struct STMT *program)
+{
+  struct STMT **defs = NULL;
+  int num_defs = 0;
+  bool success = true;
+
+  for (struct STMT *stmt = program; stmt != NULL;)
+  {
+    if (stmt->stmt_type == STMT_DEF)
+    {
+      if (pg_find_def(defs, num_defs, stmt->types.def->function_name) != NULL)
+      {
+        fprintf(interp->output, "**PROGRAMGRAPH ERROR: function '%s' is already defined (line %d)\n",
+                stmt->types.def->function_name, stmt->line);
+        success = false;
+        break;
+      }
+
+      defs = (struct STMT **)realloc(defs, (num_defs + 1) * sizeof(struct STMT *));
+      if (defs == NULL)
+        panic("out of memory (pg_bind_program)");
+
+      defs[num_defs++] = stmt;
+    }
+
+    switch (stmt->stmt_type)
+    {
+    case STMT_ASSIGNMENT:
+      stmt = stmt->types.assignment->next_stmt;
+      break;
+    case STMT_FUNCTION_CALL:
+      stmt = stmt->types.function_call->next_stmt;
+      break;
+    case STMT_WHILE_LOOP:
+      stmt = stmt->types.while_loop->next_stmt;
+      break;
+    case STMT_FOR_LOOP:
+      stmt = stmt->types.for_loop->next_stmt;
+      break;
+    case STMT_DEF:
+      stmt = stmt->types.def->next_stmt;
+      break;
+    default: // STMT_PASS
+      stmt = stmt->types.pass->next_stmt;
+      break;
+    }
+  }
+
+  if (success && num_defs > 0)
+    pg_bind_calls(program, defs, num_defs);
+
+  free(defs);
+
+  return success;
+}
+
+//
+// pg_destroy_element, pg_destroy_unary_expr, pg_destroy_expr,
+// pg_destroy_condition, pg_destroy_value
+//
+// Free the given part of the graph; NULL is ignored.
+//
+static void pg_destroy_element(struct ELEMENT *element)
+{
+  if (element == NULL)
+    return;
+
+  free(element->element_value);
+  free(element);
+}
+
+static void pg_destroy_unary_expr(struct UNARY_EXPR *unary)
+{
+  if (unary == NULL)
+    return;
+
+  pg_destroy_element(unary->element);
+  pg_destroy_element(unary->index);
+  pg_destroy_element(unary->end);
+  free(unary);
+}
+
+static void pg_destroy_expr(struct VALUE_EXPR *expr)
+{
+  if (expr == NULL)
+    return;
+
+  for (int i = 0; i < expr->num_steps; i++)
+  {
+    pg_destroy_unary_expr(expr->steps[i].lhs);
+    pg_destroy_unary_expr(expr->steps[i].rhs);
+  }
+
+  free(expr->steps);
+  pg_destroy_unary_expr(expr->lhs);
+  pg_destroy_unary_expr(expr->rhs);
+  free(expr);
+}
+
+static void pg_destroy_condition(struct CONDITION *condition)
+{
+  if (condition == NULL)
+    return;
+
+  pg_destroy_expr(condition->expr);
+  pg_destroy_condition(condition->lhs);
+  pg_destroy_condition(condition->rhs);
+  free(condition);
+}
+
+static void pg_destroy_value(struct VALUE *value)
+{
+  if (value == NULL)
+    return;
+
+  if (value->value_type == VALUE_FUNCTION_CALL)
+  {
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+    free(call->function_name);
+    for (int i = 0; i < call->num_parameters; i++)
+      pg_destroy_element(call->parameters[i]);
+
+    free(call->parameters);
+    free(call);
+  }
+  else if (value->value_type == VALUE_LIST)
+  {
+    for (int i = 0; i < value->types.list->num_elements; i++)
+      pg_destroy_element(value->types.list->elements[i]);
+
+    free(value->types.list->elements);
+    free(value->types.list);
+  }
+  else if (value->value_type == VALUE_DICT)
+  {
+    for (int i = 0; i < value->types.dict->num_entries; i++)
+    {
+      pg_destroy_element(value->types.dict->keys[i]);
+      pg_destroy_element(value->types.dict->values[i]);
+    }
+
+    free(value->types.dict->keys);
+    free(value->types.dict->values);
+    free(value->types.dict);
+  }
+  else
+  {
+    pg_destroy_expr(value->types.expr);
+  }
+
+  free(value);
+}
+
+//
+// pg_copy_element, pg_copy_elements, pg_copy_unary_expr,
+// pg_copy_expr, pg_copy_condition, pg_copy_value
+//
+// Return a copy of the given part of the graph, sharing nothing
+// with it but the defs that calls are bound to; NULL is copied
+// as NULL.
+//
+static struct ELEMENT *pg_copy_element(struct ELEMENT *element)
+{
+  if (element == NULL)
+    return NULL;
+
+  struct ELEMENT *copy = (struct ELEMENT *)pg_alloc(sizeof(struct ELEMENT));
+
+  *copy = *element;
+  copy->element_value = dupString(element->element_value);
+
+  return copy;
+}
+
+static struct ELEMENT **pg_copy_elements(struct ELEMENT **elements, int count)
+{
+  if (count == 0)
+    return NULL;
+
+  struct ELEMENT **copy = (struct ELEMENT **)pg_alloc(count * sizeof(struct ELEMENT *));
+
+  for (int i = 0; i < count; i++)
+    copy[i] = pg_copy_element(elements[i]);
+
+  return copy;
+}
+
+static struct UNARY_EXPR *pg_copy_unary_expr(struct UNARY_EXPR *unary)
+{
+  if (unary == NULL)
+    return NULL;
+
+  struct UNARY_EXPR *copy = (struct UNARY_EXPR *)pg_alloc(sizeof(struct UNARY_EXPR));
+
+  *copy = *unary;
+  copy->element = pg_copy_element(unary->element);
+  copy->index = pg_copy_element(unary->index);
+  copy->end = pg_copy_element(unary->end);
+
+  return copy;
+}
+
+static struct UNARY_EXPR *pg_copy_operand(struct UNARY_EXPR *unary, struct VALUE_EXPR *steps, struct VALUE_EXPR *copied_steps)
+{
+  struct UNARY_EXPR *copy = pg_copy_unary_expr(unary);
+
+  if (pg_is_nested(copy)) // the same step of the copy:
+    copy->expr = copied_steps + (unary->expr - steps);
+
+  return copy;
+}
+
+static struct VALUE_EXPR *pg_copy_expr(struct VALUE_EXPR *expr)
+{
+  if (expr == NULL)
+    return NULL;
+
+  struct VALUE_EXPR *copy = (struct VALUE_EXPR *)pg_alloc(sizeof(struct VALUE_EXPR));
+
+  *copy = *expr;
+
+  if (expr->num_steps > 0)
+  {
+    copy->steps = (struct VALUE_EXPR *)pg_alloc(expr->num_steps * sizeof(struct VALUE_EXPR));
+
+    for (int i = 0; i < expr->num_steps; i++)
+    {
+      copy->steps[i] = expr->steps[i];
+      copy->steps[i].lhs = pg_copy_operand(expr->steps[i].lhs, expr->steps, copy->steps);
+      copy->steps[i].rhs = pg_copy_operand(expr->steps[i].rhs, expr->steps, copy->steps);
+    }
+  }
+
+  copy->lhs = pg_copy_operand(expr->lhs, expr->steps, copy->steps);
+  copy->rhs = pg_copy_operand(expr->rhs, expr->steps, copy->steps);
+
+  return copy;
+}
+
+static struct CONDITION *pg_copy_condition(struct CONDITION *condition)
+{
+  if (condition == NULL)
+    return NULL;
+
+  return pg_condition(condition->condition_type, pg_copy_expr(condition->expr),
+                      pg_copy_condition(condition->lhs), pg_copy_condition(condition->rhs));
+}
+
+static struct VALUE *pg_copy_value(struct VALUE *value)
+{
+  if (value == NULL)
+    return NULL;
+
+  struct VALUE *copy = (struct VALUE *)pg_alloc(sizeof(struct VALUE));
+
+  copy->value_type = value->value_type;
+
+  if (value->value_type == VALUE_FUNCTION_CALL)
+  {
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+    struct VALUE_FUNCTION_CALL *call_copy = (struct VALUE_FUNCTION_CALL *)pg_alloc(sizeof(struct VALUE_FUNCTION_CALL));
+
+    *call_copy = *call;
+    call_copy->function_name = dupString(call->function_name);
+    call_copy->parameters = pg_copy_elements(call->parameters, call->num_parameters);
+    copy->types.function_call = call_copy;
+  }
+  else if (value->value_type == VALUE_LIST)
+  {
+    struct VALUE_LIST *list = (struct VALUE_LIST *)pg_alloc(sizeof(struct VALUE_LIST));
+
+    list->num_elements = value->types.list->num_elements;
+    list->elements = pg_copy_elements(value->types.list->elements, list->num_elements);
+    copy->types.list = list;
+  }
+  else if (value->value_type == VALUE_DICT)
+  {
+    struct VALUE_DICT *dict = (struct VALUE_DICT *)pg_alloc(sizeof(struct VALUE_DICT));
+
+    dict->num_entries = value->types.dict->num_entries;
+    dict->keys = pg_copy_elements(value->types.dict->keys, dict->num_entries);
+    dict->values = pg_copy_elements(value->types.dict->values, dict->num_entries);
+    copy->types.dict = dict;
+  }
+  else
+  {
+    copy->types.expr = pg_copy_expr(value->types.expr);
+  }
+
+  return copy;
+}
+
+//
+// pg_print_element
+//
+// Prints an element, with quotes around string literals.
+//
+static void pg_print_element(FILE *output, struct ELEMENT *element)
+{
+  if (element == NULL)
+    return;
+
+  if (element->element_type == ELEMENT_STR_LITERAL)
+    fprintf(output, "'%s'", element->element_value);
+  else
+    fprintf(output, "%s", element->element_value);
+}
+
+//
+// pg_print_unary_expr
+//
+static void pg_print_unary_expr(FILE *output, struct UNARY_EXPR *unary)
+{
+  switch (unary->expr_type)
+  {
+  case UNARY_PTR_DEREF:
+    fprintf(output, "*");
+    break;
+  case UNARY_ADDRESS_OF:
+    fprintf(output, "&");
+    break;
+  case UNARY_PLUS:
+    fprintf(output, "+");
+    break;
+  case UNARY_MINUS:
+    fprintf(output, "-");
+    break;
+  }
+
+  pg_print_element(output, unary->element);
+
+  if (unary->expr_type == UNARY_INDEX || unary->expr_type == UNARY_SLICE)
+  {
+    fprintf(output, "[");
+    pg_print_element(output, unary->index);
+    if (unary->expr_type == UNARY_SLICE)
+      fprintf(output, ":");
+    pg_print_element(output, unary->end);
+    fprintf(output, "]");
+  }
+}
+
+//
+// pg_print_expr
+//
+// Prints the expression, with a nested operand in parentheses
+// if its operator binds less tightly than the expression's, or
+// as tightly on the side it doesn't group to.
+//
+static int pg_precedence(int operator)
+{
+  switch (operator)
+  {
+  case OPERATOR_POWER:
+    return 4;
+  case OPERATOR_ASTERISK:
+  case OPERATOR_DIV:
+  case OPERATOR_MOD:
+    return 3;
+  case OPERATOR_PLUS:
+  case OPERATOR_MINUS:
+    return 2;
+  default:
+    return 1;
+  }
+}
+
+static void pg_print_expr(FILE *output, struct VALUE_EXPR *expr);
+
+static void pg_print_step(FILE *output, struct VALUE_EXPR *expr, struct UNARY_EXPR *operand, bool is_rhs)
+{
+  if (operand->expr_type != UNARY_NESTED)
+  {
+    pg_print_unary_expr(output, operand);
+    return;
+  }
+
+  struct VALUE_EXPR *step = operand->expr;
+
+  int outer = pg_precedence(expr->operator);
+  int inner = step->isBinaryExpr ? pg_precedence(step->operator) : INT_MAX;
+
+  bool grouped = inner < outer || (inner == outer && (outer == 1 || is_rhs != (expr->operator == OPERATOR_POWER)));
+
+  fputs(grouped ? "(" : "", output);
+  pg_print_expr(output, step);
+  fputs(grouped ? ")" : "", output);
+}
+
+static void pg_print_expr(FILE *output, struct VALUE_EXPR *expr)
+{
+  static char *operators[] = {" + ", " - ", " * ", " ** ", " % ", " / ",
+                              " == ", " != ", " < ", " <= ", " > ", " >= ",
+                              " is ", " in "};
+
+  pg_print_step(output, expr, expr->lhs, false);
+
+  if (!expr->isBinaryExpr)
+    return;
+
+  if (expr->operator < 0 || expr->operator >= OPERATOR_NO_OP)
+    panic("unknown operator (pg_print_expr)");
+
+  fputs(operators[expr->operator], output);
+
+  pg_print_step(output, expr, expr->rhs, true);
+}
+
+//
+// pg_print_condition
+//
+// Prints the condition, with an operand that binds less tightly
+// than its operator in parentheses, e.g. an or under an and.
+//
+static void pg_print_condition(FILE *output, struct CONDITION *condition);
+
+static void pg_print_operand(FILE *output, struct CONDITION *condition, struct CONDITION *operand)
+{
+  static const int binding[] = {3, 1, 0, 2}; // by enum CONDITION_TYPES
+
+  bool grouped = binding[operand->condition_type] < binding[condition->condition_type];
+
+  fputs(grouped ? "(" : "", output);
+  pg_print_condition(output, operand);
+  fputs(grouped ? ")" : "", output);
+}
+
+static void pg_print_condition(FILE *output, struct CONDITION *condition)
+{
+  if (condition->condition_type == CONDITION_EXPR)
+  {
+    pg_print_expr(output, condition->expr);
+  }
+  else if (condition->condition_type == CONDITION_NOT)
+  {
+    fputs("not ", output);
+    pg_print_operand(output, condition, condition->lhs);
+  }
+  else
+  {
+    pg_print_operand(output, condition, condition->lhs);
+    fputs((condition->condition_type == CONDITION_AND) ? " and " : " or ", output);
+    pg_print_operand(output, condition, condition->rhs);
+  }
+}
+
+//
+// pg_print_call
+//
+// Prints a call of the named function with the given parameters.
+//
+static void pg_print_call(FILE *output, char *function_name, int num_parameters, struct ELEMENT **parameters)
+{
+  fprintf(output, "%s(", function_name);
+  for (int i = 0; i < num_parameters; i++)
+  {
+    if (i > 0)
+      fprintf(output, ", ");
+    pg_print_element(output, parameters[i]);
+  }
+  fprintf(output, ")");
+}
+
+//
+// pg_print_value
+//
+// Prints the right-hand side of an assignment, or the value of
+// a return.
+//
+static void pg_print_value(FILE *output, struct VALUE *value)
+{
+  if (value->value_type == VALUE_FUNCTION_CALL)
+  {
+    struct VALUE_FUNCTION_CALL *call = value->types.function_call;
+
+    pg_print_call(output, call->function_name, call->num_parameters, call->parameters);
+  }
+  else if (value->value_type == VALUE_LIST)
+  {
+    struct VALUE_LIST *list = value->types.list;
+
+    fprintf(output, "[");
+    for (int i = 0; i < list->num_elements; i++)
+    {
+      if (i > 0)
+        fprintf(output, ", ");
+      pg_print_element(output, list->elements[i]);
+    }
+    fprintf(output, "]");
+  }
+  else if (value->value_type == VALUE_DICT)
+  {
+    struct VALUE_DICT *dict = value->types.dict;
+
+    fprintf(output, "{");
+    for (int i = 0; i < dict->num_entries; i++)
+    {
+      if (i > 0)
+        fprintf(output, ", ");
+      pg_print_element(output, dict->keys[i]);
+      fprintf(output, ": ");
+      pg_print_element(output, dict->values[i]);
+    }
+    fprintf(output, "}");
+  }
+  else
+  {
+    pg_print_expr(output, value->types.expr);
+  }
+}
+
+//
+// pg_print_stmts
+//
+// Prints the statements, one per line, each preceded by its
+// line #. Lines with no statement are printed with just their
+// line #, so the output lines up with the source. Loop bodies
+// are indented 2 spaces per level of nesting.
+//
+static void pg_print_stmts(FILE *output, struct STMT *stmt, int depth, int *line)
+{
+  while (stmt != NULL)
+  {
+    while (*line < stmt->line)
+    {
+      fprintf(output, "%d:\n", *line);
+      (*line)++;
+    }
+
+    fprintf(output, "%d: %*s", stmt->line, 2 * depth, "");
+
+    if (stmt->line >= *line)
+      *line = stmt->line + 1;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+      if (assign->isPtrDeref)
+        fprintf(output, "*");
+
+      fprintf(output, "%s", assign->var_name);
+
+      if (assign->index != NULL)
+      {
+        fprintf(output, "[");
+        pg_print_element(output, assign->index);
+        fprintf(output, "]");
+      }
+
+      fprintf(output, " = ");
+
+      pg_print_value(output, assign->rhs);
+
+      fprintf(output, "\n");
+
+      stmt = assign->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+      if (call->object != NULL)
+      {
+        pg_print_element(output, call->object);
+        fprintf(output, ".");
+      }
+
+      pg_print_call(output, call->function_name, call->num_parameters, call->parameters);
+      fprintf(output, "\n");
+
+      stmt = call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+      fprintf(output, "while ");
+      pg_print_condition(output, loop->condition);
+      fprintf(output, ":\n");
+
+      //
+      // statements hoisted out of the body come first, under
+      // their original line #s:
+      //
+      int hoisted = INT_MAX;
+
+      pg_print_stmts(output, loop->preheader, depth + 1, &hoisted);
+      pg_print_stmts(output, loop->loop_body, depth + 1, line);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+      fprintf(output, "for %s in range(", loop->var_name);
+      pg_print_element(output, loop->start);
+      fprintf(output, ", ");
+      pg_print_element(output, loop->stop);
+      fprintf(output, ", ");
+      pg_print_element(output, loop->step);
+      fprintf(output, "):\n");
+
+      pg_print_stmts(output, loop->loop_body, depth + 1, line);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_PASS)
+    {
+      fprintf(output, "pass\n");
+
+      stmt = stmt->types.pass->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      struct STMT_DEF *def = stmt->types.def;
+
+      fprintf(output, "def %s(", def->function_name);
+      for (int i = 0; i < def->num_params; i++)
+        fprintf(output, (i > 0) ? ", %s" : "%s", def->locals[i]);
+      fprintf(output, "):\n");
+
+      pg_print_stmts(output, def->body, depth + 1, line);
+
+      stmt = def->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      fprintf(output, "return");
+
+      if (stmt->types.return_stmt->value != NULL)
+      {
+        fprintf(output, " ");
+        pg_print_value(output, stmt->types.return_stmt->value);
+      }
+
+      fprintf(output, "\n");
+
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else
+    {
+      panic("unknown type of statement?! (programgraph_print)");
+    }
+  }
+}
+
+//
+// Public functions:
+//
+
+//
+// programgraph_build
+//
+// Given a legal nuPython program in the form of a list
+// of tokens, builds and returns a program graph
+// representing the nuPython program.
+//
+// Returns NULL if an error occurs and the program graph
+// could not be built; in this case an error message is
+// output to the interpreter's output stream.
+//
+struct STMT *programgraph_build(struct Interpreter *interp, struct TokenQueue *tokens)
+{
+  assert(interp != NULL);
+
+  if (tokens == NULL)
+    panic("tokens is NULL (programgraph_build)");
+
+  struct TokenNode *cur = tokens->head;
+  struct STMT *program = NULL;
+
+  if (!pg_build_stmts(interp, &cur, nuPy_EOS, false, &program) || !pg_bind_program(interp, program))
+  {
+    programgraph_destroy(program);
+    return NULL;
+  }
+
+  return program;
+}
+
+//
+// programgraph_destroy
+//
+// Frees all the memory with in given program graph.
+//
+void programgraph_destroy(struct STMT *program)
+{
+  struct STMT *stmt = program;
+
+  while (stmt != NULL)
+  {
+    struct STMT *next = NULL;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+      next = assign->next_stmt;
+
+      pg_destroy_value(assign->rhs);
+      pg_destroy_element(assign->index);
+      free(assign->var_name);
+      free(assign);
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+      next = call->next_stmt;
+
+      free(call->function_name);
+      pg_destroy_element(call->object);
+      for (int i = 0; i < call->num_parameters; i++)
+        pg_destroy_element(call->parameters[i]);
+
+      free(call->parameters);
+      free(call);
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+      next = loop->next_stmt;
+
+      pg_destroy_condition(loop->condition);
+      programgraph_destroy(loop->preheader);
+      programgraph_destroy(loop->loop_body);
+      free(loop);
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+      next = loop->next_stmt;
+
+      free(loop->var_name);
+      pg_destroy_element(loop->start);
+      pg_destroy_element(loop->stop);
+      pg_destroy_element(loop->step);
+      programgraph_destroy(loop->loop_body);
+      free(loop);
+    }
+    else if (stmt->stmt_type == STMT_DEF)
+    {
+      struct STMT_DEF *def = stmt->types.def;
+
+      next = def->next_stmt;
+
+      free(def->function_name);
+      for (int i = 0; i < def->num_locals; i++)
+        free(def->locals[i]);
+
+      free(def->locals);
+      programgraph_destroy(def->body);
+      free(def);
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      next = stmt->types.return_stmt->next_stmt;
+
+      pg_destroy_value(stmt->types.return_stmt->value);
+      free(stmt->types.return_stmt);
+    }
+    else
+    {
+      assert(stmt->stmt_type == STMT_PASS);
+
+      next = stmt->types.pass->next_stmt;
+
+      free(stmt->types.pass);
+    }
+
+    free(stmt);
+
+    stmt = next;
+  }
+}
+
+//
+// programgraph_copy
+//
+// Returns a copy of the given statements, e.g. the body of a
+// function, which is freed with programgraph_destroy.
+//
+struct STMT *programgraph_copy(struct STMT *stmts)
+{
+  struct STMT *first = NULL;
+  struct STMT **link = &first;
+
+  for (struct STMT *stmt = stmts; stmt != NULL;)
+  {
+    struct STMT *copy = (struct STMT *)pg_alloc(sizeof(struct STMT));
+
+    *copy = *stmt;
+    *link = copy;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT)
+    {
+      struct STMT_ASSIGNMENT *assign = stmt->types.assignment;
+
+      copy->types.assignment = (struct STMT_ASSIGNMENT *)pg_alloc(sizeof(struct STMT_ASSIGNMENT));
+      *copy->types.assignment = *assign;
+      copy->types.assignment->var_name = dupString(assign->var_name);
+      copy->types.assignment->index = pg_copy_element(assign->index);
+      copy->types.assignment->rhs = pg_copy_value(assign->rhs);
+
+      link = &copy->types.assignment->next_stmt;
+      stmt = assign->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    {
+      struct STMT_FUNCTION_CALL *call = stmt->types.function_call;
+
+      copy->types.function_call = (struct STMT_FUNCTION_CALL *)pg_alloc(sizeof(struct STMT_FUNCTION_CALL));
+      *copy->types.function_call = *call;
+      copy->types.function_call->function_name = dupString(call->function_name);
+      copy->types.function_call->object = pg_copy_element(call->object);
+      copy->types.function_call->parameters = pg_copy_elements(call->parameters, call->num_parameters);
+
+      link = &copy->types.function_call->next_stmt;
+      stmt = call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    {
+      struct STMT_WHILE_LOOP *loop = stmt->types.while_loop;
+
+      copy->types.while_loop = (struct STMT_WHILE_LOOP *)pg_alloc(sizeof(struct STMT_WHILE_LOOP));
+      copy->types.while_loop->condition = pg_copy_condition(loop->condition);
+      copy->types.while_loop->preheader = programgraph_copy(loop->preheader);
+      copy->types.while_loop->loop_body = programgraph_copy(loop->loop_body);
+
+      link = &copy->types.while_loop->next_stmt;
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FOR_LOOP)
+    {
+      struct STMT_FOR_LOOP *loop = stmt->types.for_loop;
+
+      copy->types.for_loop = (struct STMT_FOR_LOOP *)pg_alloc(sizeof(struct STMT_FOR_LOOP));
+      *copy->types.for_loop = *loop;
+      copy->types.for_loop->var_name = dupString(loop->var_name);
+      copy->types.for_loop->start = pg_copy_element(loop->start);
+      copy->types.for_loop->stop = pg_copy_element(loop->stop);
+      copy->types.for_loop->step = pg_copy_element(loop->step);
+      copy->types.for_loop->loop_body = programgraph_copy(loop->loop_body);
+
+      link = &copy->types.for_loop->next_stmt;
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_RETURN)
+    {
+      copy->types.return_stmt = (struct STMT_RETURN *)pg_alloc(sizeof(struct STMT_RETURN));
+      copy->types.return_stmt->value = pg_copy_value(stmt->types.return_stmt->value);
+
+      link = &copy->types.return_stmt->next_stmt;
+      stmt = stmt->types.return_stmt->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_PASS)
+    {
+      copy->types.pass = (struct STMT_PASS *)pg_alloc(sizeof(struct STMT_PASS));
+
+      link = &copy->types.pass->next_stmt;
+      stmt = stmt->types.pass->next_stmt;
+    }
+    else // defs are only at the top level, and there are no ifs yet
+    {
+      panic("unexpected statement (programgraph_copy)");
+    }
+  }
+
+  *link = NULL;
+
+  return first;
+}
+
+//
+// pg_print
+//
+// Prints the program graph to the given stream.
+//
+static void pg_print(FILE *output, struct STMT *program)
+{
+  int line = 1;
+
+  fprintf(output, "**PROGRAM GRAPH PRINT**\n");
+
+  pg_print_stmts(output, program, 0, &line);
+
+  fprintf(output, "%d: $\n", line);
+  fprintf(output, "**END PRINT**\n");
+}
+
+//
+// programgraph_print
+//
+// Prints the contents of the program graph to the
+// interpreter's output stream.
+//
+void programgraph_print(struct Interpreter *interp, struct STMT *program)
+{
+  pg_print(interp->output, program);
+}
+
+//
+// programgraph_listing
+//
+// Returns what programgraph_print prints, as a string.
+//
+char *programgraph_listing(struct STMT *program)
+{
+  char *listing = NULL;
+  size_t size = 0;
+  FILE *output = open_memstream(&listing, &size);
+
+  if (output == NULL)
+    return NULL;
+
+  pg_print(output, program);
+  fclose(output); // finalizes listing
+
+  return listing;
+}
@@ -8,6 +8,7 @@
 
 #include <stdbool.h> // true, false
 #include "tokenqueue.h"
+#include "interpreter.h"
 
 //
 // A nuPython program is 1 or more statements:
@@ -22,7 +23,10 @@ enum STMT_TYPES
   STMT_FUNCTION_CALL,
   STMT_IF_THEN_ELSE,
   STMT_WHILE_LOOP,
-  STMT_PASS
+  STMT_FOR_LOOP,
+  STMT_PASS,
+  STMT_DEF,
+  STMT_RETURN
 };
 
 struct STMT
@@ -42,7 +46,10 @@ struct STMT
     struct STMT_FUNCTION_CALL *function_call;
     struct STMT_IF_THEN_ELSE *if_then_else;
     struct STMT_WHILE_LOOP *while_loop;
+    struct STMT_FOR_LOOP *for_loop;
     struct STMT_PASS *pass;
+    struct STMT_DEF *def;
+    struct STMT_RETURN *return_stmt;
   } types;
 };
 
@@ -51,10 +58,13 @@ struct STMT_ASSIGNMENT
   //
   // Examples:  x = 123
   //           *p = x + y
+  //            x[i] = y
   //
   char *var_name;
+  int slot; // x's slot in the frame if it's a local (see STMT_DEF), else -1
   bool isPtrDeref;
-  struct VALUE *rhs; // rhs = "right-hand side"
+  struct ELEMENT *index; // x[index] = ..., else NULL
+  struct VALUE *rhs;     // rhs = "right-hand side"
 
   struct STMT *next_stmt;
 };
@@ -64,9 +74,15 @@ struct STMT_FUNCTION_CALL
   //
   // Examples: print()
   //           print("the output is")
+  //           x.append(1)
+  //           f(x, 2)
   //
   char *function_name;
-  struct ELEMENT *parameter; // optional => could be NULL
+  int builtin;             // the function called, enum BUILTIN_ID (see builtins.h)
+  struct STMT *function;   // else the STMT_DEF of the function called, else NULL
+  struct ELEMENT *object;  // x in x.append(1), else NULL
+  int num_parameters;
+  struct ELEMENT **parameters;
 
   struct STMT *next_stmt;
 };
@@ -81,7 +97,7 @@ struct STMT_IF_THEN_ELSE
   //          else:
   //          { ... }
   //
-  struct VALUE_EXPR *condition;
+  struct CONDITION *condition;
   struct STMT *true_path;  // next stmt if the condition is true
   struct STMT *false_path; // next stmt if the condition is false
 };
@@ -89,14 +105,34 @@ struct STMT_IF_THEN_ELSE
 struct STMT_WHILE_LOOP
 {
   //
-  // Example: while x<10:
+  // Example: while x<10 and not done:
   //          { ... }
   //
-  struct VALUE_EXPR *condition;
+  struct CONDITION *condition;
+  struct STMT *preheader; // hoisted out of the body, run once before
+                          // the 1st iteration (see optimizer_licm)
   struct STMT *loop_body; // loop body if the condition is true
   struct STMT *next_stmt; // next stmt after the loop is over
 };
 
+struct STMT_FOR_LOOP
+{
+  //
+  // Example: for i in range(0, n, 2):
+  //          { ... }
+  //
+  // range(n) and range(a, b) are built with the missing start
+  // and step as the literals 0 and 1:
+  //
+  char *var_name;
+  int slot; // the variable's slot in the frame if it's a local, else -1
+  struct ELEMENT *start;
+  struct ELEMENT *stop;
+  struct ELEMENT *step;
+  struct STMT *loop_body; // loop body, run once per value
+  struct STMT *next_stmt; // next stmt after the loop is over
+};
+
 struct STMT_PASS
 {
   //
@@ -105,13 +141,48 @@ struct STMT_PASS
   struct STMT *next_stmt;
 };
 
+struct STMT_DEF
+{
+  //
+  // Example: def f(a, b):
+  //          { ... }
+  //
+  // Functions are defined at the top level, and calls are bound
+  // to them when the graph is built, so a function may be called
+  // before its def. The locals of a function are its parameters
+  // and the variables assigned in its body, which are read and
+  // written in slots of a frame on the interpreter's call stack
+  // rather than by name in memory; the other variables the body
+  // reads are the program's.
+  //
+  char *function_name;
+  int num_params;
+  int num_locals;
+  char **locals;          // by slot, the parameters first
+  struct STMT *body;
+  struct STMT *next_stmt; // next stmt after the def
+};
+
+struct STMT_RETURN
+{
+  //
+  // Examples: return
+  //           return x + 1
+  //           return f(x)
+  //
+  struct VALUE *value; // optional => could be NULL, returning None
+  struct STMT *next_stmt;
+};
+
 //
 // nuPython values / expressions:
 //
 enum VALUE_TYPES
 {
   VALUE_FUNCTION_CALL = 0,
-  VALUE_EXPR
+  VALUE_EXPR,
+  VALUE_LIST,
+  VALUE_DICT
 };
 
 struct VALUE
@@ -128,23 +199,114 @@ struct VALUE
   {
     struct VALUE_FUNCTION_CALL *function_call;
     struct VALUE_EXPR *expr;
+    struct VALUE_LIST *list;
+    struct VALUE_DICT *dict;
   } types;
 };
 
 struct VALUE_FUNCTION_CALL
 {
   char *function_name;
-  struct ELEMENT *parameter; // optional => could be NULL
+  int builtin;           // the function called, enum BUILTIN_ID (see builtins.h)
+  struct STMT *function; // else the STMT_DEF of the function called, else NULL
+  int num_parameters;
+  struct ELEMENT **parameters;
+};
+
+struct VALUE_LIST
+{
+  //
+  // Example: [1, x, 'abc']
+  //
+  int num_elements;
+  struct ELEMENT **elements;
+};
+
+struct VALUE_DICT
+{
+  //
+  // Example: {'a': 1, x: y}, entry i being keys[i]: values[i]
+  //
+  int num_entries;
+  struct ELEMENT **keys;
+  struct ELEMENT **values;
 };
 
 struct VALUE_EXPR
 {
+  //
+  // Examples: x
+  //           x + 1
+  //           (x + 1) * y ** 2
+  //
+  // An expression with more than one operator is lowered when it's
+  // built to a flat array of steps, in postfix order: each step is
+  // an expression whose UNARY_NESTED operands are the values of
+  // earlier steps, and the expression itself is the last, e.g. the
+  // steps of (x + 1) * y ** 2 are x + 1 and y ** 2, and it is then
+  // their product. So the steps are evaluated in order on a stack
+  // of values, popping a step's nested operands and pushing its
+  // value; there are never more values than steps, so with up to
+  // EXPR_STACK_SIZE steps the stack needs no allocation. An
+  // operand evaluated before a nested rhs is a step of its own, so
+  // that the operands are evaluated from left to right.
+  //
   struct UNARY_EXPR *lhs; // lhs = "left-hand side"
 
   bool isBinaryExpr; // true => we have operator and rhs
 
   int operator;           // enum OPERATORS
+  int types;              // enum EXPR_TYPES
   struct UNARY_EXPR *rhs; // optional => could be NULL
+
+  int num_steps;
+  struct VALUE_EXPR *steps; // NULL if there are none
+};
+
+#define EXPR_STACK_SIZE 16
+
+//
+// The types of the operands of a binary expression, if they are
+// proven before the program runs (see optimizer_types); otherwise
+// the types are checked as the expression is evaluated:
+//
+enum EXPR_TYPES
+{
+  EXPR_TYPES_UNKNOWN = 0,
+  EXPR_TYPES_INT_INT,
+  EXPR_TYPES_INT_REAL,
+  EXPR_TYPES_REAL_INT,
+  EXPR_TYPES_REAL_REAL,
+  EXPR_TYPES_STR_STR
+};
+
+//
+// nuPython conditions, of while loops and ifs:
+//
+enum CONDITION_TYPES
+{
+  CONDITION_EXPR = 0,
+  CONDITION_AND,
+  CONDITION_OR,
+  CONDITION_NOT
+};
+
+struct CONDITION
+{
+  //
+  // Examples: x < 10
+  //           x < 10 and not done
+  //           a or b and c, which is a or (b and c)
+  //
+  // The expressions must be booleans. An and or an or only
+  // evaluates its rhs if its lhs doesn't decide the condition,
+  // and a condition is branched on as it's decided, without
+  // making a boolean value of it.
+  //
+  int condition_type;      // enum CONDITION_TYPES
+  struct VALUE_EXPR *expr; // for CONDITION_EXPR, else NULL
+  struct CONDITION *lhs;   // the lhs of and / or, the operand of not
+  struct CONDITION *rhs;   // the rhs of and / or, else NULL
 };
 
 enum UNARY_EXPR_TYPES
@@ -153,7 +315,10 @@ enum UNARY_EXPR_TYPES
   UNARY_ADDRESS_OF,
   UNARY_PLUS,
   UNARY_MINUS,
-  UNARY_ELEMENT
+  UNARY_ELEMENT,
+  UNARY_INDEX, // x[index]
+  UNARY_SLICE, // x[index:end]
+  UNARY_NESTED // (x + 1), the value of a step (see VALUE_EXPR)
 };
 
 struct UNARY_EXPR
@@ -167,6 +332,20 @@ struct UNARY_EXPR
   // underlying element (identifier or literal):
   //
   struct ELEMENT *element;
+
+  //
+  // subscript of a list or string, for UNARY_INDEX and
+  // UNARY_SLICE; the index and end of a slice are optional
+  // => could be NULL:
+  //
+  struct ELEMENT *index;
+  struct ELEMENT *end;
+
+  //
+  // the step computing a UNARY_NESTED operand, which is in the
+  // steps of the outermost expression:
+  //
+  struct VALUE_EXPR *expr;
 };
 
 //
@@ -189,6 +368,8 @@ struct ELEMENT
   // what kind of element do we have?
   //
   int element_type; // enum ELEMENT_TYPES
+  int defined;      // enum ELEMENT_DEFINED, for an identifier
+  int slot;         // for an identifier, its slot in the frame if it's a local, else -1
 
   //
   // underlying element (identifier or literal):
@@ -196,6 +377,18 @@ struct ELEMENT
   char *element_value; // e.g. "x" or "123" or "3.14" or "this is a string"
 };
 
+//
+// Whether an identifier has been assigned every time it's read,
+// or none of the times, if that's proven before the program runs
+// (see optimizer_types); otherwise it's checked at each read:
+//
+enum ELEMENT_DEFINED
+{
+  ELEMENT_DEFINED_UNKNOWN = 0,
+  ELEMENT_DEFINED_ALWAYS,
+  ELEMENT_DEFINED_NEVER
+};
+
 //
 // nuPython operators
 //
@@ -231,7 +424,8 @@ enum OPERATORS
 // to work with than the raw tokens.
 //
 // Returns NULL if an error occurs and the program graph
-// could not be built.
+// could not be built; in this case an error message is
+// output to the interpreter's output stream.
 //
 // NOTE: the program graph may contain semantic errors,
 // e.g. type errors or calls to functions that don't exist.
@@ -239,7 +433,7 @@ enum OPERATORS
 // (it could also be done using a pre-execution pass
 // through the graph).
 //
-struct STMT *programgraph_build(struct TokenQueue *tokens);
+struct STMT *programgraph_build(struct Interpreter *interp, struct TokenQueue *tokens);
 
 //
 // programgraph_destroy
@@ -248,9 +442,30 @@ struct STMT *programgraph_build(struct TokenQueue *tokens);
 //
 void programgraph_destroy(struct STMT *program);
 
+//
+// programgraph_copy
+//
+// Returns a copy of the given statements, e.g. the body of a
+// function, which is freed with programgraph_destroy. Calls in
+// the copy are bound to the same defs as in the original. The
+// statements may not include defs.
+//
+struct STMT *programgraph_copy(struct STMT *stmts);
+
 //
 // programgraph_print
 //
-// Prints the contents of the program graph to the console.
+// Prints the contents of the program graph to the
+// interpreter's output stream.
+//
+void programgraph_print(struct Interpreter *interp, struct STMT *program);
+
+//
+// programgraph_listing
+//
+// Returns what programgraph_print prints for the program graph,
+// as a string that the caller frees, or NULL if out of memory.
+// The graph cache keeps the listing of a program as it was built,
+// before it was optimized (see graphcache_store).
 //
-void programgraph_print(struct STMT *program);
+char *programgraph_listing(struct STMT *program);
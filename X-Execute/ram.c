@@ -0,0 +1,326 @@
+/*ram.c*/
+
+//
+// Random access memory (RAM) for nuPython
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>  // strcmp
+
+#include "ram.h"
+#include "list.h"
+#include "dict.h"
+#include "util.h"
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**RAM ERROR\n");
+  printf("**RAM ERROR: %s\n", msg);
+  printf("**RAM ERROR\n");
+
+  exit(-123);
+}
+
+//
+// Public functions:
+//
+
+//
+// ram_init
+//
+// Returns a pointer to a dynamically-allocated memory
+// for storing nuPython variables and their values. All
+// memory cells are initialized to the value None.
+//
+struct RAM *ram_init(void)
+{
+  struct RAM *memory = (struct RAM *)malloc(sizeof(struct RAM));
+  if (memory == NULL)
+    panic("out of memory (ram_init)");
+
+  memory->num_values = 0;
+  memory->capacity = 4;
+  memory->cells = (struct RAM_CELL *)malloc(sizeof(struct RAM_CELL) * memory->capacity);
+  if (memory->cells == NULL)
+    panic("out of memory (ram_init)");
+
+  for (int i = 0; i < memory->capacity; i++)
+  {
+    memory->cells[i].identifier = NULL;
+    memory->cells[i].value.value_type = RAM_TYPE_NONE;
+  }
+
+  return memory;
+}
+
+//
+// ram_destroy
+//
+// Frees the dynamically-allocated memory associated with
+// the given memory. After the call returns, you cannot
+// use the memory.
+//
+void ram_destroy(struct RAM *memory)
+{
+  for (int i = 0; i < memory->num_values; i++)
+  {
+    free(memory->cells[i].identifier);
+
+    if (memory->cells[i].value.value_type == RAM_TYPE_STR)
+      free(memory->cells[i].value.types.s);
+    else if (memory->cells[i].value.value_type == RAM_TYPE_LIST)
+      list_release(memory->cells[i].value.types.l);
+    else if (memory->cells[i].value.value_type == RAM_TYPE_DICT)
+      dict_release(memory->cells[i].value.types.m);
+  }
+
+  free(memory->cells);
+  free(memory);
+}
+
+//
+// ram_get_addr
+//
+// If the given identifier (e.g. "x") has been written to
+// memory, returns the address of this value --- an integer
+// in the range 0..N-1 where N is the number of values currently
+// stored in memory. Returns -1 if no such identifier exists
+// in memory.
+//
+int ram_get_addr(struct RAM *memory, char *identifier)
+{
+  for (int i = 0; i < memory->num_values; i++)
+  {
+    if (strcmp(memory->cells[i].identifier, identifier) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+//
+// ram_read_cell_by_addr
+//
+// Given a memory address (an integer in the range 0..N-1),
+// returns a COPY of the value contained in that memory cell.
+// Returns NULL if the address is not valid.
+//
+// NOTE: the caller takes ownership of the copy and must
+// eventually free this memory via ram_free_value(). A list
+// is not copied, the copy is another reference to it.
+//
+struct RAM_VALUE *ram_read_cell_by_addr(struct RAM *memory, int address)
+{
+  if (address < 0 || address >= memory->num_values)
+    return NULL;
+
+  struct RAM_VALUE *copy = (struct RAM_VALUE *)malloc(sizeof(struct RAM_VALUE));
+  if (copy == NULL)
+    panic("out of memory (ram_read_cell_by_addr)");
+
+  *copy = memory->cells[address].value;
+
+  if (copy->value_type == RAM_TYPE_STR)
+    copy->types.s = dupString(copy->types.s);
+  else if (copy->value_type == RAM_TYPE_LIST)
+    list_retain(copy->types.l);
+  else if (copy->value_type == RAM_TYPE_DICT)
+    dict_retain(copy->types.m);
+
+  return copy;
+}
+
+//
+// ram_read_cell_by_id
+//
+// If the given identifier (e.g. "x") has been written to
+// memory, returns a COPY of the value contained in memory.
+// Returns NULL if no such identifier exists in memory.
+//
+// NOTE: the caller takes ownership of the copy and must
+// eventually free this memory via ram_free_value().
+//
+struct RAM_VALUE *ram_read_cell_by_id(struct RAM *memory, char *identifier)
+{
+  return ram_read_cell_by_addr(memory, ram_get_addr(memory, identifier));
+}
+
+//
+// ram_free_value
+//
+// Frees the memory value returned by ram_read_cell_by_id and
+// ram_read_cell_by_addr.
+//
+void ram_free_value(struct RAM_VALUE *value)
+{
+  if (value == NULL)
+    return;
+
+  if (value->value_type == RAM_TYPE_STR)
+    free(value->types.s);
+  else if (value->value_type == RAM_TYPE_LIST)
+    list_release(value->types.l);
+  else if (value->value_type == RAM_TYPE_DICT)
+    dict_release(value->types.m);
+
+  free(value);
+}
+
+//
+// ram_write_cell_by_addr
+//
+// Writes the given value to the memory cell at the given
+// address. If a value already exists at this address, that
+// value is overwritten by this new value. Returns true if
+// the value was successfully written, false if not (which
+// implies the memory address is invalid).
+//
+// NOTE: if the value being written is a string, it will
+// be duplicated and stored; if it's a list or dictionary, the
+// memory cell holds a reference to it.
+//
+bool ram_write_cell_by_addr(struct RAM *memory, struct RAM_VALUE value, int address)
+{
+  if (address < 0 || address >= memory->num_values)
+    return false;
+
+  struct RAM_VALUE *cell = &memory->cells[address].value;
+
+  //
+  // duplicate before freeing the old value, in case the
+  // caller is writing a string back to where it came from
+  // (or a list or dictionary, which mustn't be freed in
+  // between):
+  //
+  if (value.value_type == RAM_TYPE_STR)
+    value.types.s = dupString(value.types.s);
+  else if (value.value_type == RAM_TYPE_LIST)
+    list_retain(value.types.l);
+  else if (value.value_type == RAM_TYPE_DICT)
+    dict_retain(value.types.m);
+
+  if (cell->value_type == RAM_TYPE_STR)
+    free(cell->types.s);
+  else if (cell->value_type == RAM_TYPE_LIST)
+    list_release(cell->types.l);
+  else if (cell->value_type == RAM_TYPE_DICT)
+    dict_release(cell->types.m);
+
+  *cell = value;
+
+  return true;
+}
+
+//
+// ram_write_cell_by_id
+//
+// Writes the given value to a memory cell named by the given
+// identifier. If a memory cell already exists with this name,
+// the existing value is overwritten by this new value. Returns
+// true since this operation always succeeds.
+//
+// NOTE: if the value being written is a string, it will
+// be duplicated and stored; if it's a list or dictionary, the
+// memory cell holds a reference to it.
+//
+bool ram_write_cell_by_id(struct RAM *memory, struct RAM_VALUE value, char *identifier)
+{
+  int address = ram_get_addr(memory, identifier);
+
+  if (address < 0) // new variable, add a cell for it:
+  {
+    if (memory->num_values == memory->capacity)
+    {
+      int capacity = memory->capacity * 2;
+
+      struct RAM_CELL *cells = (struct RAM_CELL *)realloc(memory->cells, sizeof(struct RAM_CELL) * capacity);
+      if (cells == NULL)
+        panic("out of memory (ram_write_cell_by_id)");
+
+      for (int i = memory->capacity; i < capacity; i++)
+      {
+        cells[i].identifier = NULL;
+        cells[i].value.value_type = RAM_TYPE_NONE;
+      }
+
+      memory->cells = cells;
+      memory->capacity = capacity;
+    }
+
+    address = memory->num_values;
+
+    memory->cells[address].identifier = dupString(identifier);
+    memory->num_values++;
+  }
+
+  return ram_write_cell_by_addr(memory, value, address);
+}
+
+//
+// ram_print
+//
+// Prints the contents of RAM to the console, for debugging.
+//
+void ram_print(struct RAM *memory)
+{
+  printf("**MEMORY PRINT**\n");
+
+  printf("Capacity: %d\n", memory->capacity);
+  printf("Num values: %d\n", memory->num_values);
+  printf("Contents:\n");
+
+  for (int i = 0; i < memory->num_values; i++)
+  {
+    struct RAM_VALUE *value = &memory->cells[i].value;
+
+    printf(" %d: %s, ", i, memory->cells[i].identifier);
+
+    switch (value->value_type)
+    {
+    case RAM_TYPE_INT:
+      printf("int, %d", value->types.i);
+      break;
+    case RAM_TYPE_REAL:
+      printf("real, %lf", value->types.d);
+      break;
+    case RAM_TYPE_STR:
+      printf("str, '%s'", value->types.s);
+      break;
+    case RAM_TYPE_PTR:
+      printf("ptr, %d", value->types.i);
+      break;
+    case RAM_TYPE_BOOLEAN:
+      printf(value->types.i ? "boolean, True" : "boolean, False");
+      break;
+    case RAM_TYPE_NONE:
+      printf("none, None");
+      break;
+    case RAM_TYPE_LIST:
+      printf("list, ");
+      list_print(stdout, value->types.l);
+      break;
+    case RAM_TYPE_DICT:
+      printf("dict, ");
+      dict_print(stdout, value->types.m);
+      break;
+    default:
+      panic("unknown ram value type?! (ram_print)");
+    }
+
+    printf("\n");
+  }
+
+  printf("**END PRINT**\n");
+}
@@ -18,9 +18,14 @@ enum RAM_VALUE_TYPES
   RAM_TYPE_STR,
   RAM_TYPE_PTR,
   RAM_TYPE_BOOLEAN,
-  RAM_TYPE_NONE
+  RAM_TYPE_NONE,
+  RAM_TYPE_LIST,
+  RAM_TYPE_DICT
 };
 
+struct LIST; // see list.h
+struct DICT; // see dict.h
+
 struct RAM_VALUE
 {
   //
@@ -36,6 +41,8 @@ struct RAM_VALUE
     int i;    // INT, PTR, BOOLEAN
     double d; // REAL
     char *s;  // STR
+    struct LIST *l; // LIST, a reference
+    struct DICT *m; // DICT, a reference
   } types;
 };
 
@@ -99,6 +106,8 @@ int ram_get_addr(struct RAM *memory, char *identifier);
 // NOTE: this function allocates memory for the value that
 // is returned. The caller takes ownership of the copy and
 // must eventually free this memory via ram_free_value().
+// A list or dictionary is not copied, the copy is another
+// reference to it.
 //
 // NOTE: a variable has to be written to memory before its
 // address becomes valid. Once a variable is written to memory,
@@ -137,7 +146,8 @@ void ram_free_value(struct RAM_VALUE *value);
 // implies the memory address is invalid).
 //
 // NOTE: if the value being written is a string, it will
-// be duplicated and stored.
+// be duplicated and stored; if it's a list or dictionary, the
+// memory cell holds a reference to it.
 //
 // NOTE: a variable has to be written to memory before its
 // address becomes valid. Once a variable is written to memory,
@@ -154,7 +164,8 @@ bool ram_write_cell_by_addr(struct RAM *memory, struct RAM_VALUE value, int addr
 // true since this operation always succeeds.
 //
 // NOTE: if the value being written is a string, it will
-// be duplicated and stored.
+// be duplicated and stored; if it's a list or dictionary, the
+// memory cell holds a reference to it.
 //
 // NOTE: a variable has to be written to memory before its
 // address becomes valid. Once a variable is written to memory,
@@ -0,0 +1,745 @@
+/*reduce.c*/
+
+//
+// Reductions over lists for nuPython; see reduce.h.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h> // AVX2, for the functions marked AVX2 only
+#define AVX2_KERNELS
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+#include "reduce.h"
+#include "util.h"
+
+#define LANES 8 // reals are summed in this many lanes, see reduce.h
+
+//
+// What a list's items are:
+//
+enum NUMBERS
+{
+  ALL_INTS = 0, // or booleans
+  SOME_REALS,   // numbers, at least one real
+  NOT_NUMBERS
+};
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**REDUCE ERROR\n");
+  printf("**REDUCE ERROR: %s\n", msg);
+  printf("**REDUCE ERROR\n");
+
+  exit(-123);
+}
+
+//
+// has_avx2
+//
+// Can the AVX2 kernels run on this CPU?
+//
+static bool has_avx2(void)
+{
+#if defined(AVX2_KERNELS)
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+//
+// The kernels, each for AVX2, SSE2 and plain C. Ints are added and
+// multiplied as unsigned, to wrap around. The real kernels work on
+// lanes (see reduce.h), reading 8 items at a time, up to m, which
+// is a multiple of 8; the caller starts and finishes the reduction.
+// min_* find the smallest item, or with flip set the largest, as
+// the smallest of the items negated: for ints ~x, for reals -x,
+// i.e. with the sign bit flipped. A real x replaces the smallest
+// so far, best, if x < best, as MINPD does.
+//
+#if defined(AVX2_KERNELS)
+
+AVX2 static unsigned sum_ints_avx2(const int *items, int n)
+{
+  __m256i sum = _mm256_setzero_si256();
+  int p = 0;
+
+  for (; p + 8 <= n; p += 8)
+    sum = _mm256_add_epi32(sum, _mm256_loadu_si256((const __m256i *)(items + p)));
+
+  unsigned lanes[8], total = 0;
+
+  _mm256_storeu_si256((__m256i *)lanes, sum);
+
+  for (int k = 0; k < 8; k++)
+    total += lanes[k];
+  for (; p < n; p++)
+    total += (unsigned)items[p];
+
+  return total;
+}
+
+AVX2 static int min_ints_avx2(const int *items, int n, bool flip)
+{
+  int flips = flip ? ~0 : 0;
+  __m256i flipped = _mm256_set1_epi32(flips);
+  __m256i best = _mm256_set1_epi32(items[0] ^ flips);
+  int p = 0;
+
+  for (; p + 8 <= n; p += 8)
+    best = _mm256_min_epi32(best, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(items + p)), flipped));
+
+  int lanes[8], min = items[0] ^ flips;
+
+  _mm256_storeu_si256((__m256i *)lanes, best);
+
+  for (int k = 0; k < 8; k++)
+    if (lanes[k] < min)
+      min = lanes[k];
+  for (; p < n; p++)
+    if ((items[p] ^ flips) < min)
+      min = items[p] ^ flips;
+
+  return min ^ flips;
+}
+
+AVX2 static unsigned dot_ints_avx2(const int *x, const int *y, int n)
+{
+  __m256i sum = _mm256_setzero_si256();
+  int p = 0;
+
+  for (; p + 8 <= n; p += 8)
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(x + p)),
+                                                   _mm256_loadu_si256((const __m256i *)(y + p))));
+
+  unsigned lanes[8], total = 0;
+
+  _mm256_storeu_si256((__m256i *)lanes, sum);
+
+  for (int k = 0; k < 8; k++)
+    total += lanes[k];
+  for (; p < n; p++)
+    total += (unsigned)x[p] * (unsigned)y[p];
+
+  return total;
+}
+
+AVX2 static void sum_lanes_avx2(const double *items, int m, double *lanes)
+{
+  __m256d low = _mm256_loadu_pd(lanes), high = _mm256_loadu_pd(lanes + 4);
+
+  for (int p = 0; p < m; p += 8)
+  {
+    low = _mm256_add_pd(low, _mm256_loadu_pd(items + p));
+    high = _mm256_add_pd(high, _mm256_loadu_pd(items + p + 4));
+  }
+
+  _mm256_storeu_pd(lanes, low);
+  _mm256_storeu_pd(lanes + 4, high);
+}
+
+AVX2 static void min_lanes_avx2(const double *items, int m, double *lanes, bool flip)
+{
+  __m256d flipped = _mm256_set1_pd(flip ? -0.0 : 0.0);
+  __m256d low = _mm256_loadu_pd(lanes), high = _mm256_loadu_pd(lanes + 4);
+
+  for (int p = LANES; p < m; p += 8)
+  {
+    low = _mm256_min_pd(_mm256_xor_pd(_mm256_loadu_pd(items + p), flipped), low);
+    high = _mm256_min_pd(_mm256_xor_pd(_mm256_loadu_pd(items + p + 4), flipped), high);
+  }
+
+  _mm256_storeu_pd(lanes, low);
+  _mm256_storeu_pd(lanes + 4, high);
+}
+
+AVX2 static void dot_lanes_avx2(const double *x, const double *y, int m, double *lanes)
+{
+  __m256d low = _mm256_loadu_pd(lanes), high = _mm256_loadu_pd(lanes + 4);
+
+  for (int p = 0; p < m; p += 8) // multiply, then add: no FMA, to round as plain C does
+  {
+    low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(x + p), _mm256_loadu_pd(y + p)));
+    high = _mm256_add_pd(high, _mm256_mul_pd(_mm256_loadu_pd(x + p + 4), _mm256_loadu_pd(y + p + 4)));
+  }
+
+  _mm256_storeu_pd(lanes, low);
+  _mm256_storeu_pd(lanes + 4, high);
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+static unsigned sum_ints_sse2(const int *items, int n)
+{
+  __m128i sum = _mm_setzero_si128();
+  int p = 0;
+
+  for (; p + 4 <= n; p += 4)
+    sum = _mm_add_epi32(sum, _mm_loadu_si128((const __m128i *)(items + p)));
+
+  unsigned lanes[4], total = 0;
+
+  _mm_storeu_si128((__m128i *)lanes, sum);
+
+  for (int k = 0; k < 4; k++)
+    total += lanes[k];
+  for (; p < n; p++)
+    total += (unsigned)items[p];
+
+  return total;
+}
+
+static int min_ints_sse2(const int *items, int n, bool flip)
+{
+  int flips = flip ? ~0 : 0;
+  __m128i flipped = _mm_set1_epi32(flips);
+  __m128i best = _mm_set1_epi32(items[0] ^ flips);
+  int p = 0;
+
+  for (; p + 4 <= n; p += 4) // SSE2 has no pminsd, so compare and select:
+  {
+    __m128i value = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(items + p)), flipped);
+    __m128i less = _mm_cmplt_epi32(value, best);
+
+    best = _mm_or_si128(_mm_and_si128(less, value), _mm_andnot_si128(less, best));
+  }
+
+  int lanes[4], min = items[0] ^ flips;
+
+  _mm_storeu_si128((__m128i *)lanes, best);
+
+  for (int k = 0; k < 4; k++)
+    if (lanes[k] < min)
+      min = lanes[k];
+  for (; p < n; p++)
+    if ((items[p] ^ flips) < min)
+      min = items[p] ^ flips;
+
+  return min ^ flips;
+}
+
+static void sum_lanes_sse2(const double *items, int m, double *lanes)
+{
+  __m128d sums[4];
+
+  for (int k = 0; k < 4; k++)
+    sums[k] = _mm_loadu_pd(lanes + 2 * k);
+
+  for (int p = 0; p < m; p += 8)
+    for (int k = 0; k < 4; k++)
+      sums[k] = _mm_add_pd(sums[k], _mm_loadu_pd(items + p + 2 * k));
+
+  for (int k = 0; k < 4; k++)
+    _mm_storeu_pd(lanes + 2 * k, sums[k]);
+}
+
+static void min_lanes_sse2(const double *items, int m, double *lanes, bool flip)
+{
+  __m128d flipped = _mm_set1_pd(flip ? -0.0 : 0.0);
+  __m128d mins[4];
+
+  for (int k = 0; k < 4; k++)
+    mins[k] = _mm_loadu_pd(lanes + 2 * k);
+
+  for (int p = LANES; p < m; p += 8)
+    for (int k = 0; k < 4; k++)
+      mins[k] = _mm_min_pd(_mm_xor_pd(_mm_loadu_pd(items + p + 2 * k), flipped), mins[k]);
+
+  for (int k = 0; k < 4; k++)
+    _mm_storeu_pd(lanes + 2 * k, mins[k]);
+}
+
+static void dot_lanes_sse2(const double *x, const double *y, int m, double *lanes)
+{
+  __m128d sums[4];
+
+  for (int k = 0; k < 4; k++)
+    sums[k] = _mm_loadu_pd(lanes + 2 * k);
+
+  for (int p = 0; p < m; p += 8)
+    for (int k = 0; k < 4; k++)
+      sums[k] = _mm_add_pd(sums[k], _mm_mul_pd(_mm_loadu_pd(x + p + 2 * k), _mm_loadu_pd(y + p + 2 * k)));
+
+  for (int k = 0; k < 4; k++)
+    _mm_storeu_pd(lanes + 2 * k, sums[k]);
+}
+
+#else
+
+static unsigned sum_ints_c(const int *items, int n)
+{
+  unsigned total = 0;
+
+  for (int p = 0; p < n; p++)
+    total += (unsigned)items[p];
+
+  return total;
+}
+
+static int min_ints_c(const int *items, int n, bool flip)
+{
+  int flips = flip ? ~0 : 0;
+  int min = items[0] ^ flips;
+
+  for (int p = 1; p < n; p++)
+    if ((items[p] ^ flips) < min)
+      min = items[p] ^ flips;
+
+  return min ^ flips;
+}
+
+static void sum_lanes_c(const double *items, int m, double *lanes)
+{
+  for (int p = 0; p < m; p += LANES)
+    for (int k = 0; k < LANES; k++)
+      lanes[k] += items[p + k];
+}
+
+static void min_lanes_c(const double *items, int m, double *lanes, bool flip)
+{
+  for (int p = LANES; p < m; p += LANES)
+    for (int k = 0; k < LANES; k++)
+    {
+      double value = (flip ? -1.0 : 1.0) * items[p + k];
+
+      lanes[k] = (value < lanes[k]) ? value : lanes[k];
+    }
+}
+
+static void dot_lanes_c(const double *x, const double *y, int m, double *lanes)
+{
+  for (int p = 0; p < m; p += LANES)
+    for (int k = 0; k < LANES; k++)
+    {
+      double product = x[p + k] * y[p + k];
+
+      lanes[k] += product;
+    }
+}
+
+#endif
+
+static unsigned dot_ints_c(const int *x, const int *y, int n)
+{
+  unsigned total = 0;
+
+  for (int p = 0; p < n; p++)
+    total += (unsigned)x[p] * (unsigned)y[p];
+
+  return total;
+}
+
+//
+// sum_ints, min_ints, dot_ints
+//
+// Reduce a C array of ints with the best kernel for the CPU.
+// dot_ints has no SSE2 kernel: SSE2 can't multiply 32-bit ints.
+//
+static int sum_ints(const int *items, int n)
+{
+#if defined(AVX2_KERNELS)
+  if (has_avx2())
+    return (int)sum_ints_avx2(items, n);
+#endif
+#if defined(__SSE2__)
+  return (int)sum_ints_sse2(items, n);
+#else
+  return (int)sum_ints_c(items, n);
+#endif
+}
+
+static int min_ints(const int *items, int n, bool flip)
+{
+#if defined(AVX2_KERNELS)
+  if (has_avx2())
+    return min_ints_avx2(items, n, flip);
+#endif
+#if defined(__SSE2__)
+  return min_ints_sse2(items, n, flip);
+#else
+  return min_ints_c(items, n, flip);
+#endif
+}
+
+static int dot_ints(const int *x, const int *y, int n)
+{
+#if defined(AVX2_KERNELS)
+  if (has_avx2())
+    return (int)dot_ints_avx2(x, y, n);
+#endif
+  return (int)dot_ints_c(x, y, n);
+}
+
+//
+// add_lanes
+//
+// Adds up the lanes of a sum, in the order given in reduce.h.
+//
+static double add_lanes(const double *lanes)
+{
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+//
+// sum_reals, min_reals, dot_reals
+//
+// Reduce a C array of reals with the best kernel for the CPU; see
+// reduce.h for the order they're added in.
+//
+static double sum_reals(const double *items, int n)
+{
+  double lanes[LANES] = {0.0};
+  int m = n - n % LANES;
+
+  if (has_avx2())
+  {
+#if defined(AVX2_KERNELS)
+    sum_lanes_avx2(items, m, lanes);
+#endif
+  }
+  else
+  {
+#if defined(__SSE2__)
+    sum_lanes_sse2(items, m, lanes);
+#else
+    sum_lanes_c(items, m, lanes);
+#endif
+  }
+
+  double sum = add_lanes(lanes);
+
+  for (int p = m; p < n; p++)
+    sum += items[p];
+
+  return sum;
+}
+
+static double min_reals(const double *items, int n, bool flip)
+{
+  double sign = flip ? -1.0 : 1.0;
+  double min = sign * items[0];
+  int m = 0;
+
+  if (n >= LANES) // each lane starts with one of the first 8 items:
+  {
+    double lanes[LANES];
+
+    m = n - n % LANES;
+
+    for (int k = 0; k < LANES; k++)
+      lanes[k] = sign * items[k];
+
+    if (has_avx2())
+    {
+#if defined(AVX2_KERNELS)
+      min_lanes_avx2(items, m, lanes, flip);
+#endif
+    }
+    else
+    {
+#if defined(__SSE2__)
+      min_lanes_sse2(items, m, lanes, flip);
+#else
+      min_lanes_c(items, m, lanes, flip);
+#endif
+    }
+
+    min = lanes[0];
+
+    for (int k = 1; k < LANES; k++)
+      min = (lanes[k] < min) ? lanes[k] : min;
+  }
+
+  for (int p = m; p < n; p++)
+    min = (sign * items[p] < min) ? sign * items[p] : min;
+
+  return sign * min;
+}
+
+static double dot_reals(const double *x, const double *y, int n)
+{
+  double lanes[LANES] = {0.0};
+  int m = n - n % LANES;
+
+  if (has_avx2())
+  {
+#if defined(AVX2_KERNELS)
+    dot_lanes_avx2(x, y, m, lanes);
+#endif
+  }
+  else
+  {
+#if defined(__SSE2__)
+    dot_lanes_sse2(x, y, m, lanes);
+#else
+    dot_lanes_c(x, y, m, lanes);
+#endif
+  }
+
+  double sum = add_lanes(lanes);
+
+  for (int p = m; p < n; p++)
+  {
+    double product = x[p] * y[p];
+
+    sum += product;
+  }
+
+  return sum;
+}
+
+//
+// is_number, number
+//
+// Numbers are ints, reals and booleans.
+//
+static bool is_number(struct RAM_VALUE value)
+{
+  return value.value_type == RAM_TYPE_INT || value.value_type == RAM_TYPE_REAL || value.value_type == RAM_TYPE_BOOLEAN;
+}
+
+static double number(struct RAM_VALUE value)
+{
+  return (value.value_type == RAM_TYPE_REAL) ? value.types.d : (double)value.types.i;
+}
+
+//
+// numbers_of
+//
+// Returns what the list's items are (enum NUMBERS); an empty list
+// is ALL_INTS.
+//
+static int numbers_of(struct LIST *list)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+
+  if (list->length == 0 || buffer->kind == LIST_INT)
+    return ALL_INTS;
+  if (buffer->kind == LIST_REAL)
+    return SOME_REALS;
+
+  int numbers = ALL_INTS;
+
+  for (int p = list->start; p < list->start + list->length; p++)
+  {
+    struct RAM_VALUE item = buffer->items.boxed[p];
+
+    if (!is_number(item))
+      return NOT_NUMBERS;
+    if (item.value_type == RAM_TYPE_REAL)
+      numbers = SOME_REALS;
+  }
+
+  return numbers;
+}
+
+//
+// ints_of, reals_of
+//
+// Return the items of a list of numbers as a C array of ints (only
+// if ALL_INTS) or reals: the list's own items if its buffer is of
+// that kind, else a copy, which the caller must free (*copied is
+// set).
+//
+static const int *ints_of(struct LIST *list, bool *copied)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+
+  *copied = (buffer->kind != LIST_INT);
+
+  if (!*copied)
+    return buffer->items.i + list->start;
+
+  int *items = (int *)malloc((list->length + 1) * sizeof(int));
+
+  if (items == NULL)
+    panic("out of memory (ints_of)");
+
+  for (int k = 0; k < list->length; k++)
+    items[k] = buffer->items.boxed[list->start + k].types.i;
+
+  return items;
+}
+
+static const double *reals_of(struct LIST *list, bool *copied)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+
+  *copied = (buffer->kind != LIST_REAL);
+
+  if (!*copied)
+    return buffer->items.d + list->start;
+
+  double *items = (double *)malloc((list->length + 1) * sizeof(double));
+
+  if (items == NULL)
+    panic("out of memory (reals_of)");
+
+  for (int k = 0; k < list->length; k++)
+    items[k] = (buffer->kind == LIST_INT) ? (double)buffer->items.i[list->start + k]
+                                          : number(buffer->items.boxed[list->start + k]);
+
+  return items;
+}
+
+//
+// extreme
+//
+// reduce_min, or with largest set, reduce_max. A boxed list is
+// searched item by item, keeping the first of equal items.
+//
+static bool extreme(struct LIST *list, struct RAM_VALUE *result, bool largest)
+{
+  struct LIST_BUFFER *buffer = list->buffer;
+
+  if (buffer->kind == LIST_INT)
+  {
+    result->value_type = RAM_TYPE_INT;
+    result->types.i = min_ints(buffer->items.i + list->start, list->length, largest);
+    return true;
+  }
+  else if (buffer->kind == LIST_REAL)
+  {
+    result->value_type = RAM_TYPE_REAL;
+    result->types.d = min_reals(buffer->items.d + list->start, list->length, largest);
+    return true;
+  }
+
+  struct RAM_VALUE *items = buffer->items.boxed + list->start;
+  bool strings = (items[0].value_type == RAM_TYPE_STR);
+  int best = 0;
+
+  for (int k = 0; k < list->length; k++)
+  {
+    if (strings ? items[k].value_type != RAM_TYPE_STR : !is_number(items[k]))
+      return false; // can't be compared
+
+    bool less = strings ? strcmp(items[k].types.s, items[best].types.s) < 0
+                        : number(items[k]) < number(items[best]);
+    bool greater = strings ? strcmp(items[k].types.s, items[best].types.s) > 0
+                           : number(items[k]) > number(items[best]);
+
+    if (largest ? greater : less)
+      best = k;
+  }
+
+  *result = items[best];
+
+  if (strings)
+    result->types.s = dupString(result->types.s);
+
+  return true;
+}
+
+//
+// Public functions:
+//
+
+//
+// reduce_sum
+//
+bool reduce_sum(struct LIST *list, struct RAM_VALUE *result)
+{
+  int numbers = numbers_of(list);
+  bool copied;
+
+  if (numbers == NOT_NUMBERS)
+    return false;
+
+  if (numbers == ALL_INTS)
+  {
+    const int *items = ints_of(list, &copied);
+
+    result->value_type = RAM_TYPE_INT;
+    result->types.i = sum_ints(items, list->length);
+
+    if (copied)
+      free((void *)items);
+  }
+  else
+  {
+    const double *items = reals_of(list, &copied);
+
+    result->value_type = RAM_TYPE_REAL;
+    result->types.d = sum_reals(items, list->length);
+
+    if (copied)
+      free((void *)items);
+  }
+
+  return true;
+}
+
+//
+// reduce_min, reduce_max
+//
+bool reduce_min(struct LIST *list, struct RAM_VALUE *result)
+{
+  return extreme(list, result, false);
+}
+
+bool reduce_max(struct LIST *list, struct RAM_VALUE *result)
+{
+  return extreme(list, result, true);
+}
+
+//
+// reduce_dot
+//
+bool reduce_dot(struct LIST *x, struct LIST *y, struct RAM_VALUE *result)
+{
+  int x_numbers = numbers_of(x), y_numbers = numbers_of(y);
+  bool x_copied, y_copied;
+
+  if (x_numbers == NOT_NUMBERS || y_numbers == NOT_NUMBERS)
+    return false;
+
+  if (x_numbers == ALL_INTS && y_numbers == ALL_INTS)
+  {
+    const int *x_items = ints_of(x, &x_copied), *y_items = ints_of(y, &y_copied);
+
+    result->value_type = RAM_TYPE_INT;
+    result->types.i = dot_ints(x_items, y_items, x->length);
+
+    if (x_copied)
+      free((void *)x_items);
+    if (y_copied)
+      free((void *)y_items);
+  }
+  else
+  {
+    const double *x_items = reals_of(x, &x_copied), *y_items = reals_of(y, &y_copied);
+
+    result->value_type = RAM_TYPE_REAL;
+    result->types.d = dot_reals(x_items, y_items, x->length);
+
+    if (x_copied)
+      free((void *)x_items);
+    if (y_copied)
+      free((void *)y_items);
+  }
+
+  return true;
+}
@@ -0,0 +1,63 @@
+/*reduce.h*/
+
+//
+// Reductions over lists for nuPython's builtins sum(), min(), max()
+// and dot().
+//
+// Lists of ints and of reals keep their items unboxed (see list.h),
+// and those are reduced by kernels using AVX2 when the CPU has it
+// (checked at run time), else SSE2, else plain C. Ints wrap around,
+// as they do in the executor, so their sums don't depend on the
+// order the items are added in. Reals do, so a sum of reals (and
+// dot's sum of products) is always added in the same order, however
+// it's computed: the items at positions 0, 8, 16, ... are added in
+// lane 0, those at 1, 9, 17, ... in lane 1, and so on for 8 lanes,
+// which are then added as ((0 + 1) + (2 + 3)) + ((4 + 5) + (6 + 7)),
+// and the last length % 8 items added to that in turn. So a sum of
+// the same reals is the same on every machine; it may differ in the
+// last bits from adding them left to right.
+//
+// Boxed lists are reduced item by item; a list of numbers that
+// holds a real is summed as a list of reals would be.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+
+#include "list.h"
+#include "ram.h"
+
+//
+// Public functions:
+//
+
+//
+// reduce_sum
+//
+// Returns the sum of the list's items via the reference parameter:
+// an int if they're all ints (or booleans), else a real; 0 if the
+// list is empty. Returns false if an item isn't a number.
+//
+bool reduce_sum(struct LIST *list, struct RAM_VALUE *result);
+
+//
+// reduce_min, reduce_max
+//
+// Return the smallest or largest item of the list, which must not
+// be empty, via the reference parameter, owned by the caller. The
+// items must all be numbers, or all strings (compared with strcmp);
+// returns false if not.
+//
+bool reduce_min(struct LIST *list, struct RAM_VALUE *result);
+bool reduce_max(struct LIST *list, struct RAM_VALUE *result);
+
+//
+// reduce_dot
+//
+// Returns the sum of the products of the items of x and y, which
+// must be the same length, via the reference parameter: an int if
+// the items are all ints, else a real. Returns false if an item
+// isn't a number.
+//
+bool reduce_dot(struct LIST *x, struct LIST *y, struct RAM_VALUE *result);
@@ -15,13 +15,39 @@
 
 #include "scanner.h"
 
+//
+// store_char
+//
+// Stores c at position i of the scanner's value, growing the
+// buffer as needed so values of any length can be collected.
+//
+static void store_char(struct Scanner *scanner, size_t i, char c)
+{
+  if (i >= scanner->capacity)
+  {
+    size_t capacity = scanner->capacity * 2;
+
+    char *value = (char *)realloc(scanner->value, capacity);
+    if (value == NULL)
+    {
+      printf("**SCANNER ERROR: out of memory (store_char)\n");
+      exit(-123);
+    }
+
+    scanner->value = value;
+    scanner->capacity = capacity;
+  }
+
+  scanner->value[i] = c;
+}
+
 //
 // collect_identifier
 //
-// Given the start of an identifier, collects the rest into value
-// while advancing the column number.
+// Given the start of an identifier, collects the rest into the
+// scanner's value while advancing the column number.
 //
-static void collect_identifier(FILE *input, int c, int *colNumber, char *value)
+static void collect_identifier(struct Scanner *scanner, int c)
 {
   assert(isalpha(c) || c == '_'); // c should be start of identifier
 
@@ -29,20 +55,20 @@ static void collect_identifier(FILE *input, int c, int *colNumber, char *value)
 
   while (isalnum(c) || c == '_') // letter, digit, or underscore
   {
-    value[i] = (char)c; // store char
+    store_char(scanner, i, (char)c); // store char
     i++;
 
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
 
-    c = fgetc(input); // get next char
+    c = fgetc(scanner->input); // get next char
   }
 
   // at this point we found the end of the identifer, so put
   // that last char back for processing later:
-  ungetc(c, input);
+  ungetc(c, scanner->input);
 
   // turn the value into a string, and let's see if we have a keyword:
-  value[i] = '\0'; // build C-style string:
+  store_char(scanner, i, '\0'); // build C-style string:
 
   return;
 }
@@ -94,10 +120,11 @@ static int id_or_keyword(char *value)
 // Given the start of an integer or real literal, collects
 // the digits (and decimal point) into the given value, advancing
 // the column pointer as it goes. The final token ID is returned,
-// since it could be an integer literal or a real literal.
+// since it could be an integer literal or a real literal (or just
+// a dot, if a '.' isn't followed by a digit).
 //
 //
-static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *value)
+static int collect_numeric_literal(struct Scanner *scanner, int c)
 {
   assert(c == '.' || isdigit(c)); // c should be start of a numeric literal
 
@@ -109,38 +136,38 @@ static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *val
   //
   if (c == '.')
   {
-    value[i] = '.';
+    store_char(scanner, i, '.');
     i++;
 
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
 
-    c = fgetc(input); // get next char
+    c = fgetc(scanner->input); // get next char
 
     if (!isdigit(c))
-    { // '.' by itself => unknown token:
-      ungetc(c, input);
+    { // '.' by itself => a dot, as in x.append(1):
+      ungetc(c, scanner->input);
 
-      value[i] = '\0';
+      store_char(scanner, i, '\0');
 
-      return nuPy_UNKNOWN;
+      return nuPy_DOT;
     }
 
     while (isdigit(c))
     {
-      value[i] = (char)c; // store char
+      store_char(scanner, i, (char)c); // store char
       i++;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      c = fgetc(input); // get next char
+      c = fgetc(scanner->input); // get next char
     }
 
     // at this point we found the end of the literal, so put
     // that last char back for processing later:
-    ungetc(c, input);
+    ungetc(c, scanner->input);
 
     // turn the value into a string:
-    value[i] = '\0'; // build C-style string:
+    store_char(scanner, i, '\0'); // build C-style string:
 
     return nuPy_REAL_LITERAL;
   }
@@ -152,15 +179,15 @@ static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *val
   //
   while (isdigit(c))
   {
-    value[i] = (char)c; // store char
+    store_char(scanner, i, (char)c); // store char
     i++;
 
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
 
-    c = fgetc(input); // get next char
+    c = fgetc(scanner->input); // get next char
   }
 
-  value[i] = '\0'; // build C-style string:
+  store_char(scanner, i, '\0'); // build C-style string:
 
   //
   // we have the integer part, what stopped the loop? if it's
@@ -168,7 +195,7 @@ static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *val
   //
   if (c != '.') // not a real literal, so return this int:
   {
-    ungetc(c, input); // put the char back for processing next:
+    ungetc(c, scanner->input); // put the char back for processing next:
 
     return nuPy_INT_LITERAL;
   }
@@ -179,29 +206,29 @@ static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *val
   // at this point we have the start of a real literal, so
   // collect the decimal point and digits:
   //
-  value[i] = '.';
+  store_char(scanner, i, '.');
   i++;
 
-  (*colNumber)++; // advance col # past char
+  scanner->col++; // advance col # past char
 
-  c = fgetc(input); // get next char
+  c = fgetc(scanner->input); // get next char
 
   while (isdigit(c))
   {
-    value[i] = (char)c; // store char
+    store_char(scanner, i, (char)c); // store char
     i++;
 
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
 
-    c = fgetc(input); // get next char
+    c = fgetc(scanner->input); // get next char
   }
 
   // at this point we found the end of the literal, so put
   // that last char back for processing later:
-  ungetc(c, input);
+  ungetc(c, scanner->input);
 
   // turn the value into a string:
-  value[i] = '\0'; // build C-style string:
+  store_char(scanner, i, '\0'); // build C-style string:
 
   return nuPy_REAL_LITERAL;
 }
@@ -212,7 +239,7 @@ static int collect_numeric_literal(FILE *input, int c, int *colNumber, char *val
 // Given the start of a string literal, collects the rest into value
 // while advancing the column number.
 //
-static void collect_string_literal(FILE *input, int c, int *colNumber, char *value,
+static void collect_string_literal(struct Scanner *scanner, int c,
                                    int startLine, int startCol)
 {
   assert(c == '"' || c == '\''); // c should be start of string literal
@@ -223,8 +250,8 @@ static void collect_string_literal(FILE *input, int c, int *colNumber, char *val
   // we don't want to store the start and end chars, so
   // let's advance past the start of the string literal:
   //
-  (*colNumber)++;   // advance col # past char
-  c = fgetc(input); // get next char
+  scanner->col++;   // advance col # past char
+  c = fgetc(scanner->input); // get next char
 
   //
   // now let's collect the string literal:
@@ -233,15 +260,15 @@ static void collect_string_literal(FILE *input, int c, int *colNumber, char *val
 
   while (c != startChar && c != '\n' && c != EOF)
   {
-    value[i] = (char)c; // store char
+    store_char(scanner, i, (char)c); // store char
     i++;
 
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
 
-    c = fgetc(input); // get next char
+    c = fgetc(scanner->input); // get next char
   }
 
-  value[i] = '\0'; // build C-style string:
+  store_char(scanner, i, '\0'); // build C-style string:
 
   //
   // how did the loop end? warn the user if they forgot the
@@ -249,10 +276,10 @@ static void collect_string_literal(FILE *input, int c, int *colNumber, char *val
   //
   if (c == '\n' || c == EOF)
   {
-    printf("**WARNING: string literal @ (%d, %d) not terminated properly\n",
-           startLine, startCol);
+    fprintf(scanner->output, "**WARNING: string literal @ (%d, %d) not terminated properly\n",
+            startLine, startCol);
 
-    ungetc(c, input); // put char back for processing next:
+    ungetc(c, scanner->input); // put char back for processing next:
   }
   else
   {
@@ -260,7 +287,7 @@ static void collect_string_literal(FILE *input, int c, int *colNumber, char *val
     // otherwise the string terminated properly, and we consumed
     // the closing quote or double-quote, so advance col number:
     //
-    (*colNumber)++; // advance col # past char
+    scanner->col++; // advance col # past char
   }
 
   return;
@@ -269,38 +296,66 @@ static void collect_string_literal(FILE *input, int c, int *colNumber, char *val
 //
 // scanner_init
 //
-// Initializes line number, column number, and value before
-// the start of the processing the next input stream.
+// Initializes the scanner to start processing the given input
+// stream: line and column numbers start at 1, and the value is
+// the empty string. Warnings are written to the output stream.
+// Returns false if out of memory.
 //
-void scanner_init(int *lineNumber, int *colNumber, char *value)
+bool scanner_init(struct Scanner *scanner, FILE *input, FILE *output)
 {
-  assert(lineNumber != NULL);
-  assert(colNumber != NULL);
-  assert(value != NULL);
+  assert(scanner != NULL);
+  assert(input != NULL);
+  assert(output != NULL);
+
+  scanner->input = input;
+  scanner->output = output;
+  scanner->line = 1;
+  scanner->col = 1;
+
+  scanner->capacity = 256; // grown as needed by store_char
+  scanner->value = (char *)malloc(scanner->capacity);
+  if (scanner->value == NULL)
+    return false;
 
-  *lineNumber = 1;
-  *colNumber = 1;
-  value[0] = '\0'; // empty string
+  scanner->value[0] = '\0'; // empty string
+
+  return true;
+}
+
+//
+// scanner_destroy
+//
+// Frees the scanner's value buffer; the input stream is not
+// closed.
+//
+void scanner_destroy(struct Scanner *scanner)
+{
+  assert(scanner != NULL);
+
+  free(scanner->value);
+  scanner->value = NULL;
+  scanner->capacity = 0;
 }
 
 //
 // scanner_nextToken
 //
-// Returns the next token in the given input stream, advancing the line
-// number and column number as appropriate. The token's string-based
-// value is returned via the "value" parameter. For example, if the
-// token returned is an integer literal, then the value returned is
-// the actual literal in string form, e.g. "123". For an identifer,
+// Returns the next token in the scanner's input stream, advancing
+// the line number and column number as appropriate. The token's
+// string-based value is left in scanner->value. For example, if the
+// token returned is an integer literal, then the value is the
+// actual literal in string form, e.g. "123". For an identifer,
 // the value is the identifer itself, e.g. "print" or "x". For a
-// string literal such as 'hi there', the value is the contents of the
-// string literal without the quotes.
+// string literal such as 'hi there', the value is the contents of
+// the string literal without the quotes.
 //
-struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, char *value)
+// NOTE: the value is owned by the scanner, and is only valid
+// until the next call to scanner_nextToken().
+//
+struct Token scanner_nextToken(struct Scanner *scanner)
 {
-  assert(input != NULL);
-  assert(lineNumber != NULL);
-  assert(colNumber != NULL);
-  assert(value != NULL);
+  assert(scanner != NULL);
+  assert(scanner->value != NULL);
 
   struct Token T;
 
@@ -312,7 +367,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
     //
     // Get the next input character:
     //
-    int c = fgetc(input);
+    int c = fgetc(scanner->input);
 
     //
     // Let's see what we have...
@@ -321,152 +376,152 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
     if (c == EOF || c == '$') // no more input, return EOS:
     {
       T.id = nuPy_EOS;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      value[0] = '$';
-      value[1] = '\0';
+      store_char(scanner, 0, '$');
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '\n') // end of line, keep going:
     {
-      (*lineNumber)++; // next line, restart column:
-      *colNumber = 1;
+      scanner->line++; // next line, restart column:
+      scanner->col = 1;
       continue;
     }
     else if (isspace(c)) // other form of whitespace, skip:
     {
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
       continue;
     }
     else if (c == '(')
     {
       T.id = nuPy_LEFT_PAREN;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == ')')
     {
       T.id = nuPy_RIGHT_PAREN;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '[')
     {
       T.id = nuPy_LEFT_BRACKET;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == ']')
     {
       T.id = nuPy_RIGHT_BRACKET;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '{')
     {
       T.id = nuPy_LEFT_BRACE;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '}')
     {
       T.id = nuPy_RIGHT_BRACE;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '+')
     {
       T.id = nuPy_PLUS;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '-')
     {
       T.id = nuPy_MINUS;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '/')
     {
       T.id = nuPy_SLASH;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == '%')
     {
       T.id = nuPy_PERCENT;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
@@ -476,27 +531,27 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // could be * or **, let's assume * for now:
       //
       T.id = nuPy_ASTERISK;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = '*';
-      value[1] = '\0';
+      store_char(scanner, 0, '*');
+      store_char(scanner, 1, '\0');
 
       //
       // now let's read the next char and see what we have:
       //
-      c = fgetc(input);
+      c = fgetc(scanner->input);
 
       if (c == '*') // it's **
       {
         T.id = nuPy_POWER;
 
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        value[1] = '*';
-        value[2] = '\0';
+        store_char(scanner, 1, '*');
+        store_char(scanner, 2, '\0');
 
         return T;
       }
@@ -506,33 +561,46 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // form a token, so we need to put the char
       // back to be processed on the next call:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       return T;
     }
     else if (c == '&')
     {
       T.id = nuPy_AMPERSAND;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
     else if (c == ':')
     {
       T.id = nuPy_COLON;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
+
+      scanner->col++; // advance col # past char
+
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
+
+      return T;
+    }
+    else if (c == ',')
+    {
+      T.id = nuPy_COMMA;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
@@ -542,27 +610,27 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // could be = or ==, let's assume = for now:
       //
       T.id = nuPy_EQUAL;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = '=';
-      value[1] = '\0';
+      store_char(scanner, 0, '=');
+      store_char(scanner, 1, '\0');
 
       //
       // now let's read the next char and see what we have:
       //
-      c = fgetc(input);
+      c = fgetc(scanner->input);
 
       if (c == '=') // it's ==
       {
         T.id = nuPy_EQUALEQUAL;
 
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        value[1] = '=';
-        value[2] = '\0';
+        store_char(scanner, 1, '=');
+        store_char(scanner, 2, '\0');
 
         return T;
       }
@@ -572,7 +640,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // form a token, so we need to put the char
       // back to be processed on the next call:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       return T;
     }
@@ -583,27 +651,27 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // assume it's the unknown token if it appears by itself:
       //
       T.id = nuPy_UNKNOWN;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = '!';
-      value[1] = '\0';
+      store_char(scanner, 0, '!');
+      store_char(scanner, 1, '\0');
 
       //
       // now let's read the next char and see what we have:
       //
-      c = fgetc(input);
+      c = fgetc(scanner->input);
 
       if (c == '=') // it's !=
       {
         T.id = nuPy_NOTEQUAL;
 
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        value[1] = '=';
-        value[2] = '\0';
+        store_char(scanner, 1, '=');
+        store_char(scanner, 2, '\0');
 
         return T;
       }
@@ -613,7 +681,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // form a token, so we need to put the char
       // back to be processed on the next call:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       return T;
     }
@@ -623,27 +691,27 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // could be < or <=, let's assume < for now:
       //
       T.id = nuPy_LT;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = '<';
-      value[1] = '\0';
+      store_char(scanner, 0, '<');
+      store_char(scanner, 1, '\0');
 
       //
       // now let's read the next char and see what we have:
       //
-      c = fgetc(input);
+      c = fgetc(scanner->input);
 
       if (c == '=') // it's <=
       {
         T.id = nuPy_LTE;
 
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        value[1] = '=';
-        value[2] = '\0';
+        store_char(scanner, 1, '=');
+        store_char(scanner, 2, '\0');
 
         return T;
       }
@@ -653,7 +721,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // form a token, so we need to put the char
       // back to be processed on the next call:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       return T;
     }
@@ -663,27 +731,27 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // could be > or >=, let's assume > for now:
       //
       T.id = nuPy_GT;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance col # past char
+      scanner->col++; // advance col # past char
 
-      value[0] = '>';
-      value[1] = '\0';
+      store_char(scanner, 0, '>');
+      store_char(scanner, 1, '\0');
 
       //
       // now let's read the next char and see what we have:
       //
-      c = fgetc(input);
+      c = fgetc(scanner->input);
 
       if (c == '=') // it's >=
       {
         T.id = nuPy_GTE;
 
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        value[1] = '=';
-        value[2] = '\0';
+        store_char(scanner, 1, '=');
+        store_char(scanner, 2, '\0');
 
         return T;
       }
@@ -693,7 +761,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // form a token, so we need to put the char
       // back to be processed on the next call:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       return T;
     }
@@ -704,9 +772,9 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       //
       while (c != '\n' && c != EOF)
       {
-        (*colNumber)++; // advance col # past char
+        scanner->col++; // advance col # past char
 
-        c = fgetc(input);
+        c = fgetc(scanner->input);
       }
 
       //
@@ -715,7 +783,7 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // let's unget and loop around to process the \n or EOF
       // instead of copying the code here:
       //
-      ungetc(c, input);
+      ungetc(c, scanner->input);
 
       continue;
     }
@@ -725,15 +793,15 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // start of identifier or keyword, let's assume identifier for now:
       //
       T.id = nuPy_IDENTIFIER;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      collect_identifier(input, c, colNumber, value);
+      collect_identifier(scanner, c);
 
       //
       // is the identifier a keyword?
       //
-      T.id = id_or_keyword(value);
+      T.id = id_or_keyword(scanner->value);
 
       return T;
     }
@@ -744,10 +812,10 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // now and see what happens:
       //
       T.id = nuPy_INT_LITERAL;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      T.id = collect_numeric_literal(input, c, colNumber, value);
+      T.id = collect_numeric_literal(scanner, c);
 
       return T;
     }
@@ -759,10 +827,10 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // note that literal must start and with the same char...
       //
       T.id = nuPy_STR_LITERAL;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      collect_string_literal(input, c, colNumber, value, T.line, T.col);
+      collect_string_literal(scanner, c, T.line, T.col);
 
       return T;
     }
@@ -772,13 +840,13 @@ struct Token scanner_nextToken(FILE *input, int *lineNumber, int *colNumber, cha
       // if we get here, then char denotes an UNKNOWN token:
       //
       T.id = nuPy_UNKNOWN;
-      T.line = *lineNumber;
-      T.col = *colNumber;
+      T.line = scanner->line;
+      T.col = scanner->col;
 
-      (*colNumber)++; // advance past char
+      scanner->col++; // advance past char
 
-      value[0] = (char)c;
-      value[1] = '\0';
+      store_char(scanner, 0, (char)c);
+      store_char(scanner, 1, '\0');
 
       return T;
     }
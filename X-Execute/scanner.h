@@ -9,27 +9,56 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h> // true, false
 #include "token.h"
 
 
+//
+// Scanner state: the stream being scanned, where we are in it,
+// and the value of the last token. Each scanner is independent,
+// so different threads can scan different streams at once.
+//
+struct Scanner
+{
+  FILE *input;     // stream of characters being scanned
+  FILE *output;    // where warnings are written
+  int line;        // current line # (1-based)
+  int col;         // current column # (1-based)
+  char *value;     // value of the last token, grown as needed
+  size_t capacity; // # of bytes allocated for value
+};
+
 //
 // scanner_init
 //
-// Initializes line number, column number, and value before
-// the start of the processing the next input stream.
+// Initializes the scanner to start processing the given input
+// stream: line and column numbers start at 1, and the value is
+// the empty string. Warnings are written to the output stream.
+// Returns false if out of memory.
+//
+bool scanner_init(struct Scanner* scanner, FILE* input, FILE* output);
+
+//
+// scanner_destroy
 //
-void scanner_init(int* lineNumber, int* colNumber, char* value);
+// Frees the scanner's value buffer; the input stream is not
+// closed.
+//
+void scanner_destroy(struct Scanner* scanner);
 
 //
 // scanner_nextToken
 //
-// Returns the next token in the given input stream, advancing the line
-// number and column number as appropriate. The token's string-based 
-// value is returned via the "value" parameter. For example, if the 
-// token returned is an integer literal, then the value returned is
-// the actual literal in string form, e.g. "123". For an identifer,
-// the value is the identifer itself, e.g. "print" or "x". For a 
-// string literal such as 'hi there', the value is the contents of the 
-// string literal without the quotes.
+// Returns the next token in the scanner's input stream, advancing
+// the line number and column number as appropriate. The token's
+// string-based value is left in scanner->value. For example, if the
+// token returned is an integer literal, then the value is the
+// actual literal in string form, e.g. "123". For an identifer,
+// the value is the identifer itself, e.g. "print" or "x". For a
+// string literal such as 'hi there', the value is the contents of
+// the string literal without the quotes.
+//
+// NOTE: the value is owned by the scanner, and is only valid
+// until the next call to scanner_nextToken().
 //
-struct Token scanner_nextToken(FILE* input, int* lineNumber, int* colNumber, char* value);
+struct Token scanner_nextToken(struct Scanner* scanner);
@@ -0,0 +1,319 @@
+/*strsearch.c*/
+
+//
+// Substring search for nuPython; see strsearch.h.
+//
+
+#include <stdint.h> // SIZE_MAX
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+#include "strsearch.h"
+
+//
+// Private functions:
+//
+
+//
+// filtered_search
+//
+// Finds a needle of at least 2 bytes by testing each position
+// for the needle's first and last bytes before comparing the
+// bytes in between.
+//
+static const char *filtered_search(const unsigned char *haystack, size_t haystack_len, const unsigned char *needle, size_t needle_len)
+{
+  size_t last = needle_len - 1;
+  size_t positions = haystack_len - last; // where the needle can start
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  __m128i firsts = _mm_set1_epi8((char)needle[0]);
+  __m128i lasts = _mm_set1_epi8((char)needle[last]);
+
+  //
+  // 32 positions at a time, as two blocks of 16, each the bytes at
+  // those positions and the bytes needle_len - 1 after them:
+  //
+  for (; i + 32 <= positions; i += 32)
+  {
+    const unsigned char *block = haystack + i;
+    __m128i low = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)block), firsts),
+                                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + last)), lasts));
+    __m128i high = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 16)), firsts),
+                                 _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(block + 16 + last)), lasts));
+
+    if (_mm_movemask_epi8(_mm_or_si128(low, high)) == 0)
+      continue; // the usual case
+
+    uint32_t matches = (uint32_t)_mm_movemask_epi8(low) | ((uint32_t)_mm_movemask_epi8(high) << 16);
+
+    while (matches != 0)
+    {
+      size_t p = i + __builtin_ctz(matches);
+
+      if (memcmp(haystack + p + 1, needle + 1, last - 1) == 0)
+        return (const char *)(haystack + p);
+
+      matches &= matches - 1;
+    }
+  }
+#endif
+
+  //
+  // the rest, or all of it without SSE2, a first byte at a time:
+  //
+  while (i < positions)
+  {
+    const unsigned char *first = (const unsigned char *)memchr(haystack + i, needle[0], positions - i);
+
+    if (first == NULL)
+      return NULL;
+
+    i = first - haystack;
+
+    if (haystack[i + last] == needle[last] && memcmp(haystack + i + 1, needle + 1, last - 1) == 0)
+      return (const char *)(haystack + i);
+
+    i++;
+  }
+
+  return NULL;
+}
+
+//
+// critical_factorization
+//
+// Splits the needle into left and right halves at a critical
+// position, found as the later start of the maximal suffixes under
+// the two orderings of the bytes, and returns that position, the
+// start of the right half. The period of the right half's suffix
+// is returned via the reference parameter.
+//
+static size_t critical_factorization(const unsigned char *needle, size_t needle_len, size_t *period)
+{
+  size_t suffix, j, k, p;
+
+  //
+  // the maximal suffix under <, starting at suffix + 1:
+  //
+  suffix = SIZE_MAX; // i.e. -1
+  j = 0;
+  k = p = 1;
+
+  while (j + k < needle_len)
+  {
+    unsigned char a = needle[j + k];
+    unsigned char b = needle[suffix + k];
+
+    if (a < b) // the suffix at j is smaller, skip past it
+    {
+      j += k;
+      k = 1;
+      p = j - suffix;
+    }
+    else if (a == b)
+    {
+      if (k != p)
+        k++;
+      else
+      {
+        j += p;
+        k = 1;
+      }
+    }
+    else // a > b: a larger suffix starts at j
+    {
+      suffix = j++;
+      k = p = 1;
+    }
+  }
+
+  *period = p;
+
+  //
+  // and under >:
+  //
+  size_t suffix_rev = SIZE_MAX;
+
+  j = 0;
+  k = p = 1;
+
+  while (j + k < needle_len)
+  {
+    unsigned char a = needle[j + k];
+    unsigned char b = needle[suffix_rev + k];
+
+    if (b < a)
+    {
+      j += k;
+      k = 1;
+      p = j - suffix_rev;
+    }
+    else if (a == b)
+    {
+      if (k != p)
+        k++;
+      else
+      {
+        j += p;
+        k = 1;
+      }
+    }
+    else
+    {
+      suffix_rev = j++;
+      k = p = 1;
+    }
+  }
+
+  if (suffix_rev + 1 < suffix + 1)
+    return suffix + 1;
+
+  *period = p;
+  return suffix_rev + 1;
+}
+
+//
+// two_way_search
+//
+// Finds a needle of at least 2 bytes with the Two-Way algorithm:
+// at each position, the right half of the needle is compared left
+// to right, and only if it matches is the left half compared right
+// to left. A mismatch in the right half shifts the needle past it;
+// a mismatch in the left half shifts it by the period. If the whole
+// needle has that period, the bytes already known to match after
+// such a shift are remembered and not compared again.
+//
+// Before any of that, the haystack byte under the needle's last
+// byte is looked up in a table of how far the needle can shift
+// until a byte of the needle lies under it, as in Horspool's
+// algorithm, so most positions are skipped after one comparison.
+//
+static const char *two_way_search(const unsigned char *haystack, size_t haystack_len, const unsigned char *needle, size_t needle_len)
+{
+  size_t period, shift;
+  size_t split = critical_factorization(needle, needle_len, &period);
+  size_t shifts[256];
+  size_t i, j = 0;
+
+  for (i = 0; i < 256; i++)
+    shifts[i] = needle_len;
+  for (i = 0; i < needle_len; i++)
+    shifts[needle[i]] = needle_len - 1 - i;
+
+  if (memcmp(needle, needle + period, split) == 0) // periodic
+  {
+    size_t memory = 0;
+
+    while (j <= haystack_len - needle_len)
+    {
+      shift = shifts[haystack[j + needle_len - 1]];
+
+      if (shift > 0)
+      {
+        if (memory > 0 && shift < period) // no match until past the byte out of place
+          shift = needle_len - period;
+
+        memory = 0;
+        j += shift;
+        continue;
+      }
+
+      // the last byte matches, so the right half up to it:
+      i = (split > memory) ? split : memory;
+
+      while (i < needle_len - 1 && needle[i] == haystack[i + j])
+        i++;
+
+      if (i < needle_len - 1)
+      {
+        j += i - split + 1;
+        memory = 0;
+        continue;
+      }
+
+      i = split - 1;
+
+      while (memory < i + 1 && needle[i] == haystack[i + j])
+        i--;
+
+      if (i + 1 < memory + 1)
+        return (const char *)(haystack + j);
+
+      j += period;
+      memory = needle_len - period;
+    }
+  }
+  else
+  {
+    period = ((split > needle_len - split) ? split : needle_len - split) + 1;
+
+    while (j <= haystack_len - needle_len)
+    {
+      shift = shifts[haystack[j + needle_len - 1]];
+
+      if (shift > 0)
+      {
+        j += shift;
+        continue;
+      }
+
+      i = split;
+
+      while (i < needle_len - 1 && needle[i] == haystack[i + j])
+        i++;
+
+      if (i < needle_len - 1)
+      {
+        j += i - split + 1;
+        continue;
+      }
+
+      i = split - 1;
+
+      while (i != SIZE_MAX && needle[i] == haystack[i + j])
+        i--;
+
+      if (i == SIZE_MAX)
+        return (const char *)(haystack + j);
+
+      j += period;
+    }
+  }
+
+  return NULL;
+}
+
+//
+// Public functions:
+//
+
+//
+// str_search
+//
+const char *str_search(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+  if (needle_len == 0)
+    return haystack;
+  if (needle_len > haystack_len)
+    return NULL;
+  if (needle_len == 1)
+    return (const char *)memchr(haystack, needle[0], haystack_len);
+
+  if (needle_len <= STR_SEARCH_SHORT)
+    return filtered_search((const unsigned char *)haystack, haystack_len, (const unsigned char *)needle, needle_len);
+  else
+    return two_way_search((const unsigned char *)haystack, haystack_len, (const unsigned char *)needle, needle_len);
+}
+
+//
+// str_contains
+//
+bool str_contains(const char *haystack, const char *needle)
+{
+  return str_search(haystack, strlen(haystack), needle, strlen(needle)) != NULL;
+}
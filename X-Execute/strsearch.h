@@ -0,0 +1,42 @@
+/*strsearch.h*/
+
+//
+// Substring search for nuPython's in operator, e.g. 'ab' in line.
+//
+// A needle of up to STR_SEARCH_SHORT bytes is found by filtering:
+// 32 positions of the haystack are tested at once (with SSE2 where
+// available) for the needle's first and last bytes, and only the
+// positions where both match are compared in full, so a search
+// usually touches each byte of the haystack once or twice. Longer
+// needles, where comparing in full at each candidate could take
+// quadratic time, are found with the Two-Way algorithm (Crochemore
+// and Perrin), which takes linear time and constant space, skipping
+// ahead by the haystack byte under the needle's last byte.
+//
+
+#pragma once
+
+#include <stddef.h>  // size_t
+#include <stdbool.h> // true, false
+
+#define STR_SEARCH_SHORT 32
+
+//
+// Public functions:
+//
+
+//
+// str_search
+//
+// Returns a pointer to the first occurrence of the needle, of
+// needle_len bytes, in the haystack, of haystack_len bytes, or
+// NULL if there is none. An empty needle occurs at the start.
+//
+const char *str_search(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len);
+
+//
+// str_contains
+//
+// Returns true if the needle occurs in the haystack, both strings.
+//
+bool str_contains(const char *haystack, const char *needle);
@@ -0,0 +1,311 @@
+/*cachetest.c*/
+
+//
+// Checks that graphcache_load rejects damaged and malformed cache
+// files. A file that is changed anywhere, cut short or grown fails
+// its hash. A file that is changed and then resealed, i.e. given the
+// hash of its new contents, must still hold a well-formed graph (see
+// check_graph): one whose pointers and statements are broken is
+// rejected, and one that loads anyway, say because a literal was
+// changed, must be safe to walk. Run from X-Execute with make
+// cachetest, or make test.
+//
+
+// the file format and hash_words:
+#include "../graphcache.c"
+
+#include "../interpreter.h"
+#include "../parser.h"
+#include "../optimizer.h"
+#include "../tokenqueue.h"
+
+#define NUM_FLIPS 64     // damaged bytes, spread over the file
+#define NUM_RESEALED 500 // random changes that are resealed
+
+static const char *source =
+    "def twice(n):\n"
+    "{\n"
+    "  return n * 2\n"
+    "}\n"
+    "\n"
+    "x = 3 * 4 + 1\n"
+    "l = [1, 2.5, 'a']\n"
+    "d = {'k': 1, 'm': 2}\n"
+    "s = 'abc' + \"def\"\n"
+    "i = 0\n"
+    "while i < 10 and not x < 0:\n"
+    "{\n"
+    "  i = i + 1\n"
+    "}\n"
+    "for j in range(3):\n"
+    "{\n"
+    "  l.append(j)\n"
+    "}\n"
+    "y = twice(i)\n"
+    "z = d['m']\n"
+    "t = s[1:3]\n"
+    "f = 'cd' in s\n"
+    "print(y)\n";
+
+static char source_path[64];
+static char cache_path[256];
+
+//
+// write_file_bytes
+//
+// Replaces the contents of the given file. Returns true if
+// successful.
+//
+static bool write_file_bytes(const char *path, const char *bytes, size_t size)
+{
+  FILE *file = fopen(path, "wb");
+
+  if (file == NULL)
+    return false;
+
+  bool success = fwrite(bytes, 1, size, file) == size;
+
+  return fclose(file) == 0 && success;
+}
+
+//
+// seal
+//
+// Stores the hash of the file's contents in its header, as
+// graphcache_store does.
+//
+static void seal(char *bytes, size_t size)
+{
+  struct GRAPHCACHE_HEADER *h = (struct GRAPHCACHE_HEADER *)bytes;
+  uint64_t hash = hash_words(HASH_START, bytes, offsetof(struct GRAPHCACHE_HEADER, file_hash));
+
+  h->file_hash = hash_words(hash, bytes + sizeof(*h), size - sizeof(*h));
+}
+
+//
+// loads
+//
+// Writes the given cache file for the source and returns true if
+// graphcache_load accepts it, after walking the graph it loads.
+//
+static bool loads(const char *bytes, size_t size)
+{
+  if (!write_file_bytes(cache_path, bytes, size))
+    return false;
+
+  FILE *input = fopen(source_path, "r");
+  struct GraphCache *cache = (input == NULL) ? NULL : graphcache_open(input, source_path);
+  struct STMT *program = graphcache_load(cache);
+
+  if (program != NULL)
+    free(programgraph_listing(program)); // walks every statement and expression
+
+  graphcache_close(cache);
+
+  if (input != NULL)
+    fclose(input);
+
+  return program != NULL;
+}
+
+//
+// check
+//
+// Counts and prints a failure if the file isn't loaded or
+// rejected as expected.
+//
+static void check(const char *what, const char *bytes, size_t size, bool expected, int *failed)
+{
+  bool loaded = loads(bytes, size);
+
+  printf("%s: %s\n", (loaded == expected) ? "ok" : "FAILED", what);
+
+  if (loaded != expected)
+    (*failed)++;
+}
+
+//
+// store_program
+//
+// Builds the source's program graph and stores it in the cache.
+// Returns true if successful.
+//
+static bool store_program(void)
+{
+  FILE *input = fopen(source_path, "r");
+  struct Interpreter *interp = interpreter_create(stdin, stdout);
+
+  if (input == NULL || interp == NULL)
+  {
+    if (input != NULL)
+      fclose(input);
+    return false;
+  }
+
+  struct GraphCache *cache = graphcache_open(input, source_path);
+  struct TokenQueue *tokens = parser_parse(interp, input);
+  struct STMT *program = (tokens == NULL) ? NULL : programgraph_build(interp, tokens);
+  bool success = false;
+
+  if (cache != NULL && program != NULL)
+  {
+    char *listing = programgraph_listing(program);
+
+    optimizer_run(interp, program, true, false, NULL);
+
+    success = graphcache_store(cache, program, listing);
+    snprintf(cache_path, sizeof(cache_path), "%s", cache->path);
+
+    free(listing);
+  }
+
+  if (program != NULL)
+    programgraph_destroy(program);
+  if (tokens != NULL)
+    tokenqueue_destroy(tokens);
+
+  graphcache_close(cache);
+  interpreter_destroy(interp);
+  fclose(input);
+
+  return success;
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/cachetestXXXXXX";
+
+  if (mkdtemp(dir) == NULL)
+  {
+    printf("**ERROR: unable to create a directory for the cache\n");
+    return 1;
+  }
+
+  setenv("NUPY_CACHE_DIR", dir, 1);
+  snprintf(source_path, sizeof(source_path), "%s/p.py", dir);
+
+  if (!write_file_bytes(source_path, source, strlen(source)) || !store_program())
+  {
+    printf("**ERROR: unable to store the program graph\n");
+    return 1;
+  }
+
+  //
+  // the file as stored:
+  //
+  FILE *file = fopen(cache_path, "rb");
+  struct stat st;
+
+  if (file == NULL || fstat(fileno(file), &st) != 0)
+  {
+    printf("**ERROR: unable to read '%s'\n", cache_path);
+    return 1;
+  }
+
+  size_t size = (size_t)st.st_size;
+  char *original = (char *)malloc(size + 8);
+  char *bytes = (char *)malloc(size + 8);
+
+  if (original == NULL || bytes == NULL || fread(original, 1, size, file) != size)
+  {
+    printf("**ERROR: unable to read '%s'\n", cache_path);
+    return 1;
+  }
+
+  fclose(file);
+
+  struct GRAPHCACHE_HEADER *header = (struct GRAPHCACHE_HEADER *)bytes;
+  int failed = 0;
+
+  check("the file as stored loads", original, size, true, &failed);
+
+  //
+  // damaged, so the hash doesn't match:
+  //
+  int flips_loaded = 0;
+
+  for (int i = 0; i < NUM_FLIPS; i++)
+  {
+    memcpy(bytes, original, size);
+    bytes[(size_t)i * size / NUM_FLIPS] ^= 0x5A;
+
+    if (loads(bytes, size))
+      flips_loaded++;
+  }
+
+  printf("%s: %d files with a damaged byte load\n", (flips_loaded == 0) ? "ok" : "FAILED", flips_loaded);
+  failed += (flips_loaded > 0);
+
+  check("a file cut short is rejected", original, size / 2, false, &failed);
+
+  memcpy(bytes, original, size);
+  memset(bytes + size, 0, 8);
+  check("a file with an extra word is rejected", bytes, size + 8, false, &failed);
+
+  //
+  // malformed, and resealed:
+  //
+  memcpy(bytes, original, size);
+  seal(bytes, size);
+  check("the file resealed loads", bytes, size, true, &failed);
+
+  memcpy(bytes, original, size);
+  ((struct STMT *)(bytes + header->root))->stmt_type = 99;
+  seal(bytes, size);
+  check("an unknown type of statement is rejected", bytes, size, false, &failed);
+
+  memcpy(bytes, original, size);
+  header->root = header->image_end + 64;
+  seal(bytes, size);
+  check("a root outside the image is rejected", bytes, size, false, &failed);
+
+  uint64_t *relocs = (uint64_t *)(bytes + ((struct GRAPHCACHE_HEADER *)original)->image_end);
+  uint64_t target = ((struct GRAPHCACHE_HEADER *)original)->image_end;
+
+  memcpy(bytes, original, size);
+  memcpy(bytes + relocs[0], &target, sizeof(target));
+  seal(bytes, size);
+  check("a pointer outside the image is rejected", bytes, size, false, &failed);
+
+  memcpy(bytes, original, size);
+  relocs[0] = offsetof(struct GRAPHCACHE_HEADER, root);
+  seal(bytes, size);
+  check("a pointer in the header is rejected", bytes, size, false, &failed);
+
+  memcpy(bytes, original, size);
+  header->root += 1; // not a node
+  seal(bytes, size);
+  check("a misaligned root is rejected", bytes, size, false, &failed);
+
+  //
+  // random changes to the image: whatever loads must be walkable
+  // (a crash fails the test), and most changes must be caught
+  //
+  int resealed_loaded = 0;
+
+  srand(1);
+
+  for (int i = 0; i < NUM_RESEALED; i++)
+  {
+    memcpy(bytes, original, size);
+
+    size_t at = sizeof(*header) + (size_t)rand() % (header->image_end - sizeof(*header));
+
+    bytes[at] = (char)rand();
+    seal(bytes, size);
+
+    if (loads(bytes, size))
+      resealed_loaded++;
+  }
+
+  printf("ok: %d of %d resealed files with a random change load\n", resealed_loaded, NUM_RESEALED);
+
+  free(original);
+  free(bytes);
+
+  unlink(cache_path);
+  unlink(source_path);
+  rmdir(dir);
+
+  return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*definedtest.c*/
+
+//
+// Checks the definite-assignment proofs of optimizer_types, via
+// optimizer_report_undefined: a read of a variable that's never
+// assigned is reported, but not one that may never run, e.g. in
+// the body of a loop or the rhs of an and, and not one that's
+// reached only after the variable may have been assigned. Run
+// from X-Execute with make definedtest, or make test.
+//
+
+// open_memstream() and fmemopen() are POSIX:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../interpreter.h"
+#include "../parser.h"
+#include "../programgraph.h"
+#include "../optimizer.h"
+#include "../tokenqueue.h"
+
+struct Expected
+{
+  char *what;
+  char *source;
+  int num_errors; // output by optimizer_report_undefined
+};
+
+static struct Expected expected[] = {
+    {"a read of a variable never assigned",
+     "print(y)\n", 1},
+    {"a read after the assignment",
+     "x = 1\n"
+     "print(x)\n", 0},
+    {"a read in a while loop that never runs",
+     "i = 0\n"
+     "while i > 0:\n"
+     "{\n"
+     "  print(y)\n"
+     "}\n", 0},
+    {"a read in the body of a for loop",
+     "for i in range(0):\n"
+     "{\n"
+     "  print(y)\n"
+     "}\n", 0},
+    {"a read in the rhs of an and",
+     "x = 0\n"
+     "while x > 1 and y > 0:\n"
+     "{\n"
+     "  x = x - 1\n"
+     "}\n", 0},
+    {"a read in the lhs of an and",
+     "x = 0\n"
+     "while y > 0 and x > 1:\n"
+     "{\n"
+     "  x = x - 1\n"
+     "}\n", 1},
+    {"a read after a loop that may assign",
+     "i = 0\n"
+     "while i < 3:\n"
+     "{\n"
+     "  y = i\n"
+     "  i = i + 1\n"
+     "}\n"
+     "print(y)\n", 0},
+};
+
+//
+// optimize
+//
+// Builds and optimizes the program graph of the given source, for
+// an interpreter outputting to the given stream. Returns NULL if
+// the source doesn't parse.
+//
+static struct STMT *optimize(struct Interpreter *interp, const char *source)
+{
+  FILE *input = fmemopen((void *)source, strlen(source), "r");
+
+  if (input == NULL)
+    return NULL;
+
+  struct TokenQueue *tokens = parser_parse(interp, input);
+
+  fclose(input);
+
+  struct STMT *program = (tokens == NULL) ? NULL : programgraph_build(interp, tokens);
+
+  if (tokens != NULL)
+    tokenqueue_destroy(tokens);
+
+  if (program != NULL)
+    optimizer_run(interp, program, true, false, NULL);
+
+  return program;
+}
+
+//
+// check_errors
+//
+// Are the expected # of reads reported as undefined?
+//
+static bool check_errors(struct Expected *expect)
+{
+  char *output = NULL;
+  size_t length = 0;
+  FILE *stream = open_memstream(&output, &length);
+  struct Interpreter *interp = (stream == NULL) ? NULL : interpreter_create(stdin, stream);
+  struct STMT *program = (interp == NULL) ? NULL : optimize(interp, expect->source);
+  int num_errors = (program == NULL) ? -1 : optimizer_report_undefined(interp, program);
+
+  bool reported = num_errors == expect->num_errors;
+
+  printf("%s: %s, %d error(s)\n", reported ? "ok" : "FAILED", expect->what, num_errors);
+
+  if (program != NULL)
+    programgraph_destroy(program);
+  if (interp != NULL)
+    interpreter_destroy(interp);
+  if (stream != NULL)
+  {
+    fclose(stream);
+
+    if (!reported)
+      printf("%s", output);
+  }
+
+  free(output);
+
+  return reported;
+}
+
+int main(void)
+{
+  int failed = 0;
+  int n = sizeof(expected) / sizeof(expected[0]);
+
+  for (int i = 0; i < n; i++)
+  {
+    if (!check_errors(&expected[i]))
+      failed++;
+  }
+
+  //
+  // x = 1, print(x): the read is proven to be assigned, so the
+  // executor needn't check it:
+  //
+  struct Interpreter *interp = interpreter_create(stdin, stdout);
+  struct STMT *program = (interp == NULL) ? NULL : optimize(interp, "x = 1\nprint(x)\n");
+
+  if (program == NULL)
+  {
+    printf("**ERROR: unable to build the program graph\n");
+    return 1;
+  }
+
+  struct STMT_FUNCTION_CALL *call = program->types.assignment->next_stmt->types.function_call;
+  bool defined = call->num_parameters == 1 && call->parameters[0]->defined == ELEMENT_DEFINED_ALWAYS;
+
+  printf("%s: x is always defined in print(x)\n", defined ? "ok" : "FAILED");
+
+  if (!defined)
+    failed++;
+
+  programgraph_destroy(program);
+  interpreter_destroy(interp);
+
+  return (failed > 0) ? 1 : 0;
+}
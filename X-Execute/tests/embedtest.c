@@ -0,0 +1,171 @@
+/*embedtest.c*/
+
+//
+// Checks that libnupy (see nupy.h) reports the errors of the
+// programs it runs, rather than aborting the program it's embedded
+// in: nupy_execute returns false and the error is sent to the
+// output callback. Run from X-Execute with make embedtest, or
+// make test.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h> // intptr_t
+#include <limits.h> // INT_MIN
+
+#include "../nupy.h"
+
+struct Expected
+{
+  char *source;
+  char *error; // sent to the output
+};
+
+static struct Expected expected[] = {
+    {"x = -1\n", "**SEMANTIC ERROR: unsupported unary operator (line 1)"},
+    {"a = 1\n"
+     "x = -a\n", "**SEMANTIC ERROR: unsupported unary operator (line 2)"},
+    {"x = input(5)\n", "**SEMANTIC ERROR: Invalid parameter for input() (line 1)"},
+    {"x = 1 / 0\n", "**EXECUTION ERROR: division by zero (line 1)"},
+    {"x = 'a' - 1\n", "**SEMANTIC ERROR: invalid operand types (line 1)"},
+    {"print(y)\n", "**SEMANTIC ERROR: name 'y' is not defined (line 1)"},
+};
+
+//
+// The output sent to output(), since the last check:
+//
+static char output_text[1024];
+static size_t output_length = 0;
+
+static void output(void *userdata, const char *text, size_t len)
+{
+  if (len > sizeof(output_text) - 1 - output_length)
+    len = sizeof(output_text) - 1 - output_length;
+
+  memcpy(output_text + output_length, text, len);
+  output_length += len;
+  output_text[output_length] = '\0';
+}
+
+//
+// constant
+//
+// A native returning its userdata, as an int.
+//
+static bool constant(void *userdata, struct RAM_VALUE *args, int num_args, struct RAM_VALUE *result)
+{
+  result->value_type = RAM_TYPE_INT;
+  result->types.i = (int)(intptr_t)userdata;
+
+  return true;
+}
+
+//
+// run
+//
+// Compiles and executes the given source in a new interpreter,
+// whose memory is left in *nupy. Returns true if it ran to
+// completion.
+//
+static bool run(struct NuPy **nupy, const char *source)
+{
+  output_length = 0;
+  output_text[0] = '\0';
+
+  *nupy = nupy_create(output, NULL, NULL);
+
+  struct NuPyProgram *program = (*nupy == NULL) ? NULL : nupy_compile(*nupy, source, strlen(source));
+  bool success = program != NULL && nupy_execute(*nupy, program, NULL);
+
+  nupy_program_destroy(program);
+
+  return success;
+}
+
+//
+// check_error
+//
+// Does the source fail with the expected error?
+//
+static bool check_error(struct Expected *expect)
+{
+  struct NuPy *nupy;
+  bool success = run(&nupy, expect->source);
+  bool reported = !success && strstr(output_text, expect->error) != NULL;
+
+  printf("%s: %s\n", reported ? "ok" : "FAILED", expect->error);
+
+  if (!reported)
+    printf("%s", output_text);
+
+  nupy_destroy(nupy);
+
+  return reported;
+}
+
+int main(void)
+{
+  int failed = 0;
+  int n = sizeof(expected) / sizeof(expected[0]);
+
+  for (int i = 0; i < n; i++)
+  {
+    if (!check_error(&expected[i]))
+      failed++;
+  }
+
+  //
+  // INT_MIN / -1 wraps around, and INT_MIN % -1 is 0:
+  //
+  struct NuPy *nupy;
+  int q = 0, r = 1;
+  bool wrapped = run(&nupy, "m = 0 - 2147483647 - 1\nd = 0 - 1\nq = m / d\nr = m % d\n") &&
+                 nupy_get_int(nupy_memory(nupy), "q", &q) && nupy_get_int(nupy_memory(nupy), "r", &r) &&
+                 q == INT_MIN && r == 0;
+
+  printf("%s: INT_MIN / -1 = INT_MIN, INT_MIN %% -1 = 0\n", wrapped ? "ok" : "FAILED");
+
+  if (!wrapped)
+    failed++;
+
+  nupy_destroy(nupy);
+
+  //
+  // a program compiled before the natives it calls are
+  // registered, and run by two interpreters in which f() is a
+  // different native, with a different ID: the call is resolved
+  // by each, and the program left unchanged:
+  //
+  const char *source = "x = f()\nprint(x)\n";
+  struct NuPy *a = nupy_create(output, NULL, NULL);
+  struct NuPy *b = nupy_create(output, NULL, NULL);
+  struct NuPyProgram *program = nupy_compile(a, source, strlen(source));
+  int type = BUILTIN_TYPE(RAM_TYPE_INT);
+
+  nupy_register(a, "g", 0, type, type, constant, (void *)7);
+  nupy_register(a, "f", 0, type, type, constant, (void *)1);
+  nupy_register(b, "f", 0, type, type, constant, (void *)2);
+
+  int x_a = 0, x_b = 0, x_again = 0;
+
+  output_length = 0;
+  bool shared = program != NULL && nupy_execute(a, program, NULL) && nupy_get_int(nupy_memory(a), "x", &x_a) &&
+                nupy_execute(b, program, NULL) && nupy_get_int(nupy_memory(b), "x", &x_b) &&
+                nupy_execute(a, program, NULL) && nupy_get_int(nupy_memory(a), "x", &x_again) &&
+                x_a == 1 && x_b == 2 && x_again == 1 && strcmp(output_text, "1\n2\n1\n") == 0;
+
+  printf("%s: a program shared by two interpreters calls the natives of each\n", shared ? "ok" : "FAILED");
+
+  if (!shared)
+  {
+    printf("%s", output_text);
+    failed++;
+  }
+
+  nupy_program_destroy(program);
+  nupy_destroy(a);
+  nupy_destroy(b);
+
+  return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#
+# int, real and bool arithmetic and comparisons in hot loops
+#
+i = 0
+s = 0
+t = 0.5
+p = 1
+while i < 5000:
+{
+  s = s + i * 3 - i % 7
+  t = t * 1.0001 + i / 4
+  p = (p * 31 + i) % 1000003
+  i = i + 1
+}
+print(s)
+print(t)
+print(p)
+
+n = 0
+b = False
+while n < 3000 and not b:
+{
+  n = n + 2
+  b = n * n > 4000000
+}
+print(n)
+print(b)
+
+q = 100000
+c = 0
+while q > 1:
+{
+  q = q / 2
+  c = c + 1
+}
+print(q)
+print(c)
+
+r = 2.0
+k = 0
+while k < 2000:
+{
+  r = r - 0.001
+  k = k + 1
+}
+print(r)
+z = r < 0.5
+print(z)
+k2 = k ** 2
+print(k2)
@@ -0,0 +1,52 @@
+#
+# functions, lists, dicts and strings, around hot loops
+#
+def square(n):
+{
+  return n * n
+}
+
+def sum_to(n):
+{
+  s = 0
+  i = 0
+  while i < n:
+  {
+    v = square(i)
+    s = s + v
+    i = i + 1
+  }
+  return s
+}
+
+a = sum_to(1000)
+print(a)
+
+L = []
+for j in range(1500):
+{
+  e = j % 13
+  L.append(e)
+}
+n = len(L)
+print(n)
+e = L[1000]
+print(e)
+
+D = {'a': 1, 'b': 2}
+D['c'] = L[7] + D['b']
+c = D['c']
+print(c)
+
+w = 'ab'
+k = 0
+while k < 10:
+{
+  w = w + 'c'
+  k = k + 1
+}
+print(w)
+f = 'ccc' in w
+print(f)
+u = w[2:5]
+print(u)
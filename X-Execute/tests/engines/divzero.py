@@ -0,0 +1,14 @@
+#
+# division by zero once the loop is compiled: the error, and the
+# output before it, must be the same
+#
+i = 0
+d = 2000
+s = 0
+while i < 3000:
+{
+  s = s + 100000 / d
+  d = d - 1
+  i = i + 1
+}
+print(s)
@@ -0,0 +1,18 @@
+#
+# INT_MIN / -1 and INT_MIN % -1 in a hot loop, which wrap around
+# and give 0
+#
+m = 0 - 2147483647 - 1
+i = 0
+q = 0
+r = 1
+d = 1
+while i < 3000:
+{
+  d = 0 - 1
+  q = m / d
+  r = m % d
+  i = i + 1
+}
+print(q)
+print(r)
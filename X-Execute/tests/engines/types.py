@@ -0,0 +1,17 @@
+#
+# the same loop, hot, run with an int and then with a real: code
+# compiled for the one must not run for the other
+#
+v = 1
+for t in range(3):
+{
+  i = 0
+  while i < 2000:
+  {
+    v = (v * 7 + i) % 1009
+    i = i + 1
+  }
+  print(v)
+  v = v * 0.5
+}
+print(v)
@@ -0,0 +1,33 @@
+#!/bin/bash
+#
+# Checks that each program in tests/engines and bench outputs the
+# same, and leaves the same in memory, run as closures (--closures),
+# with hot loops compiled to machine code (--jit) and compiled ahead
+# of time (--aot) as it does with the interpreter, errors included.
+# Run from X-Execute with make enginetest, or make test.
+#
+cache=$(mktemp -d)
+export NUPY_CACHE_DIR="$cache"
+failed=0
+
+for program in tests/engines/*.py bench/*.py
+do
+  expected=$(./a.out "$program" 2>&1 | sed -n '/^\*\*executing/,$p')
+
+  for mode in --closures --jit --aot
+  do
+    actual=$(./a.out $mode "$program" 2>&1 | sed -n '/^\*\*executing/,$p')
+
+    if [ "$actual" == "$expected" ]
+    then
+      echo "ok: $program $mode"
+    else
+      echo "FAILED: $program $mode"
+      diff <(echo "$expected") <(echo "$actual")
+      failed=1
+    fi
+  done
+done
+
+rm -rf "$cache"
+exit $failed
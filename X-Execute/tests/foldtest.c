@@ -0,0 +1,127 @@
+/*foldtest.c*/
+
+//
+// Checks that optimizer_run folds and simplifies expressions of
+// more than one operator, whose steps (see VALUE_EXPR) fold one
+// into the next, e.g. 60 * 60 * 24 to 86400 and x * 1 * 1 to x.
+// Run from X-Execute with make foldtest, or make test.
+//
+
+// fmemopen() is POSIX:
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../interpreter.h"
+#include "../parser.h"
+#include "../programgraph.h"
+#include "../optimizer.h"
+#include "../tokenqueue.h"
+
+static const char *source =
+    "x = 7\n"
+    "y = 60 * 60 * 24\n"
+    "z = (1 + 2) * 3\n"
+    "a = x * 1 * 1\n"
+    "b = x + 0 + 0\n"
+    "c = 2 ** 3 ** 2\n"
+    "d = x + (2 * 3)\n";
+
+struct Expected
+{
+  char *var_name;
+  int element_type; // of the single element the rhs is folded to
+  char *element_value;
+};
+
+static struct Expected expected[] = {
+    {"x", ELEMENT_INT_LITERAL, "7"},
+    {"y", ELEMENT_INT_LITERAL, "86400"},
+    {"z", ELEMENT_INT_LITERAL, "9"},
+    {"a", ELEMENT_IDENTIFIER, "x"},
+    {"b", ELEMENT_IDENTIFIER, "x"},
+    {"c", ELEMENT_INT_LITERAL, "512"},
+};
+
+//
+// check_folded
+//
+// Is the assignment's rhs just the expected element, with no
+// steps left?
+//
+static bool check_folded(struct STMT *stmt, struct Expected *expect)
+{
+  struct STMT_ASSIGNMENT *assignment = stmt->types.assignment;
+  struct VALUE_EXPR *expr = assignment->rhs->types.expr;
+
+  bool folded = strcmp(assignment->var_name, expect->var_name) == 0 && !expr->isBinaryExpr &&
+                expr->num_steps == 0 && expr->lhs->expr_type == UNARY_ELEMENT &&
+                expr->lhs->element->element_type == expect->element_type &&
+                strcmp(expr->lhs->element->element_value, expect->element_value) == 0;
+
+  printf("%s: %s = %s\n", folded ? "ok" : "FAILED", expect->var_name, expect->element_value);
+
+  return folded;
+}
+
+int main(void)
+{
+  struct Interpreter *interp = interpreter_create(stdin, stdout);
+  FILE *input = fmemopen((void *)source, strlen(source), "r");
+
+  if (interp == NULL || input == NULL)
+  {
+    printf("**ERROR: unable to create the interpreter\n");
+    return 1;
+  }
+
+  struct TokenQueue *tokens = parser_parse(interp, input);
+
+  fclose(input);
+
+  struct STMT *program = (tokens == NULL) ? NULL : programgraph_build(interp, tokens);
+
+  if (tokens != NULL)
+    tokenqueue_destroy(tokens);
+
+  if (program == NULL)
+  {
+    printf("**ERROR: unable to build the program graph\n");
+    interpreter_destroy(interp);
+    return 1;
+  }
+
+  optimizer_run(interp, program, true, false, NULL);
+
+  int failed = 0;
+  int n = sizeof(expected) / sizeof(expected[0]);
+  struct STMT *stmt = program;
+
+  for (int i = 0; i < n; i++)
+  {
+    if (!check_folded(stmt, &expected[i]))
+      failed++;
+
+    stmt = stmt->types.assignment->next_stmt;
+  }
+
+  //
+  // x + 6: the lhs, read before the nested rhs, is put back once
+  // the rhs is folded:
+  //
+  struct VALUE_EXPR *expr = stmt->types.assignment->rhs->types.expr;
+  bool inlined = expr->isBinaryExpr && expr->num_steps == 0 && expr->lhs->expr_type == UNARY_ELEMENT &&
+                 expr->rhs->expr_type == UNARY_ELEMENT && strcmp(expr->rhs->element->element_value, "6") == 0;
+
+  printf("%s: d = x + 6\n", inlined ? "ok" : "FAILED");
+
+  if (!inlined)
+    failed++;
+
+  programgraph_destroy(program);
+  interpreter_destroy(interp);
+
+  return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,383 @@
+/*threadpool.c*/
+
+//
+// Work-stealing thread pool. Each worker thread has its own queue of
+// tasks; a worker takes tasks from the back of its own queue, and when
+// that is empty, steals from the front of another worker's queue. This
+// keeps all the workers busy even when tasks take very different
+// amounts of time to run.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+#include <assert.h>
+#include <pthread.h>
+
+#include "threadpool.h"
+
+//
+// what each worker thread is given when it starts:
+//
+struct WorkerArgs
+{
+  struct ThreadPool *pool;
+  int id; // index of this worker's own queue
+};
+
+//
+// Private functions:
+//
+
+//
+// queue_push_back
+//
+// Adds the task to the back of the queue, growing the
+// array if needed. Returns false if out of memory.
+//
+static bool queue_push_back(struct WorkQueue *queue, struct Task task)
+{
+  pthread_mutex_lock(&queue->lock);
+
+  if (queue->size == queue->capacity)
+  {
+    //
+    // full, double the capacity and unwrap the circular array
+    // so the tasks start at index 0:
+    //
+    int capacity = (queue->capacity == 0) ? 8 : queue->capacity * 2;
+    struct Task *tasks = (struct Task *)malloc(sizeof(struct Task) * capacity);
+    if (tasks == NULL)
+    {
+      pthread_mutex_unlock(&queue->lock);
+      return false;
+    }
+
+    for (int i = 0; i < queue->size; i++)
+    {
+      tasks[i] = queue->tasks[(queue->front + i) % queue->capacity];
+    }
+
+    free(queue->tasks);
+    queue->tasks = tasks;
+    queue->front = 0;
+    queue->capacity = capacity;
+  }
+
+  queue->tasks[(queue->front + queue->size) % queue->capacity] = task;
+  queue->size++;
+
+  pthread_mutex_unlock(&queue->lock);
+  return true;
+}
+
+//
+// queue_pop_back
+//
+// The owning worker takes its most recently added task (LIFO),
+// which is the one most likely to still be in cache. Returns
+// false if the queue is empty.
+//
+static bool queue_pop_back(struct WorkQueue *queue, struct Task *task)
+{
+  bool found = false;
+
+  pthread_mutex_lock(&queue->lock);
+
+  if (queue->size > 0)
+  {
+    queue->size--;
+    *task = queue->tasks[(queue->front + queue->size) % queue->capacity];
+    found = true;
+  }
+
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+//
+// queue_steal_front
+//
+// Another worker takes the oldest task (FIFO), which keeps
+// thieves away from the end the owner is working on. Returns
+// false if the queue is empty.
+//
+static bool queue_steal_front(struct WorkQueue *queue, struct Task *task)
+{
+  bool found = false;
+
+  pthread_mutex_lock(&queue->lock);
+
+  if (queue->size > 0)
+  {
+    *task = queue->tasks[queue->front];
+    queue->front = (queue->front + 1) % queue->capacity;
+    queue->size--;
+    found = true;
+  }
+
+  pthread_mutex_unlock(&queue->lock);
+  return found;
+}
+
+//
+// take_task
+//
+// Tries the worker's own queue first, then the other queues
+// in turn, starting with the next worker over. Returns false
+// if every queue is empty.
+//
+static bool take_task(struct ThreadPool *pool, int id, struct Task *task)
+{
+  if (queue_pop_back(&pool->queues[id], task))
+    return true;
+
+  for (int i = 1; i < pool->num_workers; i++)
+  {
+    int victim = (id + i) % pool->num_workers;
+
+    if (queue_steal_front(&pool->queues[victim], task))
+      return true;
+  }
+
+  return false;
+}
+
+//
+// worker
+//
+// Main loop of each worker thread: sleep until tasks are
+// queued, take one (stealing if necessary) and run it, until
+// the pool is shut down and there is nothing left to do.
+//
+static void *worker(void *arg)
+{
+  struct WorkerArgs *args = (struct WorkerArgs *)arg;
+  struct ThreadPool *pool = args->pool;
+  int id = args->id;
+
+  free(args);
+
+  while (true)
+  {
+    pthread_mutex_lock(&pool->lock);
+
+    while (pool->num_queued == 0 && !pool->shutdown)
+    {
+      pthread_cond_wait(&pool->wakeup, &pool->lock);
+    }
+
+    if (pool->num_queued == 0) // shutdown, and no work left:
+    {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    //
+    // there is work somewhere, but another worker may beat us
+    // to it, in which case we just go back to sleep:
+    //
+    struct Task task;
+
+    if (!take_task(pool, id, &task))
+      continue;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->num_queued--;
+    pthread_mutex_unlock(&pool->lock);
+
+    task.function(task.arg);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->num_pending--;
+    if (pool->num_pending == 0)
+      pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+//
+// Public functions:
+//
+
+//
+// threadpool_create
+//
+// Returns a pointer to a dynamically-allocated pool of
+// num_workers threads, which are started immediately.
+// Returns NULL if the pool could not be created.
+//
+struct ThreadPool *threadpool_create(int num_workers)
+{
+  assert(num_workers > 0);
+
+  struct ThreadPool *pool = (struct ThreadPool *)malloc(sizeof(struct ThreadPool));
+  if (pool == NULL)
+    return NULL;
+
+  pool->num_workers = num_workers;
+  pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * num_workers);
+  pool->queues = (struct WorkQueue *)malloc(sizeof(struct WorkQueue) * num_workers);
+
+  if (pool->threads == NULL || pool->queues == NULL)
+  {
+    free(pool->threads);
+    free(pool->queues);
+    free(pool);
+    return NULL;
+  }
+
+  for (int i = 0; i < num_workers; i++)
+  {
+    pthread_mutex_init(&pool->queues[i].lock, NULL);
+    pool->queues[i].tasks = NULL;
+    pool->queues[i].front = 0;
+    pool->queues[i].size = 0;
+    pool->queues[i].capacity = 0;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wakeup, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  pool->num_queued = 0;
+  pool->num_pending = 0;
+  pool->next_queue = 0;
+  pool->shutdown = false;
+
+  //
+  // now start the workers; if we can't start them all, run
+  // with the ones we have:
+  //
+  int started = 0;
+
+  for (int i = 0; i < num_workers; i++)
+  {
+    struct WorkerArgs *args = (struct WorkerArgs *)malloc(sizeof(struct WorkerArgs));
+    if (args == NULL)
+      break;
+
+    args->pool = pool;
+    args->id = started;
+
+    if (pthread_create(&pool->threads[started], NULL, worker, args) != 0)
+    {
+      free(args);
+      break;
+    }
+
+    started++;
+  }
+
+  if (started == 0)
+  {
+    pool->num_workers = 0;
+    threadpool_destroy(pool);
+    return NULL;
+  }
+
+  pool->num_workers = started;
+
+  return pool;
+}
+
+//
+// threadpool_submit
+//
+// Adds a task to the pool; some worker thread will
+// eventually call function(arg). Tasks are spread over
+// the worker queues round-robin, and rebalanced by
+// stealing. Returns false if out of memory.
+//
+bool threadpool_submit(struct ThreadPool *pool, TaskFunction function, void *arg)
+{
+  assert(pool != NULL);
+  assert(function != NULL);
+
+  struct Task task;
+  task.function = function;
+  task.arg = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  int id = pool->next_queue;
+  pool->next_queue = (pool->next_queue + 1) % pool->num_workers;
+  pool->num_pending++;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (!queue_push_back(&pool->queues[id], task))
+  {
+    pthread_mutex_lock(&pool->lock);
+    pool->num_pending--;
+    if (pool->num_pending == 0)
+      pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->lock);
+    return false;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->num_queued++;
+  pthread_cond_signal(&pool->wakeup);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+//
+// threadpool_wait
+//
+// Blocks until every task submitted so far has finished.
+//
+void threadpool_wait(struct ThreadPool *pool)
+{
+  assert(pool != NULL);
+
+  pthread_mutex_lock(&pool->lock);
+
+  while (pool->num_pending > 0)
+  {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+//
+// threadpool_destroy
+//
+// Waits for all submitted tasks to finish, stops the
+// worker threads, and frees the pool.
+//
+void threadpool_destroy(struct ThreadPool *pool)
+{
+  if (pool == NULL)
+    return;
+
+  threadpool_wait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->wakeup);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->num_workers; i++)
+  {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  for (int i = 0; i < pool->num_workers; i++)
+  {
+    free(pool->queues[i].tasks);
+    pthread_mutex_destroy(&pool->queues[i].lock);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wakeup);
+  pthread_cond_destroy(&pool->idle);
+
+  free(pool->threads);
+  free(pool->queues);
+  free(pool);
+}
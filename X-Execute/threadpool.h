@@ -0,0 +1,87 @@
+/*threadpool.h*/
+
+//
+// Work-stealing thread pool. Each worker thread has its own queue of
+// tasks; a worker takes tasks from the back of its own queue, and when
+// that is empty, steals from the front of another worker's queue. This
+// keeps all the workers busy even when tasks take very different
+// amounts of time to run.
+//
+
+#pragma once
+
+#include <stdbool.h> // true, false
+#include <pthread.h>
+
+//
+// a task is a function to call, and the argument to pass it:
+//
+typedef void (*TaskFunction)(void *arg);
+
+struct Task
+{
+  TaskFunction function;
+  void *arg;
+};
+
+struct WorkQueue
+{
+  pthread_mutex_t lock;
+  struct Task *tasks; // circular array of tasks
+  int front;          // index of the oldest task (stolen first)
+  int size;           // # of tasks currently in the queue
+  int capacity;       // total # of tasks the array can hold
+};
+
+struct ThreadPool
+{
+  int num_workers;
+  pthread_t *threads;
+  struct WorkQueue *queues; // one per worker
+
+  pthread_mutex_t lock;  // protects the fields below
+  pthread_cond_t wakeup; // signaled when tasks are added or on shutdown
+  pthread_cond_t idle;   // signaled when the last pending task finishes
+  int num_queued;        // # of tasks waiting in the queues
+  int num_pending;       // # of tasks submitted but not yet finished
+  int next_queue;        // round-robin index for threadpool_submit
+  bool shutdown;
+};
+
+//
+// Public functions:
+//
+
+//
+// threadpool_create
+//
+// Returns a pointer to a dynamically-allocated pool of
+// num_workers threads, which are started immediately.
+// Returns NULL if the pool could not be created.
+//
+struct ThreadPool *threadpool_create(int num_workers);
+
+//
+// threadpool_submit
+//
+// Adds a task to the pool; some worker thread will
+// eventually call function(arg). Tasks are spread over
+// the worker queues round-robin, and rebalanced by
+// stealing. Returns false if out of memory.
+//
+bool threadpool_submit(struct ThreadPool *pool, TaskFunction function, void *arg);
+
+//
+// threadpool_wait
+//
+// Blocks until every task submitted so far has finished.
+//
+void threadpool_wait(struct ThreadPool *pool);
+
+//
+// threadpool_destroy
+//
+// Waits for all submitted tasks to finish, stops the
+// worker threads, and frees the pool.
+//
+void threadpool_destroy(struct ThreadPool *pool);
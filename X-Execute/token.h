@@ -74,5 +74,11 @@ enum TokenID
   nuPy_KEYW_PASS,     // pass
   nuPy_KEYW_RETURN,   // return
   nuPy_KEYW_TRUE,     // True
-  nuPy_KEYW_WHILE     // while
+  nuPy_KEYW_WHILE,    // while
+  //
+  // punctuation for lists, after the keywords so the ids
+  // above don't change:
+  //
+  nuPy_COMMA,         // ,
+  nuPy_DOT            // . e.g. in x.append(1)
 };
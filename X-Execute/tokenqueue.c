@@ -0,0 +1,241 @@
+/*tokenqueue.c*/
+
+//
+// Token Queue for nuPython
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h> // true, false
+
+#include "tokenqueue.h"
+#include "util.h"
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**TOKENQUEUE ERROR\n");
+  printf("**TOKENQUEUE ERROR: %s\n", msg);
+  printf("**TOKENQUEUE ERROR\n");
+
+  exit(-123);
+}
+
+//
+// tokenqueue_create
+//
+// Returns a pointer to a new, empty queue of tokens.
+//
+struct TokenQueue *tokenqueue_create(void)
+{
+  struct TokenQueue *tokens = (struct TokenQueue *)malloc(sizeof(struct TokenQueue));
+  if (tokens == NULL)
+    panic("out of memory (tokenqueue_create)");
+
+  tokens->head = NULL;
+  tokens->tail = NULL;
+
+  return tokens;
+}
+
+//
+// tokenqueue_destroy
+//
+// Frees the queue, and all the tokens and values in it.
+//
+void tokenqueue_destroy(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_destroy)");
+
+  struct TokenNode *cur = tokens->head;
+
+  while (cur != NULL)
+  {
+    struct TokenNode *next = cur->next;
+
+    free(cur->value);
+    free(cur);
+
+    cur = next;
+  }
+
+  free(tokens);
+}
+
+//
+// tokenqueue_enqueue
+//
+// Adds the token to the end of the queue; the value is
+// duplicated, so the caller keeps ownership of theirs.
+//
+void tokenqueue_enqueue(struct TokenQueue *tokens, struct Token token, char *value)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_enqueue)");
+
+  struct TokenNode *node = (struct TokenNode *)malloc(sizeof(struct TokenNode));
+  if (node == NULL)
+    panic("out of memory (tokenqueue_enqueue)");
+
+  node->token = token;
+  node->value = dupString(value);
+  node->next = NULL;
+
+  if (tokens->tail == NULL) // empty:
+  {
+    tokens->head = node;
+    tokens->tail = node;
+  }
+  else
+  {
+    tokens->tail->next = node;
+    tokens->tail = node;
+  }
+}
+
+//
+// tokenqueue_dequeue
+//
+// Removes the token at the front of the queue.
+//
+void tokenqueue_dequeue(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_dequeue)");
+  if (tokens->head == NULL)
+    panic("token queue is empty (tokenqueue_dequeue)");
+
+  struct TokenNode *node = tokens->head;
+
+  tokens->head = node->next;
+  if (tokens->head == NULL)
+    tokens->tail = NULL;
+
+  free(node->value);
+  free(node);
+}
+
+//
+// tokenqueue_empty
+//
+// Returns true if the queue is empty, false if not.
+//
+bool tokenqueue_empty(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_empty)");
+
+  return tokens->head == NULL;
+}
+
+//
+// tokenqueue_peekToken
+//
+// Returns the token at the front of the queue.
+//
+struct Token tokenqueue_peekToken(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_peekToken)");
+  if (tokens->head == NULL)
+    panic("token queue is empty (tokenqueue_peekToken)");
+
+  return tokens->head->token;
+}
+
+//
+// tokenqueue_peekValue
+//
+// Returns the value of the token at the front of the queue;
+// the value is still owned by the queue.
+//
+char *tokenqueue_peekValue(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_peekValue)");
+  if (tokens->head == NULL)
+    panic("token queue is empty (tokenqueue_peekValue)");
+
+  return tokens->head->value;
+}
+
+//
+// tokenqueue_peek2Token
+//
+// Returns the 2nd token in the queue.
+//
+struct Token tokenqueue_peek2Token(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_peek2Token)");
+  if (tokens->head == NULL)
+    panic("token queue is empty (tokenqueue_peek2Token)");
+  if (tokens->head->next == NULL)
+    panic("cannot look two tokens ahead! (tokenqueue_peek2Token)");
+
+  return tokens->head->next->token;
+}
+
+//
+// tokenqueue_peek2Value
+//
+// Returns the value of the 2nd token in the queue; the
+// value is still owned by the queue.
+//
+char *tokenqueue_peek2Value(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_peek2Value)");
+  if (tokens->head == NULL)
+    panic("token queue is empty (tokenqueue_peek2Value)");
+  if (tokens->head->next == NULL)
+    panic("cannot look two tokens ahead! (tokenqueue_peek2Value)");
+
+  return tokens->head->next->value;
+}
+
+//
+// tokenqueue_print
+//
+// Prints the tokens in the queue to the console, for debugging.
+//
+void tokenqueue_print(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_print)");
+
+  printf("**TokenQueue Print**\n");
+
+  for (struct TokenNode *cur = tokens->head; cur != NULL; cur = cur->next)
+  {
+    printf("%d@(%d,%d): '%s'\n", cur->token.id, cur->token.line, cur->token.col, cur->value);
+  }
+
+  printf("**TokenQueue Print Done**\n");
+}
+
+//
+// tokenqueue_duplicate
+//
+// Returns a copy of the queue: same tokens, same values.
+//
+struct TokenQueue *tokenqueue_duplicate(struct TokenQueue *tokens)
+{
+  if (tokens == NULL)
+    panic("tokens param is NULL (tokenqueue_duplicate)");
+
+  struct TokenQueue *copy = tokenqueue_create();
+
+  for (struct TokenNode *cur = tokens->head; cur != NULL; cur = cur->next)
+  {
+    tokenqueue_enqueue(copy, cur->token, cur->value);
+  }
+
+  return copy;
+}
@@ -0,0 +1,156 @@
+/*util.c*/
+
+//
+// Utility functions for nuPython
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // strlen, memcpy, strcspn
+#include <ctype.h>  // tolower
+
+#include "util.h"
+
+//
+// panic
+//
+// Outputs the given error message and exits the program;
+// these are errors we cannot recover from, e.g. out of memory.
+//
+static void panic(char *msg)
+{
+  printf("**UTIL ERROR\n");
+  printf("**UTIL ERROR: %s\n", msg);
+  printf("**UTIL ERROR\n");
+
+  exit(-123);
+}
+
+//
+// dupString
+//
+// Duplicates the given string and returns a pointer
+// to the copy.
+//
+// NOTE: this function allocates memory for the copy,
+// the caller takes ownership of the copy and must
+// eventually free that memory.
+//
+char *dupString(char *s)
+{
+  if (s == NULL)
+    panic("s is NULL (dupString)");
+
+  size_t N = strlen(s) + 1; // include null terminator
+
+  char *copy = (char *)malloc(N);
+  if (copy == NULL)
+    panic("out of memory (dupString)");
+
+  memcpy(copy, s, N);
+
+  return copy;
+}
+
+//
+// dupStrings
+//
+// Given 2 strings, makes a copy by concatenating
+// them together, and returns the copy.
+//
+// NOTE: this function allocates memory for the copy,
+// the caller takes ownership of the copy and must
+// eventually free that memory.
+//
+char *dupStrings(char *s1, char *s2)
+{
+  if (s1 == NULL)
+    panic("s1 is NULL (dupStrings)");
+  if (s2 == NULL)
+    panic("s2 is NULL (dupStrings)");
+
+  size_t N1 = strlen(s1);
+  size_t N2 = strlen(s2);
+
+  char *copy = (char *)malloc(N1 + N2 + 1);
+  if (copy == NULL)
+    panic("out of memory (dupStrings)");
+
+  memcpy(copy, s1, N1);
+  memcpy(copy + N1, s2, N2 + 1); // include null terminator
+
+  return copy;
+}
+
+//
+// dupAndStripEOLN
+//
+// Duplicates the given string and returns a pointer
+// to the copy; any EOLN characters (\n, \r, etc.)
+// are also removed.
+//
+// NOTE: this function allocates memory for the copy,
+// the caller takes ownership of the copy and must
+// eventually free that memory.
+//
+char *dupAndStripEOLN(char *s)
+{
+  if (s == NULL)
+    panic("s is NULL (dupAndStripEOLN)");
+
+  size_t N = strlen(s) + 1;
+
+  char *copy = (char *)malloc(N);
+  if (copy == NULL)
+    panic("out of memory (dupAndStripEOLN)");
+
+  memcpy(copy, s, N);
+
+  copy[strcspn(copy, "\r\n")] = '\0'; // truncate at first EOLN char
+
+  return copy;
+}
+
+//
+// icmpStrings
+//
+// case-insensitive comparison of strings s1 and s2.
+// Like strcmp, returns 0 if s1 == s2 and returns a
+// non-zero value if s1 != s2.
+//
+// Example: icmpStrings("apple", "APPLE") returns 0
+//
+int icmpStrings(char *s1, char *s2)
+{
+  if (s1 == NULL)
+    panic("s1 is NULL (icmpStrings)");
+  if (s2 == NULL)
+    panic("s2 is NULL (icmpStrings)");
+
+  while (*s1 != '\0' && tolower((unsigned char)*s1) == tolower((unsigned char)*s2))
+  {
+    s1++;
+    s2++;
+  }
+
+  return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
+}
+
+//
+// hashBytes
+//
+// Returns the 64-bit FNV-1a hash of the given bytes, continuing
+// from the given hash (HASH_START for the first piece).
+//
+unsigned long long hashBytes(unsigned long long hash, const void *bytes, size_t length)
+{
+  const unsigned char *p = (const unsigned char *)bytes;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stddef.h> // size_t
 
 //
 // dupString
@@ -54,3 +55,14 @@ char* dupAndStripEOLN(char* s);
 // Example: icmpStrings("apple", "APPLE") returns 0
 //
 int icmpStrings(char* s1, char* s2);
+
+//
+// hashBytes
+//
+// Returns the 64-bit FNV-1a hash of the given bytes. To hash
+// data in pieces, pass HASH_START for the first piece and the
+// previous result for each piece after that.
+//
+#define HASH_START 14695981039346656037ULL
+
+unsigned long long hashBytes(unsigned long long hash, const void* bytes, size_t length);